@@ -18,5 +18,7 @@ enum {
 
 /* for pltgot relocation */
 #define ARCH_JUMP_SLOT R_AARCH64_JUMP_SLOT
+/* relocations counted by DT_RELACOUNT */
+#define ARCH_RELATIVE R_AARCH64_RELATIVE
 
 #endif /* ARCH_ELF_HH */
@@ -7,19 +7,17 @@
 
 #include "safe-ptr.hh"
 #include <osv/debug.h>
+#include "exceptions.hh"
 
 struct frame {
     frame* next;
     void* pc;
 };
 
-int backtrace_safe(void** pc, int nr)
+static int walk_frames(frame* fp, void** pc, int nr)
 {
-    frame* fp;
     frame* next;
 
-    asm ("mov %0, x29" : "=r"(fp));
-
     int i = 0;
     while (i < nr
            && fp
@@ -31,3 +29,22 @@ int backtrace_safe(void** pc, int nr)
 
     return i;
 }
+
+int backtrace_safe(void** pc, int nr)
+{
+    frame* fp;
+
+    asm ("mov %0, x29" : "=r"(fp));
+
+    return walk_frames(fp, pc, nr);
+}
+
+int backtrace_safe_interrupted(void** pc, int nr)
+{
+    auto ef = current_interrupt_frame;
+    if (!ef || nr == 0) {
+        return 0;
+    }
+    pc[0] = ef->get_pc();
+    return 1 + walk_frames(reinterpret_cast<frame*>(ef->regs[29]), pc + 1, nr - 1);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// There are no SIMD variants of the ZFS checksums on aarch64 yet, so only
+// the portable implementations are listed.
+
+#include <osv/checksum.hh>
+#include <bsd/sys/crypto/sha2/sha2.h>
+
+// Same layout as zio_cksum_t (sys/spa.h)
+struct zio_cksum {
+    uint64_t zc_word[4];
+};
+
+extern "C" void fletcher_4_native(const void *buf, uint64_t size, zio_cksum *zcp);
+extern "C" void fletcher_4_byteswap(const void *buf, uint64_t size, zio_cksum *zcp);
+
+namespace osv {
+namespace checksum {
+
+template <void (*Fn)(const void*, uint64_t, zio_cksum*)>
+static void fletcher_4_variant(const void *buf, uint64_t size, uint64_t cksum[4])
+{
+    Fn(buf, size, reinterpret_cast<zio_cksum*>(cksum));
+}
+
+std::vector<variant<fletcher_4_fn>> fletcher_4_native_variants()
+{
+    return {{"scalar", fletcher_4_variant<fletcher_4_native>}};
+}
+
+std::vector<variant<fletcher_4_fn>> fletcher_4_byteswap_variants()
+{
+    return {{"scalar", fletcher_4_variant<fletcher_4_byteswap>}};
+}
+
+std::vector<variant<sha256_blocks_fn>> sha256_variants()
+{
+    return {{"generic", SHA256_Transform_generic}};
+}
+
+}
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// The ARMv8 PMU is not supported yet: no counters
+
+#include <osv/pmu.hh>
+
+namespace pmu {
+
+unsigned counters()
+{
+    return 0;
+}
+
+bool supported(event e)
+{
+    return false;
+}
+
+bool overflow_supported()
+{
+    return false;
+}
+
+void start(unsigned counter, event e, bool overflow_interrupt)
+{
+}
+
+void stop(unsigned counter)
+{
+}
+
+u64 read(unsigned counter)
+{
+    return 0;
+}
+
+void write(unsigned counter, u64 value)
+{
+}
+
+u64 mask()
+{
+    return 0;
+}
+
+void set_overflow_handler(std::function<void (unsigned counter)> handler)
+{
+}
+
+}
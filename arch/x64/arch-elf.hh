@@ -36,5 +36,7 @@ enum {
 
 /* for pltgot relocation */
 #define ARCH_JUMP_SLOT R_X86_64_JUMP_SLOT
+/* relocations counted by DT_RELACOUNT */
+#define ARCH_RELATIVE R_X86_64_RELATIVE
 
 #endif /* ARCH_ELF_HH */
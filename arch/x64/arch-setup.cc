@@ -356,18 +356,19 @@ void arch_init_drivers()
     // Register any parsed virtio-mmio devices
     virtio::register_mmio_devices(device_manager::instance());
 
-    // Initialize all drivers
+    // Initialize all drivers. The disk drivers all name their disks vblkN,
+    // and the network drivers ethN, so each kind is probed in one group.
     hw::driver_manager* drvman = hw::driver_manager::instance();
-    drvman->register_driver(virtio::blk::probe);
-    drvman->register_driver(virtio::scsi::probe);
-    drvman->register_driver(virtio::net::probe);
-    drvman->register_driver(virtio::rng::probe);
-    drvman->register_driver(virtio::fs::probe);
-    drvman->register_driver(xenfront::xenplatform_pci::probe);
-    drvman->register_driver(ahci::hba::probe);
-    drvman->register_driver(vmw::pvscsi::probe);
-    drvman->register_driver(vmw::vmxnet3::probe);
-    drvman->register_driver(ide::ide_drive::probe);
+    drvman->register_driver(virtio::blk::probe, "block");
+    drvman->register_driver(virtio::scsi::probe, "block");
+    drvman->register_driver(virtio::net::probe, "net");
+    drvman->register_driver(virtio::rng::probe, "rng");
+    drvman->register_driver(virtio::fs::probe, "block");
+    drvman->register_driver(xenfront::xenplatform_pci::probe, "xen");
+    drvman->register_driver(ahci::hba::probe, "block");
+    drvman->register_driver(vmw::pvscsi::probe, "block");
+    drvman->register_driver(vmw::vmxnet3::probe, "net");
+    drvman->register_driver(ide::ide_drive::probe, "block");
     boot_time.event("drivers probe");
     drvman->load_all();
     drvman->list_drivers();
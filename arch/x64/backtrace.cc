@@ -6,6 +6,7 @@
  */
 
 #include "safe-ptr.hh"
+#include "exceptions.hh"
 
 #include <osv/execinfo.hh>
 
@@ -14,12 +15,10 @@ struct frame {
     void* pc;
 };
 
-int backtrace_safe(void** pc, int nr)
+static int walk_frames(frame* rbp, void** pc, int nr)
 {
-    frame* rbp;
     frame* next;
 
-    asm("mov %%rbp, %0" : "=rm"(rbp));
     int i = 0;
     while (i < nr
             && safe_load(&rbp->next, next)
@@ -31,5 +30,20 @@ int backtrace_safe(void** pc, int nr)
     return i;
 }
 
+int backtrace_safe(void** pc, int nr)
+{
+    frame* rbp;
 
+    asm("mov %%rbp, %0" : "=rm"(rbp));
+    return walk_frames(rbp, pc, nr);
+}
 
+int backtrace_safe_interrupted(void** pc, int nr)
+{
+    auto ef = current_interrupt_frame;
+    if (!ef || nr == 0) {
+        return 0;
+    }
+    pc[0] = ef->get_pc();
+    return 1 + walk_frames(reinterpret_cast<frame*>(ef->rbp), pc + 1, nr - 1);
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// SIMD implementations of the block checksums used by ZFS. Like memcpy(),
+// the public entry points are ifuncs resolved from the CPU features at boot.
+
+#include <osv/checksum.hh>
+#include <bsd/sys/crypto/sha2/sha2.h>
+#include <immintrin.h>
+#include "cpuid.hh"
+
+// Same layout as zio_cksum_t (sys/spa.h)
+struct zio_cksum {
+    uint64_t zc_word[4];
+};
+
+// The portable implementations, in zfs_fletcher.c
+extern "C" void fletcher_4_scalar_native(const void *buf, uint64_t size, zio_cksum *zcp);
+extern "C" void fletcher_4_scalar_byteswap(const void *buf, uint64_t size, zio_cksum *zcp);
+
+namespace {
+
+// Continue a fletcher-4 checksum over the words the SIMD loop left over
+template <bool Byteswap>
+inline void fletcher_4_tail(const uint32_t *ip, const uint32_t *ipend,
+                            uint64_t a, uint64_t b, uint64_t c, uint64_t d,
+                            zio_cksum *zcp)
+{
+    for (; ip < ipend; ip++) {
+        a += Byteswap ? __builtin_bswap32(*ip) : *ip;
+        b += a;
+        c += b;
+        d += c;
+    }
+    zcp->zc_word[0] = a;
+    zcp->zc_word[1] = b;
+    zcp->zc_word[2] = c;
+    zcp->zc_word[3] = d;
+}
+
+// The SIMD variants run N interleaved fletcher-4 streams, lane j summing
+// words j, j+N, j+2N, ... The sums of the whole buffer are then linear
+// combinations of the per-lane sums.
+
+__attribute__((target("sse2")))
+void fletcher_4_sse2_native(const void *buf, uint64_t size, zio_cksum *zcp)
+{
+    auto ip = static_cast<const uint32_t*>(buf);
+    auto ipend = ip + size / sizeof(uint32_t);
+    auto simd_end = ip + (size / sizeof(uint32_t) & ~uint64_t(1));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero, b = zero, c = zero, d = zero;
+
+    for (; ip < simd_end; ip += 2) {
+        __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip));
+        x = _mm_unpacklo_epi32(x, zero);
+        a = _mm_add_epi64(a, x);
+        b = _mm_add_epi64(b, a);
+        c = _mm_add_epi64(c, b);
+        d = _mm_add_epi64(d, c);
+    }
+
+    uint64_t va[2], vb[2], vc[2], vd[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(va), a);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(vb), b);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(vc), c);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(vd), d);
+
+    fletcher_4_tail<false>(ip, ipend,
+        va[0] + va[1],
+        2 * (vb[0] + vb[1]) - va[1],
+        4 * (vc[0] + vc[1]) - vb[0] - 3 * vb[1],
+        8 * (vd[0] + vd[1]) - 4 * vc[0] - 8 * vc[1] + vb[1],
+        zcp);
+}
+
+template <bool Byteswap>
+__attribute__((target("avx2")))
+void fletcher_4_avx2(const void *buf, uint64_t size, zio_cksum *zcp)
+{
+    auto ip = static_cast<const uint32_t*>(buf);
+    auto ipend = ip + size / sizeof(uint32_t);
+    auto simd_end = ip + (size / sizeof(uint32_t) & ~uint64_t(3));
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                                       4, 5, 6, 7, 0, 1, 2, 3);
+    __m256i a = _mm256_setzero_si256(), b = a, c = a, d = a;
+
+    for (; ip < simd_end; ip += 4) {
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip));
+        if (Byteswap) {
+            w = _mm_shuffle_epi8(w, bswap);
+        }
+        __m256i x = _mm256_cvtepu32_epi64(w);
+        a = _mm256_add_epi64(a, x);
+        b = _mm256_add_epi64(b, a);
+        c = _mm256_add_epi64(c, b);
+        d = _mm256_add_epi64(d, c);
+    }
+
+    uint64_t va[4], vb[4], vc[4], vd[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(va), a);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(vb), b);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(vc), c);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(vd), d);
+
+    fletcher_4_tail<Byteswap>(ip, ipend,
+        va[0] + va[1] + va[2] + va[3],
+        4 * (vb[0] + vb[1] + vb[2] + vb[3]) - va[1] - 2 * va[2] - 3 * va[3],
+        16 * (vc[0] + vc[1] + vc[2] + vc[3])
+            - 6 * vb[0] - 10 * vb[1] - 14 * vb[2] - 18 * vb[3]
+            + va[2] + 3 * va[3],
+        64 * (vd[0] + vd[1] + vd[2] + vd[3])
+            - 48 * vc[0] - 64 * vc[1] - 80 * vc[2] - 96 * vc[3]
+            + 4 * vb[0] + 10 * vb[1] + 20 * vb[2] + 34 * vb[3] - va[3],
+        zcp);
+}
+
+// The ymm registers are only usable if we enabled them in XCR0, see
+// arch_cpu::init_on_cpu(). There is no room for the AVX-512 state in
+// fpu_state, so the 512-bit registers are not an option in the kernel.
+bool have_avx2()
+{
+    auto& f = processor::features();
+    return f.xsave && f.avx && f.avx2;
+}
+
+bool have_sha()
+{
+    auto& f = processor::features();
+    return f.sha && f.ssse3 && f.sse4_1;
+}
+
+const uint32_t sha256_k[64] __attribute__((aligned(16))) = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// SHA-256 using the SHA extensions. sha256rnds2 keeps the state as the
+// {A,B,E,F} and {C,D,G,H} halves, so it is shuffled in and out of that
+// layout around the loop.
+__attribute__((target("sha,sse4.1")))
+void sha256_shani(uint32_t state[8], const void *data, size_t nblocks)
+{
+    auto p = static_cast<const uint8_t*>(data);
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                         0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xb1);                 // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1b);           // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);        // CDGH
+
+    for (; nblocks > 0; nblocks--, p += SHA256_BLOCK_LENGTH) {
+        __m128i abef = state0, cdgh = state1;
+        __m128i w[4];
+        for (int i = 0; i < 4; i++) {
+            w[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+            w[i] = _mm_shuffle_epi8(w[i], bswap);
+        }
+        // Four rounds per iteration, w[] holding the last 16 message words
+        for (int i = 0; i < 16; i++) {
+            __m128i msg = _mm_add_epi32(w[i & 3],
+                _mm_load_si128(reinterpret_cast<const __m128i*>(&sha256_k[4 * i])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1,
+                                           _mm_shuffle_epi32(msg, 0x0e));
+            if (i < 12) {
+                // W[t] = s1(W[t-2]) + W[t-7] + s0(W[t-15]) + W[t-16]
+                __m128i t = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                t = _mm_add_epi32(t, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(t, w[(i + 3) & 3]);
+            }
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);              // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xb1);           // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);        // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);           // HGFE
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+}
+
+extern "C"
+void (*resolve_fletcher_4_native())(const void *buf, uint64_t size, zio_cksum *zcp)
+{
+    if (have_avx2()) {
+        return fletcher_4_avx2<false>;
+    }
+    // SSE2 is always there on x86_64
+    return fletcher_4_sse2_native;
+}
+
+extern "C"
+void (*resolve_fletcher_4_byteswap())(const void *buf, uint64_t size, zio_cksum *zcp)
+{
+    if (have_avx2()) {
+        return fletcher_4_avx2<true>;
+    }
+    return fletcher_4_scalar_byteswap;
+}
+
+extern "C"
+void (*resolve_sha256_transform())(uint32_t state[8], const void *data, size_t nblocks)
+{
+    if (have_sha()) {
+        return sha256_shani;
+    }
+    return SHA256_Transform_generic;
+}
+
+extern "C" void fletcher_4_native(const void *buf, uint64_t size, zio_cksum *zcp)
+    __attribute__((ifunc("resolve_fletcher_4_native")));
+extern "C" void fletcher_4_byteswap(const void *buf, uint64_t size, zio_cksum *zcp)
+    __attribute__((ifunc("resolve_fletcher_4_byteswap")));
+extern "C" void SHA256_Transform_x64(uint32_t state[8], const void *data, size_t nblocks)
+    __attribute__((ifunc("resolve_sha256_transform")));
+
+namespace osv {
+namespace checksum {
+
+template <void (*Fn)(const void*, uint64_t, zio_cksum*)>
+static void fletcher_4_variant(const void *buf, uint64_t size, uint64_t cksum[4])
+{
+    Fn(buf, size, reinterpret_cast<zio_cksum*>(cksum));
+}
+
+std::vector<variant<fletcher_4_fn>> fletcher_4_native_variants()
+{
+    std::vector<variant<fletcher_4_fn>> ret;
+    ret.push_back({"scalar", fletcher_4_variant<fletcher_4_scalar_native>});
+    ret.push_back({"sse2", fletcher_4_variant<fletcher_4_sse2_native>});
+    if (have_avx2()) {
+        ret.push_back({"avx2", fletcher_4_variant<fletcher_4_avx2<false>>});
+    }
+    return ret;
+}
+
+std::vector<variant<fletcher_4_fn>> fletcher_4_byteswap_variants()
+{
+    std::vector<variant<fletcher_4_fn>> ret;
+    ret.push_back({"scalar", fletcher_4_variant<fletcher_4_scalar_byteswap>});
+    if (have_avx2()) {
+        ret.push_back({"avx2", fletcher_4_variant<fletcher_4_avx2<true>>});
+    }
+    return ret;
+}
+
+std::vector<variant<sha256_blocks_fn>> sha256_variants()
+{
+    std::vector<variant<sha256_blocks_fn>> ret;
+    ret.push_back({"generic", SHA256_Transform_generic});
+    if (have_sha()) {
+        ret.push_back({"sha-ni", sha256_shani});
+    }
+    return ret;
+}
+
+}
+}
@@ -24,10 +24,12 @@ struct features_type {
     bool xsave;
     bool osxsave;
     bool avx;
+    bool avx2;
     bool rdrand;
     bool clflush;
     bool fsgsbase;
     bool repmovsb;
+    bool sha;
     bool gbpage;
     bool invariant_tsc;
     bool kvm_clocksource;
@@ -57,6 +57,11 @@ enum class msr : uint32_t {
     X2APIC_SELF_IPI = 0x83f,
 
     IA32_APIC_BASE = 0x0000001b,
+    IA32_PMC0 = 0x000000c1,
+    IA32_PERFEVTSEL0 = 0x00000186,
+    IA32_PERF_GLOBAL_STATUS = 0x0000038e,
+    IA32_PERF_GLOBAL_CTRL = 0x0000038f,
+    IA32_PERF_GLOBAL_OVF_CTRL = 0x00000390,
     IA32_EFER = 0xc0000080,
     IA32_STAR = 0xc0000081,
     IA32_LSTAR = 0xc0000082,
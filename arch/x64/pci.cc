@@ -7,10 +7,16 @@
 
 #include <osv/debug.hh>
 #include <osv/pci.hh>
+#include <osv/spinlock.h>
+#include <osv/mutex.h>
 #include "drivers/pci-function.hh"
 
 namespace pci {
 
+// Selecting the register and accessing it are two port accesses, which
+// drivers probing in parallel must not interleave.
+static spinlock_t config_lock;
+
     /* 31     30  -  24  23 - 16  15 - 11  10 - 8     7 - 2    1 - 0
      * Enable Reserved   Bus Nr   Device   Function  Register  0   0
      *
@@ -38,36 +44,42 @@ static inline void prepare_pci_config_access(u8 bus, u8 slot, u8 func, u8 offset
 
 u32 read_pci_config(u8 bus, u8 slot, u8 func, u8 offset)
 {
+    SCOPE_LOCK(config_lock);
     prepare_pci_config_access(bus, slot, func, offset);
     return inl(PCI_CONFIG_DATA);
 }
 
 u16 read_pci_config_word(u8 bus, u8 slot, u8 func, u8 offset)
 {
+    SCOPE_LOCK(config_lock);
     prepare_pci_config_access(bus, slot, func, offset);
     return inw(PCI_CONFIG_DATA + (offset & 0x02));
 }
 
 u8 read_pci_config_byte(u8 bus, u8 slot, u8 func, u8 offset)
 {
+    SCOPE_LOCK(config_lock);
     prepare_pci_config_access(bus, slot, func, offset);
     return inb(PCI_CONFIG_DATA + (offset & 0x03));
 }
 
 void write_pci_config(u8 bus, u8 slot, u8 func, u8 offset, u32 val)
 {
+    SCOPE_LOCK(config_lock);
     prepare_pci_config_access(bus, slot, func, offset);
     outl(val, PCI_CONFIG_DATA);
 }
 
 void write_pci_config_word(u8 bus, u8 slot, u8 func, u8 offset, u16 val)
 {
+    SCOPE_LOCK(config_lock);
     prepare_pci_config_access(bus, slot, func, offset);
     outw(val, PCI_CONFIG_DATA + (offset & 0x02));
 }
 
 void write_pci_config_byte(u8 bus, u8 slot, u8 func, u8 offset, u8 val)
 {
+    SCOPE_LOCK(config_lock);
     prepare_pci_config_access(bus, slot, func, offset);
     outb(val, PCI_CONFIG_DATA + (offset & 0x03));
 }
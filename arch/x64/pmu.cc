@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Intel architectural performance monitoring (CPUID leaf 0xa), which is
+// also what KVM's virtual PMU implements. Only the general purpose counters
+// are used, as every event we offer can be counted on any of them.
+
+#include <osv/pmu.hh>
+#include <algorithm>
+#include "processor.hh"
+#include "msr.hh"
+#include "apic.hh"
+#include "exceptions.hh"
+
+namespace pmu {
+
+namespace {
+
+struct event_code {
+    u8 event;
+    u8 umask;
+    u8 cpuid_bit; // set in CPUID.0xa:ebx if the event is not available
+};
+
+const event_code event_codes[] = {
+    { 0x3c, 0x00, 0 }, // cycles: unhalted core cycles
+    { 0xc0, 0x00, 1 }, // instructions retired
+    { 0x2e, 0x4f, 3 }, // last level cache references
+    { 0x2e, 0x41, 4 }, // last level cache misses
+    { 0xc4, 0x00, 5 }, // branch instructions retired
+    { 0xc5, 0x00, 6 }, // branch misses retired
+};
+
+constexpr u64 evtsel_usr = 1 << 16;
+constexpr u64 evtsel_os = 1 << 17;
+constexpr u64 evtsel_int = 1 << 20;
+constexpr u64 evtsel_en = 1 << 22;
+
+struct pmu_info {
+    unsigned version;
+    unsigned counters;
+    unsigned width;
+    u32 unavailable;
+
+    pmu_info()
+    {
+        auto r = processor::cpuid(0);
+        if (r.a < 0xa) {
+            version = counters = width = 0;
+            return;
+        }
+        r = processor::cpuid(0xa);
+        version = r.a & 0xff;
+        counters = version ? std::min((r.a >> 8) & 0xff, max_counters) : 0;
+        width = (r.a >> 16) & 0xff;
+        // bits beyond the length of the ebx vector are unavailable too
+        auto len = (r.a >> 24) & 0xff;
+        unavailable = r.b | ~((1u << len) - 1);
+    }
+};
+
+const pmu_info& info()
+{
+    static pmu_info i;
+    return i;
+}
+
+unsigned overflow_vector;
+std::function<void (unsigned)> overflow_handler;
+
+void overflow_interrupt()
+{
+    auto status = processor::rdmsr(msr::IA32_PERF_GLOBAL_STATUS);
+    auto gp = status & ((u64(1) << info().counters) - 1);
+    processor::wrmsr(msr::IA32_PERF_GLOBAL_OVF_CTRL, status);
+    for (unsigned i = 0; i < info().counters; i++) {
+        if (gp & (u64(1) << i)) {
+            overflow_handler(i);
+        }
+    }
+    // The local APIC masks the interrupt when delivering it
+    processor::apic->write(apicreg::LVTPC, overflow_vector);
+}
+
+}
+
+unsigned counters()
+{
+    return info().counters;
+}
+
+bool supported(event e)
+{
+    return counters() && e < event::count &&
+           !(info().unavailable & (1u << event_codes[unsigned(e)].cpuid_bit));
+}
+
+bool overflow_supported()
+{
+    // Version 1 has no global status register to find the counter
+    return counters() && info().version >= 2;
+}
+
+u64 mask()
+{
+    return (u64(1) << info().width) - 1;
+}
+
+void start(unsigned counter, event e, bool interrupt)
+{
+    auto& code = event_codes[unsigned(e)];
+    u64 evtsel = code.event | (u64(code.umask) << 8) | evtsel_usr | evtsel_os | evtsel_en;
+    if (interrupt) {
+        evtsel |= evtsel_int;
+        processor::apic->write(apicreg::LVTPC, overflow_vector);
+    }
+    processor::wrmsr(u32(msr::IA32_PERFEVTSEL0) + counter, 0);
+    processor::wrmsr(u32(msr::IA32_PMC0) + counter, 0);
+    if (info().version >= 2) {
+        // Enabled at reset, but a firmware or previous kernel may disagree
+        processor::wrmsr(msr::IA32_PERF_GLOBAL_CTRL, (u64(1) << info().counters) - 1);
+    }
+    processor::wrmsr(u32(msr::IA32_PERFEVTSEL0) + counter, evtsel);
+}
+
+void stop(unsigned counter)
+{
+    processor::wrmsr(u32(msr::IA32_PERFEVTSEL0) + counter, 0);
+}
+
+u64 read(unsigned counter)
+{
+    return processor::rdmsr(u32(msr::IA32_PMC0) + counter);
+}
+
+void write(unsigned counter, u64 value)
+{
+    processor::wrmsr(u32(msr::IA32_PMC0) + counter, value & mask());
+}
+
+void set_overflow_handler(std::function<void (unsigned counter)> handler)
+{
+    overflow_handler = handler;
+    if (!overflow_vector) {
+        overflow_vector = idt.register_handler(overflow_interrupt);
+    }
+}
+
+}
@@ -15,6 +15,11 @@ extern "C" int get_cpuid(void)
     return sched::cpu::current()->id;
 }
 
+extern "C" int get_pinned_cpuid(void)
+{
+    return sched::thread::current()->pinned() ? get_cpuid() : -1;
+}
+
 uint64_t get_cyclecount(void)
 {
     return processor::ticks();
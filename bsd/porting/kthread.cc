@@ -38,6 +38,13 @@ kthread_add(void (*func)(void *), void *arg, struct proc *p,
     return 0;
 }
 
+// Like FreeBSD's sched_bind(): from now on, td only runs on the given cpu
+void kthread_bind(struct thread *td, int cpu)
+{
+    assert(cpu >= 0 && cpu < (int)sched::cpus.size());
+    sched::thread::pin(reinterpret_cast<sched::thread*>(td), sched::cpus[cpu]);
+}
+
 
 int kproc_create(void (*func)(void *), void *arg, struct proc **p,
                 int flags, int pages, const char *str, ...)
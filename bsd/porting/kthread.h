@@ -25,6 +25,9 @@ int
 kproc_create(void (*func)(void *), void *arg,
                     struct proc **newpp, int flags, int pages, const char *fmt, ...);
 
+struct thread;
+void kthread_bind(struct thread *td, int cpu);
+
 struct proc *get_curproc(void);
 extern void thread_mark_emergency();
 __END_DECLS
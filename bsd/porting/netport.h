@@ -280,7 +280,7 @@ static __inline void        splx(intrmask_t ipl)   { return; }
 /* must match max_cpus in include/sched.hh */
 #define MAXCPU		(sizeof(unsigned long) * 8)
 
-extern unsigned smp_processors;
+extern volatile unsigned smp_processors;
 #define mp_ncpus smp_processors
 
 /*
@@ -307,6 +307,8 @@ int ppsratecheck(struct timeval *lasttime, int *curpps, int maxpps);
 int ratecheck(struct timeval *lasttime, const struct timeval *mininterval);
 
 int get_cpuid(void);
+/* cpu the current thread is pinned to, or -1 if it may migrate */
+int get_pinned_cpuid(void);
 
 size_t get_physmem(void);
 extern size_t physmem;
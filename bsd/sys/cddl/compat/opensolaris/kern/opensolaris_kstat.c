@@ -32,10 +32,19 @@
 
 #include <stdlib.h>
 #include <osv/debug.h>
+#include <osv/mutex.h>
+#include <osv/zfs_stats.h>
 #include <bsd/porting/netport.h>
 
 SYSCTL_NODE(, OID_AUTO, kstat, CTLFLAG_RW, 0, "Kernel statistics");
 
+/*
+ * Without sysctl, installed kstats are kept on a list instead, for
+ * kstat_read().
+ */
+static mutex_t kstat_lock = MUTEX_INITIALIZER;
+static kstat_t *kstat_list;
+
 kstat_t *
 kstat_create(char *module, int instance, char *name, char *class, uchar_t type,
     ulong_t ndata, uchar_t flags)
@@ -49,7 +58,11 @@ kstat_create(char *module, int instance, char *name, char *class, uchar_t type,
 	 * done in this function.
 	 */
 	ksp = malloc(sizeof(*ksp));
+	ksp->ks_data = NULL;
 	ksp->ks_ndata = ndata;
+	strlcpy(ksp->ks_module, module, sizeof(ksp->ks_module));
+	strlcpy(ksp->ks_name, name, sizeof(ksp->ks_name));
+	ksp->ks_next = NULL;
 
 #if 0
 	/*
@@ -106,6 +119,10 @@ kstat_sysctl(SYSCTL_HANDLER_ARGS)
 void
 kstat_install(kstat_t *ksp)
 {
+	mutex_lock(&kstat_lock);
+	ksp->ks_next = kstat_list;
+	kstat_list = ksp;
+	mutex_unlock(&kstat_lock);
 #if 0
 	kstat_named_t *ksent;
 	u_int i;
@@ -123,8 +140,44 @@ kstat_install(kstat_t *ksp)
 void
 kstat_delete(kstat_t *ksp)
 {
+	kstat_t **kspp;
+
+	mutex_lock(&kstat_lock);
+	for (kspp = &kstat_list; *kspp != NULL; kspp = &(*kspp)->ks_next) {
+		if (*kspp == ksp) {
+			*kspp = ksp->ks_next;
+			break;
+		}
+	}
+	mutex_unlock(&kstat_lock);
 #if 0
 	sysctl_ctx_free(&ksp->ks_sysctl_ctx);
 #endif
 	free(ksp);
 }
+
+int
+kstat_read(const char *module, const char *name,
+    void (*fn)(const char *, uint64_t, void *), void *arg)
+{
+	kstat_named_t *ksent;
+	kstat_t *ksp;
+	u_int i;
+
+	mutex_lock(&kstat_lock);
+	for (ksp = kstat_list; ksp != NULL; ksp = ksp->ks_next) {
+		if (strcmp(ksp->ks_module, module) == 0 &&
+		    strcmp(ksp->ks_name, name) == 0)
+			break;
+	}
+	if (ksp == NULL) {
+		mutex_unlock(&kstat_lock);
+		return (ENOENT);
+	}
+	ksent = ksp->ks_data;
+	for (i = 0; i < ksp->ks_ndata; i++, ksent++)
+		fn(ksent->name, ksent->value.ui64, arg);
+	mutex_unlock(&kstat_lock);
+
+	return (0);
+}
@@ -75,6 +75,23 @@ taskq_create(const char *name, int nthreads, pri_t pri, int minalloc __unused2,
 	return ((taskq_t *)tq);
 }
 
+/*
+ * A taskq whose threads only run on the given cpu.
+ */
+taskq_t *
+taskq_create_pinned(const char *name, int nthreads, pri_t pri, int cpu)
+{
+	taskq_t *tq;
+
+	tq = kmem_alloc(sizeof(*tq), KM_SLEEP);
+	tq->tq_queue = taskqueue_create(name, M_WAITOK, taskqueue_thread_enqueue,
+	    &tq->tq_queue);
+	(void) taskqueue_start_threads_pinned(&tq->tq_queue, nthreads, pri,
+	    cpu, "%s", name);
+
+	return ((taskq_t *)tq);
+}
+
 taskq_t *
 taskq_create_proc(const char *name, int nthreads, pri_t pri, int minalloc,
     int maxalloc, proc_t *proc __unused2, uint_t flags)
@@ -35,9 +35,14 @@
 
 #define	KSTAT_FLAG_VIRTUAL	0x01
 
+#define	KSTAT_STRLEN	31
+
 typedef struct kstat {
 	void	*ks_data;
 	u_int	 ks_ndata;
+	char	 ks_module[KSTAT_STRLEN];
+	char	 ks_name[KSTAT_STRLEN];
+	struct kstat *ks_next;
 #if 0 //def _KERNEL
 	struct sysctl_ctx_list ks_sysctl_ctx;
 	struct sysctl_oid *ks_sysctl_root;
@@ -45,7 +50,6 @@ typedef struct kstat {
 } kstat_t;
 
 typedef struct kstat_named {
-#define	KSTAT_STRLEN	31
 	char	name[KSTAT_STRLEN];
 #define	KSTAT_DATA_CHAR		0
 #define	KSTAT_DATA_INT32	1
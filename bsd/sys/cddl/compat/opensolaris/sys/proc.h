@@ -45,6 +45,8 @@
 #define	maxclsyspri	PVM
 #define	max_ncpus	MAXCPU
 #define	boot_max_ncpus	MAXCPU
+extern volatile unsigned smp_processors;
+#define	boot_ncpus	smp_processors
 
 #define	TS_RUN	0
 
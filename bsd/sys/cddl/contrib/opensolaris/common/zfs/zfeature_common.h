@@ -53,6 +53,7 @@ static enum spa_feature {
 	SPA_FEATURE_ASYNC_DESTROY,
 	SPA_FEATURE_EMPTY_BPOBJ,
 	SPA_FEATURE_LZ4_COMPRESS,
+	SPA_FEATURE_ZSTD_COMPRESS,
 	SPA_FEATURES
 } spa_feature_t;
 
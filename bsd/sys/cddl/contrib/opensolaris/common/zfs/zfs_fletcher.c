@@ -165,6 +165,18 @@ fletcher_2_byteswap(const void *buf, uint64_t size, zio_cksum_t *zcp)
 	ZIO_SET_CHECKSUM(zcp, a0, a1, b0, b1);
 }
 
+/*
+ * On x86_64 the kernel resolves fletcher_4_native() and
+ * fletcher_4_byteswap() at boot to a SIMD variant the CPU supports
+ * (see arch/x64/checksum.cc); the C versions below are the fallback.
+ */
+#if defined(_KERNEL) && defined(__x86_64__)
+#define	fletcher_4_native	fletcher_4_scalar_native
+#define	fletcher_4_byteswap	fletcher_4_scalar_byteswap
+void fletcher_4_scalar_native(const void *, uint64_t, zio_cksum_t *);
+void fletcher_4_scalar_byteswap(const void *, uint64_t, zio_cksum_t *);
+#endif
+
 void
 fletcher_4_native(const void *buf, uint64_t size, zio_cksum_t *zcp)
 {
@@ -199,6 +211,9 @@ fletcher_4_byteswap(const void *buf, uint64_t size, zio_cksum_t *zcp)
 	ZIO_SET_CHECKSUM(zcp, a, b, c, d);
 }
 
+#undef	fletcher_4_native
+#undef	fletcher_4_byteswap
+
 void
 fletcher_4_incremental_native(const void *buf, uint64_t size,
     zio_cksum_t *zcp)
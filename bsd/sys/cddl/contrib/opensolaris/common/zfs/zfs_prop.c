@@ -98,6 +98,26 @@ zfs_prop_init(void)
 		{ "gzip-9",	ZIO_COMPRESS_GZIP_9 },
 		{ "zle",	ZIO_COMPRESS_ZLE },
 		{ "lz4",	ZIO_COMPRESS_LZ4 },
+		{ "zstd",	ZIO_COMPRESS_ZSTD_DEFAULT },	/* zstd default */
+		{ "zstd-1",	ZIO_COMPRESS_ZSTD_1 },
+		{ "zstd-2",	ZIO_COMPRESS_ZSTD_2 },
+		{ "zstd-3",	ZIO_COMPRESS_ZSTD_3 },
+		{ "zstd-4",	ZIO_COMPRESS_ZSTD_4 },
+		{ "zstd-5",	ZIO_COMPRESS_ZSTD_5 },
+		{ "zstd-6",	ZIO_COMPRESS_ZSTD_6 },
+		{ "zstd-7",	ZIO_COMPRESS_ZSTD_7 },
+		{ "zstd-8",	ZIO_COMPRESS_ZSTD_8 },
+		{ "zstd-9",	ZIO_COMPRESS_ZSTD_9 },
+		{ "zstd-10",	ZIO_COMPRESS_ZSTD_10 },
+		{ "zstd-11",	ZIO_COMPRESS_ZSTD_11 },
+		{ "zstd-12",	ZIO_COMPRESS_ZSTD_12 },
+		{ "zstd-13",	ZIO_COMPRESS_ZSTD_13 },
+		{ "zstd-14",	ZIO_COMPRESS_ZSTD_14 },
+		{ "zstd-15",	ZIO_COMPRESS_ZSTD_15 },
+		{ "zstd-16",	ZIO_COMPRESS_ZSTD_16 },
+		{ "zstd-17",	ZIO_COMPRESS_ZSTD_17 },
+		{ "zstd-18",	ZIO_COMPRESS_ZSTD_18 },
+		{ "zstd-19",	ZIO_COMPRESS_ZSTD_19 },
 		{ NULL }
 	};
 
@@ -213,7 +233,8 @@ zfs_prop_init(void)
 	zprop_register_index(ZFS_PROP_COMPRESSION, "compression",
 	    ZIO_COMPRESS_DEFAULT, PROP_INHERIT,
 	    ZFS_TYPE_FILESYSTEM | ZFS_TYPE_VOLUME,
-	    "on | off | lzjb | gzip | gzip-[1-9] | zle | lz4",
+	    "on | off | lzjb | gzip | gzip-[1-9] | zle | lz4 | zstd | "
+	    "zstd-[1-19]",
 	    "COMPRESS", compress_table);
 	zprop_register_index(ZFS_PROP_SNAPDIR, "snapdir", ZFS_SNAPDIR_HIDDEN,
 	    PROP_INHERIT, ZFS_TYPE_FILESYSTEM,
@@ -116,10 +116,29 @@
  *	- L2ARC write completion, which walks L2ARC buflists
  *	- ARC header destruction, as it removes from L2ARC buflists
  *	- ARC header release, as it removes from L2ARC buflists
+ *
+ * Compressed ARC (vfs.zfs.arc_compressed):
+ *
+ * When enabled, compressed blocks are read from disk without being
+ * decompressed by the zio pipeline, and the header keeps the on-disk
+ * (compressed) copy in b_cdata next to the decompressed buffer handed
+ * out to the consumers.  When the decompressed data is evicted the
+ * header moves to a ghost list as usual, but keeps its compressed copy,
+ * so a later "ghost hit" is served by decompressing it instead of doing
+ * an I/O.  The decompressed buffers thus act as a smaller cache in front
+ * of a (logically) much larger one of compressed blocks.
+ *
+ * Compressed copies are charged to arc_size at their physical size and
+ * may take up to arc_compressed_percent of arc_c; beyond that the oldest
+ * ones are dropped (their headers stay on the ghost lists).  They are
+ * linked on arc_compressed_list, protected by arc_compressed_mtx, which
+ * is taken after the hash lock; hash locks are only tryenter'ed while
+ * holding it.
  */
 
 #include <sys/spa.h>
 #include <sys/zio.h>
+#include <sys/zio_compress.h>
 #include <sys/zfs_context.h>
 #include <sys/arc.h>
 #include <sys/refcount.h>
@@ -201,6 +220,21 @@ SYSCTL_UQUAD(_vfs_zfs, OID_AUTO, arc_max, CTLFLAG_RDTUN, &zfs_arc_max, 0,
 SYSCTL_UQUAD(_vfs_zfs, OID_AUTO, arc_min, CTLFLAG_RDTUN, &zfs_arc_min, 0,
     "Minimum ARC size");
 
+/*
+ * Keep compressed blocks in memory (see "Compressed ARC" above), using up
+ * to arc_compressed_percent of the cache for them.
+ */
+int zfs_arc_compressed = 0;
+int zfs_arc_compressed_percent = 75;
+
+TUNABLE_INT("vfs.zfs.arc_compressed", &zfs_arc_compressed);
+TUNABLE_INT("vfs.zfs.arc_compressed_percent", &zfs_arc_compressed_percent);
+SYSCTL_INT(_vfs_zfs, OID_AUTO, arc_compressed, CTLFLAG_RW,
+    &zfs_arc_compressed, 0, "Keep compressed blocks in the ARC");
+SYSCTL_INT(_vfs_zfs, OID_AUTO, arc_compressed_percent, CTLFLAG_RW,
+    &zfs_arc_compressed_percent, 0,
+    "Share of the ARC usable by compressed blocks");
+
 /*
  * Note that buffers can be in one of 6 states:
  *	ARC_anon	- anonymous (discussed below)
@@ -252,6 +286,7 @@ struct arcs_lock {
 typedef struct arc_state {
 	uint64_t arcs_lsize[ARC_BUFC_NUMTYPES];	/* amount of evictable data */
 	uint64_t arcs_size;	/* total amount of data in this state */
+	uint64_t arcs_csize;	/* ghost size still held compressed */
 	list_t	arcs_lists[ARC_BUFC_NUMLISTS]; /* list of evictable buffers */
 	struct arcs_lock arcs_locks[ARC_BUFC_NUMLISTS] __aligned(CACHE_LINE_SIZE);
 } arc_state_t;
@@ -303,6 +338,9 @@ typedef struct arc_stats {
 	kstat_named_t arcstat_hdr_size;
 	kstat_named_t arcstat_data_size;
 	kstat_named_t arcstat_other_size;
+	kstat_named_t arcstat_compressed_size;
+	kstat_named_t arcstat_uncompressed_size;
+	kstat_named_t arcstat_compressed_hits;
 	kstat_named_t arcstat_l2_hits;
 	kstat_named_t arcstat_l2_misses;
 	kstat_named_t arcstat_l2_feeds;
@@ -373,6 +411,9 @@ static arc_stats_t arc_stats = {
 	{ "hdr_size",			KSTAT_DATA_UINT64 },
 	{ "data_size",			KSTAT_DATA_UINT64 },
 	{ "other_size",			KSTAT_DATA_UINT64 },
+	{ "compressed_size",		KSTAT_DATA_UINT64 },
+	{ "uncompressed_size",		KSTAT_DATA_UINT64 },
+	{ "compressed_hits",		KSTAT_DATA_UINT64 },
 	{ "l2_hits",			KSTAT_DATA_UINT64 },
 	{ "l2_misses",			KSTAT_DATA_UINT64 },
 	{ "l2_feeds",			KSTAT_DATA_UINT64 },
@@ -465,6 +506,7 @@ static arc_state_t	*arc_l2c_only;
 #define	arc_c		ARCSTAT(arcstat_c)	/* target size of cache */
 #define	arc_c_min	ARCSTAT(arcstat_c_min)	/* min target cache size */
 #define	arc_c_max	ARCSTAT(arcstat_c_max)	/* max target cache size */
+#define	arc_csize	ARCSTAT(arcstat_compressed_size) /* compressed copies */
 
 static int		arc_no_grow;	/* Don't try to grow cache size */
 static uint64_t		arc_tempreserve;
@@ -535,11 +577,18 @@ struct arc_buf_hdr {
 	list_node_t		b_l2node;
 
 	uint32_t         b_mmaped;
+
+	/* compressed copy, protected by hash lock and arc_compressed_mtx */
+	void			*b_cdata;
+	uint64_t		b_csize;
+	list_node_t		b_cnode;
 };
 
 static arc_buf_t *arc_eviction_list;
 static kmutex_t arc_eviction_mtx;
 static arc_buf_hdr_t arc_eviction_hdr;
+static list_t arc_compressed_list;	/* headers with b_cdata, LRU */
+static kmutex_t arc_compressed_mtx;
 static void arc_get_data_buf(arc_buf_t *buf);
 static void arc_access(arc_buf_hdr_t *buf, kmutex_t *hash_lock);
 static int arc_evict_needed(arc_buf_contents_t type);
@@ -554,6 +603,13 @@ static boolean_t l2arc_write_eligible(uint64_t spa_guid, arc_buf_hdr_t *ab);
 	((state) == arc_mru_ghost || (state) == arc_mfu_ghost ||	\
 	(state) == arc_l2c_only)
 
+/*
+ * The part of a ghost list that is really a ghost: headers which still
+ * hold a compressed copy are cached, and don't count against the
+ * ghost list limits.
+ */
+#define	GHOST_SIZE(state)	((state)->arcs_size - (state)->arcs_csize)
+
 /*
  * Private ARC flags.  These flags are private ARC only flags that will show up
  * in b_flags in the arc_hdr_buf_t.  Some flags are publicly declared, and can
@@ -1256,6 +1312,167 @@ remove_reference(arc_buf_hdr_t *ab, kmutex_t *hash_lock, void *tag)
 	return (cnt);
 }
 
+/*
+ * Hand the compressed copy of a block just read from disk over to its
+ * header.  The hash lock must be held.
+ */
+static void
+arc_cdata_attach(arc_buf_hdr_t *hdr, void *cdata, uint64_t csize)
+{
+	ASSERT(MUTEX_HELD(HDR_LOCK(hdr)));
+	ASSERT3P(hdr->b_cdata, ==, NULL);
+	ASSERT(hdr->b_state == arc_mru || hdr->b_state == arc_mfu);
+
+	hdr->b_cdata = cdata;
+	hdr->b_csize = csize;
+	mutex_enter(&arc_compressed_mtx);
+	list_insert_head(&arc_compressed_list, hdr);
+	mutex_exit(&arc_compressed_mtx);
+
+	ARCSTAT_INCR(arcstat_compressed_size, csize);
+	ARCSTAT_INCR(arcstat_uncompressed_size, hdr->b_size);
+	atomic_add_64(&arc_size, csize);
+}
+
+static void
+arc_cdata_free_locked(arc_buf_hdr_t *hdr)
+{
+	uint64_t csize = hdr->b_csize;
+
+	ASSERT(MUTEX_HELD(&arc_compressed_mtx));
+	ASSERT(hdr->b_cdata != NULL);
+
+	list_remove(&arc_compressed_list, hdr);
+	if (GHOST_STATE(hdr->b_state)) {
+		ASSERT3U(hdr->b_state->arcs_csize, >=, hdr->b_size);
+		atomic_add_64(&hdr->b_state->arcs_csize, -hdr->b_size);
+	}
+	zio_data_buf_free(hdr->b_cdata, csize);
+	hdr->b_cdata = NULL;
+	hdr->b_csize = 0;
+
+	ARCSTAT_INCR(arcstat_compressed_size, -csize);
+	ARCSTAT_INCR(arcstat_uncompressed_size, -hdr->b_size);
+	ASSERT(arc_size >= csize);
+	atomic_add_64(&arc_size, -csize);
+}
+
+static void
+arc_cdata_free(arc_buf_hdr_t *hdr)
+{
+	mutex_enter(&arc_compressed_mtx);
+	arc_cdata_free_locked(hdr);
+	mutex_exit(&arc_compressed_mtx);
+}
+
+/*
+ * The decompressed data of hdr has just been evicted, leaving the
+ * compressed copy as the only cached one: move it to the head of the
+ * list, so that it is dropped last.
+ */
+static void
+arc_cdata_evicted(arc_buf_hdr_t *hdr)
+{
+	ASSERT(MUTEX_HELD(HDR_LOCK(hdr)));
+
+	mutex_enter(&arc_compressed_mtx);
+	list_remove(&arc_compressed_list, hdr);
+	list_insert_head(&arc_compressed_list, hdr);
+	mutex_exit(&arc_compressed_mtx);
+}
+
+/*
+ * Drop compressed copies, oldest first, until at least `bytes' have been
+ * freed.  Headers whose hash lock is busy are skipped.  Returns the
+ * number of bytes freed.
+ */
+static int64_t
+arc_cdata_trim(int64_t bytes)
+{
+	arc_buf_hdr_t *ab, *ab_prev;
+	kmutex_t *hash_lock;
+	int64_t freed = 0;
+	uint64_t missed = 0;
+
+	mutex_enter(&arc_compressed_mtx);
+	for (ab = list_tail(&arc_compressed_list); ab && freed < bytes;
+	    ab = ab_prev) {
+		ab_prev = list_prev(&arc_compressed_list, ab);
+		hash_lock = HDR_LOCK(ab);
+		/* caller may be trying to modify this buffer, skip it */
+		if (MUTEX_HELD(hash_lock) || !mutex_tryenter(hash_lock)) {
+			missed += 1;
+			continue;
+		}
+		freed += ab->b_csize;
+		arc_cdata_free_locked(ab);
+		mutex_exit(hash_lock);
+	}
+	mutex_exit(&arc_compressed_mtx);
+
+	if (missed)
+		ARCSTAT_INCR(arcstat_mutex_miss, missed);
+
+	return (freed);
+}
+
+/*
+ * Decompress the compressed copy of hdr into buf, as arc_read_done()
+ * would have done with the data read from disk.  On failure the copy is
+ * dropped, and the block has to be read again.
+ */
+static int
+arc_cdata_read(arc_buf_hdr_t *hdr, arc_buf_t *buf, const blkptr_t *bp)
+{
+	ASSERT(MUTEX_HELD(HDR_LOCK(hdr)));
+	ASSERT(hdr->b_cdata != NULL);
+
+	if (zio_decompress_data(BP_GET_COMPRESS(bp), hdr->b_cdata,
+	    buf->b_data, hdr->b_csize, hdr->b_size) != 0) {
+		arc_cdata_free(hdr);
+		return (EIO);
+	}
+
+	if (BP_SHOULD_BYTESWAP(bp)) {
+		dmu_object_byteswap_t bswap =
+		    DMU_OT_BYTESWAP(BP_GET_TYPE(bp));
+		arc_byteswap_func_t *func = BP_GET_LEVEL(bp) > 0 ?
+		    byteswap_uint64_array :
+		    dmu_ot_byteswap[bswap].ob_func;
+		func(buf->b_data, hdr->b_size);
+	}
+
+	arc_cksum_compute(buf, B_FALSE);
+#ifdef illumos
+	arc_buf_watch(buf);
+#endif /* illumos */
+
+	return (0);
+}
+
+/*
+ * Whether a block about to be read should have its compressed copy kept
+ */
+static boolean_t
+arc_cdata_wanted(const blkptr_t *bp, int zio_flags)
+{
+	return (zfs_arc_compressed && zfs_arc_compressed_percent > 0 &&
+	    BP_GET_COMPRESS(bp) != ZIO_COMPRESS_OFF &&
+	    BP_GET_PSIZE(bp) < BP_GET_LSIZE(bp) &&
+	    !(zio_flags & ZIO_FLAG_RAW));
+}
+
+/*
+ * How much of the cache compressed copies may use
+ */
+static uint64_t
+arc_cdata_limit(void)
+{
+	if (!zfs_arc_compressed)
+		return (0);
+	return (arc_c / 100 * MIN(zfs_arc_compressed_percent, 100));
+}
+
 /*
  * Move the supplied buffer to the indicated state.  The mutex
  * for the buffer must be held by the caller.
@@ -1275,6 +1492,23 @@ arc_change_state(arc_state_t *new_state, arc_buf_hdr_t *ab, kmutex_t *hash_lock)
 	ASSERT(ab->b_datacnt == 0 || !GHOST_STATE(new_state));
 	ASSERT(ab->b_datacnt <= 1 || old_state != arc_anon);
 
+	/*
+	 * The compressed copy only outlives the decompressed data
+	 * while the header is on the mru/mfu ghost lists.
+	 */
+	if (ab->b_cdata != NULL) {
+		if (new_state == arc_anon || new_state == arc_l2c_only) {
+			arc_cdata_free(ab);
+		} else {
+			if (GHOST_STATE(old_state))
+				atomic_add_64(&old_state->arcs_csize,
+				    -ab->b_size);
+			if (GHOST_STATE(new_state))
+				atomic_add_64(&new_state->arcs_csize,
+				    ab->b_size);
+		}
+	}
+
 	from_delta = to_delta = ab->b_datacnt * ab->b_size;
 
 	/*
@@ -1766,6 +2000,7 @@ arc_hdr_destroy(arc_buf_hdr_t *hdr)
 	ASSERT(!list_link_active(&hdr->b_arc_node));
 	ASSERT3P(hdr->b_hash_next, ==, NULL);
 	ASSERT3P(hdr->b_acb, ==, NULL);
+	ASSERT3P(hdr->b_cdata, ==, NULL);
 	kmem_cache_free(hdr_cache, hdr);
 }
 
@@ -1986,6 +2221,8 @@ evict_start:
 				ASSERT(HDR_IN_HASH_TABLE(ab));
 				ab->b_flags |= ARC_IN_HASH_TABLE;
 				ab->b_flags &= ~ARC_BUF_AVAILABLE;
+				if (ab->b_cdata != NULL)
+					arc_cdata_evicted(ab);
 				DTRACE_PROBE1(arc__evict, arc_buf_hdr_t *, ab);
 			}
 			if (!have_lock)
@@ -2037,9 +2274,9 @@ evict_start:
 	 * sure we also adjust the ghost state size if necessary.
 	 */
 	if (arc_no_grow &&
-	    arc_mru_ghost->arcs_size + arc_mfu_ghost->arcs_size > arc_c) {
+	    GHOST_SIZE(arc_mru_ghost) + GHOST_SIZE(arc_mfu_ghost) > arc_c) {
 		int64_t mru_over = arc_anon->arcs_size + arc_mru->arcs_size +
-		    arc_mru_ghost->arcs_size - arc_c;
+		    GHOST_SIZE(arc_mru_ghost) - arc_c;
 
 		if (mru_over > 0 && arc_mru_ghost->arcs_lsize[type] > 0) {
 			int64_t todelete =
@@ -2047,8 +2284,8 @@ evict_start:
 			arc_evict_ghost(arc_mru_ghost, 0, todelete);
 		} else if (arc_mfu_ghost->arcs_lsize[type] > 0) {
 			int64_t todelete = MIN(arc_mfu_ghost->arcs_lsize[type],
-			    arc_mru_ghost->arcs_size +
-			    arc_mfu_ghost->arcs_size - arc_c);
+			    GHOST_SIZE(arc_mru_ghost) +
+			    GHOST_SIZE(arc_mfu_ghost) - arc_c);
 			arc_evict_ghost(arc_mfu_ghost, 0, todelete);
 		}
 	}
@@ -2176,6 +2413,12 @@ arc_sized_adjust(int64_t to_reclaim)
 	int64_t adjustment, delta, freed;
 	size_t old_to_reclaim = to_reclaim;
 
+	/*
+	 * Keep the compressed copies within their share of the cache
+	 */
+	if (arc_csize > arc_cdata_limit())
+		(void) arc_cdata_trim(arc_csize - arc_cdata_limit());
+
 	/*
 	 * Adjust MRU size
 	 */
@@ -2229,7 +2472,7 @@ arc_sized_adjust(int64_t to_reclaim)
 	 * Adjust ghost lists
 	 */
 
-	adjustment = arc_mru->arcs_size + arc_mru_ghost->arcs_size - arc_c;
+	adjustment = arc_mru->arcs_size + GHOST_SIZE(arc_mru_ghost) - arc_c;
 
 	if (adjustment > 0 && arc_mru_ghost->arcs_size > 0) {
 		delta = MIN(arc_mru_ghost->arcs_size, adjustment);
@@ -2237,13 +2480,20 @@ arc_sized_adjust(int64_t to_reclaim)
 	}
 
 	adjustment =
-	    arc_mru_ghost->arcs_size + arc_mfu_ghost->arcs_size - arc_c;
+	    GHOST_SIZE(arc_mru_ghost) + GHOST_SIZE(arc_mfu_ghost) - arc_c;
 
 	if (adjustment > 0 && arc_mfu_ghost->arcs_size > 0) {
 		delta = MIN(arc_mfu_ghost->arcs_size, adjustment);
 		arc_evict_ghost(arc_mfu_ghost, 0, delta);
 	}
 
+	/*
+	 * Compressed copies are the cheapest to give back under memory
+	 * pressure: they only save a re-read from disk.
+	 */
+	if (to_reclaim > 0)
+		to_reclaim -= arc_cdata_trim(to_reclaim);
+
 	return old_to_reclaim - to_reclaim;
 }
 
@@ -2922,6 +3172,7 @@ arc_read_done(zio_t *zio)
 	kmutex_t	*hash_lock;
 	arc_callback_t	*callback_list, *acb;
 	int		freeable = FALSE;
+	void		*cdata = NULL;
 
 	buf = zio->io_private;
 	hdr = buf->b_hdr;
@@ -2945,6 +3196,18 @@ arc_read_done(zio_t *zio)
 	if (l2arc_noprefetch && (hdr->b_flags & ARC_PREFETCH))
 		hdr->b_flags &= ~ARC_L2CACHE;
 
+	/*
+	 * The block was read as is for the compressed ARC: decompress it
+	 * ourselves, so that we can hold on to the compressed copy.
+	 */
+	if (zio->io_flags & ZIO_FLAG_RAW) {
+		cdata = zio->io_data;
+		if (zio->io_error == 0 &&
+		    zio_decompress_data(BP_GET_COMPRESS(zio->io_bp), cdata,
+		    buf->b_data, zio->io_size, hdr->b_size) != 0)
+			zio->io_error = EIO;
+	}
+
 	/* byteswap if necessary */
 	callback_list = hdr->b_acb;
 	ASSERT(callback_list != NULL);
@@ -2972,6 +3235,13 @@ arc_read_done(zio_t *zio)
 		arc_access(hdr, hash_lock);
 	}
 
+	if (cdata != NULL) {
+		if (hash_lock && zio->io_error == 0 && hdr->b_cdata == NULL)
+			arc_cdata_attach(hdr, cdata, zio->io_size);
+		else
+			zio_data_buf_free(cdata, zio->io_size);
+	}
+
 	/* create copies of the data buffer for the callers */
 	abuf = buf;
 	for (acb = callback_list; acb; acb = acb->acb_next) {
@@ -3232,6 +3502,29 @@ top:
 			hdr->b_datacnt = 1;
 			arc_get_data_buf(buf);
 			arc_access(hdr, hash_lock);
+
+			/*
+			 * If we still have the block compressed, this is
+			 * a hit after all.
+			 */
+			if (hdr->b_cdata != NULL &&
+			    arc_cdata_read(hdr, buf, bp) == 0) {
+				*arc_flags |= ARC_CACHED;
+				if (done == NULL)
+					hdr->b_flags |= ARC_BUF_AVAILABLE;
+				DTRACE_PROBE1(arc__hit, arc_buf_hdr_t *, hdr);
+				mutex_exit(hash_lock);
+				ARCSTAT_BUMP(arcstat_hits);
+				ARCSTAT_BUMP(arcstat_compressed_hits);
+				ARCSTAT_CONDSTAT(!(hdr->b_flags & ARC_PREFETCH),
+				    demand, prefetch,
+				    hdr->b_type != ARC_BUFC_METADATA,
+				    data, metadata, hits);
+
+				if (done)
+					done(NULL, buf, private);
+				return (0);
+			}
 		}
 
 		ASSERT(!GHOST_STATE(hdr->b_state));
@@ -3339,8 +3632,21 @@ top:
 			}
 		}
 
-		rzio = zio_read(pio, spa, bp, buf->b_data, size,
-		    arc_read_done, buf, priority, zio_flags, zb);
+		if (arc_cdata_wanted(bp, zio_flags)) {
+			/*
+			 * Skip the decompression in the zio pipeline;
+			 * arc_read_done() does it and keeps the compressed
+			 * copy.
+			 */
+			uint64_t psize = BP_GET_PSIZE(bp);
+
+			rzio = zio_read(pio, spa, bp, zio_data_buf_alloc(psize),
+			    psize, arc_read_done, buf, priority,
+			    zio_flags | ZIO_FLAG_RAW, zb);
+		} else {
+			rzio = zio_read(pio, spa, bp, buf->b_data, size,
+			    arc_read_done, buf, priority, zio_flags, zb);
+		}
 
 		if (*arc_flags & ARC_WAIT)
 			return (zio_wait(rzio));
@@ -3436,6 +3742,8 @@ arc_buf_evict(arc_buf_t *buf)
 		ASSERT(HDR_IN_HASH_TABLE(hdr));
 		hdr->b_flags |= ARC_IN_HASH_TABLE;
 		hdr->b_flags &= ~ARC_BUF_AVAILABLE;
+		if (hdr->b_cdata != NULL)
+			arc_cdata_evicted(hdr);
 
 		mutex_exit(evicted_lock);
 		mutex_exit(lock);
@@ -4036,6 +4344,10 @@ arc_init(void)
 	mutex_init(&arc_eviction_mtx, NULL, MUTEX_DEFAULT, NULL);
 	bzero(&arc_eviction_hdr, sizeof (arc_buf_hdr_t));
 
+	mutex_init(&arc_compressed_mtx, NULL, MUTEX_DEFAULT, NULL);
+	list_create(&arc_compressed_list, sizeof (arc_buf_hdr_t),
+	    offsetof(arc_buf_hdr_t, b_cnode));
+
 	arc_ksp = kstat_create("zfs", 0, "arcstats", "misc", KSTAT_TYPE_NAMED,
 	    sizeof (arc_stats) / sizeof (kstat_named_t), KSTAT_FLAG_VIRTUAL);
 
@@ -4122,6 +4434,8 @@ arc_fini(void)
 	}
 
 	mutex_destroy(&arc_eviction_mtx);
+	list_destroy(&arc_compressed_list);
+	mutex_destroy(&arc_compressed_mtx);
 	mutex_destroy(&arc_reclaim_thr_lock);
 	cv_destroy(&arc_reclaim_thr_cv);
 
@@ -590,8 +590,14 @@ dbuf_read_impl(dmu_buf_impl_t *db, zio_t *zio, uint32_t *flags)
 		*flags |= DB_RF_CACHED;
 }
 
+/*
+ * Like dbuf_read(), but when given a parent zio, also sets *missp if it
+ * issued a demand read that missed the cache, so that the caller can tell
+ * the prefetcher how long it took once the parent zio is done.
+ */
 int
-dbuf_read(dmu_buf_impl_t *db, zio_t *zio, uint32_t flags)
+dbuf_read_miss(dmu_buf_impl_t *db, zio_t *zio, uint32_t flags,
+    boolean_t *missp)
 {
 	int err = 0;
 	int havepzio = (zio != NULL);
@@ -627,6 +633,7 @@ dbuf_read(dmu_buf_impl_t *db, zio_t *zio, uint32_t flags)
 		DB_DNODE_EXIT(db);
 	} else if (db->db_state == DB_UNCACHED) {
 		spa_t *spa = dn->dn_objset->os_spa;
+		hrtime_t start = gethrtime();
 
 		if (zio == NULL)
 			zio = zio_root(spa, NULL, NULL, ZIO_FLAG_CANFAIL);
@@ -642,8 +649,15 @@ dbuf_read(dmu_buf_impl_t *db, zio_t *zio, uint32_t flags)
 			rw_exit(&dn->dn_struct_rwlock);
 		DB_DNODE_EXIT(db);
 
-		if (!havepzio)
+		if (!havepzio) {
 			err = zio_wait(zio);
+			/* the prefetcher sizes its distance after this */
+			if (prefetch && !err && !(flags & DB_RF_CACHED))
+				dmu_zfetch_read_latency(gethrtime() - start);
+		} else if (missp != NULL && prefetch &&
+		    !(flags & DB_RF_CACHED)) {
+			*missp = B_TRUE;
+		}
 	} else {
 		mutex_exit(&db->db_mtx);
 		if (prefetch)
@@ -671,6 +685,12 @@ dbuf_read(dmu_buf_impl_t *db, zio_t *zio, uint32_t flags)
 	return (err);
 }
 
+int
+dbuf_read(dmu_buf_impl_t *db, zio_t *zio, uint32_t flags)
+{
+	return (dbuf_read_miss(db, zio, flags, NULL));
+}
+
 static void
 dbuf_noread(dmu_buf_impl_t *db)
 {
@@ -381,6 +381,7 @@ dmu_buf_hold_array_by_dnode_sparse(dnode_t *dn, uint64_t offset, uint64_t length
 	int err;
 	zio_t *zio;
 	hrtime_t start;
+	boolean_t miss = B_FALSE;
 
 	ASSERT(length <= DMU_MAX_ACCESS);
 
@@ -410,8 +411,7 @@ dmu_buf_hold_array_by_dnode_sparse(dnode_t *dn, uint64_t offset, uint64_t length
 
 	if (dn->dn_objset->os_dsl_dataset)
 		dp = dn->dn_objset->os_dsl_dataset->ds_dir->dd_pool;
-	if (dp && dsl_pool_sync_context(dp))
-		start = gethrtime();
+	start = gethrtime();
 	zio = zio_root(dn->dn_objset->os_spa, NULL, NULL, ZIO_FLAG_CANFAIL);
 	blkid = dbuf_whichblock(dn, offset);
 	for (i = 0; i < nblks; i++) {
@@ -424,7 +424,7 @@ dmu_buf_hold_array_by_dnode_sparse(dnode_t *dn, uint64_t offset, uint64_t length
 		}
 		/* initiate async i/o */
 		if (read)
-			(void) dbuf_read(db, zio, dbuf_flags);
+			(void) dbuf_read_miss(db, zio, dbuf_flags, &miss);
 #ifdef _KERNEL
 #ifndef __OSV__
 		else
@@ -440,6 +440,9 @@ dmu_buf_hold_array_by_dnode_sparse(dnode_t *dn, uint64_t offset, uint64_t length
 	/* track read overhead when we are in sync context */
 	if (dp && dsl_pool_sync_context(dp))
 		dp->dp_read_overhead += gethrtime() - start;
+	/* the prefetcher sizes its distance after the latency of misses */
+	if (miss && !err)
+		dmu_zfetch_read_latency(gethrtime() - start);
 	if (err) {
 		dmu_buf_rele_array(dbp, nblks, tag);
 		return (err);
@@ -1822,6 +1825,19 @@ dmu_object_size_from_db(dmu_buf_t *db_fake, uint32_t *blksize,
 	DB_DNODE_EXIT(db);
 }
 
+void
+dmu_object_zfetch_stats_from_db(dmu_buf_t *db_fake,
+    struct fiozfetchstats *fzs)
+{
+	dmu_buf_impl_t *db = (dmu_buf_impl_t *)db_fake;
+	dnode_t *dn;
+
+	DB_DNODE_ENTER(db);
+	dn = DB_DNODE(db);
+	dmu_zfetch_stats(&dn->dn_zfetch, fzs);
+	DB_DNODE_EXIT(db);
+}
+
 void
 byteswap_uint64_array(void *vbuf, size_t size)
 {
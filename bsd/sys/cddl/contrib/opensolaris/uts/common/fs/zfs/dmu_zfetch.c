@@ -30,6 +30,7 @@
 #include <sys/dmu.h>
 #include <sys/dbuf.h>
 #include <sys/kstat.h>
+#include <sys/filio.h>
 
 /*
  * I'm against tune-ables, but these should probably exist as tweakable globals
@@ -46,6 +47,14 @@ uint32_t	zfetch_min_sec_reap = 2;
 uint32_t	zfetch_block_cap = 256;
 /* number of bytes in a array_read at which we stop prefetching (1Mb) */
 uint64_t	zfetch_array_rd_sz = 1024 * 1024;
+/* size the prefetch distance from consumption rate and read latency */
+int		zfetch_adaptive = 1;
+
+/*
+ * Moving average of the latency of demand reads that missed the cache, in
+ * nanoseconds.  This is how far ahead of a stream we want to be reading.
+ */
+static uint64_t	zfetch_read_latency;
 
 SYSCTL_DECL(_vfs_zfs);
 SYSCTL_INT(_vfs_zfs, OID_AUTO, prefetch_disable, CTLFLAG_RW,
@@ -64,9 +73,13 @@ TUNABLE_QUAD("vfs.zfs.zfetch.array_rd_sz", &zfetch_array_rd_sz);
 SYSCTL_UQUAD(_vfs_zfs_zfetch, OID_AUTO, array_rd_sz, CTLFLAG_RDTUN,
     &zfetch_array_rd_sz, 0,
     "Number of bytes in a array_read at which we stop prefetching");
+TUNABLE_INT("vfs.zfs.zfetch.adaptive", &zfetch_adaptive);
+SYSCTL_INT(_vfs_zfs_zfetch, OID_AUTO, adaptive, CTLFLAG_RW,
+    &zfetch_adaptive, 0, "Adapt prefetch distance to rate and latency");
 
 /* forward decls for static routines */
 static int		dmu_zfetch_colinear(zfetch_t *, zstream_t *);
+static uint64_t		dmu_zfetch_distance(zstream_t *);
 static void		dmu_zfetch_dofetch(zfetch_t *, zstream_t *);
 static uint64_t		dmu_zfetch_fetch(dnode_t *, uint64_t, uint64_t);
 static uint64_t		dmu_zfetch_fetchsz(dnode_t *, uint64_t, uint64_t);
@@ -191,6 +204,68 @@ dmu_zfetch_colinear(zfetch_t *zf, zstream_t *zh)
 	return (0);
 }
 
+/*
+ * Work out the prefetch cap of a stream, i.e. roughly how many blocks ahead
+ * of the reader we prefetch.  Without enough history to go by, the cap
+ * doubles each time the stream advances.  Otherwise it is what the reader
+ * consumes in twice the time a read takes, so the blocks arrive before they
+ * are needed, without prefetching much more than that for slow readers;
+ * the cap is halved at most per step, so it doesn't collapse on a hiccup.
+ */
+static uint64_t
+dmu_zfetch_distance(zstream_t *zs)
+{
+	uint64_t latency = zfetch_read_latency;
+	uint64_t want;
+
+	if (!zfetch_adaptive || latency == 0 || zs->zst_interval == 0)
+		return (MIN(zfetch_block_cap, 2 * zs->zst_cap));
+
+	want = 2 * latency / zs->zst_interval;
+	want = MAX(want, zs->zst_cap / 2);
+	want = MAX(want, zs->zst_len);
+	return (MIN(zfetch_block_cap, want));
+}
+
+/*
+ * Update the consumption rate of a stream, as a moving average of the time
+ * between blocks read, when it is advanced by nblks blocks.
+ */
+static void
+dmu_zfetch_advance(zstream_t *zs, uint64_t nblks)
+{
+	hrtime_t now = gethrtime();
+	uint64_t interval;
+
+	if (zs->zst_atime != 0 && nblks != 0) {
+		interval = (now - zs->zst_atime) / nblks;
+		if (zs->zst_interval == 0)
+			zs->zst_interval = MAX(interval, 1);
+		else
+			zs->zst_interval = MAX((7 * zs->zst_interval +
+			    interval) / 8, 1);
+	}
+	zs->zst_atime = now;
+}
+
+/*
+ * Called with the latency of a demand read that wasn't cached, to keep
+ * track of how long it takes for prefetched blocks to arrive.  Updates race
+ * with each other, which is fine for an estimate.
+ */
+void
+dmu_zfetch_read_latency(hrtime_t latency)
+{
+	uint64_t avg = zfetch_read_latency;
+
+	if (latency <= 0)
+		return;
+	if (avg == 0)
+		zfetch_read_latency = latency;
+	else
+		zfetch_read_latency = (7 * avg + latency) / 8;
+}
+
 /*
  * Given a zstream_t, determine the bounds of the prefetch.  Then call the
  * routine that actually prefetches the individual blocks.
@@ -205,7 +280,7 @@ dmu_zfetch_dofetch(zfetch_t *zf, zstream_t *zs)
 	uint64_t	blocks_fetched;
 
 	zs->zst_stride = MAX((int64_t)zs->zst_stride, zs->zst_len);
-	zs->zst_cap = MIN(zfetch_block_cap, 2 * zs->zst_cap);
+	zs->zst_cap = dmu_zfetch_distance(zs);
 
 	prefetch_tail = MAX((int64_t)zs->zst_ph_offset,
 	    (int64_t)(zs->zst_offset + zs->zst_stride));
@@ -237,6 +312,7 @@ dmu_zfetch_dofetch(zfetch_t *zf, zstream_t *zs)
 
 		blocks_fetched = dmu_zfetch_fetch(zf->zf_dnode,
 		    prefetch_ofst, zs->zst_len);
+		atomic_add_64(&zf->zf_prefetched, blocks_fetched);
 
 		prefetch_tail += zs->zst_stride;
 		/* stop if we've run out of stuff to prefetch */
@@ -285,6 +361,9 @@ dmu_zfetch_init(zfetch_t *zf, dnode_t *dno)
 	zf->zf_dnode = dno;
 	zf->zf_stream_cnt = 0;
 	zf->zf_alloc_fail = 0;
+	zf->zf_hits = 0;
+	zf->zf_misses = 0;
+	zf->zf_prefetched = 0;
 
 	list_create(&zf->zf_stream, sizeof (zstream_t),
 	    offsetof(zstream_t, zst_node));
@@ -527,6 +606,7 @@ top:
 		} else {
 			ZFETCHSTAT_BUMP(zfetchstat_stream_noresets);
 			rc = 1;
+			dmu_zfetch_advance(zs, zh->zst_len);
 			dmu_zfetch_dofetch(zf, zs);
 			mutex_exit(&zs->zst_lock);
 		}
@@ -693,8 +773,10 @@ dmu_zfetch(zfetch_t *zf, uint64_t offset, uint64_t size, int prefetched)
 	fetched = dmu_zfetch_find(zf, &zst, prefetched);
 	if (fetched) {
 		ZFETCHSTAT_BUMP(zfetchstat_hits);
+		atomic_inc_64(&zf->zf_hits);
 	} else {
 		ZFETCHSTAT_BUMP(zfetchstat_misses);
+		atomic_inc_64(&zf->zf_misses);
 		if (fetched = dmu_zfetch_colinear(zf, &zst)) {
 			ZFETCHSTAT_BUMP(zfetchstat_colinear_hits);
 		} else {
@@ -739,6 +821,8 @@ dmu_zfetch(zfetch_t *zf, uint64_t offset, uint64_t size, int prefetched)
 		newstream->zst_cap = zst.zst_len;
 		newstream->zst_direction = ZFETCH_FORWARD;
 		newstream->zst_last = ddi_get_lbolt();
+		newstream->zst_atime = gethrtime();
+		newstream->zst_interval = 0;
 
 		mutex_init(&newstream->zst_lock, NULL, MUTEX_DEFAULT, NULL);
 
@@ -752,3 +836,26 @@ dmu_zfetch(zfetch_t *zf, uint64_t offset, uint64_t size, int prefetched)
 		}
 	}
 }
+
+/*
+ * Report the prefetch statistics of a dnode, for FIOZFETCHSTATS.
+ */
+void
+dmu_zfetch_stats(zfetch_t *zf, struct fiozfetchstats *fzs)
+{
+	zstream_t *zs;
+
+	fzs->fzs_hits = zf->zf_hits;
+	fzs->fzs_misses = zf->zf_misses;
+	fzs->fzs_prefetched = zf->zf_prefetched;
+	fzs->fzs_streams = 0;
+	fzs->fzs_distance = 0;
+
+	rw_enter(&zf->zf_rwlock, RW_READER);
+	for (zs = list_head(&zf->zf_stream); zs;
+	    zs = list_next(&zf->zf_stream, zs)) {
+		fzs->fzs_streams++;
+		fzs->fzs_distance = MAX(fzs->fzs_distance, zs->zst_cap);
+	}
+	rw_exit(&zf->zf_rwlock);
+}
@@ -718,6 +718,9 @@ dnode_move_impl(dnode_t *odn, dnode_t *ndn)
 	ndn->dn_zfetch.zf_dnode = odn->dn_zfetch.zf_dnode;
 	ndn->dn_zfetch.zf_stream_cnt = odn->dn_zfetch.zf_stream_cnt;
 	ndn->dn_zfetch.zf_alloc_fail = odn->dn_zfetch.zf_alloc_fail;
+	ndn->dn_zfetch.zf_hits = odn->dn_zfetch.zf_hits;
+	ndn->dn_zfetch.zf_misses = odn->dn_zfetch.zf_misses;
+	ndn->dn_zfetch.zf_prefetched = odn->dn_zfetch.zf_prefetched;
 
 	/*
 	 * Update back pointers. Updating the handle fixes the back pointer of
@@ -84,6 +84,7 @@ typedef enum zti_modes {
 	ZTI_MODE_FIXED,			/* value is # of threads (min 1) */
 	ZTI_MODE_ONLINE_PERCENT,	/* value is % of online CPUs */
 	ZTI_MODE_BATCH,			/* cpu-intensive; value is ignored */
+	ZTI_MODE_PERCPU,		/* one taskq per cpu, value is # threads */
 	ZTI_MODE_NULL,			/* don't create a taskq */
 	ZTI_NMODES
 } zti_modes_t;
@@ -91,6 +92,7 @@ typedef enum zti_modes {
 #define	ZTI_P(n, q)	{ ZTI_MODE_FIXED, (n), (q) }
 #define	ZTI_PCT(n)	{ ZTI_MODE_ONLINE_PERCENT, (n), 1 }
 #define	ZTI_BATCH	{ ZTI_MODE_BATCH, 0, 1 }
+#define	ZTI_PCPU(n)	{ ZTI_MODE_PERCPU, (n), 0 }
 #define	ZTI_NULL	{ ZTI_MODE_NULL, 0, 0 }
 
 #define	ZTI_N(n)	ZTI_P(n, 1)
@@ -119,6 +121,12 @@ static const char *const zio_taskq_types[ZIO_TASKQ_TYPES] = {
  * taskq and the number of taskqs; when dispatching an event in this case, the
  * particular taskq is chosen at random.
  *
+ * Latency sensitive operations use ZTI_PCPU(#), which creates a taskq per
+ * cpu with its threads bound to that cpu, sharing out the # threads (at
+ * least one per cpu). A zio is dispatched to the taskq of the cpu that
+ * issued it, so its pipeline, and the thread waiting for it, stay on that
+ * cpu instead of bouncing through a shared queue.
+ *
  * The different taskq priorities are to handle the different contexts (issue
  * and interrupt) and then to reserve threads for ZIO_PRIORITY_NOW I/Os that
  * need to be handled with minimum delay.
@@ -126,7 +134,7 @@ static const char *const zio_taskq_types[ZIO_TASKQ_TYPES] = {
 const zio_taskq_info_t zio_taskqs[ZIO_TYPES][ZIO_TASKQ_TYPES] = {
 	/* ISSUE	ISSUE_HIGH	INTR		INTR_HIGH */
 	{ ZTI_ONE,	ZTI_NULL,	ZTI_ONE,	ZTI_NULL }, /* NULL */
-	{ ZTI_N(8),	ZTI_NULL,	ZTI_BATCH,	ZTI_NULL }, /* READ */
+	{ ZTI_PCPU(8),	ZTI_NULL,	ZTI_PCPU(1),	ZTI_NULL }, /* READ */
 	{ ZTI_BATCH,	ZTI_N(5),	ZTI_N(16),	ZTI_N(5) }, /* WRITE */
 	{ ZTI_P(4, 8),	ZTI_NULL,	ZTI_ONE,	ZTI_NULL }, /* FREE */
 	{ ZTI_ONE,	ZTI_NULL,	ZTI_ONE,	ZTI_NULL }, /* CLAIM */
@@ -144,6 +152,10 @@ static int spa_load_impl(spa_t *spa, uint64_t, nvlist_t *config,
 static void spa_vdev_resilver_done(spa_t *spa);
 
 uint_t		zio_taskq_batch_pct = 100;	/* 1 thread per cpu in pset */
+int		zio_taskq_percpu = 1;		/* 0 turns ZTI_PCPU into ZTI_N */
+TUNABLE_INT("vfs.zfs.zio_taskq_percpu", &zio_taskq_percpu);
+SYSCTL_INT(_vfs_zfs, OID_AUTO, zio_taskq_percpu, CTLFLAG_RDTUN,
+    &zio_taskq_percpu, 0, "Use per-cpu taskqs for latency sensitive I/O");
 #ifdef PSRSET_BIND
 id_t		zio_taskq_psrset_bind = PS_NONE;
 #endif
@@ -840,9 +852,22 @@ spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 	if (mode == ZTI_MODE_NULL) {
 		tqs->stqs_count = 0;
 		tqs->stqs_taskq = NULL;
+		tqs->stqs_percpu = B_FALSE;
 		return;
 	}
 
+	if (mode == ZTI_MODE_PERCPU) {
+		if (zio_taskq_percpu && boot_ncpus > 1) {
+			count = boot_ncpus;
+			value = MAX(value / count, 1);
+		} else {
+			mode = ZTI_MODE_FIXED;
+			count = 1;
+			value = MAX(value, boot_ncpus);
+		}
+	}
+	tqs->stqs_percpu = (mode == ZTI_MODE_PERCPU);
+
 	ASSERT3U(count, >, 0);
 
 	tqs->stqs_count = count;
@@ -867,6 +892,9 @@ spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 			flags |= TASKQ_THREADS_CPU_PCT;
 			break;
 
+		case ZTI_MODE_PERCPU:
+			break;
+
 		default:
 			panic("unrecognized mode for %s_%s taskq (%u:%u) in "
 			    "spa_activate()",
@@ -882,6 +910,12 @@ spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 			    zio_type_name[t], zio_taskq_types[q]);
 		}
 
+		if (tqs->stqs_percpu) {
+			tqs->stqs_taskq[i] = taskq_create_pinned(name, value,
+			    maxclsyspri, i);
+			continue;
+		}
+
 #ifdef SYSDC
 		if (zio_taskq_sysdc && spa->spa_proc != &p0) {
 			if (batch)
@@ -924,11 +958,12 @@ spa_taskqs_fini(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
  * Dispatch a task to the appropriate taskq for the ZFS I/O type and priority.
  * Note that a type may have multiple discrete taskqs to avoid lock contention
  * on the taskq itself. In that case we choose which taskq at random by using
- * the low bits of gethrtime().
+ * the low bits of gethrtime(), unless they are per-cpu taskqs, where we use
+ * the one bound to cpu.
  */
 void
-spa_taskq_dispatch_ent(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
-    task_func_t *func, void *arg, uint_t flags, void *task)
+spa_taskq_dispatch_cpu(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
+    task_func_t *func, void *arg, uint_t flags, void *task, int cpu)
 {
 	spa_taskqs_t *tqs = &spa->spa_zio_taskq[t][q];
 	taskq_t *tq;
@@ -938,6 +973,8 @@ spa_taskq_dispatch_ent(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
 
 	if (tqs->stqs_count == 1) {
 		tq = tqs->stqs_taskq[0];
+	} else if (tqs->stqs_percpu) {
+		tq = tqs->stqs_taskq[cpu % tqs->stqs_count];
 	} else {
 		tq = tqs->stqs_taskq[gethrtime() % tqs->stqs_count];
 	}
@@ -949,6 +986,13 @@ spa_taskq_dispatch_ent(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
 #endif
 }
 
+void
+spa_taskq_dispatch_ent(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
+    task_func_t *func, void *arg, uint_t flags, void *task)
+{
+	spa_taskq_dispatch_cpu(spa, t, q, func, arg, flags, task, CPU_SEQID);
+}
+
 static void
 spa_create_zio_taskqs(spa_t *spa)
 {
@@ -1667,6 +1667,43 @@ spa_has_slogs(spa_t *spa)
 	return (spa->spa_log_class->mc_rotor != NULL);
 }
 
+static boolean_t
+vdev_has_leaf_path(vdev_t *vd, const char *path)
+{
+	if (vd->vdev_ops->vdev_op_leaf)
+		return (vd->vdev_path != NULL &&
+		    strcmp(vd->vdev_path, path) == 0);
+	for (int c = 0; c < vd->vdev_children; c++) {
+		if (vdev_has_leaf_path(vd->vdev_child[c], path))
+			return (B_TRUE);
+	}
+	return (B_FALSE);
+}
+
+/*
+ * Whether the named pool has a log device at the given path, so that OSv
+ * doesn't try to add it again on every boot.
+ */
+boolean_t
+spa_has_log_device(const char *pool, const char *path)
+{
+	spa_t *spa;
+	vdev_t *rvd;
+	boolean_t found = B_FALSE;
+
+	if (spa_open(pool, &spa, FTAG) != 0)
+		return (B_FALSE);
+	spa_config_enter(spa, SCL_VDEV, FTAG, RW_READER);
+	rvd = spa->spa_root_vdev;
+	for (int c = 0; c < rvd->vdev_children && !found; c++) {
+		vdev_t *tvd = rvd->vdev_child[c];
+		found = tvd->vdev_islog && vdev_has_leaf_path(tvd, path);
+	}
+	spa_config_exit(spa, SCL_VDEV, FTAG);
+	spa_close(spa, FTAG);
+	return (found);
+}
+
 spa_log_state_t
 spa_get_log_state(spa_t *spa)
 {
@@ -676,6 +676,13 @@ void dmu_object_info_from_db(dmu_buf_t *db, dmu_object_info_t *doi);
 void dmu_object_size_from_db(dmu_buf_t *db, uint32_t *blksize,
     u_longlong_t *nblk512);
 
+/*
+ * Get the prefetch statistics of the object, see FIOZFETCHSTATS.
+ */
+struct fiozfetchstats;
+void dmu_object_zfetch_stats_from_db(dmu_buf_t *db,
+    struct fiozfetchstats *fzs);
+
 typedef struct dmu_objset_stats {
 	uint64_t dds_num_clones; /* number of clones of this */
 	uint64_t dds_creation_txg;
@@ -33,8 +33,12 @@ extern "C" {
 #endif
 
 extern uint64_t	zfetch_array_rd_sz;
+extern uint32_t	zfetch_max_streams;
+extern uint32_t	zfetch_block_cap;
+extern int	zfetch_adaptive;
 
 struct dnode;				/* so we can reference dnode */
+struct fiozfetchstats;
 
 typedef enum zfetch_dirn {
 	ZFETCH_FORWARD = 1,		/* prefetch increasing block numbers */
@@ -50,6 +54,8 @@ typedef struct zstream {
 	uint64_t	zst_cap;	/* prefetch limit (cap), in blocks */
 	kmutex_t	zst_lock;	/* protects stream */
 	clock_t		zst_last;	/* lbolt of last prefetch */
+	hrtime_t	zst_atime;	/* time of last access */
+	uint64_t	zst_interval;	/* avg ns between blocks read */
 	avl_node_t	zst_node;	/* embed avl node here */
 } zstream_t;
 
@@ -59,6 +65,9 @@ typedef struct zfetch {
 	struct dnode	*zf_dnode;	/* dnode that owns this zfetch */
 	uint32_t	zf_stream_cnt;	/* # of active streams */
 	uint64_t	zf_alloc_fail;	/* # of failed attempts to alloc strm */
+	uint64_t	zf_hits;	/* # of reads that followed a stream */
+	uint64_t	zf_misses;	/* # of reads that followed none */
+	uint64_t	zf_prefetched;	/* # of blocks prefetched */
 } zfetch_t;
 
 void		zfetch_init(void);
@@ -67,6 +76,8 @@ void		zfetch_fini(void);
 void		dmu_zfetch_init(zfetch_t *, struct dnode *);
 void		dmu_zfetch_rele(zfetch_t *);
 void		dmu_zfetch(zfetch_t *, uint64_t, uint64_t, int);
+void		dmu_zfetch_read_latency(hrtime_t);
+void		dmu_zfetch_stats(zfetch_t *, struct fiozfetchstats *);
 
 
 #ifdef	__cplusplus
@@ -110,6 +110,7 @@ typedef enum spa_proc_state {
 typedef struct spa_taskqs {
 	uint_t stqs_count;
 	taskq_t **stqs_taskq;
+	boolean_t stqs_percpu;	/* stqs_taskq[i] is bound to cpu i */
 } spa_taskqs_t;
 
 struct spa {
@@ -249,6 +250,8 @@ extern const char *spa_config_path;
 
 extern void spa_taskq_dispatch_ent(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
 	task_func_t *func, void *arg, uint_t flags, void *ent);
+extern void spa_taskq_dispatch_cpu(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
+	task_func_t *func, void *arg, uint_t flags, void *ent, int cpu);
 
 #ifdef	__cplusplus
 }
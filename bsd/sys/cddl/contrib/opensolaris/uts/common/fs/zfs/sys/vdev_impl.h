@@ -99,6 +99,12 @@ struct vdev_cache {
 	kmutex_t	vc_lock;
 };
 
+/*
+ * Leaf i/o latency histogram: bucket 0 counts the i/os that took under 1us,
+ * bucket n those that took [2^(n-1), 2^n) us, the last one all slower ones.
+ */
+#define	VDEV_LAT_BUCKETS	24
+
 struct vdev_queue {
 	avl_tree_t	vq_deadline_tree;
 	avl_tree_t	vq_read_tree;
@@ -135,6 +141,7 @@ struct vdev {
 	uint64_t	vdev_children;	/* number of children		*/
 	space_map_t	vdev_dtl[DTL_TYPES]; /* in-core dirty time logs	*/
 	vdev_stat_t	vdev_stat;	/* virtual device statistics	*/
+	uint64_t	vdev_lat_histo[ZIO_TYPES][VDEV_LAT_BUCKETS]; /* leaf */
 	boolean_t	vdev_expanding;	/* expand the vdev?		*/
 	boolean_t	vdev_reopening;	/* reopen in progress?		*/
 	int		vdev_open_error; /* error on last open		*/
@@ -117,6 +117,9 @@ struct zilog {
 	uint64_t	zl_next_batch;	/* next batch number */
 	uint64_t	zl_com_batch;	/* committed batch number */
 	kcondvar_t	zl_cv_batch[2];	/* batch condition variables */
+	kcondvar_t	zl_cv_commit;	/* batch completion, in order */
+	uint64_t	zl_inflight;	/* batches issued, not committed */
+	uint64_t	zl_error_batch;	/* last batch to fall back to sync */
 	itxg_t		zl_itxg[TXG_SIZE]; /* intent log txg chains */
 	list_t		zl_itx_commit_list; /* itx list to be committed */
 	uint64_t	zl_itx_list_sz;	/* total size of records on list */
@@ -107,9 +107,33 @@ enum zio_compress {
 	ZIO_COMPRESS_GZIP_9,
 	ZIO_COMPRESS_ZLE,
 	ZIO_COMPRESS_LZ4,
+	ZIO_COMPRESS_ZSTD_1,
+	ZIO_COMPRESS_ZSTD_2,
+	ZIO_COMPRESS_ZSTD_3,
+	ZIO_COMPRESS_ZSTD_4,
+	ZIO_COMPRESS_ZSTD_5,
+	ZIO_COMPRESS_ZSTD_6,
+	ZIO_COMPRESS_ZSTD_7,
+	ZIO_COMPRESS_ZSTD_8,
+	ZIO_COMPRESS_ZSTD_9,
+	ZIO_COMPRESS_ZSTD_10,
+	ZIO_COMPRESS_ZSTD_11,
+	ZIO_COMPRESS_ZSTD_12,
+	ZIO_COMPRESS_ZSTD_13,
+	ZIO_COMPRESS_ZSTD_14,
+	ZIO_COMPRESS_ZSTD_15,
+	ZIO_COMPRESS_ZSTD_16,
+	ZIO_COMPRESS_ZSTD_17,
+	ZIO_COMPRESS_ZSTD_18,
+	ZIO_COMPRESS_ZSTD_19,
 	ZIO_COMPRESS_FUNCTIONS
 };
 
+#define	ZIO_COMPRESS_ZSTD_DEFAULT	ZIO_COMPRESS_ZSTD_3
+#define	ZIO_COMPRESS_IS_ZSTD(compress)			\
+	((compress) >= ZIO_COMPRESS_ZSTD_1 &&		\
+	(compress) <= ZIO_COMPRESS_ZSTD_19)
+
 /* N.B. when altering this value, also change BOOTFS_COMPRESS_VALID below */
 #define	ZIO_COMPRESS_ON_VALUE	ZIO_COMPRESS_LZJB
 #define	ZIO_COMPRESS_DEFAULT	ZIO_COMPRESS_OFF
@@ -408,6 +432,7 @@ struct zio {
 
 	uint64_t	io_offset;
 	uint64_t	io_deadline;
+	hrtime_t	io_timestamp;	/* leaf i/o queued, for latency */
 	avl_node_t	io_offset_node;
 	avl_node_t	io_deadline_node;
 	avl_tree_t	*io_vdev_tree;
@@ -429,6 +454,7 @@ struct zio {
 	zio_gang_node_t	*io_gang_tree;
 	void		*io_executor;
 	void		*io_waiter;
+	int		io_cpu;		/* cpu the logical I/O was issued on */
 	kmutex_t	io_lock;
 	kcondvar_t	io_cv;
 
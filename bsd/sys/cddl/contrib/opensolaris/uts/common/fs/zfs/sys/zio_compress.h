@@ -75,6 +75,12 @@ extern size_t lz4_compress(void *src, void *dst, size_t s_len, size_t d_len,
     int level);
 extern int lz4_decompress(void *src, void *dst, size_t s_len, size_t d_len,
     int level);
+extern size_t zstd_compress(void *src, void *dst, size_t s_len, size_t d_len,
+    int level);
+extern int zstd_decompress(void *src, void *dst, size_t s_len, size_t d_len,
+    int level);
+extern void zstd_init(void);
+extern void zstd_fini(void);
 
 /*
  * Compress and decompress data if necessary.
@@ -42,6 +42,9 @@
 #include <sys/arc.h>
 #include <sys/zil.h>
 #include <sys/dsl_scan.h>
+#include <osv/zfs_stats.h>
+
+CTASSERT(VDEV_LAT_BUCKETS == ZFS_LAT_BUCKETS);
 
 SYSCTL_DECL(_vfs_zfs);
 SYSCTL_NODE(_vfs_zfs, OID_AUTO, vdev, CTLFLAG_RW, 0, "ZFS VDEV");
@@ -2359,6 +2362,10 @@ vdev_clear(spa_t *spa, vdev_t *vd)
 	vd->vdev_stat.vs_write_errors = 0;
 	vd->vdev_stat.vs_checksum_errors = 0;
 
+	mutex_enter(&vd->vdev_stat_lock);
+	bzero(vd->vdev_lat_histo, sizeof (vd->vdev_lat_histo));
+	mutex_exit(&vd->vdev_stat_lock);
+
 	for (int c = 0; c < vd->vdev_children; c++)
 		vdev_clear(spa, vd->vdev_child[c]);
 
@@ -2504,6 +2511,90 @@ vdev_get_stats(vdev_t *vd, vdev_stat_t *vs)
 	}
 }
 
+/*
+ * Add the queue depths and latency histograms of the leaves under vd to zvs.
+ */
+static void
+vdev_iostat_sum_leaves(vdev_t *vd, struct zfs_vdev_iostat *zvs)
+{
+	vdev_queue_t *vq = &vd->vdev_queue;
+
+	if (!vd->vdev_ops->vdev_op_leaf) {
+		for (int c = 0; c < vd->vdev_children; c++)
+			vdev_iostat_sum_leaves(vd->vdev_child[c], zvs);
+		return;
+	}
+
+	mutex_enter(&vq->vq_lock);
+	zvs->queued += avl_numnodes(&vq->vq_deadline_tree);
+	zvs->pending += avl_numnodes(&vq->vq_pending_tree);
+	mutex_exit(&vq->vq_lock);
+
+	mutex_enter(&vd->vdev_stat_lock);
+	for (int b = 0; b < VDEV_LAT_BUCKETS; b++) {
+		zvs->read_latency[b] += vd->vdev_lat_histo[ZIO_TYPE_READ][b];
+		zvs->write_latency[b] += vd->vdev_lat_histo[ZIO_TYPE_WRITE][b];
+	}
+	mutex_exit(&vd->vdev_stat_lock);
+}
+
+static void
+vdev_iostat_walk(vdev_t *vd, int level,
+    void (*fn)(const struct zfs_vdev_iostat *, void *), void *arg)
+{
+	struct zfs_vdev_iostat zvs;
+	char name[32];
+	vdev_stat_t vs;
+
+	bzero(&zvs, sizeof (zvs));
+	if (vd == vd->vdev_spa->spa_root_vdev) {
+		zvs.name = spa_name(vd->vdev_spa);
+	} else if (vd->vdev_path != NULL) {
+		zvs.name = vd->vdev_path;
+	} else {
+		(void) snprintf(name, sizeof (name), "%s-%llu",
+		    vd->vdev_ops->vdev_op_type, (u_longlong_t)vd->vdev_id);
+		zvs.name = name;
+	}
+	zvs.level = level;
+
+	vdev_get_stats(vd, &vs);
+	zvs.read_ops = vs.vs_ops[ZIO_TYPE_READ];
+	zvs.write_ops = vs.vs_ops[ZIO_TYPE_WRITE];
+	zvs.read_bytes = vs.vs_bytes[ZIO_TYPE_READ];
+	zvs.write_bytes = vs.vs_bytes[ZIO_TYPE_WRITE];
+	vdev_iostat_sum_leaves(vd, &zvs);
+
+	fn(&zvs, arg);
+
+	for (int c = 0; c < vd->vdev_children; c++)
+		vdev_iostat_walk(vd->vdev_child[c], level + 1, fn, arg);
+}
+
+/*
+ * Report the i/o statistics of every vdev of the named pool, for the
+ * monitoring API.  Only counters are copied, so this is cheap enough to
+ * be polled.
+ */
+int
+zfs_pool_iostat(const char *pool,
+    void (*fn)(const struct zfs_vdev_iostat *, void *), void *arg)
+{
+	spa_t *spa;
+	int error;
+
+	if ((error = spa_open(pool, &spa, FTAG)) != 0)
+		return (error);
+
+	spa_config_enter(spa, SCL_VDEV, FTAG, RW_READER);
+	vdev_iostat_walk(spa->spa_root_vdev, 0, fn, arg);
+	spa_config_exit(spa, SCL_VDEV, FTAG);
+
+	spa_close(spa, FTAG);
+
+	return (0);
+}
+
 void
 vdev_clear_stats(vdev_t *vd)
 {
@@ -2511,6 +2602,7 @@ vdev_clear_stats(vdev_t *vd)
 	vd->vdev_stat.vs_space = 0;
 	vd->vdev_stat.vs_dspace = 0;
 	vd->vdev_stat.vs_alloc = 0;
+	bzero(vd->vdev_lat_histo, sizeof (vd->vdev_lat_histo));
 	mutex_exit(&vd->vdev_stat_lock);
 }
 
@@ -2589,6 +2681,14 @@ vdev_stat_update(zio_t *zio, uint64_t psize)
 		vs->vs_ops[type]++;
 		vs->vs_bytes[type] += psize;
 
+		if (vd->vdev_ops->vdev_op_leaf && zio->io_timestamp != 0) {
+			hrtime_t us = (gethrtime() - zio->io_timestamp) /
+			    (NANOSEC / MICROSEC);
+			int b = MIN(highbit(us), VDEV_LAT_BUCKETS - 1);
+
+			vd->vdev_lat_histo[type][b]++;
+		}
+
 		mutex_exit(&vd->vdev_stat_lock);
 		return;
 	}
@@ -28,6 +28,7 @@
 #include <sys/types.h>
 #include <osv/bio.h>
 #include <osv/device.h>
+#include <osv/devstat.h>
 
 #include <sys/zfs_context.h>
 #include <sys/spa_impl.h>
@@ -146,6 +147,11 @@ vdev_disk_start_bio(zio_t *zio)
 	bio->bio_caller1 = zio;
 	bio->bio_done = vdev_disk_bio_done;
 
+	/* An aggregated i/o is a child of each of the i/os it merged. */
+	if (zio->io_parent_count > 1)
+		devstat_merged(bio->bio_dev, bio->bio_cmd,
+		    zio->io_parent_count - 1);
+
 	bio->bio_dev->driver->devops->strategy(bio);
 	return ZIO_PIPELINE_STOP;
 }
@@ -302,6 +302,15 @@ zfs_ioctl(vnode_t *vp, file_t *fp, u_long com, void *data)
 		*(offset_t *)data = off;
 #endif
 		return (0);
+
+	case FIOZFETCHSTATS:
+		zp = VTOZ(vp);
+		zfsvfs = zp->z_zfsvfs;
+		ZFS_ENTER(zfsvfs);
+		ZFS_VERIFY_ZP(zp);
+		dmu_object_zfetch_stats_from_db(sa_get_db(zp->z_sa_hdl), data);
+		ZFS_EXIT(zfsvfs);
+		return (0);
 	}
 	return (ENOTTY);
 }
@@ -84,6 +84,17 @@ TUNABLE_INT("vfs.zfs.cache_flush_disable", &zfs_nocacheflush);
 SYSCTL_INT(_vfs_zfs, OID_AUTO, cache_flush_disable, CTLFLAG_RDTUN,
     &zfs_nocacheflush, 0, "Disable cache flush");
 
+/*
+ * Number of commit batches that may have their log blocks in flight at
+ * once.  A batch is issued as soon as the previous one has handed its log
+ * blocks to the pipeline, rather than after they are on stable storage.
+ * Setting this to 1 serializes commits as before.
+ */
+int zil_max_inflight = 4;
+TUNABLE_INT("vfs.zfs.zil_max_inflight", &zil_max_inflight);
+SYSCTL_INT(_vfs_zfs, OID_AUTO, zil_max_inflight, CTLFLAG_RW,
+    &zil_max_inflight, 0, "Maximum number of ZIL commit batches in flight");
+
 static kmem_cache_t *zil_lwb_cache;
 
 static void zil_async_to_sync(zilog_t *zilog, uint64_t foid);
@@ -763,12 +774,10 @@ zil_add_block(zilog_t *zilog, const blkptr_t *bp)
 	if (zfs_nocacheflush)
 		return;
 
-	ASSERT(zilog->zl_writer);
-
 	/*
-	 * Even though we're zl_writer, we still need a lock because the
+	 * The tree is shared by all the batches in flight, and the
 	 * zl_get_data() callbacks may have dmu_sync() done callbacks
-	 * that will run concurrently.
+	 * that will run concurrently with the next writer.
 	 */
 	mutex_enter(&zilog->zl_vdev_lock);
 	for (i = 0; i < ndvas; i++) {
@@ -782,33 +791,42 @@ zil_add_block(zilog_t *zilog, const blkptr_t *bp)
 	mutex_exit(&zilog->zl_vdev_lock);
 }
 
+/*
+ * Flush the vdevs written by a batch.  All of its blocks, including those
+ * added by zl_get_data() callbacks, are in the tree by the time its root
+ * zio is done; later batches may be adding theirs meanwhile, so we flush
+ * a snapshot of the tree and leave it alone.  Flushing a vdev early on
+ * behalf of a later batch is harmless.
+ */
 static void
 zil_flush_vdevs(zilog_t *zilog)
 {
 	spa_t *spa = zilog->zl_spa;
 	avl_tree_t *t = &zilog->zl_vdev_tree;
-	void *cookie = NULL;
 	zil_vdev_node_t *zv;
+	uint64_t *vdevs;
+	int i, n;
 	zio_t *zio;
 
-	ASSERT(zilog->zl_writer);
-
-	/*
-	 * We don't need zl_vdev_lock here because we're the zl_writer,
-	 * and all zl_get_data() callbacks are done.
-	 */
-	if (avl_numnodes(t) == 0)
+	mutex_enter(&zilog->zl_vdev_lock);
+	n = avl_numnodes(t);
+	if (n == 0) {
+		mutex_exit(&zilog->zl_vdev_lock);
 		return;
+	}
+	vdevs = kmem_alloc(n * sizeof (uint64_t), KM_SLEEP);
+	for (i = 0, zv = avl_first(t); zv != NULL; zv = AVL_NEXT(t, zv))
+		vdevs[i++] = zv->zv_vdev;
+	mutex_exit(&zilog->zl_vdev_lock);
 
 	spa_config_enter(spa, SCL_STATE, FTAG, RW_READER);
 
 	zio = zio_root(spa, NULL, NULL, ZIO_FLAG_CANFAIL);
 
-	while ((zv = avl_destroy_nodes(t, &cookie)) != NULL) {
-		vdev_t *vd = vdev_lookup_top(spa, zv->zv_vdev);
+	for (i = 0; i < n; i++) {
+		vdev_t *vd = vdev_lookup_top(spa, vdevs[i]);
 		if (vd != NULL)
 			zio_flush(zio, vd);
-		kmem_free(zv, sizeof (*zv));
 	}
 
 	/*
@@ -818,6 +836,27 @@ zil_flush_vdevs(zilog_t *zilog)
 	(void) zio_wait(zio);
 
 	spa_config_exit(spa, SCL_STATE, FTAG);
+
+	kmem_free(vdevs, n * sizeof (uint64_t));
+}
+
+/*
+ * Forget the vdevs to flush, once no batch is in flight.
+ */
+static void
+zil_clear_vdevs(zilog_t *zilog)
+{
+	avl_tree_t *t = &zilog->zl_vdev_tree;
+	void *cookie = NULL;
+	zil_vdev_node_t *zv;
+
+	ASSERT(MUTEX_HELD(&zilog->zl_lock));
+	ASSERT(zilog->zl_inflight == 0);
+
+	mutex_enter(&zilog->zl_vdev_lock);
+	while ((zv = avl_destroy_nodes(t, &cookie)) != NULL)
+		kmem_free(zv, sizeof (*zv));
+	mutex_exit(&zilog->zl_vdev_lock);
 }
 
 /*
@@ -1440,17 +1479,25 @@ zil_async_to_sync(zilog_t *zilog, uint64_t foid)
 	}
 }
 
-static void
-zil_commit_writer(zilog_t *zilog)
+/*
+ * Issue the log blocks for the commit list.  Returns the root zio of the
+ * writes, for the caller to wait on (NULL if nothing was written), and sets
+ * *fallback if the records couldn't all be logged, so that the caller has
+ * to wait for the txg to sync instead.
+ */
+static zio_t *
+zil_commit_writer(zilog_t *zilog, boolean_t *fallback)
 {
 	uint64_t txg;
 	itx_t *itx;
 	lwb_t *lwb;
+	zio_t *root;
 	spa_t *spa = zilog->zl_spa;
-	int error = 0;
 
 	ASSERT(zilog->zl_root_zio == NULL);
 
+	*fallback = B_FALSE;
+
 	mutex_exit(&zilog->zl_lock);
 
 	zil_get_commit_list(zilog);
@@ -1461,7 +1508,7 @@ zil_commit_writer(zilog_t *zilog)
 	 */
 	if (list_head(&zilog->zl_itx_commit_list) == NULL) {
 		mutex_enter(&zilog->zl_lock);
-		return;
+		return (NULL);
 	}
 
 	if (zilog->zl_suspend) {
@@ -1492,26 +1539,15 @@ zil_commit_writer(zilog_t *zilog)
 	zilog->zl_cur_used = 0;
 
 	/*
-	 * Wait if necessary for the log blocks to be on stable storage.
+	 * The blocks of the next batch will hang off a root zio of its own.
 	 */
-	if (zilog->zl_root_zio) {
-		error = zio_wait(zilog->zl_root_zio);
-		zilog->zl_root_zio = NULL;
-		zil_flush_vdevs(zilog);
-	}
-
-	if (error || lwb == NULL)
-		txg_wait_synced(zilog->zl_dmu_pool, 0);
+	root = zilog->zl_root_zio;
+	zilog->zl_root_zio = NULL;
 
 	mutex_enter(&zilog->zl_lock);
 
-	/*
-	 * Remember the highest committed log sequence number for ztest.
-	 * We only update this value when all the log writes succeeded,
-	 * because ztest wants to ASSERT that it got the whole log chain.
-	 */
-	if (error == 0 && lwb != NULL)
-		zilog->zl_commit_lr_seq = zilog->zl_lr_seq;
+	*fallback = (lwb == NULL);
+	return (root);
 }
 
 /*
@@ -1525,10 +1561,17 @@ zil_commit_writer(zilog_t *zilog)
  * Those cthreads are all waiting on the same cv for that batch.
  *
  * There will also be a different and growing batch of threads that are
- * waiting to commit (qthreads). When the committing batch completes
- * a transition occurs such that the cthreads exit and the qthreads become
- * cthreads. One of the new cthreads becomes the writer thread for the
- * batch. Any new threads arriving become new qthreads.
+ * waiting to commit (qthreads). Once the writer has issued its log blocks,
+ * one of the qthreads becomes the writer of the next batch and the others
+ * become its cthreads, while the blocks of the first batch are still being
+ * written.  Up to zil_max_inflight batches can be in flight like this, so
+ * the log device sees several log block writes at once rather than one
+ * commit at a time.  Any new threads arriving become new qthreads.
+ *
+ * Since the log blocks of a batch are chained after those of the previous
+ * one, a batch is only complete once all of the earlier ones are: each
+ * writer waits on zl_cv_commit for its turn before announcing its batch
+ * as committed.
  *
  * Only 2 condition variables are needed and there's no transition
  * between the two cvs needed. They just flip-flop between qthreads
@@ -1540,7 +1583,10 @@ zil_commit_writer(zilog_t *zilog)
 void
 zil_commit(zilog_t *zilog, uint64_t foid)
 {
-	uint64_t mybatch;
+	uint64_t mybatch, lr_seq;
+	boolean_t fallback;
+	zio_t *root;
+	int error = 0;
 
 	if (zilog->zl_sync == ZFS_SYNC_DISABLED)
 		return;
@@ -1550,26 +1596,88 @@ zil_commit(zilog_t *zilog, uint64_t foid)
 
 	mutex_enter(&zilog->zl_lock);
 	mybatch = zilog->zl_next_batch;
-	while (zilog->zl_writer) {
-		cv_wait(&zilog->zl_cv_batch[mybatch & 1], &zilog->zl_lock);
+	for (;;) {
 		if (mybatch <= zilog->zl_com_batch) {
 			mutex_exit(&zilog->zl_lock);
 			return;
 		}
+		if (mybatch == zilog->zl_next_batch && !zilog->zl_writer &&
+		    zilog->zl_inflight < MAX(zil_max_inflight, 1))
+			break;
+		cv_wait(&zilog->zl_cv_batch[mybatch & 1], &zilog->zl_lock);
 	}
 
 	zilog->zl_next_batch++;
 	zilog->zl_writer = B_TRUE;
-	zil_commit_writer(zilog);
+	zilog->zl_inflight++;
+	root = zil_commit_writer(zilog, &fallback);
+	lr_seq = zilog->zl_lr_seq;
+
+	/*
+	 * If we couldn't log everything the lwb chain is broken, and the
+	 * next batch must not start until the txg has synced.  Otherwise
+	 * let a thread of the next batch become its writer.  That cv is
+	 * also waited on by the cthreads of the batch before ours, so they
+	 * all have to be woken up.
+	 */
+	if (!fallback) {
+		zilog->zl_writer = B_FALSE;
+		cv_broadcast(&zilog->zl_cv_batch[(mybatch + 1) & 1]);
+	}
+	mutex_exit(&zilog->zl_lock);
+
+	/*
+	 * Wait if necessary for the log blocks to be on stable storage.
+	 */
+	if (root != NULL) {
+		error = zio_wait(root);
+		zil_flush_vdevs(zilog);
+	}
+
+	if (error || fallback)
+		txg_wait_synced(zilog->zl_dmu_pool, 0);
+
+	mutex_enter(&zilog->zl_lock);
+	while (zilog->zl_com_batch + 1 != mybatch)
+		cv_wait(&zilog->zl_cv_commit, &zilog->zl_lock);
+
+	if (error || fallback) {
+		/*
+		 * The batches issued before our txg sync may have chained
+		 * their blocks after one that never made it to disk.
+		 */
+		zilog->zl_error_batch = zilog->zl_next_batch - 1;
+	} else if (mybatch <= zilog->zl_error_batch) {
+		mutex_exit(&zilog->zl_lock);
+		txg_wait_synced(zilog->zl_dmu_pool, 0);
+		mutex_enter(&zilog->zl_lock);
+		error = EIO;
+	}
+
+	/*
+	 * Remember the highest committed log sequence number for ztest.
+	 * We only update this value when all the log writes succeeded,
+	 * because ztest wants to ASSERT that it got the whole log chain.
+	 */
+	if (error == 0 && !fallback && root != NULL)
+		zilog->zl_commit_lr_seq = lr_seq;
+
 	zilog->zl_com_batch = mybatch;
-	zilog->zl_writer = B_FALSE;
+	if (fallback)
+		zilog->zl_writer = B_FALSE;
+	if (--zilog->zl_inflight == 0)
+		zil_clear_vdevs(zilog);
 	mutex_exit(&zilog->zl_lock);
 
-	/* wake up one thread to become the next writer */
-	cv_signal(&zilog->zl_cv_batch[(mybatch+1) & 1]);
+	/* let the next batch complete */
+	cv_broadcast(&zilog->zl_cv_commit);
 
-	/* wake up all threads waiting for this batch to be committed */
-	cv_broadcast(&zilog->zl_cv_batch[mybatch & 1]);
+	/*
+	 * Wake up all threads waiting for this batch to be committed, and
+	 * those waiting for room to issue the next one.
+	 */
+	cv_broadcast(&zilog->zl_cv_batch[0]);
+	cv_broadcast(&zilog->zl_cv_batch[1]);
 }
 
 /*
@@ -1706,6 +1814,7 @@ zil_alloc(objset_t *os, zil_header_t *zh_phys)
 	cv_init(&zilog->zl_cv_suspend, NULL, CV_DEFAULT, NULL);
 	cv_init(&zilog->zl_cv_batch[0], NULL, CV_DEFAULT, NULL);
 	cv_init(&zilog->zl_cv_batch[1], NULL, CV_DEFAULT, NULL);
+	cv_init(&zilog->zl_cv_commit, NULL, CV_DEFAULT, NULL);
 
 	return (zilog);
 }
@@ -1743,6 +1852,7 @@ zil_free(zilog_t *zilog)
 	cv_destroy(&zilog->zl_cv_suspend);
 	cv_destroy(&zilog->zl_cv_batch[0]);
 	cv_destroy(&zilog->zl_cv_batch[1]);
+	cv_destroy(&zilog->zl_cv_commit);
 
 	kmem_free(zilog, sizeof (zilog_t));
 }
@@ -212,6 +212,7 @@ zio_init(void)
 		zfs_mg_alloc_failures = 8;
 
 	zio_inject_init();
+	zstd_init();
 }
 
 void
@@ -239,6 +240,7 @@ zio_fini(void)
 	kmem_cache_destroy(zio_cache);
 
 	zio_inject_fini();
+	zstd_fini();
 }
 
 /*
@@ -607,6 +609,8 @@ zio_create(zio_t *pio, spa_t *spa, uint64_t txg, const blkptr_t *bp,
 	if (zb != NULL)
 		zio->io_bookmark = *zb;
 
+	zio->io_cpu = (pio != NULL) ? pio->io_cpu : CPU_SEQID;
+
 	if (pio != NULL) {
 		if (zio->io_logical == NULL)
 			zio->io_logical = pio->io_logical;
@@ -1168,8 +1172,12 @@ zio_taskq_dispatch(zio_t *zio, enum zio_taskq_type q, boolean_t cutinline)
 		q++;
 
 	ASSERT3U(q, <, ZIO_TASKQ_TYPES);
-	spa_taskq_dispatch_ent(spa, t, q, (task_func_t *)zio_execute, zio,
-	    flags, &zio->io_tqent);
+	/*
+	 * Per-cpu taskqs run the zio on the cpu that issued it, where its
+	 * waiter and its data most likely still are.
+	 */
+	spa_taskq_dispatch_cpu(spa, t, q, (task_func_t *)zio_execute, zio,
+	    flags, &zio->io_tqent, zio->io_cpu);
 }
 
 static boolean_t
@@ -2492,6 +2500,8 @@ zio_vdev_io_start(zio_t *zio)
 		if (zio->io_type == ZIO_TYPE_READ && vdev_cache_read(zio) == 0)
 			return (ZIO_PIPELINE_CONTINUE);
 
+		zio->io_timestamp = gethrtime();
+
 		if ((zio = vdev_queue_io(zio)) == NULL)
 			return (ZIO_PIPELINE_STOP);
 
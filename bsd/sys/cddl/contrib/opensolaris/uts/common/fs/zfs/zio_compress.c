@@ -54,6 +54,25 @@ zio_compress_info_t zio_compress_table[ZIO_COMPRESS_FUNCTIONS] = {
 	{gzip_compress,		gzip_decompress,	9,	"gzip-9"},
 	{zle_compress,		zle_decompress,		64,	"zle"},
 	{lz4_compress,		lz4_decompress,		0,	"lz4"},
+	{zstd_compress,		zstd_decompress,	1,	"zstd-1"},
+	{zstd_compress,		zstd_decompress,	2,	"zstd-2"},
+	{zstd_compress,		zstd_decompress,	3,	"zstd-3"},
+	{zstd_compress,		zstd_decompress,	4,	"zstd-4"},
+	{zstd_compress,		zstd_decompress,	5,	"zstd-5"},
+	{zstd_compress,		zstd_decompress,	6,	"zstd-6"},
+	{zstd_compress,		zstd_decompress,	7,	"zstd-7"},
+	{zstd_compress,		zstd_decompress,	8,	"zstd-8"},
+	{zstd_compress,		zstd_decompress,	9,	"zstd-9"},
+	{zstd_compress,		zstd_decompress,	10,	"zstd-10"},
+	{zstd_compress,		zstd_decompress,	11,	"zstd-11"},
+	{zstd_compress,		zstd_decompress,	12,	"zstd-12"},
+	{zstd_compress,		zstd_decompress,	13,	"zstd-13"},
+	{zstd_compress,		zstd_decompress,	14,	"zstd-14"},
+	{zstd_compress,		zstd_decompress,	15,	"zstd-15"},
+	{zstd_compress,		zstd_decompress,	16,	"zstd-16"},
+	{zstd_compress,		zstd_decompress,	17,	"zstd-17"},
+	{zstd_compress,		zstd_decompress,	18,	"zstd-18"},
+	{zstd_compress,		zstd_decompress,	19,	"zstd-19"},
 };
 
 enum zio_compress
@@ -0,0 +1,173 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ */
+
+/*
+ * Zstandard compression, on top of libzstd.  The compression level is
+ * part of the algorithm (zstd-1 .. zstd-19), like it is for gzip.
+ *
+ * As with lz4, the compressed data is preceded by its size, since the
+ * block we are handed back for decompression is padded out to a whole
+ * sector, and a zstd frame can't tell the padding from its own data.
+ *
+ * The compression contexts hold several MB of tables at the higher levels,
+ * so instead of allocating one per block they are cached for reuse, up to
+ * one per CPU.  The (much smaller) decompression contexts are cached too.
+ */
+
+#include <sys/zfs_context.h>
+#include <sys/zio_compress.h>
+#include <zstd.h>
+
+typedef struct zstd_ctx_cache {
+	kmutex_t	zc_lock;
+	int		zc_nfree;
+	int		zc_max;
+	void		**zc_free;
+} zstd_ctx_cache_t;
+
+static zstd_ctx_cache_t zstd_cctx_cache;
+static zstd_ctx_cache_t zstd_dctx_cache;
+
+static void
+zstd_ctx_cache_init(zstd_ctx_cache_t *zc)
+{
+	mutex_init(&zc->zc_lock, NULL, MUTEX_DEFAULT, NULL);
+	zc->zc_nfree = 0;
+	zc->zc_max = max_ncpus;
+	zc->zc_free = kmem_zalloc(zc->zc_max * sizeof (void *), KM_SLEEP);
+}
+
+static void *
+zstd_ctx_get(zstd_ctx_cache_t *zc)
+{
+	void *ctx = NULL;
+
+	mutex_enter(&zc->zc_lock);
+	if (zc->zc_nfree > 0)
+		ctx = zc->zc_free[--zc->zc_nfree];
+	mutex_exit(&zc->zc_lock);
+
+	return (ctx);
+}
+
+/*
+ * Returns B_FALSE if the cache is full, and the caller has to free ctx.
+ */
+static boolean_t
+zstd_ctx_put(zstd_ctx_cache_t *zc, void *ctx)
+{
+	boolean_t cached = B_FALSE;
+
+	mutex_enter(&zc->zc_lock);
+	if (zc->zc_nfree < zc->zc_max) {
+		zc->zc_free[zc->zc_nfree++] = ctx;
+		cached = B_TRUE;
+	}
+	mutex_exit(&zc->zc_lock);
+
+	return (cached);
+}
+
+size_t
+zstd_compress(void *s_start, void *d_start, size_t s_len, size_t d_len,
+    int level)
+{
+	uint32_t bufsiz;
+	char *dest = d_start;
+	ZSTD_CCtx *cctx;
+	size_t c_len;
+
+	ASSERT(d_len >= sizeof (bufsiz));
+
+	cctx = zstd_ctx_get(&zstd_cctx_cache);
+	if (cctx == NULL && (cctx = ZSTD_createCCtx()) == NULL)
+		return (s_len);
+
+	c_len = ZSTD_compressCCtx(cctx, &dest[sizeof (bufsiz)],
+	    d_len - sizeof (bufsiz), s_start, s_len, level);
+
+	if (!zstd_ctx_put(&zstd_cctx_cache, cctx))
+		ZSTD_freeCCtx(cctx);
+
+	/* Signal an error, e.g. if the data doesn't fit in d_len. */
+	if (ZSTD_isError(c_len))
+		return (s_len);
+
+	*(uint32_t *)dest = BE_32((uint32_t)c_len);
+
+	return (c_len + sizeof (bufsiz));
+}
+
+/*ARGSUSED*/
+int
+zstd_decompress(void *s_start, void *d_start, size_t s_len, size_t d_len,
+    int level)
+{
+	const char *src = s_start;
+	uint32_t bufsiz = BE_IN32(src);
+	ZSTD_DCtx *dctx;
+	size_t ret;
+
+	/* invalid compressed buffer size encoded at start */
+	if (bufsiz + sizeof (bufsiz) > s_len)
+		return (1);
+
+	dctx = zstd_ctx_get(&zstd_dctx_cache);
+	if (dctx == NULL && (dctx = ZSTD_createDCtx()) == NULL)
+		return (1);
+
+	ret = ZSTD_decompressDCtx(dctx, d_start, d_len,
+	    &src[sizeof (bufsiz)], bufsiz);
+
+	if (!zstd_ctx_put(&zstd_dctx_cache, dctx))
+		ZSTD_freeDCtx(dctx);
+
+	return (ZSTD_isError(ret) ? 1 : 0);
+}
+
+void
+zstd_init(void)
+{
+	zstd_ctx_cache_init(&zstd_cctx_cache);
+	zstd_ctx_cache_init(&zstd_dctx_cache);
+}
+
+void
+zstd_fini(void)
+{
+	while (zstd_cctx_cache.zc_nfree > 0)
+		ZSTD_freeCCtx(
+		    zstd_cctx_cache.zc_free[--zstd_cctx_cache.zc_nfree]);
+	while (zstd_dctx_cache.zc_nfree > 0)
+		ZSTD_freeDCtx(
+		    zstd_dctx_cache.zc_free[--zstd_dctx_cache.zc_nfree]);
+
+	kmem_free(zstd_cctx_cache.zc_free,
+	    zstd_cctx_cache.zc_max * sizeof (void *));
+	kmem_free(zstd_dctx_cache.zc_free,
+	    zstd_dctx_cache.zc_max * sizeof (void *));
+	mutex_destroy(&zstd_cctx_cache.zc_lock);
+	mutex_destroy(&zstd_dctx_cache.zc_lock);
+}
@@ -29,6 +29,7 @@
 #include <sys/cdefs.h>
 
 #include <unistd.h> /* for close() */
+#include <vector>
 
 /* XXX we use functions that might not exist. */
 
@@ -379,6 +380,8 @@ linux_to_bsd_msg_flags(int flags)
 		ret_flags |= MSG_WAITALL;
 	if (flags & LINUX_MSG_NOSIGNAL)
 		ret_flags |= MSG_NOSIGNAL;
+	if (flags & LINUX_MSG_WAITFORONE)
+		ret_flags |= MSG_WAITFORONE;
 #if 0 /* not handled */
 	if (flags & LINUX_MSG_PROXY)
 		;
@@ -1193,6 +1196,108 @@ bad:
 	return (error);
 }
 
+int
+linux_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+    int *count)
+{
+	int error, bsd_flags;
+	unsigned int i;
+
+	if (vlen > UIO_MAXIOV)
+		vlen = UIO_MAXIOV;
+
+	/*
+	 * Destination addresses are converted into a private copy of the
+	 * vector, the caller's headers are only updated with msg_len.
+	 */
+	std::vector<struct mmsghdr> bsd_msgvec(msgvec, msgvec + vlen);
+	for (i = 0; i < vlen; i++) {
+		struct msghdr *msg = &bsd_msgvec[i].msg_hdr;
+		struct bsd_sockaddr *to = NULL;
+
+		if (msg->msg_control != NULL && msg->msg_controllen == 0)
+			msg->msg_control = NULL;
+		/* FIXME: Translate msg control */
+		assert(msg->msg_control == NULL);
+
+		error = linux_to_bsd_msghdr(msg);
+		if (error == 0 && msg->msg_name != NULL)
+			error = linux_getsockaddr(&to,
+			    (const bsd_osockaddr*)msg->msg_name, msg->msg_namelen);
+		msg->msg_name = to;
+		if (error)
+			goto bad;
+	}
+
+	bsd_flags = linux_to_bsd_msg_flags(flags);
+	error = kern_sendmmsg(s, bsd_msgvec.data(), vlen, bsd_flags, count);
+	if (error == 0) {
+		for (int j = 0; j < *count; j++)
+			msgvec[j].msg_len = bsd_msgvec[j].msg_len;
+	}
+
+bad:
+	while (i-- > 0) {
+		if (bsd_msgvec[i].msg_hdr.msg_name)
+			free(bsd_msgvec[i].msg_hdr.msg_name);
+	}
+	return (error);
+}
+
+int
+linux_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+    struct timespec *timeout, int *count)
+{
+	struct msghdr *msg;
+	int error, bsd_flags;
+	unsigned int i;
+
+	if (vlen > UIO_MAXIOV)
+		vlen = UIO_MAXIOV;
+
+	for (i = 0; i < vlen; i++) {
+		msg = &msgvec[i].msg_hdr;
+		error = linux_to_bsd_msghdr(msg);
+		if (error)
+			return (error);
+		if (msg->msg_name) {
+			error = linux_to_bsd_sockaddr(
+			    (struct bsd_sockaddr *)msg->msg_name,
+			    msg->msg_namelen);
+			if (error)
+				return (error);
+		}
+	}
+
+	bsd_flags = linux_to_bsd_msg_flags(flags);
+	error = kern_recvmmsg(s, msgvec, vlen, bsd_flags, timeout, count);
+	if (error)
+		return (error);
+
+	for (i = 0; i < (unsigned int)*count; i++) {
+		msg = &msgvec[i].msg_hdr;
+		error = bsd_to_linux_msghdr(msg);
+		if (error)
+			return (error);
+		bsd_flags = msg->msg_flags;
+		msg->msg_flags = 0;
+		if (bsd_flags & MSG_TRUNC)
+			msg->msg_flags |= LINUX_MSG_TRUNC;
+		if (bsd_flags & MSG_CTRUNC)
+			msg->msg_flags |= LINUX_MSG_CTRUNC;
+		if (msg->msg_name && msg->msg_namelen > 2) {
+			error = bsd_to_linux_sockaddr(
+			    (struct bsd_sockaddr *)msg->msg_name);
+			if (error)
+				return (error);
+			error = linux_sa_put((bsd_osockaddr*)msg->msg_name);
+			if (error)
+				return (error);
+		}
+	}
+	return (0);
+}
+
 int
 linux_shutdown(int s, int how)
 {
@@ -211,6 +211,18 @@ static void SHA512_Last(SHA512_CTX*);
 static void SHA256_Transform(SHA256_CTX*, const sha2_word32*);
 static void SHA512_Transform(SHA512_CTX*, const sha2_word64*);
 
+/*
+ * SHA-256 blocks are compressed by SHA256_Transform_blocks(), which on
+ * x86_64 is resolved at boot to the fastest variant the CPU supports
+ * (see arch/x64/checksum.cc), and is the portable C code otherwise.
+ */
+#if defined(_KERNEL) && defined(__x86_64__)
+void SHA256_Transform_x64(u_int32_t[8], const void*, size_t);
+#define	SHA256_Transform_blocks	SHA256_Transform_x64
+#else
+#define	SHA256_Transform_blocks	SHA256_Transform_generic
+#endif
+
 
 /*** SHA-XYZ INITIAL HASH VALUES AND CONSTANTS ************************/
 /* Hash constant words K for SHA-256: */
@@ -505,6 +517,17 @@ static void SHA256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+void SHA256_Transform_generic(u_int32_t state[8], const void *data, size_t nblocks) {
+	SHA256_CTX	context;
+	const sha2_byte	*p = data;
+
+	bcopy(state, context.state, sizeof(context.state));
+	for (; nblocks > 0; nblocks--, p += SHA256_BLOCK_LENGTH) {
+		SHA256_Transform(&context, (const sha2_word32*)p);
+	}
+	bcopy(context.state, state, sizeof(context.state));
+}
+
 void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -527,7 +550,7 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			context->bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA256_Transform(context, (sha2_word32*)context->buffer);
+			SHA256_Transform_blocks(context->state, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			bcopy(data, &context->buffer[usedspace], len);
@@ -537,12 +560,14 @@ void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= SHA256_BLOCK_LENGTH) {
+	if (len >= SHA256_BLOCK_LENGTH) {
 		/* Process as many complete blocks as we can */
-		SHA256_Transform(context, (const sha2_word32*)data);
-		context->bitcount += SHA256_BLOCK_LENGTH << 3;
-		len -= SHA256_BLOCK_LENGTH;
-		data += SHA256_BLOCK_LENGTH;
+		size_t	nblocks = len / SHA256_BLOCK_LENGTH;
+
+		SHA256_Transform_blocks(context->state, data, nblocks);
+		context->bitcount += (sha2_word64)nblocks * SHA256_BLOCK_LENGTH << 3;
+		len -= nblocks * SHA256_BLOCK_LENGTH;
+		data += nblocks * SHA256_BLOCK_LENGTH;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -579,7 +604,7 @@ void SHA256_Final(sha2_byte digest[], SHA256_CTX* context) {
 					bzero(&context->buffer[usedspace], SHA256_BLOCK_LENGTH - usedspace);
 				}
 				/* Do second-to-last transform: */
-				SHA256_Transform(context, (sha2_word32*)context->buffer);
+				SHA256_Transform_blocks(context->state, context->buffer, 1);
 
 				/* And set-up for the last transform: */
 				bzero(context->buffer, SHA256_SHORT_BLOCK_LENGTH);
@@ -595,7 +620,7 @@ void SHA256_Final(sha2_byte digest[], SHA256_CTX* context) {
 		*(sha2_word64*)&context->buffer[SHA256_SHORT_BLOCK_LENGTH] = context->bitcount;
 
 		/* Final transform: */
-		SHA256_Transform(context, (sha2_word32*)context->buffer);
+		SHA256_Transform_blocks(context->state, context->buffer, 1);
 
 #if BYTE_ORDER == LITTLE_ENDIAN
 		{
@@ -396,11 +396,10 @@ taskqueue_drain_timeout(struct taskqueue *queue,
 }
 #endif
 
-int
-taskqueue_start_threads(struct taskqueue **tqp, int count, int pri,
-			const char *name, ...)
+static int
+_taskqueue_start_threads(struct taskqueue **tqp, int count, int pri,
+			 int cpu, const char *name, va_list ap)
 {
-	va_list ap;
 //	struct thread *td;
 	struct taskqueue *tq;
 	int i, error;
@@ -411,9 +410,7 @@ taskqueue_start_threads(struct taskqueue **tqp, int count, int pri,
 
 	tq = *tqp;
 
-	va_start(ap, name);
 	vsnprintf(ktname, sizeof(ktname), name, ap);
-	va_end(ap);
 
 	tq->tq_threads = calloc(count, sizeof(struct thread *));
 	if (tq->tq_threads == NULL) {
@@ -434,8 +431,11 @@ taskqueue_start_threads(struct taskqueue **tqp, int count, int pri,
 			printf("%s: kthread_add(%s): error %d", __func__,
 			    ktname, error);
 			tq->tq_threads[i] = NULL;		/* paranoid */
-		} else
+		} else {
+			if (cpu != NOCPU)
+				kthread_bind(tq->tq_threads[i], cpu);
 			tq->tq_tcount++;
+		}
 	}
 #if 0
 	for (i = 0; i < count; i++) {
@@ -452,6 +452,36 @@ taskqueue_start_threads(struct taskqueue **tqp, int count, int pri,
 	return (0);
 }
 
+int
+taskqueue_start_threads(struct taskqueue **tqp, int count, int pri,
+			const char *name, ...)
+{
+	va_list ap;
+	int error;
+
+	va_start(ap, name);
+	error = _taskqueue_start_threads(tqp, count, pri, NOCPU, name, ap);
+	va_end(ap);
+	return (error);
+}
+
+/*
+ * Like taskqueue_start_threads(), with the threads bound to cpu, so that
+ * tasks enqueued from that cpu are run on it.
+ */
+int
+taskqueue_start_threads_pinned(struct taskqueue **tqp, int count, int pri,
+			       int cpu, const char *name, ...)
+{
+	va_list ap;
+	int error;
+
+	va_start(ap, name);
+	error = _taskqueue_start_threads(tqp, count, pri, cpu, name, ap);
+	va_end(ap);
+	return (error);
+}
+
 void
 taskqueue_thread_loop(void *arg)
 {
@@ -2361,11 +2361,9 @@ int
 soreceive_dgram(struct socket *so, struct bsd_sockaddr **psa, struct uio *uio,
     struct mbuf **mp0, struct mbuf **controlp, int *flagsp)
 {
-	struct mbuf *m, *m2;
-	int flags, error;
-	ssize_t len;
+	struct mbuf *m;
+	int flags, error, n;
 	struct protosw *pr = so->so_proto;
-	struct mbuf *nextrecord;
 
 	if (psa != NULL)
 		*psa = NULL;
@@ -2395,10 +2393,37 @@ soreceive_dgram(struct socket *so, struct bsd_sockaddr **psa, struct uio *uio,
 	KASSERT((so->so_proto->pr_flags & PR_CONNREQUIRED) == 0,
 	    ("soreceive_dgram: P_CONNREQUIRED"));
 
+	error = soreceive_dgram_dequeue(so, uio, &m, 1, flags, &n);
+	if (error || n == 0)
+		return (error);
+	return (soreceive_dgram_record(so, m, psa, uio, controlp, flagsp));
+}
+
+/*
+ * Pull up to maxrecords datagrams off the receive buffer of a datagram
+ * socket, taking the socket lock only once.  Blocks for the first datagram
+ * unless the socket is non-blocking or MSG_DONTWAIT is set, but never for
+ * the following ones.  Each record is then handed to
+ * soreceive_dgram_record() for copyout, without the socket lock held.
+ *
+ * *nrecords is 0 on end-of-file or when uio has no room and no datagram
+ * is queued.
+ */
+int
+soreceive_dgram_dequeue(struct socket *so, struct uio *uio,
+    struct mbuf **records, int maxrecords, int flags, int *nrecords)
+{
+	struct mbuf *m, *m2;
+	struct mbuf *nextrecord;
+	int error;
+
+	*nrecords = 0;
+
 	/*
 	 * Loop blocking while waiting for a datagram.
 	 */
 	SOCK_LOCK(so);
+	flush_net_channel(so);
 	while ((m = so->so_rcv.sb_mb) == NULL) {
 		KASSERT(so->so_rcv.sb_cc == 0,
 		    ("soreceive_dgram: sb_mb NULL but sb_cc %u",
@@ -2429,28 +2454,34 @@ soreceive_dgram(struct socket *so, struct bsd_sockaddr **psa, struct uio *uio,
 	}
 	SOCK_LOCK_ASSERT(so);
 
-	SBLASTRECORDCHK(&so->so_rcv);
-	SBLASTMBUFCHK(&so->so_rcv);
-	nextrecord = m->m_hdr.mh_nextpkt;
-	if (nextrecord == NULL) {
-		KASSERT(so->so_rcv.sb_lastrecord == m,
-		    ("soreceive_dgram: lastrecord != m"));
-	}
+	while (m != NULL && *nrecords < maxrecords) {
+		SBLASTRECORDCHK(&so->so_rcv);
+		SBLASTMBUFCHK(&so->so_rcv);
+		nextrecord = m->m_hdr.mh_nextpkt;
+		if (nextrecord == NULL) {
+			KASSERT(so->so_rcv.sb_lastrecord == m,
+			    ("soreceive_dgram: lastrecord != m"));
+		}
 
-	KASSERT(so->so_rcv.sb_mb->m_hdr.mh_nextpkt == nextrecord,
-	    ("soreceive_dgram: m_hdr.mh_nextpkt != nextrecord"));
+		KASSERT(so->so_rcv.sb_mb->m_hdr.mh_nextpkt == nextrecord,
+		    ("soreceive_dgram: m_hdr.mh_nextpkt != nextrecord"));
 
-	/*
-	 * Pull 'm' and its chain off the front of the packet queue.
-	 */
-	so->so_rcv.sb_mb = NULL;
-	sockbuf_pushsync(so, &so->so_rcv, nextrecord);
+		/*
+		 * Pull 'm' and its chain off the front of the packet queue.
+		 */
+		so->so_rcv.sb_mb = NULL;
+		sockbuf_pushsync(so, &so->so_rcv, nextrecord);
 
-	/*
-	 * Walk 'm's chain and free that many bytes from the socket buffer.
-	 */
-	for (m2 = m; m2 != NULL; m2 = m2->m_hdr.mh_next)
-		sbfree(&so->so_rcv, m2);
+		/*
+		 * Walk 'm's chain and free that many bytes from the socket
+		 * buffer.
+		 */
+		for (m2 = m; m2 != NULL; m2 = m2->m_hdr.mh_next)
+			sbfree(&so->so_rcv, m2);
+
+		records[(*nrecords)++] = m;
+		m = so->so_rcv.sb_mb;
+	}
 
 	/*
 	 * Do a few last checks before we let go of the lock.
@@ -2458,6 +2489,31 @@ soreceive_dgram(struct socket *so, struct bsd_sockaddr **psa, struct uio *uio,
 	SBLASTRECORDCHK(&so->so_rcv);
 	SBLASTMBUFCHK(&so->so_rcv);
 	SOCK_UNLOCK(so);
+	return (0);
+}
+
+/*
+ * Copy out a single datagram record dequeued by soreceive_dgram_dequeue().
+ * The record is always consumed, even on error.
+ */
+int
+soreceive_dgram_record(struct socket *so, struct mbuf *m,
+    struct bsd_sockaddr **psa, struct uio *uio, struct mbuf **controlp,
+    int *flagsp)
+{
+	struct mbuf *m2;
+	int flags, error;
+	ssize_t len;
+	struct protosw *pr = so->so_proto;
+
+	if (psa != NULL)
+		*psa = NULL;
+	if (controlp != NULL)
+		*controlp = NULL;
+	if (flagsp != NULL)
+		flags = *flagsp &~ MSG_EOR;
+	else
+		flags = 0;
 
 	if (pr->pr_flags & PR_ADDR) {
 		KASSERT(m->m_hdr.mh_type == MT_SONAME,
@@ -61,6 +61,8 @@
 #include <osv/mempool.hh>
 #include <osv/pagealloc.hh>
 #include <osv/zcopy.hh>
+#include <osv/clock.hh>
+#include <osv/tx_batch.hh>
 #include <sys/eventfd.h>
 
 using namespace std;
@@ -715,6 +717,248 @@ sys_recvmsg(int s, struct msghdr *msg, int flags, ssize_t* bytes)
 	return (error);
 }
 
+/*
+ * Set up a uio over the iovec of the given msghdr.  uio_iov is a local copy
+ * of the user's iovec, since sosend()/soreceive() are going to change it.
+ */
+static int
+msghdr_uio(struct msghdr *mp, std::vector<iovec>& uio_iov, struct uio *auio,
+    enum uio_rw rw)
+{
+	struct iovec *iov;
+	int i;
+
+	uio_iov.assign(mp->msg_iov, mp->msg_iov + mp->msg_iovlen);
+
+	auio->uio_iov = uio_iov.data();
+	auio->uio_iovcnt = uio_iov.size();
+	auio->uio_rw = rw;
+	auio->uio_offset = 0;			/* XXX */
+	auio->uio_resid = 0;
+	iov = mp->msg_iov;
+	for (i = 0; i < mp->msg_iovlen; i++, iov++) {
+		if ((auio->uio_resid += iov->iov_len) < 0)
+			return (EINVAL);
+	}
+	return (0);
+}
+
+#define	RECVMMSG_BATCH	64
+
+/*
+ * Receive up to vlen datagrams with a single pass over the receive buffer
+ * lock: soreceive_dgram_dequeue() pulls all the queued records at once and
+ * they are copied out one by one without the lock held.
+ *
+ * Like recvmsg(), ancillary data is dropped.
+ */
+static int
+recvmmsg_dgram(struct socket *so, struct mmsghdr *msgvec, unsigned int vlen,
+    int flags, unsigned int *received)
+{
+	struct mbuf *records[RECVMMSG_BATCH];
+	std::vector<iovec> uio_iov;
+	struct uio auio;
+	int i, nrecords, error;
+
+	*received = 0;
+
+	error = msghdr_uio(&msgvec[0].msg_hdr, uio_iov, &auio, UIO_READ);
+	if (error)
+		return (error);
+
+	CURVNET_SET(so->so_vnet);
+	error = soreceive_dgram_dequeue(so, &auio, records,
+	    MIN(vlen, RECVMMSG_BATCH), flags, &nrecords);
+	if (error)
+		goto out;
+
+	for (i = 0; i < nrecords; i++) {
+		struct msghdr *mp = &msgvec[i].msg_hdr;
+		struct bsd_sockaddr *fromsa = NULL;
+		ssize_t len;
+
+		if (i > 0) {
+			error = msghdr_uio(mp, uio_iov, &auio, UIO_READ);
+			if (error)
+				break;
+		}
+		len = auio.uio_resid;
+		mp->msg_flags = flags;
+		error = soreceive_dgram_record(so, records[i],
+		    mp->msg_name ? &fromsa : NULL, &auio, NULL, &mp->msg_flags);
+		records[i] = NULL;
+		if (error) {
+			if (fromsa)
+				free(fromsa);
+			break;
+		}
+		msgvec[i].msg_len = len - auio.uio_resid;
+		if (mp->msg_name) {
+			len = mp->msg_namelen;
+			if (len <= 0 || fromsa == NULL)
+				len = 0;
+			else {
+				len = MIN(len, fromsa->sa_len);
+				bcopy(fromsa, mp->msg_name, len);
+			}
+			mp->msg_namelen = len;
+		}
+		mp->msg_controllen = 0;
+		if (fromsa)
+			free(fromsa);
+		(*received)++;
+	}
+
+	/* Datagrams that were dequeued but can't be delivered are dropped */
+	for (; i < nrecords; i++) {
+		if (records[i])
+			m_freem(records[i]);
+	}
+out:
+	CURVNET_RESTORE();
+	return (error);
+}
+
+int
+kern_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+    struct timespec *timeout, int *count)
+{
+	osv::clock::uptime::time_point deadline;
+	struct file *fp;
+	struct socket *so;
+	unsigned int n, received;
+	ssize_t bytes;
+	int error;
+
+	if (timeout != NULL) {
+		if (timeout->tv_sec < 0 || timeout->tv_nsec < 0 ||
+		    timeout->tv_nsec >= 1000000000L)
+			return (EINVAL);
+		deadline = osv::clock::uptime::now() +
+		    std::chrono::seconds(timeout->tv_sec) +
+		    std::chrono::nanoseconds(timeout->tv_nsec);
+	}
+
+	error = getsock_cap(s, &fp, NULL);
+	if (error)
+		return (error);
+	so = (socket*)file_data(fp);
+
+	n = 0;
+	while (n < vlen) {
+		int rflags = flags & ~MSG_WAITFORONE;
+
+		if (so->so_proto->pr_usrreqs->pru_soreceive == soreceive_dgram &&
+		    !(rflags & (MSG_PEEK | MSG_OOB))) {
+			error = recvmmsg_dgram(so, msgvec + n, vlen - n, rflags,
+			    &received);
+		} else {
+			msgvec[n].msg_hdr.msg_flags = rflags;
+			error = kern_recvit(s, &msgvec[n].msg_hdr, NULL, &bytes);
+			received = 0;
+			if (error == 0 && bytes > 0) {
+				msgvec[n].msg_len = bytes;
+				received = 1;
+			}
+		}
+		n += received;
+		if (error || received == 0)
+			break;
+
+		/* Only the first datagram is waited for with MSG_WAITFORONE */
+		if (flags & MSG_WAITFORONE)
+			flags |= MSG_DONTWAIT;
+		if (timeout != NULL && osv::clock::uptime::now() >= deadline)
+			break;
+	}
+	fdrop(fp);
+
+	/*
+	 * An error after some datagrams have been received is not reported,
+	 * the next call will hit it again.
+	 */
+	if (n > 0 || error == 0) {
+		*count = n;
+		return (0);
+	}
+	return (error);
+}
+
+static int
+sendmmsg_loop(struct socket *so, struct mmsghdr *msgvec, unsigned int vlen,
+    int flags, unsigned int *sent)
+{
+	std::vector<iovec> uio_iov;
+	struct uio auio;
+	int error = 0;
+
+	for (*sent = 0; *sent < vlen; (*sent)++) {
+		struct msghdr *mp = &msgvec[*sent].msg_hdr;
+		struct mbuf *control = NULL;
+		ssize_t len;
+
+		error = msghdr_uio(mp, uio_iov, &auio, UIO_WRITE);
+		if (error)
+			break;
+		if (mp->msg_control) {
+			if (mp->msg_controllen < sizeof(struct cmsghdr)) {
+				error = EINVAL;
+				break;
+			}
+			error = sockargs(&control, (caddr_t)mp->msg_control,
+			    mp->msg_controllen, MT_CONTROL);
+			if (error)
+				break;
+		}
+		len = auio.uio_resid;
+		error = sosend(so, (struct bsd_sockaddr *)mp->msg_name, &auio, 0,
+		    control, flags, 0);
+		if (error) {
+			if (auio.uio_resid != len && (error == ERESTART ||
+			    error == EINTR || error == EWOULDBLOCK))
+				error = 0;
+			else
+				break;
+		}
+		msgvec[*sent].msg_len = len - auio.uio_resid;
+	}
+	return (error);
+}
+
+int
+kern_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+    int *count)
+{
+	struct file *fp;
+	struct socket *so;
+	unsigned int sent;
+	int error;
+
+	error = getsock_cap(s, &fp, NULL);
+	if (error)
+		return (error);
+	so = (struct socket *)file_data(fp);
+
+	/*
+	 * Datagram sends never wait for the peer, so the NIC may be kicked
+	 * once for the whole vector.  Stream sockets may block waiting for
+	 * ACKs of the data sent so far, which must not sit unkicked.
+	 */
+	if (so->so_type == SOCK_DGRAM) {
+		osv::tx_batch batch;
+		error = sendmmsg_loop(so, msgvec, vlen, flags, &sent);
+	} else
+		error = sendmmsg_loop(so, msgvec, vlen, flags, &sent);
+	fdrop(fp);
+
+	if (sent > 0 || error == 0) {
+		*count = sent;
+		return (0);
+	}
+	return (error);
+}
+
 /* ARGSUSED */
 int
 sys_shutdown(int s, int how)
@@ -11,6 +11,8 @@
 
 #define sock_d(...)		tprintf_d("socket-api", __VA_ARGS__);
 
+extern "C" void dhcp_wait();
+
 extern "C"
 int socketpair(int domain, int type, int protocol, int sv[2])
 {
@@ -207,6 +209,25 @@ ssize_t recvmsg(int fd, struct msghdr *msg, int flags)
 	return bytes;
 }
 
+extern "C"
+int recvmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen,
+    unsigned int flags, struct timespec *timeout)
+{
+	int error, count;
+
+	sock_d("recvmmsg(fd=%d, msgvec=..., vlen=%u, flags=0x%x)", fd, vlen,
+	    flags);
+
+	error = linux_recvmmsg(fd, msgvec, vlen, flags, timeout, &count);
+	if (error) {
+		sock_d("recvmmsg() failed, errno=%d", error);
+		errno = error;
+		return -1;
+	}
+
+	return count;
+}
+
 extern "C"
 ssize_t sendto(int fd, const void *buf, size_t len, int flags,
     const struct bsd_sockaddr *addr, socklen_t alen)
@@ -263,6 +284,25 @@ ssize_t sendmsg(int fd, const struct msghdr *msg, int flags)
 	return bytes;
 }
 
+extern "C"
+int sendmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen,
+    unsigned int flags)
+{
+	int error, count;
+
+	sock_d("sendmmsg(fd=%d, msgvec=..., vlen=%u, flags=0x%x)", fd, vlen,
+	    flags);
+
+	error = linux_sendmmsg(fd, msgvec, vlen, flags, &count);
+	if (error) {
+		sock_d("sendmmsg() failed, errno=%d", error);
+		errno = error;
+		return -1;
+	}
+
+	return count;
+}
+
 extern "C"
 int getsockopt(int fd, int level, int optname, void *__restrict optval,
 		socklen_t *__restrict optlen)
@@ -329,6 +369,11 @@ int socket(int domain, int type, int protocol)
 
 	sock_d("socket(domain=%d, type=%d, protocol=%d)", domain, type, protocol);
 
+	/* With --dhcp-async, this is where the application first needs the
+	 * network, so it waits for the lease here rather than at boot. */
+	if (domain == AF_INET || domain == AF_INET6)
+		dhcp_wait();
+
 	error = linux_socket(domain, type, protocol, &s);
 	if (error) {
 		sock_d("socket() failed, errno=%d", error);
@@ -221,6 +221,8 @@ in_pcbinfo_init(struct inpcbinfo *pcbinfo, const char *name,
 	    &pcbinfo->ipi_hashmask);
 	pcbinfo->ipi_porthashbase = (inpcbporthead *)hashinit(porthash_nelements, 0,
 	    &pcbinfo->ipi_porthashmask);
+	pcbinfo->ipi_lbgrouphashbase = (inpcblbgrouphead *)hashinit(
+	    porthash_nelements, 0, &pcbinfo->ipi_lbgrouphashmask);
 	// FIXME: uma_zone_set_max(pcbinfo->ipi_zone, maxsockets);
 }
 
@@ -237,10 +239,174 @@ in_pcbinfo_destroy(struct inpcbinfo *pcbinfo)
 	hashdestroy(pcbinfo->ipi_hashbase, 0, pcbinfo->ipi_hashmask);
 	hashdestroy(pcbinfo->ipi_porthashbase, 0,
 	    pcbinfo->ipi_porthashmask);
+	hashdestroy(pcbinfo->ipi_lbgrouphashbase, 0,
+	    pcbinfo->ipi_lbgrouphashmask);
 	INP_HASH_LOCK_DESTROY(pcbinfo);
 	INP_INFO_LOCK_DESTROY(pcbinfo);
 }
 
+/*
+ * SO_REUSEPORT load balancing groups.
+ *
+ * Linux applications expect every socket bound to the same address and port
+ * with SO_REUSEPORT to get its own share of incoming connections (or
+ * datagrams), rather than the last one bound receiving all of them.  Group
+ * membership is maintained under the hash write lock whenever a pcb is
+ * hashed, rehashed, starts listening, changes SO_REUSEPORT or is removed.
+ */
+#define	INP_LBGROUP_SIZMIN	8
+
+static bool
+in_pcblbgroup_eligible(struct inpcb *inp)
+{
+	struct socket *so = inp->inp_socket;
+
+	if ((inp->inp_flags2 & INP_REUSEPORT) == 0 ||
+	    (inp->inp_flags & (INP_INHASHLIST | INP_DROPPED)) != INP_INHASHLIST)
+		return (false);
+	/* Connected pcbs are found by the exact match lookup. */
+	if (inp->inp_faddr.s_addr != INADDR_ANY || inp->inp_lport == 0)
+		return (false);
+	/* Multicast keeps the BSD semantics of delivery to every socket. */
+	if (IN_MULTICAST(ntohl(inp->inp_laddr.s_addr)))
+		return (false);
+	if (so == NULL ||
+	    (so->so_type == SOCK_STREAM && (so->so_options & SO_ACCEPTCONN) == 0))
+		return (false);
+	return (true);
+}
+
+static int
+in_pcblbgroup_insert(struct inpcb *inp)
+{
+	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcblbgrouphead *hdr;
+	struct inpcblbgroup *grp;
+
+	INP_HASH_WLOCK_ASSERT(pcbinfo);
+
+	hdr = &pcbinfo->ipi_lbgrouphashbase[
+	    INP_PCBPORTHASH(inp->inp_lport, pcbinfo->ipi_lbgrouphashmask)];
+	LIST_FOREACH(grp, hdr, il_list) {
+		if (grp->il_lport == inp->inp_lport &&
+		    grp->il_laddr.s_addr == inp->inp_laddr.s_addr)
+			break;
+	}
+	if (grp == NULL) {
+		grp = (inpcblbgroup *)malloc(sizeof(struct inpcblbgroup));
+		if (grp == NULL)
+			return (ENOBUFS);
+		grp->il_laddr = inp->inp_laddr;
+		grp->il_lport = inp->inp_lport;
+		grp->il_inpsiz = 0;
+		grp->il_inpcnt = 0;
+		grp->il_npinned = 0;
+		grp->il_inp = NULL;
+		LIST_INSERT_HEAD(hdr, grp, il_list);
+	}
+	if (grp->il_inpcnt == grp->il_inpsiz) {
+		u_int siz = MAX(grp->il_inpsiz * 2, INP_LBGROUP_SIZMIN);
+		struct inpcb **inps;
+
+		inps = (inpcb **)realloc(grp->il_inp, siz * sizeof(*inps));
+		if (inps == NULL) {
+			if (grp->il_inpcnt == 0) {
+				LIST_REMOVE(grp, il_list);
+				free(grp);
+			}
+			return (ENOBUFS);
+		}
+		grp->il_inp = inps;
+		grp->il_inpsiz = siz;
+	}
+	grp->il_inp[grp->il_inpcnt++] = inp;
+	inp->inp_lbgroup = grp;
+	inp->inp_lbcpu = get_pinned_cpuid();
+	if (inp->inp_lbcpu >= 0)
+		grp->il_npinned++;
+	return (0);
+}
+
+static void
+in_pcblbgroup_remove(struct inpcb *inp)
+{
+	struct inpcblbgroup *grp = inp->inp_lbgroup;
+	u_int i;
+
+	INP_HASH_WLOCK_ASSERT(inp->inp_pcbinfo);
+
+	for (i = 0; i < grp->il_inpcnt; i++) {
+		if (grp->il_inp[i] == inp) {
+			grp->il_inp[i] = grp->il_inp[--grp->il_inpcnt];
+			break;
+		}
+	}
+	if (inp->inp_lbcpu >= 0)
+		grp->il_npinned--;
+	inp->inp_lbgroup = NULL;
+	inp->inp_lbcpu = -1;
+	if (grp->il_inpcnt == 0) {
+		LIST_REMOVE(grp, il_list);
+		free(grp->il_inp);
+		free(grp);
+	}
+}
+
+/*
+ * Bring the pcb's group membership in line with its current binding,
+ * listen state and SO_REUSEPORT setting.
+ */
+void
+in_pcblbgroup_update(struct inpcb *inp)
+{
+	struct inpcblbgroup *grp = inp->inp_lbgroup;
+	bool eligible;
+
+	INP_LOCK_ASSERT(inp);
+	INP_HASH_WLOCK_ASSERT(inp->inp_pcbinfo);
+
+	eligible = in_pcblbgroup_eligible(inp);
+	if (grp != NULL && (!eligible ||
+	    grp->il_laddr.s_addr != inp->inp_laddr.s_addr ||
+	    grp->il_lport != inp->inp_lport))
+		in_pcblbgroup_remove(inp);
+	/*
+	 * Failing to join is not fatal: the pcb is still reachable through
+	 * the regular wildcard lookup, just without load balancing.
+	 */
+	if (eligible && inp->inp_lbgroup == NULL)
+		(void)in_pcblbgroup_insert(inp);
+}
+
+/*
+ * Pick the group member for a flow.  Members owned by threads pinned to the
+ * current cpu are preferred, so that a per-cpu server thread accepts the
+ * connections whose packets are processed on its own cpu.
+ */
+static struct inpcb *
+in_pcblbgroup_select(const struct inpcblbgroup *grp, uint32_t hash)
+{
+	u_int i, idx, nlocal = 0;
+	int cpu;
+
+	if (grp->il_npinned != 0) {
+		cpu = get_cpuid();
+		for (i = 0; i < grp->il_inpcnt; i++) {
+			if (grp->il_inp[i]->inp_lbcpu == cpu)
+				nlocal++;
+		}
+		if (nlocal != 0) {
+			idx = hash % nlocal;
+			for (i = 0; i < grp->il_inpcnt; i++) {
+				if (grp->il_inp[i]->inp_lbcpu == cpu &&
+				    idx-- == 0)
+					return (grp->il_inp[i]);
+			}
+		}
+	}
+	return (grp->il_inp[hash % grp->il_inpcnt]);
+}
+
 /*
  * Allocate a PCB and associate it with the socket.
  * On success return with the PCB locked.
@@ -1090,6 +1256,8 @@ in_pcbdrop(struct inpcb *inp)
 		struct inpcbport *phd = inp->inp_phd;
 
 		INP_HASH_WLOCK(inp->inp_pcbinfo);
+		if (inp->inp_lbgroup != NULL)
+			in_pcblbgroup_remove(inp);
 		LIST_REMOVE(inp, inp_hash);
 		LIST_REMOVE(inp, inp_portlist);
 		if (LIST_FIRST(&phd->phd_pcblist) == NULL) {
@@ -1340,6 +1508,30 @@ in_pcblookup_local(struct inpcbinfo *pcbinfo, struct in_addr laddr,
 }
 #undef INP_LOOKUP_MAPPED_PCB_COST
 
+/*
+ * Lookup a load balanced SO_REUSEPORT group bound to exactly laddr:lport and
+ * return the member selected for the given foreign endpoint.
+ */
+static struct inpcb *
+in_pcblookup_lbgroup(struct inpcbinfo *pcbinfo, struct in_addr faddr,
+    u_short fport, struct in_addr laddr, u_short lport)
+{
+	struct inpcblbgrouphead *hdr;
+	struct inpcblbgroup *grp;
+
+	INP_HASH_LOCK_ASSERT(pcbinfo);
+
+	hdr = &pcbinfo->ipi_lbgrouphashbase[
+	    INP_PCBPORTHASH(lport, pcbinfo->ipi_lbgrouphashmask)];
+	LIST_FOREACH(grp, hdr, il_list) {
+		if (grp->il_lport == lport &&
+		    grp->il_laddr.s_addr == laddr.s_addr)
+			return (in_pcblbgroup_select(grp,
+			    INP_PCBLBGROUP_PKTHASH(faddr.s_addr, lport, fport)));
+	}
+	return (NULL);
+}
+
 /*
  * Lookup PCB in hash list, using pcbinfo tables.  This variation assumes
  * that the caller has locked the hash list, and will not perform any further
@@ -1396,6 +1588,7 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 		struct inpcb *local_wild_mapped = NULL;
 #endif
 		struct inpcb *jail_wild = NULL;
+		struct in_addr wildaddr;
 		int injail;
 
 		/*
@@ -1406,6 +1599,15 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 		 *      4. non-jailed, wild.
 		 */
 
+		/*
+		 * SO_REUSEPORT groups bound to the exact local address are
+		 * preferred; groups bound to INADDR_ANY rank just below
+		 * sockets bound to the exact address.
+		 */
+		inp = in_pcblookup_lbgroup(pcbinfo, faddr, fport, laddr, lport);
+		if (inp != NULL)
+			return (inp);
+
 		head = &pcbinfo->ipi_hashbase[INP_PCBHASH(INADDR_ANY, lport,
 		    0, pcbinfo->ipi_hashmask)];
 		LIST_FOREACH(inp, head, inp_hash) {
@@ -1449,6 +1651,11 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 			return (jail_wild);
 		if (local_exact != NULL)
 			return (local_exact);
+		wildaddr.s_addr = INADDR_ANY;
+		inp = in_pcblookup_lbgroup(pcbinfo, faddr, fport, wildaddr,
+		    lport);
+		if (inp != NULL)
+			return (inp);
 		if (local_wild != NULL)
 			return (local_wild);
 #ifdef INET6
@@ -1575,6 +1782,7 @@ in_pcbinshash_internal(struct inpcb *inp)
 	LIST_INSERT_HEAD(&phd->phd_pcblist, inp, inp_portlist);
 	LIST_INSERT_HEAD(pcbhash, inp, inp_hash);
 	inp->inp_flags |= INP_INHASHLIST;
+	in_pcblbgroup_update(inp);
 	return (0);
 }
 
@@ -1616,7 +1824,7 @@ in_pcbrehash_mbuf(struct inpcb *inp, struct mbuf *m)
 
 	LIST_REMOVE(inp, inp_hash);
 	LIST_INSERT_HEAD(head, inp, inp_hash);
-
+	in_pcblbgroup_update(inp);
 }
 
 void
@@ -1642,6 +1850,8 @@ in_pcbremlists(struct inpcb *inp)
 		struct inpcbport *phd = inp->inp_phd;
 
 		INP_HASH_WLOCK(pcbinfo);
+		if (inp->inp_lbgroup != NULL)
+			in_pcblbgroup_remove(inp);
 		LIST_REMOVE(inp, inp_hash);
 		LIST_REMOVE(inp, inp_portlist);
 		if (LIST_FIRST(&phd->phd_pcblist) == NULL) {
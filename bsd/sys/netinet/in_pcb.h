@@ -67,6 +67,7 @@ struct inpcbpolicy;
  */
 LIST_HEAD(inpcbhead, inpcb);
 LIST_HEAD(inpcbporthead, inpcbport);
+LIST_HEAD(inpcblbgrouphead, inpcblbgroup);
 typedef	u_quad_t	inp_gen_t;
 
 /*
@@ -203,6 +204,8 @@ struct inpcb {
 	} inp_depend6 = {};
 	LIST_ENTRY(inpcb) inp_portlist = {};	/* (i/p) */
 	struct	inpcbport *inp_phd = {};	/* (i/p) head of this list */
+	struct	inpcblbgroup *inp_lbgroup = {};	/* (h) SO_REUSEPORT group */
+	int	inp_lbcpu = -1;		/* (h) cpu of pinned group member */
 	inp_gen_t	inp_gencnt;	/* (c) generation count */
 	struct llentry	*inp_lle;	/* cached L2 information */
 	struct rtentry	*inp_rt;	/* cached L3 information */
@@ -261,6 +264,23 @@ struct inpcbport {
 	u_short phd_port;
 };
 
+/*
+ * Load balancing group for listening (TCP) or bound (UDP) sockets sharing
+ * the same local address and port through SO_REUSEPORT.  As on Linux, each
+ * new connection or datagram is handed to one member of the group, chosen
+ * by a hash of the foreign address and port, preferring members owned by
+ * threads pinned to the cpu that is processing the packet.
+ */
+struct inpcblbgroup {
+	LIST_ENTRY(inpcblbgroup) il_list;
+	struct	in_addr il_laddr;
+	u_short	il_lport;
+	u_int	il_inpsiz;		/* size of il_inp[] */
+	u_int	il_inpcnt;		/* # of elements in il_inp[] */
+	u_int	il_npinned;		/* # of members with inp_lbcpu set */
+	struct	inpcb **il_inp;
+};
+
 /*-
  * Global data structure for each high-level protocol (UDP, TCP, ...) in both
  * IPv4 and IPv6.  Holds inpcb lists and information for managing them.
@@ -321,6 +341,12 @@ struct inpcbinfo {
 	struct inpcbporthead	*ipi_porthashbase;	/* (h) */
 	u_long			 ipi_porthashmask;	/* (h) */
 
+	/*
+	 * Load balanced SO_REUSEPORT groups, hashed by local port number.
+	 */
+	struct inpcblbgrouphead	*ipi_lbgrouphashbase;	/* (h) */
+	u_long			 ipi_lbgrouphashmask;	/* (h) */
+
 	/*
 	 * Pointer to network stack instance
 	 */
@@ -401,6 +427,8 @@ void 	inp_4tuple_get(struct inpcb *inp, uint32_t *laddr, uint16_t *lp,
 	(((faddr) ^ ((faddr) >> 16) ^ ntohs((lport) ^ (fport))) & (mask))
 #define INP_PCBPORTHASH(lport, mask) \
 	(ntohs((lport)) & (mask))
+#define INP_PCBLBGROUP_PKTHASH(faddr, lport, fport) \
+	((faddr) ^ ((faddr) >> 16) ^ ntohs((lport) ^ (fport)))
 
 /*
  * Flags for inp_vflags -- historically version flags only
@@ -511,6 +539,7 @@ VNET_DECLARE(int, ipport_tcpallocs);
 #define	V_ipport_stoprandom	VNET(ipport_stoprandom)
 #define	V_ipport_tcpallocs	VNET(ipport_tcpallocs)
 
+void	in_pcblbgroup_update(struct inpcb *);
 void	in_pcbinfo_destroy(struct inpcbinfo *);
 void	in_pcbinfo_init(struct inpcbinfo *, const char *, struct inpcbhead *,
 	    int, int, u_int);
@@ -905,6 +905,9 @@ ip_ctloutput(struct socket *so, struct sockopt *sopt)
 					inp->inp_flags2 |= INP_REUSEPORT;
 				else
 					inp->inp_flags2 &= ~INP_REUSEPORT;
+				INP_HASH_WLOCK(inp->inp_pcbinfo);
+				in_pcblbgroup_update(inp);
+				INP_HASH_WUNLOCK(inp->inp_pcbinfo);
 				INP_UNLOCK(inp);
 				error = 0;
 				break;
@@ -373,6 +373,9 @@ tcp_usr_listen(struct socket *so, int backlog, struct thread *td)
 	if (error == 0) {
 		tp->set_state(TCPS_LISTEN);
 		solisten_proto(so, backlog);
+		INP_HASH_WLOCK(&V_tcbinfo);
+		in_pcblbgroup_update(inp);
+		INP_HASH_WUNLOCK(&V_tcbinfo);
 	}
 	SOCK_UNLOCK(so);
 
@@ -50,6 +50,9 @@
 #include <bsd/sys/sys/socketvar.h>
 
 #include <bsd/sys/net/if.h>
+#include <bsd/sys/net/if_var.h>
+#include <bsd/sys/net/ethernet.h>
+#include <bsd/sys/net/netisr.h>
 #include <bsd/sys/net/route.h>
 
 #include <bsd/sys/netinet/in.h>
@@ -284,6 +287,145 @@ udp_append(struct inpcb *inp, struct ip *ip, struct mbuf *n, int off,
 		sorwakeup_locked(so);
 }
 
+/*
+ * Net channels: once a unicast datagram has been delivered to a socket that
+ * is the only one on its port, further datagrams of the flow are steered by
+ * the interface classifier straight to a channel of the socket, and IP and
+ * UDP input processing happen in the context of the thread consuming them.
+ */
+static bool
+udp_net_channel_eligible(struct inpcb *inp)
+{
+	struct udpcb *up = intoudpcb(inp);
+	bool sole;
+
+	INP_LOCK_ASSERT(inp);
+	if (up->u_tun_func != NULL || inp->inp_moptions != NULL ||
+	    (inp->inp_vflag & INP_IPV4) == 0 ||
+	    (inp->inp_socket->so_options & (SO_REUSEADDR|SO_REUSEPORT)))
+		return (false);
+
+	/*
+	 * With another pcb on the port the classifier could steer datagrams
+	 * that in_pcblookup() would rather hand to the other one.
+	 */
+	INP_HASH_RLOCK(&V_udbinfo);
+	sole = inp->inp_phd != NULL &&
+	    LIST_FIRST(&inp->inp_phd->phd_pcblist) == inp &&
+	    LIST_NEXT(inp, inp_portlist) == NULL;
+	INP_HASH_RUNLOCK(&V_udbinfo);
+	return (sole);
+}
+
+static ipv4_udp_conn_id
+udp_connection_id(struct inpcb *inp)
+{
+	return {
+		inp->inp_faddr,
+		inp->inp_laddr,
+		ntohs(inp->inp_fport),
+		ntohs(inp->inp_lport)
+	};
+}
+
+// INP_LOCK held
+static void
+udp_net_channel_packet(struct inpcb *inp, struct mbuf *m)
+{
+	struct ip *ip;
+	uint8_t protocol;
+	int hlen;
+
+	log_packet_handling(m, NETISR_ETHER);
+	ip = (struct ip *)(mtod(m, caddr_t) + ETHER_HDR_LEN);
+	if (!udp_net_channel_eligible(inp) ||
+	    in_broadcast(ip->ip_dst, m->M_dat.MH.MH_pkthdr.rcvif)) {
+		/*
+		 * The port got shared since the channel was registered, or
+		 * this is a directed broadcast: let the netisr thread look
+		 * up the receivers, we can't lock their pcbs from here.
+		 */
+		udp_teardown_net_channel(inp);
+		netisr_queue(NETISR_ETHER, m);
+		return;
+	}
+	m_adj(m, ETHER_HDR_LEN);
+	m = ip_preprocess_packet(m, protocol, hlen);
+	if (m == NULL)
+		return;
+	udp_input(m, hlen);
+}
+
+static void
+udp_setup_net_channel(struct inpcb *inp, struct ifnet *intf)
+{
+	struct udpcb *up = intoudpcb(inp);
+	struct socket *so = inp->inp_socket;
+
+	INP_LOCK_ASSERT(inp);
+	if (up->u_nc_intf != NULL || (intf->if_flags & IFF_LOOPBACK) ||
+	    !udp_net_channel_eligible(inp))
+		return;
+
+	if (up->u_nc == NULL) {
+		up->u_nc = aligned_new<net_channel>([=] (mbuf *m) {
+			udp_net_channel_packet(inp, m);
+		});
+		so->so_nc = up->u_nc;
+		if (so->fp) {
+			WITH_LOCK(so->fp->f_lock) {
+				for (auto&& pl : so->fp->f_poll_list) {
+					so->so_nc->add_poller(*pl._req);
+				}
+				if (so->fp->f_epolls) {
+					for (auto&& ep : *so->fp->f_epolls) {
+						so->so_nc->add_epoll(ep);
+					}
+				}
+			}
+		}
+	}
+	up->u_nc_intf = intf;
+	intf->add_net_channel(up->u_nc, udp_connection_id(inp));
+}
+
+/*
+ * Stop steering datagrams to the channel; it has to be done before the
+ * addresses of the pcb change.  The channel itself is kept, it may still
+ * hold datagrams.
+ */
+void
+udp_teardown_net_channel(struct inpcb *inp)
+{
+	struct udpcb *up = intoudpcb(inp);
+
+	INP_LOCK_ASSERT(inp);
+	if (up->u_nc_intf == NULL)
+		return;
+	up->u_nc_intf->del_net_channel(udp_connection_id(inp));
+	up->u_nc_intf = NULL;
+}
+
+static void
+udp_free_net_channel(struct inpcb *inp)
+{
+	struct udpcb *up = intoudpcb(inp);
+	struct socket *so = inp->inp_socket;
+
+	if (up->u_nc == NULL)
+		return;
+	udp_teardown_net_channel(inp);
+	if (so && so->fp) {
+		for (auto&& pl : so->fp->f_poll_list) {
+			so->so_nc->del_poller(*pl._req);
+		}
+	}
+	if (so)
+		so->so_nc = nullptr;
+	osv::rcu_dispose(up->u_nc);
+	up->u_nc = NULL;
+}
+
 void
 udp_input(struct mbuf *m, int off)
 {
@@ -568,6 +710,8 @@ udp_input(struct mbuf *m, int off)
 		return;
 	}
 	udp_append(inp, ip, m, iphlen, &udp_in);
+	if (intoudpcb(inp)->u_nc_intf == NULL)
+		udp_setup_net_channel(inp, ifp);
 	INP_UNLOCK(inp);
 	return;
 
@@ -1342,6 +1486,7 @@ udp_abort(struct socket *so)
 	KASSERT(inp != NULL, ("udp_abort: inp == NULL"));
 	INP_LOCK(inp);
 	if (inp->inp_faddr.s_addr != INADDR_ANY) {
+		udp_teardown_net_channel(inp);
 		INP_HASH_WLOCK(&V_udbinfo);
 		in_pcbdisconnect(inp);
 		inp->inp_laddr.s_addr = INADDR_ANY;
@@ -1429,6 +1574,7 @@ udp_close(struct socket *so)
 	KASSERT(inp != NULL, ("udp_close: inp == NULL"));
 	INP_LOCK(inp);
 	if (inp->inp_faddr.s_addr != INADDR_ANY) {
+		udp_teardown_net_channel(inp);
 		INP_HASH_WLOCK(&V_udbinfo);
 		in_pcbdisconnect(inp);
 		inp->inp_laddr.s_addr = INADDR_ANY;
@@ -1453,6 +1599,7 @@ udp_connect(struct socket *so, struct bsd_sockaddr *nam, struct thread *td)
 		return (EISCONN);
 	}
 	sin = (struct bsd_sockaddr_in *)nam;
+	udp_teardown_net_channel(inp);
 	INP_HASH_WLOCK(&V_udbinfo);
 	error = in_pcbconnect(inp, nam, 0);
 	INP_HASH_WUNLOCK(&V_udbinfo);
@@ -1476,6 +1623,7 @@ udp_detach(struct socket *so)
 	INP_LOCK(inp);
 	up = intoudpcb(inp);
 	KASSERT(up != NULL, ("%s: up == NULL", __func__));
+	udp_free_net_channel(inp);
 	inp->inp_ppcb = NULL;
 	in_pcbdetach(inp);
 	in_pcbfree(inp);
@@ -1495,6 +1643,7 @@ udp_disconnect(struct socket *so)
 		INP_UNLOCK(inp);
 		return (ENOTCONN);
 	}
+	udp_teardown_net_channel(inp);
 	INP_HASH_WLOCK(&V_udbinfo);
 	in_pcbdisconnect(inp);
 	inp->inp_laddr.s_addr = INADDR_ANY;
@@ -51,6 +51,8 @@ struct udpiphdr {
 #define	ui_ulen		ui_u.uh_ulen
 #define	ui_sum		ui_u.uh_sum
 
+struct net_channel;
+
 typedef void(*udp_tun_func_t)(struct mbuf *, int off, struct inpcb *);
 
 /*
@@ -59,6 +61,8 @@ typedef void(*udp_tun_func_t)(struct mbuf *, int off, struct inpcb *);
 struct udpcb {
 	udp_tun_func_t	u_tun_func;	/* UDP kernel tunneling callback. */
 	u_int		u_flags;	/* Generic UDP flags. */
+	struct net_channel *u_nc;	/* channel of the consuming thread */
+	struct ifnet	*u_nc_intf;	/* interface u_nc is registered on */
 };
 
 #define	intoudpcb(ip)	((struct udpcb *)(ip)->inp_ppcb)
@@ -155,6 +159,7 @@ void		 udp_destroy(void);
 #endif
 void		 udp_input(struct mbuf *, int);
 struct inpcb	*udp_notify(struct inpcb *inp, int errval);
+void		 udp_teardown_net_channel(struct inpcb *inp);
 int		 udp_shutdown(struct socket *so);
 
 int udp_set_kernel_tunneling(struct socket *so, udp_tun_func_t f);
@@ -39,6 +39,7 @@
 #define	_SYS_FILIO_H_
 
 #include <sys/ioccom.h>
+#include <stdint.h>
 
 /* Generic file-descriptor ioctl's. */
 #define	FIOCLEX		 _IO('f', 1)		/* set close on exec on fd */
@@ -60,5 +61,14 @@ struct fiodgname_arg {
 /* Handle lseek SEEK_DATA and SEEK_HOLE for holey file knowledge. */
 #define	FIOSEEKDATA	_IOWR('f', 97, off_t)	/* SEEK_DATA */
 #define	FIOSEEKHOLE	_IOWR('f', 98, off_t)	/* SEEK_HOLE */
+/* ZFS prefetcher statistics of a file. */
+struct fiozfetchstats {
+	uint64_t	fzs_hits;	/* reads that followed a stream */
+	uint64_t	fzs_misses;	/* reads that followed none */
+	uint64_t	fzs_prefetched;	/* blocks prefetched */
+	uint64_t	fzs_streams;	/* streams being followed */
+	uint64_t	fzs_distance;	/* largest prefetch cap, in blocks */
+};
+#define	FIOZFETCHSTATS	_IOR('f', 99, struct fiozfetchstats)
 
 #endif /* !_SYS_FILIO_H_ */
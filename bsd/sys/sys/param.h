@@ -113,6 +113,8 @@
 #ifndef TRUE
 #define	TRUE	1
 #endif
+
+#define	NOCPU	(-1)		/* For when we aren't on a CPU. */
 #endif
 
 /* Machine type dependent parameters. */
@@ -403,6 +403,7 @@ struct sockproto {
 #endif
 #if __BSD_VISIBLE
 #define	MSG_NOSIGNAL	0x20000		/* do not generate SIGPIPE on EOF */
+#define	MSG_WAITFORONE	0x80000		/* for recvmmsg() */
 #endif
 
 #if __BSD_VISIBLE
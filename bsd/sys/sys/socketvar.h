@@ -353,6 +353,11 @@ int	soreceive_stream(struct socket *so, struct bsd_sockaddr **paddr,
 int	soreceive_dgram(struct socket *so, struct bsd_sockaddr **paddr,
 	    struct uio *uio, struct mbuf **mp0, struct mbuf **controlp,
 	    int *flagsp);
+int	soreceive_dgram_dequeue(struct socket *so, struct uio *uio,
+	    struct mbuf **records, int maxrecords, int flags, int *nrecords);
+int	soreceive_dgram_record(struct socket *so, struct mbuf *m,
+	    struct bsd_sockaddr **psa, struct uio *uio,
+	    struct mbuf **controlp, int *flagsp);
 int	soreceive_generic(struct socket *so, struct bsd_sockaddr **paddr,
 	    struct uio *uio, struct mbuf **mp0, struct mbuf **controlp,
 	    int *flagsp);
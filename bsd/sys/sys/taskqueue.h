@@ -67,6 +67,9 @@ struct taskqueue *taskqueue_create(const char *name, int mflags,
 				    void *context);
 int	taskqueue_start_threads(struct taskqueue **tqp, int count, int pri,
 				const char *name, ...) __printflike(4, 5);
+int	taskqueue_start_threads_pinned(struct taskqueue **tqp, int count,
+				int pri, int cpu, const char *name, ...)
+				__printflike(5, 6);
 int	taskqueue_enqueue(struct taskqueue *queue, struct task *task);
 #if 0
 int	taskqueue_enqueue_timeout(struct taskqueue *queue,
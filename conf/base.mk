@@ -2,6 +2,10 @@ conf-preempt=1
 conf-tracing=0
 conf-debug_memory=0
 
+# How the x64 kernel is compressed in loader.img: fastlz, or lz4 which
+# decompresses faster. Needs a clean build when changed.
+conf-lzkernel_codec=fastlz
+
 # debug level logging (enabled automatically in mode=debug)
 conf-logger_debug=0
 
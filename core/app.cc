@@ -19,10 +19,12 @@
 #include <boost/range/algorithm/transform.hpp>
 #include <osv/wait_record.hh>
 #include "libc/pthread.hh"
+#include <osv/boot.hh>
 
 using namespace boost::range;
 
 extern int optind;
+extern boot_time_chart boot_time;
 
 // Java uses this global variable (supplied by Glibc) to figure out
 // aproximatively where the initial thread's stack end.
@@ -203,6 +205,7 @@ application::application(const std::string& command,
         // ELF object and pass delay_init set to true (3rd argument) to the get_library method below.
         // The ELF object will be initialized by explicitly calling program::init_library() from
         // application::main() invoked by new thread later.
+        _load_stats = current_program->get_load_stats();
         _lib = current_program->get_library(_command, {}, true);
     } catch (const launch_error &e) {
         throw;
@@ -315,6 +318,9 @@ void application::main()
     // for reasons explained in application::application().
     elf::get_program()->init_library(_args.size(), _argv.get());
     sched::thread::current()->set_name(_command);
+    if (boot_time.app_phases) {
+        print_load_stats();
+    }
 
     if (_main) {
         run_main();
@@ -330,6 +336,24 @@ void application::main()
     // _entry_point() doesn't return
 }
 
+void application::print_load_stats()
+{
+    // Other applications may be loading at the same time, in which case
+    // their work is counted here too.
+    auto now = elf::get_program()->get_load_stats();
+    auto ms = [] (u64 ns) { return ns / 1000000.0; };
+    auto lookups = now.lookups - _load_stats.lookups;
+    auto hits = now.lookup_hits - _load_stats.lookup_hits;
+    printf("%s: ELF load %.2fms (%lu objects), relocation %.2fms, init %.2fms, "
+           "symbol lookups %lu (%.1f%% cached), %lu prelinked\n", _command.c_str(),
+           ms(now.load_ns - _load_stats.load_ns),
+           now.objects - _load_stats.objects,
+           ms(now.relocate_ns - _load_stats.relocate_ns),
+           ms(now.init_ns - _load_stats.init_ns),
+           lookups, lookups ? 100.0 * hits / lookups : 0.0,
+           now.prelinked - _load_stats.prelinked);
+}
+
 void application::prepare_argv(elf::program *program)
 {
     // Prepare program_* variable used by the libc
@@ -477,7 +501,7 @@ int application::get_return_code()
     return _return_code;
 }
 
-std::string application::get_command()
+const std::string& application::get_command() const
 {
     return _command;
 }
@@ -4,6 +4,7 @@
 #include "drivers/clock.hh"
 #include <osv/barrier.hh>
 #include <osv/boot.hh>
+#include <algorithm>
 
 double boot_time_chart::to_msec(u64 time)
 {
@@ -20,7 +21,11 @@ void boot_time_chart::print_one_time(int index)
 
 void boot_time_chart::event(const char *str)
 {
-    event(_event++, str, processor::ticks());
+    auto stamp = processor::ticks();
+    auto idx = _event.fetch_add(1, std::memory_order_relaxed);
+    if (idx < max_events) {
+        event(idx, str, stamp);
+    }
 }
 
 void boot_time_chart::event(int event_idx, const char *str)
@@ -40,7 +45,7 @@ void boot_time_chart::print_chart()
         debug("Skipping bootchart: please run this with a clocksource that can do ticks/nanoseconds conversion.\n");
         return;
     }
-    int events = _event;
+    int events = std::min(_event.load(), max_events);
     for (auto i = 1; i < events; ++i) {
         print_one_time(i);
     }
@@ -48,7 +53,7 @@ void boot_time_chart::print_chart()
 
 void boot_time_chart::print_total_time()
 {
-    auto last = arrays[_event - 1].stamp;
+    auto last = arrays[std::min(_event.load(), max_events) - 1].stamp;
     auto initial = arrays[0].stamp;
     printf("Booted up in %.2f ms\n", to_msec(last - initial));
 }
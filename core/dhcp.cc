@@ -6,6 +6,7 @@
  */
 
 #include <list>
+#include <fstream>
 
 #include <stdlib.h>
 
@@ -66,6 +67,22 @@ void dhcp_start(bool wait)
     net_dhcp_worker.start(wait);
 }
 
+void dhcp_start_background()
+{
+    net_dhcp_worker.init();
+    net_dhcp_worker.start_background();
+}
+
+void dhcp_wait()
+{
+    net_dhcp_worker.wait();
+}
+
+void dhcp_set_lease_cache(const char* path)
+{
+    net_dhcp_worker.set_lease_cache(path);
+}
+
 // Send DHCP release, for example at shutdown.
 void dhcp_release()
 {
@@ -261,7 +278,8 @@ namespace dhcp {
             options = add_option(options, DHCP_OPTION_HOSTNAME, hostname.length(), (u8*)(hostname.c_str()));
         }
 
-        if(request_packet_type == DHCP_REQUEST_SELECTING) {
+        if(request_packet_type == DHCP_REQUEST_SELECTING ||
+           request_packet_type == DHCP_REQUEST_INIT_REBOOT) {
             options = add_option(options, DHCP_OPTION_REQUESTED_ADDRESS, 4, (u8*)&requested_ip);
         }
         options = add_option(options, DHCP_OPTION_PARAMETER_REQUEST_LIST,
@@ -534,7 +552,7 @@ namespace dhcp {
     {
         _sock = new dhcp_socket(ifp);
         _xid = 0;
-        _client_addr = _server_addr = ipv4_zero;
+        _client_addr = _server_addr = _cached_addr = ipv4_zero;
     }
 
     dhcp_interface_state::~dhcp_interface_state()
@@ -558,6 +576,39 @@ namespace dhcp {
         _sock->dhcp_send(dm);
     }
 
+    void dhcp_interface_state::init_reboot()
+    {
+        // Only try once: if the server doesn't answer, the retries discover
+        if (_cached_addr == ipv4_zero) {
+            discover();
+            return;
+        }
+        auto addr = _cached_addr;
+        _cached_addr = ipv4_zero;
+
+        _state = DHCP_REQUEST;
+        dhcp_mbuf dm(false);
+        _xid = rand();
+        _client_addr = _server_addr = ipv4_zero;
+        std::string hostname_str("");
+        char hostname[256];
+        if (0 == gethostname(hostname, sizeof(hostname))) {
+            hostname_str.assign(hostname);
+        }
+        // RFC 2131 section 3.2: a client which remembers its address asks
+        // for it again, without the server identifier. A NAK sends us back
+        // to discovery (see state_request()).
+        dm.compose_request(_ifp,
+                           _xid,
+                           addr,
+                           ipv4_zero,
+                           dhcp_mbuf::DHCP_REQUEST_INIT_REBOOT,
+                           hostname_str);
+        dhcp_i( "Broadcasting DHCPREQUEST message with xid: [%d] to reuse cached IP: %s",
+                _xid, addr.to_string().c_str());
+        _sock->dhcp_send(dm);
+    }
+
     void dhcp_interface_state::release()
     {
         // Update state
@@ -740,7 +791,7 @@ namespace dhcp {
     ///////////////////////////////////////////////////////////////////////////
 
     dhcp_worker::dhcp_worker()
-        : _dhcp_thread(nullptr), _have_ip(false), _waiter(nullptr)
+        : _dhcp_thread(nullptr), _have_ip(false), _waiter(nullptr), _pending(false)
     {
 
     }
@@ -769,6 +820,8 @@ namespace dhcp {
         }
         IFNET_RUNLOCK();
 
+        load_leases();
+
         // Create the worker thread
         _dhcp_thread = sched::thread::make([&] { dhcp_worker_fn(); });
         _dhcp_thread->set_name("dhcp");
@@ -802,7 +855,67 @@ namespace dhcp {
     void dhcp_worker::start(bool wait)
     {
         // FIXME: clear routing table (use case run dhclient 2nd time)
-        _send_and_wait(wait, &dhcp_interface_state::discover);
+        _send_and_wait(wait, &dhcp_interface_state::init_reboot);
+    }
+
+    void dhcp_worker::start_background()
+    {
+        _pending.store(true);
+        // Runs the same retry loop as start(true), in its own thread, which
+        // exits once the lease is there.
+        sched::thread::make([this] {
+            start(true);
+            WITH_LOCK(_lock) {
+                _pending.store(false);
+                _lease_cond.wake_all();
+            }
+        }, sched::thread::attr().detached().name("dhcp-start"))->start();
+    }
+
+    void dhcp_worker::wait()
+    {
+        if (!_pending.load(std::memory_order_relaxed)) {
+            return;
+        }
+        dhcp_i("Waiting for IP...");
+        WITH_LOCK(_lock) {
+            _lease_cond.wait_until(_lock, [&] { return !_pending.load(); });
+        }
+    }
+
+    // The cache has a line per interface: its name and its last address
+    void dhcp_worker::load_leases()
+    {
+        if (_lease_cache.empty()) {
+            return;
+        }
+        std::ifstream f(_lease_cache);
+        std::string ifname, addr;
+        while (f >> ifname >> addr) {
+            boost::system::error_code ec;
+            auto ip = ip::address_v4::from_string(addr, ec);
+            for (auto &it: _universe) {
+                if (!ec && ifname == it.first->if_xname) {
+                    it.second->set_cached_addr(ip);
+                }
+            }
+        }
+    }
+
+    void dhcp_worker::save_leases()
+    {
+        if (_lease_cache.empty()) {
+            return;
+        }
+        std::ofstream f(_lease_cache, std::ios::trunc);
+        for (auto &it: _universe) {
+            if (it.second->is_acknowledged()) {
+                f << it.first->if_xname << " " << it.second->client_addr().to_string() << "\n";
+            }
+        }
+        if (!f) {
+            dhcp_w("Couldn't save the leases to %s", _lease_cache.c_str());
+        }
     }
 
     void dhcp_worker::release()
@@ -844,6 +957,9 @@ namespace dhcp {
 
             // Check if we got an ip
             if (it->second->is_acknowledged()) {
+                if (!_have_ip) {
+                    save_leases();
+                }
                 _have_ip = true;
                 if (_waiter) {
                     _waiter->wake();
@@ -28,8 +28,10 @@
 #include <osv/demangle.hh>
 #include <boost/version.hpp>
 #include <deque>
+#include <fstream>
 #include "drivers/random.hh"
 #include <osv/kaslr.hh>
+#include <osv/clock.hh>
 
 #include "arch.hh"
 
@@ -46,6 +48,7 @@ TRACEPOINT(trace_elf_unload, "%s", const char *);
 TRACEPOINT(trace_elf_lookup, "%s", const char *);
 TRACEPOINT(trace_elf_lookup_next, "%s", const char *);
 TRACEPOINT(trace_elf_lookup_addr, "%p", const void *);
+TRACEPOINT(trace_elf_lookup_cached, "%s", const char *);
 
 extern void* elf_start;
 extern size_t elf_size;
@@ -693,6 +696,12 @@ symbol_module object::symbol(unsigned idx, bool ignore_missing)
     }
     auto nameidx = sym->st_name;
     auto name = dynamic_ptr<const char>(DT_STRTAB) + nameidx;
+    if (_prelinked) {
+        auto ret = prelinked_symbol(idx, name);
+        if (ret.symbol) {
+            return ret;
+        }
+    }
     auto ret = _prog.lookup(name, this);
     if (!ret.symbol && binding == STB_WEAK) {
         return symbol_module(sym, this);
@@ -707,6 +716,30 @@ symbol_module object::symbol(unsigned idx, bool ignore_missing)
     return ret;
 }
 
+// The definition scripts/prelink.py found for our symbol idx, called name,
+// or none if it found none, or if what it found doesn't have that name.
+symbol_module object::prelinked_symbol(unsigned idx, const char* name)
+{
+    if (idx >= _prelinked->bindings.size()) {
+        return symbol_module(nullptr, nullptr);
+    }
+    auto& binding = _prelinked->bindings[idx];
+    if (binding.first >= _prelinked_modules.size()) {
+        return symbol_module(nullptr, nullptr);
+    }
+    auto obj = _prelinked_modules[binding.first];
+    if (binding.second >= obj->_symbols_count) {
+        return symbol_module(nullptr, nullptr);
+    }
+    auto sym = &obj->dynamic_ptr<Elf64_Sym>(DT_SYMTAB)[binding.second];
+    auto strtab = obj->dynamic_ptr<const char>(DT_STRTAB);
+    if (sym->st_shndx == SHN_UNDEF || strcmp(strtab + sym->st_name, name) != 0) {
+        return symbol_module(nullptr, nullptr);
+    }
+    _prog._prelinked_symbols.fetch_add(1, std::memory_order_relaxed);
+    return symbol_module(sym, obj);
+}
+
 // symbol_other(idx) is similar to symbol(idx), except that the symbol is not
 // looked up in the object itself, just in the other objects.
 symbol_module object::symbol_other(unsigned idx)
@@ -734,6 +767,28 @@ symbol_module object::symbol_other(unsigned idx)
     return ret;
 }
 
+// Relative relocations need no symbol lookups and are independent of each
+// other, so in objects which have a lot of them (large PIE executables can
+// have millions) they are spread over all cpus.
+static constexpr size_t parallel_relocations_min = 64 * 1024;
+
+// Calls fn(i, nslices) for i in [0, nslices), on a thread of its own for each
+// cpu, and waits for all of them to return.
+template <typename Fn>
+static void for_each_cpu_slice(Fn fn)
+{
+    auto nslices = sched::cpus.size();
+    std::vector<std::unique_ptr<sched::thread>> threads;
+    for (unsigned i = 0; i < nslices; i++) {
+        threads.emplace_back(sched::thread::make([=] { fn(i, nslices); },
+                sched::thread::attr().pin(sched::cpus[i]).name("elf-reloc")));
+        threads.back()->start();
+    }
+    for (auto& t : threads) {
+        t->join();
+    }
+}
+
 void object::relocate_rela()
 {
     if(has_non_writable_text_relocations()) {
@@ -743,6 +798,24 @@ void object::relocate_rela()
     auto rela = dynamic_ptr<Elf64_Rela>(DT_RELA);
     assert(dynamic_val(DT_RELAENT) == sizeof(Elf64_Rela));
     unsigned nb = dynamic_val(DT_RELASZ) / sizeof(Elf64_Rela);
+    // The linker sorts the relative relocations first, and tells us how
+    // many there are.
+    unsigned nrelative = 0;
+    if (dynamic_exists(DT_RELACOUNT)) {
+        nrelative = std::min<unsigned>(dynamic_val(DT_RELACOUNT), nb);
+    }
+    if (nrelative >= parallel_relocations_min && sched::cpus.size() > 1) {
+        for_each_cpu_slice([=] (unsigned i, unsigned nslices) {
+            auto end = rela + u64(nrelative) * (i + 1) / nslices;
+            for (auto p = rela + u64(nrelative) * i / nslices; p < end; ++p) {
+                assert((p->r_info & 0xffffffff) == ARCH_RELATIVE);
+                *static_cast<void**>(_base + p->r_offset) = _base + p->r_addend;
+            }
+        });
+        rela += nrelative;
+        nb -= nrelative;
+        elf_debug("Relocated %d relative symbols in DT_RELA in parallel\n", nrelative);
+    }
     for (auto p = rela; p < rela + nb; ++p) {
         auto info = p->r_info;
         u32 sym = info >> 32;
@@ -758,8 +831,79 @@ void object::relocate_rela()
     elf_debug("Relocated %d symbols in DT_RELA\n", nb);
 }
 
+// Applies the DT_RELR entries [p, end), where being the word the first of
+// them relocates from if it is a bitmap entry.
+static void apply_relr(void* base, const u64* p, const u64* end, u64* where)
+{
+    auto b = reinterpret_cast<u64>(base);
+    for (; p < end; ++p) {
+        if ((*p & 1) == 0) {
+            // An even entry is the offset of a word to relocate...
+            where = static_cast<u64*>(base + *p);
+            *where++ += b;
+        } else {
+            // ... and an odd one is a bitmap of which of the next 63 words
+            // are to be relocated as well.
+            auto bitmap = *p >> 1;
+            for (unsigned i = 0; bitmap; bitmap >>= 1, i++) {
+                if (bitmap & 1) {
+                    where[i] += b;
+                }
+            }
+            where += 63;
+        }
+    }
+}
+
+// DT_RELR is a compact encoding of relative relocations (the addend is
+// the word being relocated), emitted by "ld -z pack-relative-relocs".
+void object::relocate_relr()
+{
+    auto relr = dynamic_ptr<const u64>(DT_RELR);
+    assert(dynamic_val(DT_RELRENT) == sizeof(u64));
+    size_t nb = dynamic_val(DT_RELRSZ) / sizeof(u64);
+    if (nb == 0) {
+        return;
+    }
+    assert((relr[0] & 1) == 0);
+    // Each bitmap entry stands for up to 63 relocations, so it takes far
+    // fewer entries to make going parallel worth it.
+    auto nslices = sched::cpus.size();
+    if (nb >= parallel_relocations_min / 64 && nslices > 1) {
+        // Linkers emit one address entry per run of relocated words, followed
+        // by bitmaps, so there may be very few address entries. Slices thus
+        // start on any entry, and a quick pass over the table finds the word
+        // each of them relocates from.
+        std::vector<u64*> wheres(nslices);
+        u64* where = nullptr;
+        unsigned slice = 0;
+        for (size_t i = 0; i < nb; i++) {
+            while (slice < nslices && nb * slice / nslices == i) {
+                wheres[slice++] = where;
+            }
+            if ((relr[i] & 1) == 0) {
+                where = static_cast<u64*>(_base + relr[i]) + 1;
+            } else {
+                where += 63;
+            }
+        }
+        for_each_cpu_slice([=, &wheres] (unsigned i, unsigned nslices) {
+            apply_relr(_base, relr + nb * i / nslices,
+                    relr + nb * (i + 1) / nslices, wheres[i]);
+        });
+        _prog._relr_sliced.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        apply_relr(_base, relr, relr + nb, nullptr);
+    }
+    elf_debug("Relocated %d entries in DT_RELR\n", nb);
+}
+
 extern "C" { void __elf_resolve_pltgot(void); }
 
+// The PLT profile is kept by the main program, for the objects of all the
+// programs, including those of applications in a namespace of their own.
+extern program* s_program;
+
 void object::relocate_pltgot()
 {
     auto pltgot = dynamic_ptr<void*>(DT_PLTGOT);
@@ -778,6 +922,11 @@ void object::relocate_pltgot()
         (dynamic_exists(DT_FLAGS) && (dynamic_val(DT_FLAGS) & DF_BIND_NOW)) ||
         (dynamic_exists(DT_FLAGS_1) && (dynamic_val(DT_FLAGS_1) & DF_1_NOW));
 
+    // Symbols the PLT profile says will be used are bound now as well, to
+    // take the lazy binding out of their first calls.
+    auto hot = bind_now ? std::unordered_set<std::string>() : s_program->plt_hot(_pathname);
+    auto symtab = dynamic_ptr<Elf64_Sym>(DT_SYMTAB);
+    auto strtab = dynamic_ptr<const char>(DT_STRTAB);
     auto rel = dynamic_ptr<Elf64_Rela>(DT_JMPREL);
     auto nrel = dynamic_val(DT_PLTRELSZ) / sizeof(*rel);
     for (auto p = rel; p < rel + nrel; ++p) {
@@ -785,14 +934,22 @@ void object::relocate_pltgot()
         u32 type = info & 0xffffffff;
         assert(type == ARCH_JUMP_SLOT);
         void *addr = _base + p->r_offset;
-        if (bind_now) {
+        u32 sym = info >> 32;
+        auto name = strtab + symtab[sym].st_name;
+        bool is_hot = hot.count(name);
+        if (bind_now || is_hot) {
             // If on-load binding is requested (instead of the default lazy
             // binding), try to resolve all the PLT entries now.
-            // If symbol cannot be resolved warn about it instead of aborting
-            u32 sym = info >> 32;
+            // If symbol cannot be resolved warn about it instead of aborting,
+            // leaving the entry to lazy binding.
             auto _sym = symbol(sym, true);
-            if (arch_relocate_jump_slot(_sym, addr, p->r_addend))
-                  continue;
+            if (arch_relocate_jump_slot(_sym, addr, p->r_addend)) {
+                if (is_hot) {
+                    // so that the next profile keeps it
+                    s_program->plt_profile_add(_pathname, name);
+                }
+                continue;
+            }
         }
         if (original_plt) {
             // Restore the link to the original plt.
@@ -827,6 +984,10 @@ void* object::resolve_pltgot(unsigned index)
     assert(type == ARCH_JUMP_SLOT);
     void *addr = _base + slot.r_offset;
     auto sm = symbol(sym);
+    if (s_program->_plt_profile_recording) {
+        auto name = dynamic_ptr<const char>(DT_STRTAB) + dynamic_ptr<Elf64_Sym>(DT_SYMTAB)[sym].st_name;
+        s_program->plt_profile_add(_pathname, name);
+    }
 
     if (sm.obj != this) {
         WITH_LOCK(_used_by_resolve_plt_got_mutex) {
@@ -842,15 +1003,48 @@ void* object::resolve_pltgot(unsigned index)
     return *static_cast<void**>(addr);
 }
 
+// Lets symbol() use the bindings prelinked for this object, if we are
+// relocating it with the very modules list they were computed against.
+void object::use_prelink()
+{
+    auto p = _prog.prelinked(_pathname);
+    if (!p) {
+        return;
+    }
+    auto ml = _prog._modules_rcu.read_by_owner();
+    if (ml->objects.size() != p->modules.size()) {
+        elf_debug("not using prelinked bindings, modules list changed\n");
+        return;
+    }
+    for (unsigned i = 0; i < p->modules.size(); i++) {
+        auto obj = ml->objects[i];
+        if (obj->_pathname != p->modules[i].first || !obj->visible() ||
+                obj->symbols_hash() != p->modules[i].second) {
+            elf_debug("not using prelinked bindings, %s changed\n", obj->_pathname.c_str());
+            return;
+        }
+    }
+    _prelinked = p;
+    _prelinked_modules = ml->objects;
+}
+
 void object::relocate()
 {
     assert(!dynamic_exists(DT_REL));
+    use_prelink();
+    // Before DT_RELA, so that IRELATIVE resolvers see relocated data
+    if (dynamic_exists(DT_RELR)) {
+        relocate_relr();
+    }
     if (dynamic_exists(DT_RELA)) {
         relocate_rela();
     }
     if (dynamic_exists(DT_JMPREL)) {
         relocate_pltgot();
     }
+    // Lazily bound PLT entries are resolved later, maybe with other modules
+    _prelinked = nullptr;
+    _prelinked_modules.clear();
 }
 
 unsigned long
@@ -996,6 +1190,36 @@ unsigned object::symtab_len()
     return len;
 }
 
+// Identifies the contents of our dynamic symbol table, the same way
+// scripts/prelink.py does: FNV-1a of the string table, the symbol table and
+// the symbol versions. With only a GNU hash table, symtab_len() leaves out
+// the symbols before the first hashed one.
+u64 object::symbols_hash()
+{
+    if (_symbols_count) {
+        return _symbols_hash;
+    }
+    unsigned count = symtab_len();
+    if (!dynamic_exists(DT_HASH)) {
+        count += dynamic_ptr<Elf64_Word>(DT_GNU_HASH)[1];
+    }
+    u64 h = 0xcbf29ce484222325;
+    auto hash = [&] (const void* data, size_t len) {
+        auto p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < len; i++) {
+            h = (h ^ p[i]) * 0x100000001b3;
+        }
+    };
+    hash(dynamic_ptr<char>(DT_STRTAB), dynamic_val(DT_STRSZ));
+    hash(dynamic_ptr<Elf64_Sym>(DT_SYMTAB), count * sizeof(Elf64_Sym));
+    if (dynamic_exists(DT_VERSYM)) {
+        hash(dynamic_ptr<Elf64_Versym>(DT_VERSYM), count * sizeof(Elf64_Versym));
+    }
+    _symbols_hash = h;
+    _symbols_count = count;
+    return h;
+}
+
 dladdr_info object::lookup_addr(const void* addr)
 {
     dladdr_info ret;
@@ -1324,6 +1548,7 @@ program::program(void* addr)
         _files[name] = _core;
     }
     _modules_rcu.assign(ml);
+    invalidate_lookup_cache(*ml);
 }
 
 void program::set_search_path(std::initializer_list<std::string> path)
@@ -1396,6 +1621,9 @@ program::load_object(std::string name, std::vector<std::string> extra_path,
         }
     }
     if (f) {
+        if (loaded_objects.empty()) {
+            load_prelink(name);
+        }
         trace_elf_load(name.c_str());
         auto ef = std::shared_ptr<object>(new file(*this, f, name),
                 [=](object *obj) { remove_object(obj); });
@@ -1411,17 +1639,24 @@ program::load_object(std::string name, std::vector<std::string> extra_path,
         new_modules->objects.insert(
                 std::prev(new_modules->objects.end()), ef.get());
         new_modules->adds++;
+        invalidate_lookup_cache(*new_modules);
         _modules_rcu.assign(new_modules.release());
         osv::rcu_dispose(old_modules);
+        auto t0 = osv::clock::uptime::now();
         ef->load_segments();
         ef->process_headers();
+        auto t1 = osv::clock::uptime::now();
+        _load_stats.objects++;
+        _load_stats.load_ns += (t1 - t0).count();
         if (!ef->is_non_pie_executable())
            _next_alloc = ef->end();
         add_debugger_obj(ef.get());
         loaded_objects.push_back(ef);
         ef->load_needed(loaded_objects);
+        t0 = osv::clock::uptime::now();
         ef->relocate();
         ef->fix_permissions();
+        _load_stats.relocate_ns += (osv::clock::uptime::now() - t0).count();
         _files[name] = ef;
         _files[ef->soname()] = ef;
         return ef;
@@ -1430,6 +1665,161 @@ program::load_object(std::string name, std::vector<std::string> extra_path,
     }
 }
 
+namespace {
+
+// Bounds-checked reader of the .prelink files written by scripts/prelink.py
+struct prelink_reader {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    bool has(size_t len) {
+        ok = ok && size_t(end - p) >= len;
+        return ok;
+    }
+    template <typename T>
+    T get() {
+        T v{};
+        if (has(sizeof(T))) {
+            memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+        }
+        return v;
+    }
+    std::string str() {
+        auto len = get<u32>();
+        if (!has(len)) {
+            return "";
+        }
+        std::string s(p, len);
+        p += len;
+        return s;
+    }
+    // Reads an element count, refusing ones the rest of the file can't hold
+    u32 count(size_t element_size) {
+        auto n = get<u32>();
+        has(size_t(n) * element_size);
+        return ok ? n : 0;
+    }
+};
+
+}
+
+// Reads the symbol bindings scripts/prelink.py precomputed for the
+// application name and the objects it needs, if the image has them.
+void program::load_prelink(const std::string& name)
+{
+    static constexpr char magic[] = "OSVPRELK";
+    static constexpr u32 version = 1;
+
+    _prelink.clear();
+    auto f = fileref_from_fname(name + ".prelink");
+    if (!f) {
+        return;
+    }
+    std::vector<char> buf(::size(f));
+    ::read(f, buf.data(), 0, buf.size());
+    prelink_reader r{buf.data(), buf.data() + buf.size()};
+    if (!r.has(sizeof(magic) - 1) || memcmp(r.p, magic, sizeof(magic) - 1)) {
+        return;
+    }
+    r.p += sizeof(magic) - 1;
+    if (r.get<u32>() != version) {
+        return;
+    }
+    auto nobjects = r.count(3 * sizeof(u32));
+    for (u32 i = 0; i < nobjects && r.ok; i++) {
+        auto pathname = r.str();
+        prelink_object obj;
+        auto nmodules = r.count(sizeof(u32) + sizeof(u64));
+        for (u32 j = 0; j < nmodules && r.ok; j++) {
+            auto module = r.str();
+            obj.modules.emplace_back(std::move(module), r.get<u64>());
+        }
+        auto nbindings = r.count(2 * sizeof(u32));
+        obj.bindings.reserve(nbindings);
+        for (u32 j = 0; j < nbindings && r.ok; j++) {
+            auto module = r.get<u32>();
+            obj.bindings.emplace_back(module, r.get<u32>());
+        }
+        _prelink.emplace(std::move(pathname), std::move(obj));
+    }
+    if (!r.ok) {
+        debug("%s.prelink is truncated, ignoring it\n", name.c_str());
+        _prelink.clear();
+    }
+}
+
+const prelink_object* program::prelinked(const std::string& name)
+{
+    auto it = _prelink.find(name);
+    return it == _prelink.end() ? nullptr : &it->second;
+}
+
+void program::record_plt_profile(const std::string& path)
+{
+    if (this != s_program) {
+        return s_program->record_plt_profile(path);
+    }
+    WITH_LOCK(_plt_profile_mutex) {
+        _plt_profile_path = path;
+    }
+    _plt_profile_recording = true;
+}
+
+void program::bind_plt_profile(const std::string& path)
+{
+    if (this != s_program) {
+        return s_program->bind_plt_profile(path);
+    }
+    std::ifstream f(path);
+    if (!f) {
+        debug("Couldn't read the PLT profile %s\n", path.c_str());
+        return;
+    }
+    SCOPE_LOCK(_plt_profile_mutex);
+    std::string pathname, name;
+    while (f >> pathname >> name) {
+        _plt_hot[pathname].insert(name);
+    }
+}
+
+void program::save_plt_profile()
+{
+    if (this != s_program) {
+        return s_program->save_plt_profile();
+    }
+    SCOPE_LOCK(_plt_profile_mutex);
+    if (_plt_profile_path.empty()) {
+        return;
+    }
+    std::ofstream f(_plt_profile_path, std::ios::trunc);
+    for (auto& obj : _plt_used) {
+        for (auto& name : obj.second) {
+            f << obj.first << " " << name << "\n";
+        }
+    }
+    if (!f) {
+        debug("Couldn't save the PLT profile to %s\n", _plt_profile_path.c_str());
+    }
+}
+
+std::unordered_set<std::string> program::plt_hot(const std::string& pathname)
+{
+    SCOPE_LOCK(_plt_profile_mutex);
+    auto it = _plt_hot.find(pathname);
+    return it == _plt_hot.end() ? std::unordered_set<std::string>() : it->second;
+}
+
+void program::plt_profile_add(const std::string& pathname, const char* name)
+{
+    WITH_LOCK(_plt_profile_mutex) {
+        if (!_plt_profile_path.empty()) {
+            _plt_used[pathname].insert(name);
+        }
+    }
+}
+
 std::shared_ptr<object>
 program::get_library(std::string name, std::vector<std::string> extra_path, bool delay_init)
 {
@@ -1448,6 +1838,7 @@ program::get_library(std::string name, std::vector<std::string> extra_path, bool
     //
     std::vector<std::shared_ptr<object>> loaded_objects;
     auto ret = load_object(name, extra_path, loaded_objects);
+    _prelink.clear();
     _loaded_objects_stack.push(loaded_objects);
 
     if (ret) {
@@ -1475,9 +1866,14 @@ void program::init_library(int argc, char** argv)
         for (unsigned i = 0; i < size; i++) {
             loaded_objects[i]->set_visibility(ThreadAndItsChildren);
         }
+        auto t0 = osv::clock::uptime::now();
         for (int i = size - 1; i >= 0; i--) {
             loaded_objects[i]->run_init_funcs(argc, argv);
         }
+        auto init_ns = (osv::clock::uptime::now() - t0).count();
+        WITH_LOCK(_mutex) {
+            _load_stats.init_ns += init_ns;
+        }
         for (unsigned i = 0; i < size; i++) {
             loaded_objects[i]->set_visibility(Public);
         }
@@ -1512,6 +1908,7 @@ void program::remove_object(object *ef)
     new_modules->objects.erase(std::find(
             new_modules->objects.begin(), new_modules->objects.end(), ef));
     new_modules->subs++;
+    invalidate_lookup_cache(*new_modules);
     _modules_rcu.assign(new_modules.release());
     osv::rcu_dispose(old_modules);
 
@@ -1545,19 +1942,113 @@ void program::del_debugger_obj(object* obj)
     }
 }
 
+// Must be called with the new list before it is published, so that a
+// lookup on the new list can't find a cache still valid for the old one.
+void program::invalidate_lookup_cache(const modules_list& ml)
+{
+    WITH_LOCK(_lookup_cache_lock.for_write()) {
+        _lookup_cache.clear();
+        _lookup_cache_pos.clear();
+        for (unsigned i = 0; i < ml.objects.size(); i++) {
+            _lookup_cache_pos[ml.objects[i]] = i;
+        }
+        _lookup_cache_gen = ml.adds + ml.subs;
+    }
+}
+
+bool program::lookup_cached(const char* name, uint32_t hash, object* seeker,
+        symbol_module& ret)
+{
+    int gen;
+    WITH_LOCK(osv::rcu_read_lock) {
+        auto modules = _modules_rcu.read();
+        gen = modules->adds + modules->subs;
+    }
+    WITH_LOCK(_lookup_cache_lock.for_read()) {
+        if (gen != _lookup_cache_gen) {
+            return false;
+        }
+        auto range = _lookup_cache.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            auto& e = it->second;
+            if (e.name != name) {
+                continue;
+            }
+            ret = e.sm;
+            // The cached result is what everybody sees. The seeker also
+            // sees its own old-version symbols, which matters if it comes
+            // first in the search order, or is the module defining it.
+            auto pos = _lookup_cache_pos.find(seeker);
+            if (seeker && pos != _lookup_cache_pos.end() && pos->second <= e.pos) {
+                if (auto sym = seeker->lookup_symbol(name, true)) {
+                    ret = symbol_module(sym, seeker);
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void program::lookup_cache_insert(const char* name, uint32_t hash, int gen,
+        const symbol_module& sm, unsigned pos)
+{
+    WITH_LOCK(_lookup_cache_lock.for_write()) {
+        if (gen != _lookup_cache_gen) {
+            return;
+        }
+        auto range = _lookup_cache.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.name == name) {
+                return;
+            }
+        }
+        _lookup_cache.emplace(hash, lookup_cache_entry{name, sm, pos});
+    }
+}
+
 symbol_module program::lookup(const char* name, object* seeker)
 {
-    trace_elf_lookup(name);
     symbol_module ret(nullptr,nullptr);
+    auto hash = dl_new_hash(name);
+    _lookups.fetch_add(1, std::memory_order_relaxed);
+    if (lookup_cached(name, hash, seeker, ret)) {
+        trace_elf_lookup_cached(name);
+        _lookup_hits.fetch_add(1, std::memory_order_relaxed);
+        return ret;
+    }
+    trace_elf_lookup(name);
+    bool cacheable = true;
+    unsigned pos = 0;
+    int gen = 0;
     with_modules([&](const elf::program::modules_list &ml)
     {
+        gen = ml.adds + ml.subs;
         for (auto module : ml.objects) {
+            cacheable &= module->visible_to_all();
             if (auto sym = module->lookup_symbol(name, seeker == module)) {
                 ret = symbol_module(sym, module);
+                // unless it's an old-version symbol only the seeker sees
+                cacheable &= seeker != module || module->lookup_symbol(name, false) == sym;
                 return;
             }
+            pos++;
         }
     });
+    if (cacheable) {
+        lookup_cache_insert(name, hash, gen, ret, pos);
+    }
+    return ret;
+}
+
+program::load_stats program::get_load_stats()
+{
+    SCOPE_LOCK(_mutex);
+    auto ret = _load_stats;
+    ret.lookups = _lookups.load(std::memory_order_relaxed);
+    ret.lookup_hits = _lookup_hits.load(std::memory_order_relaxed);
+    ret.prelinked = _prelinked_symbols.load(std::memory_order_relaxed);
+    ret.relr_sliced = _relr_sliced.load(std::memory_order_relaxed);
     return ret;
 }
 
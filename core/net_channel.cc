@@ -12,6 +12,7 @@
 #include <bsd/sys/netinet/ip.h>
 #include <bsd/sys/netinet/ip.h>
 #include <bsd/sys/netinet/tcp.h>
+#include <bsd/sys/netinet/udp.h>
 #include <bsd/sys/net/ethernet.h>
 #include <bsd/sys/net/netisr.h>
 
@@ -109,27 +110,59 @@ classifier::classifier()
 {
 }
 
-void classifier::add(ipv4_tcp_conn_id id, net_channel* channel)
+template <typename Key>
+void classifier::add(channels<Key>& table, Key id, net_channel* channel)
 {
     WITH_LOCK(_mtx) {
-        _ipv4_tcp_channels.emplace(id, channel);
+        table.emplace(id, channel);
     }
 }
 
-void classifier::remove(ipv4_tcp_conn_id id)
+template <typename Key>
+void classifier::remove(channels<Key>& table, Key id)
 {
     WITH_LOCK(_mtx) {
-        auto i = _ipv4_tcp_channels.owner_find(id,
-                std::hash<ipv4_tcp_conn_id>(), key_item_compare());
+        auto i = table.owner_find(id, std::hash<Key>(), key_item_compare<Key>());
         assert(i);
-        _ipv4_tcp_channels.erase(i);
+        table.erase(i);
+    }
+}
+
+// must be called with rcu lock held
+template <typename Key>
+net_channel* classifier::find(channels<Key>& table, Key id)
+{
+    auto i = table.reader_find(id, std::hash<Key>(), key_item_compare<Key>());
+    if (!i) {
+        return nullptr;
     }
+    return i->chan;
+}
+
+void classifier::add(ipv4_tcp_conn_id id, net_channel* channel)
+{
+    add(_ipv4_tcp_channels, id, channel);
+}
+
+void classifier::remove(ipv4_tcp_conn_id id)
+{
+    remove(_ipv4_tcp_channels, id);
+}
+
+void classifier::add(ipv4_udp_conn_id id, net_channel* channel)
+{
+    add(_ipv4_udp_channels, id, channel);
+}
+
+void classifier::remove(ipv4_udp_conn_id id)
+{
+    remove(_ipv4_udp_channels, id);
 }
 
 bool classifier::post_packet(mbuf* m)
 {
     WITH_LOCK(osv::rcu_read_lock) {
-        if (auto nc = classify_ipv4_tcp(m)) {
+        if (auto nc = classify_ipv4(m)) {
             log_packet_in(m, NETISR_ETHER);
             if (!nc->push(m)) {
                 return false;
@@ -143,13 +176,16 @@ bool classifier::post_packet(mbuf* m)
 }
 
 // must be called with rcu lock held
-net_channel* classifier::classify_ipv4_tcp(mbuf* m)
+net_channel* classifier::classify_ipv4(mbuf* m)
 {
     caddr_t h = m->m_hdr.mh_data;
     if (unsigned(m->m_hdr.mh_len) < ETHER_HDR_LEN + sizeof(ip)) {
         return nullptr;
     }
     auto ether_hdr = reinterpret_cast<ether_header*>(h);
+    // There is no IPv6 input path (the stack is built without INET6), so
+    // IPv6 frames are left to ether_input() which drops them.  An IPv6 flow
+    // key only makes sense once tcp_input()/udp_input() can consume them.
     if (ntohs(ether_hdr->ether_type) != ETHERTYPE_IP) {
         return nullptr;
     }
@@ -159,26 +195,62 @@ net_channel* classifier::classify_ipv4_tcp(mbuf* m)
     if (ip_size < sizeof(ip)) {
         return nullptr;
     }
-    if (ip_hdr->ip_p != IPPROTO_TCP) {
-        return nullptr;
-    }
     if (ntohs(ip_hdr->ip_off) & ~IP_DF) {
         return nullptr;
     }
-    auto src_addr = ip_hdr->ip_src;
-    auto dst_addr = ip_hdr->ip_dst;
     h += ip_size;
+    switch (ip_hdr->ip_p) {
+    case IPPROTO_TCP:
+        return classify_ipv4_tcp(ip_hdr, h);
+    case IPPROTO_UDP:
+        // Broadcast and multicast datagrams may have several receivers
+        if (ETHER_IS_MULTICAST(ether_hdr->ether_dhost)) {
+            return nullptr;
+        }
+        if (unsigned(m->m_hdr.mh_len) < (h - m->m_hdr.mh_data) + sizeof(udphdr)) {
+            return nullptr;
+        }
+        return classify_ipv4_udp(ip_hdr, h);
+    default:
+        return nullptr;
+    }
+}
+
+// must be called with rcu lock held
+net_channel* classifier::classify_ipv4_tcp(ip* ip_hdr, caddr_t h)
+{
     auto tcp_hdr = reinterpret_cast<tcphdr*>(h);
     if (tcp_hdr->th_flags & (TH_SYN | TH_FIN | TH_RST)) {
-	    return nullptr;
+        return nullptr;
     }
     auto src_port = ntohs(tcp_hdr->th_sport);
     auto dst_port = ntohs(tcp_hdr->th_dport);
-    auto id = ipv4_tcp_conn_id{src_addr, dst_addr, src_port, dst_port};
-    auto i = _ipv4_tcp_channels.reader_find(id,
-            std::hash<ipv4_tcp_conn_id>(), key_item_compare());
-    if (!i) {
+    auto id = ipv4_tcp_conn_id{ip_hdr->ip_src, ip_hdr->ip_dst, src_port, dst_port};
+    return find(_ipv4_tcp_channels, id);
+}
+
+// must be called with rcu lock held
+net_channel* classifier::classify_ipv4_udp(ip* ip_hdr, caddr_t h)
+{
+    if (_ipv4_udp_channels.empty()) {
         return nullptr;
     }
-    return i->chan;
+    auto udp_hdr = reinterpret_cast<udphdr*>(h);
+    auto src_port = ntohs(udp_hdr->uh_sport);
+    auto dst_port = ntohs(udp_hdr->uh_dport);
+    auto src_addr = ip_hdr->ip_src;
+    auto dst_addr = ip_hdr->ip_dst;
+    in_addr any = { INADDR_ANY };
+
+    // Same preference as in_pcblookup(): connected sockets first, then
+    // sockets bound to the destination address, then wildcard ones.
+    if (auto nc = find(_ipv4_udp_channels,
+            ipv4_udp_conn_id{src_addr, dst_addr, src_port, dst_port})) {
+        return nc;
+    }
+    if (auto nc = find(_ipv4_udp_channels,
+            ipv4_udp_conn_id{any, dst_addr, 0, dst_port})) {
+        return nc;
+    }
+    return find(_ipv4_udp_channels, ipv4_udp_conn_id{any, any, 0, dst_port});
 }
@@ -6,18 +6,21 @@
  */
 
 
+#include <bitset>
 #include <unordered_map>
 #include <unordered_set>
-#include <deque>
-#include <stack>
+#include <vector>
 #include <boost/variant.hpp>
+#include <boost/intrusive/list.hpp>
 #include <osv/pagecache.hh>
 #include <osv/mempool.hh>
 #include <fs/vfs/vfs.h>
 #include <fs/vfs/vfs_id.h>
 #include <osv/trace.hh>
 #include <osv/prio.hh>
+#include <osv/clock.hh>
 #include <chrono>
+#include <algorithm>
 
 extern "C" {
 void arc_unshare_buf(arc_buf_t*);
@@ -63,15 +66,30 @@ std::unordered_set<mmu::hw_ptep<0>>::iterator end(std::unique_ptr<std::unordered
 
 namespace pagecache {
 
-static unsigned lru_max_length = 100;
-static unsigned lru_free_count = 20;
+// The cache is split into shards by hashkey, each with its own locks, so
+// that faults on different pages from different cpus do not serialize on
+// a single mutex. The lock order is write_lock -> writeback_lock ->
+// arc_read_lock/read_lock of the same shard -> arc map lock; no path holds
+// two shards' locks of the same kind at once.
+//
+// All pages of an aligned chunk of a file share a shard, so that the
+// flusher can write back a contiguous run of them under one shard's locks.
+constexpr unsigned nr_shards = 32;
+constexpr unsigned shard_chunk_shift = 17;
+constexpr unsigned flush_batch_pages = 1 << (shard_chunk_shift - mmu::page_size_shift);
+
+// The write cache length limits apply to each shard's CLOCK list
+static unsigned clock_max_length = 100;
+static unsigned clock_free_count = 20;
+constexpr unsigned min_clock_length = 16;
 constexpr unsigned max_lru_free_count = 200;
 static void* zero_page;
 
 void  __attribute__((constructor(init_prio::pagecache))) setup()
 {
-    lru_max_length = std::max(memory::phys_mem_size / memory::page_size / 100, size_t(100));
-    lru_free_count = std::min(lru_max_length/5, max_lru_free_count);
+    auto lru_max_length = std::max(memory::phys_mem_size / memory::page_size / 100, size_t(100));
+    clock_max_length = std::max(lru_max_length / nr_shards, size_t(min_clock_length));
+    clock_free_count = std::min(clock_max_length/5, max_lru_free_count);
     zero_page = memory::alloc_page();
     memset(zero_page, 0, mmu::page_size);
 }
@@ -190,11 +208,17 @@ public:
     }
 };
 
+static mutex& writeback_lock_of(const hashkey& key);
+
 class cached_page_write : public cached_page {
 private:
     struct vnode* _vp;
     bool _dirty = false;
+    bool _referenced = true;
+    osv::clock::uptime::time_point _dirty_since;
 public:
+    boost::intrusive::list_member_hook<> _clock_link;
+
     cached_page_write(hashkey key, vfs_file* fp) : cached_page(key, memory::alloc_page()) {
         _vp = fp->f_dentry->d_vnode;
         vref(_vp);
@@ -216,6 +240,7 @@ public:
 
         _dirty = false;
 
+        SCOPE_LOCK(writeback_lock_of(_key));
         vn_lock(_vp);
         error = VOP_WRITE(_vp, &uio, 0);
         vn_unlock(_vp);
@@ -229,63 +254,132 @@ public:
         vrele(_vp);
         return p;
     }
+    struct vnode* vnode() {
+        return _vp;
+    }
     void mark_dirty() {
+        if (!_dirty) {
+            _dirty_since = osv::clock::uptime::now();
+        }
         _dirty |= true;
     }
+    void mark_clean() {
+        _dirty = false;
+    }
+    bool dirty() {
+        return _dirty;
+    }
+    osv::clock::uptime::time_point dirty_since() {
+        return _dirty_since;
+    }
+    // dirty, or written through a pte since its dirty bit was last cleared
+    bool needs_writeback() {
+        return _dirty || for_each_pte([] (mmu::hw_ptep<0> pte) { return pte.read().dirty(); }, std::logical_or<bool>(), false);
+    }
     bool flush_check_dirty() {
         return for_each_pte([] (mmu::hw_ptep<0> pte) { return mmu::clear_pte(pte).dirty(); }, std::logical_or<bool>(), false);
     }
+    void mark_referenced() {
+        _referenced = true;
+    }
+    // CLOCK reference bit: set by faults on the page, or by the hardware on
+    // any access through one of its ptes since the hand last passed.
+    bool test_and_clear_referenced() {
+        bool accessed = clear_accessed();
+        bool referenced = _referenced;
+        _referenced = false;
+        return accessed || referenced;
+    }
 };
 
+typedef boost::intrusive::list<cached_page_write,
+        boost::intrusive::member_hook<cached_page_write,
+                                      boost::intrusive::list_member_hook<>,
+                                      &cached_page_write::_clock_link>,
+        boost::intrusive::constant_time_size<true>> clock_list;
+
 class cached_page_arc;
 
-static unsigned drop_arc_read_cached_page(cached_page_arc* cp, bool flush = true);
+static unsigned drop_arc_read_cached_page(hashkey& key, arc_buf_t* ab);
 
 class cached_page_arc : public cached_page {
 public:
     typedef std::unordered_multimap<arc_buf_t*, cached_page_arc*> arc_map;
 
-    static arc_map arc_cache_map;
+    // Pages mapping each ARC buffer, sharded by the buffer rather than by
+    // hashkey, under a lock of its own nested inside the cache shard locks.
+    struct arc_map_shard {
+        mutex lock;
+        arc_map map;
+    };
+
+    static arc_map_shard arc_maps[nr_shards];
 
 private:
     arc_buf_t* _ab;
-    bool _removed = false;
+    bool _removed = false; // protected by the arc map lock
+
+    static arc_map_shard& arc_map_of(arc_buf_t* ab)
+    {
+        return arc_maps[(reinterpret_cast<uintptr_t>(ab) >> 6) % nr_shards];
+    }
 
     static arc_buf_t* ref(arc_buf_t* ab, cached_page_arc* pc)
     {
-        arc_cache_map.emplace(ab, pc);
+        auto& s = arc_map_of(ab);
+        SCOPE_LOCK(s.lock);
+        s.map.emplace(ab, pc);
+        arc_share_buf(ab);
         return ab;
     }
 
-    static bool unref(arc_buf_t* ab, cached_page_arc* pc)
+    static void unref(arc_buf_t* ab, cached_page_arc* pc)
     {
-        auto it = arc_cache_map.equal_range(ab);
+        auto& s = arc_map_of(ab);
+        SCOPE_LOCK(s.lock);
+
+        if (pc->_removed) {
+            // unmap_arc_buf() already took the buffer's pages off the map
+            return;
+        }
 
-        arc_cache_map.erase(std::find(it.first, it.second, pc));
+        auto it = s.map.equal_range(ab);
 
-        return arc_cache_map.find(ab) == arc_cache_map.end();
+        s.map.erase(std::find(it.first, it.second, pc));
+
+        if (s.map.find(ab) == s.map.end()) {
+            arc_unshare_buf(ab);
+        }
     }
 
 public:
     cached_page_arc(hashkey key, void* page, arc_buf_t* ab) : cached_page(key, page), _ab(ref(ab, this)) {}
     virtual ~cached_page_arc() {
-        if (!_removed && unref(_ab, this)) {
-            arc_unshare_buf(_ab);
-        }
+        unref(_ab, this);
     }
     arc_buf_t* arcbuf() {
         return _ab;
     }
     static void unmap_arc_buf(arc_buf_t* ab) {
-        auto it = arc_cache_map.equal_range(ab);
-        unsigned count = 0;
+        std::vector<hashkey> keys;
+        auto& s = arc_map_of(ab);
+
+        WITH_LOCK(s.lock) {
+            auto it = s.map.equal_range(ab);
+            std::for_each(it.first, it.second, [&keys](arc_map::value_type& p) {
+                    auto cp = p.second;
+                    cp->_removed = true;
+                    keys.push_back(cp->key());
+            });
+            s.map.erase(ab);
+        }
 
-        std::for_each(it.first, it.second, [&count](arc_map::value_type& p) {
-                auto cp = p.second;
-                cp->_removed = true;
-                count += drop_arc_read_cached_page(cp, false);
-        });
-        arc_cache_map.erase(ab);
+        // The pages themselves are dropped under their cache shard locks,
+        // which nest outside the arc map lock, so it cannot be held here.
+        unsigned count = 0;
+        for (auto&& key : keys) {
+            count += drop_arc_read_cached_page(key, ab);
+        }
         if (count) {
             mmu::flush_tlb_all();
         }
@@ -296,16 +390,36 @@ static bool operator==(const cached_page_arc::arc_map::value_type& l, const cach
     return l.second == r;
 }
 
-std::unordered_multimap<arc_buf_t*, cached_page_arc*> cached_page_arc::arc_cache_map;
-//Map used to store read cache pages for ZFS filesystem interacting with ARC
-static std::unordered_map<hashkey, cached_page_arc*> arc_read_cache;
-//Map used to store read cache pages for non-ZFS filesystems
-static std::unordered_map<hashkey, cached_page*> read_cache;
-static std::unordered_map<hashkey, cached_page_write*> write_cache;
-static std::deque<cached_page_write*> write_lru;
-static mutex arc_read_lock; // protects against parallel access to the ARC read cache
-static mutex read_lock; // protects against parallel access to the read cache
-static mutex write_lock; // protect against parallel access to the write cache
+cached_page_arc::arc_map_shard cached_page_arc::arc_maps[nr_shards];
+
+struct cache_shard {
+    //Map used to store read cache pages for ZFS filesystem interacting with ARC
+    std::unordered_map<hashkey, cached_page_arc*> arc_read_cache;
+    //Map used to store read cache pages for non-ZFS filesystems
+    std::unordered_map<hashkey, cached_page*> read_cache;
+    std::unordered_map<hashkey, cached_page_write*> write_cache;
+    clock_list write_clock; // front is the CLOCK hand
+    cached_page_write* tofree[max_lru_free_count]; // protected by write_lock
+    mutex arc_read_lock; // protects against parallel access to the ARC read cache
+    mutex read_lock; // protects against parallel access to the read cache
+    mutex write_lock; // protect against parallel access to the write cache
+    mutex writeback_lock; // keeps write-backs of the shard's pages in order
+    unsigned flushes_in_flight = 0; // protected by write_lock
+};
+
+static cache_shard shards[nr_shards];
+
+static cache_shard& shard_of(const hashkey& key)
+{
+    // consecutive chunks of a file should land on different shards
+    uint64_t h = key.dev ^ (key.ino * 0x9e3779b97f4a7c15ULL) ^ (key.offset >> shard_chunk_shift);
+    return shards[h % nr_shards];
+}
+
+static mutex& writeback_lock_of(const hashkey& key)
+{
+    return shard_of(key).writeback_lock;
+}
 
 template<typename T>
 static T find_in_cache(std::unordered_map<hashkey, T>& cache, hashkey& key)
@@ -341,18 +455,19 @@ static void remove_read_mapping(std::unordered_map<hashkey, T>& cache, cached_pa
 }
 
 TRACEPOINT(trace_remove_mapping, "buf=%p, addr=%p, ptep=%p", void*, void*, void*);
-static void remove_arc_read_mapping(cached_page_arc* cp, mmu::hw_ptep<0> ptep)
+static void remove_arc_read_mapping(cache_shard& s, cached_page_arc* cp, mmu::hw_ptep<0> ptep)
 {
     trace_remove_mapping(cp->arcbuf(), cp->addr(), ptep.release());
-    remove_read_mapping(arc_read_cache, cp, ptep);
+    remove_read_mapping(s.arc_read_cache, cp, ptep);
 }
 
 void remove_read_mapping(hashkey& key, mmu::hw_ptep<0> ptep)
 {
-    SCOPE_LOCK(read_lock);
-    cached_page* cp = find_in_cache(read_cache, key);
+    auto& s = shard_of(key);
+    SCOPE_LOCK(s.read_lock);
+    cached_page* cp = find_in_cache(s.read_cache, key);
     if (cp) {
-        remove_read_mapping(read_cache, cp, ptep);
+        remove_read_mapping(s.read_cache, cp, ptep);
         // The method remove_read_mapping() is called by pagecache::get()
         // to handle MAP_PRIVATE COW (Copy-On-Write) scenario triggered by an attempt to write
         // to read-only page in read_cache (write protection page-fault). To handle it properly
@@ -377,10 +492,11 @@ void remove_read_mapping(hashkey& key, mmu::hw_ptep<0> ptep)
 
 void remove_arc_read_mapping(hashkey& key, mmu::hw_ptep<0> ptep)
 {
-    SCOPE_LOCK(arc_read_lock);
-    cached_page_arc* cp = find_in_cache(arc_read_cache, key);
+    auto& s = shard_of(key);
+    SCOPE_LOCK(s.arc_read_lock);
+    cached_page_arc* cp = find_in_cache(s.arc_read_cache, key);
     if (cp) {
-        remove_arc_read_mapping(cp, ptep);
+        remove_arc_read_mapping(s, cp, ptep);
     }
 }
 
@@ -399,36 +515,46 @@ static unsigned drop_read_cached_page(std::unordered_map<hashkey, T>& cache, cac
     return flushed;
 }
 
-static unsigned drop_arc_read_cached_page(cached_page_arc* cp, bool flush)
-{
-    return drop_read_cached_page(arc_read_cache, cp, flush);
-}
-
 static void drop_read_cached_page(hashkey& key)
 {
-    SCOPE_LOCK(read_lock);
-    cached_page* cp = find_in_cache(read_cache, key);
+    auto& s = shard_of(key);
+    SCOPE_LOCK(s.read_lock);
+    cached_page* cp = find_in_cache(s.read_cache, key);
     if (cp) {
-        drop_read_cached_page(read_cache, cp, true);
+        drop_read_cached_page(s.read_cache, cp, true);
     }
 }
 
 TRACEPOINT(trace_drop_read_cached_page, "buf=%p, addr=%p", void*, void*);
 static void drop_arc_read_cached_page(hashkey& key)
 {
-    SCOPE_LOCK(arc_read_lock);
-    cached_page_arc* cp = find_in_cache(arc_read_cache, key);
+    auto& s = shard_of(key);
+    SCOPE_LOCK(s.arc_read_lock);
+    cached_page_arc* cp = find_in_cache(s.arc_read_cache, key);
     if (cp) {
         trace_drop_read_cached_page(cp->arcbuf(), cp->addr());
-        drop_read_cached_page(arc_read_cache, cp, true);
+        drop_read_cached_page(s.arc_read_cache, cp, true);
     }
 }
 
+// Drops the page of an ARC buffer being unmapped, unless it went away (or
+// was replaced) while unmap_arc_buf() wasn't holding the shard lock.
+// Leaves the tlb flush to the caller.
+static unsigned drop_arc_read_cached_page(hashkey& key, arc_buf_t* ab)
+{
+    auto& s = shard_of(key);
+    SCOPE_LOCK(s.arc_read_lock);
+    cached_page_arc* cp = find_in_cache(s.arc_read_cache, key);
+    if (cp && cp->arcbuf() == ab) {
+        return drop_read_cached_page(s.arc_read_cache, cp, false);
+    }
+    return 0;
+}
+
 TRACEPOINT(trace_unmap_arc_buf, "buf=%p", void*);
 void unmap_arc_buf(arc_buf_t* ab)
 {
     trace_unmap_arc_buf(ab);
-    SCOPE_LOCK(arc_read_lock);
     cached_page_arc::unmap_arc_buf(ab);
 }
 
@@ -436,17 +562,18 @@ TRACEPOINT(trace_map_arc_buf, "buf=%p page=%p", void*, void*);
 void map_arc_buf(hashkey *key, arc_buf_t* ab, void *page)
 {
     trace_map_arc_buf(ab, page);
-    SCOPE_LOCK(arc_read_lock);
+    auto& s = shard_of(*key);
+    SCOPE_LOCK(s.arc_read_lock);
     cached_page_arc* pc = new cached_page_arc(*key, page, ab);
-    arc_read_cache.emplace(*key, pc);
-    arc_share_buf(ab);
+    s.arc_read_cache.emplace(*key, pc);
 }
 
 void map_read_cached_page(hashkey *key, void *page)
 {
-    SCOPE_LOCK(read_lock);
+    auto& s = shard_of(*key);
+    SCOPE_LOCK(s.read_lock);
     cached_page* pc = new cached_page(*key, page);
-    read_cache.emplace(*key, pc);
+    s.read_cache.emplace(*key, pc);
 }
 
 static int create_read_cached_page(vfs_file* fp, hashkey& key)
@@ -464,26 +591,236 @@ static std::unique_ptr<cached_page_write> create_write_cached_page(vfs_file* fp,
     return std::unique_ptr<cached_page_write>(cp);
 }
 
+// Background write-back of dirty pages of shared mappings, by one flusher
+// thread per filesystem. Every flush_interval it collects the pte dirty
+// bits, and writes back the pages that have been dirty for longer than
+// dirty_expire, or all of them once more than dirty_ratio percent of the
+// write cache is dirty (or when eviction ran into dirty pages). Contiguous
+// dirty pages of a file are copied out and written back in one go, without
+// holding the shard's write_lock, so faults are not held up by the I/O.
+TRACEPOINT(trace_pagecache_flush, "dev=%x ino=%d offset=%d pages=%u", dev_t, ino_t, off_t, unsigned);
+class flusher {
+    static constexpr unsigned _dirty_ratio = 10;
+    static constexpr unsigned _max_pages = 8 * flush_batch_pages;
+    static constexpr std::chrono::seconds _flush_interval {1};
+    static constexpr std::chrono::seconds _dirty_expire {5};
+    const dev_t _dev;
+    std::atomic<bool> _wakeup {false};
+    std::unique_ptr<char[]> _buf;
+    std::unique_ptr<sched::thread> _thread;
+
+    struct flush_run {
+        hashkey key;
+        struct vnode* vp;
+        unsigned pages;
+    };
+public:
+    explicit flusher(dev_t dev) : _dev(dev), _buf(new char[_max_pages * mmu::page_size]),
+        _thread(sched::thread::make([this] { run(); }, sched::thread::attr().name("pagecache-flush"))) {
+        _thread->start();
+    }
+    void wake() {
+        _wakeup.store(true);
+        _thread->wake();
+    }
+private:
+    // Moves pte dirty bits into the pages, and counts the dirty ones
+    unsigned collect_dirty()
+    {
+        unsigned ndirty = 0;
+        bool cleared = false;
+
+        for (auto&& s : shards) {
+            WITH_LOCK(s.write_lock) {
+                for (auto&& cp : s.write_clock) {
+                    if (cp.key().dev != _dev) {
+                        continue;
+                    }
+                    if (cp.clear_dirty()) {
+                        cp.mark_dirty();
+                        cleared = true;
+                    }
+                    if (cp.dirty()) {
+                        ndirty++;
+                    }
+                }
+            }
+        }
+        // a write after this lands in a dirty bit again, so the copy we
+        // take below is at least as new as the page was here
+        if (cleared) {
+            mmu::flush_tlb_all();
+        }
+        return ndirty;
+    }
+
+    // Returns true if the shard may have more pages to write back
+    bool flush_shard(cache_shard& s, bool all, osv::clock::uptime::time_point now)
+    {
+        std::vector<cached_page_write*> dirty;
+        std::vector<flush_run> runs;
+
+        s.write_lock.lock();
+        for (auto&& cp : s.write_clock) {
+            if (cp.key().dev == _dev && cp.dirty() && (all || now - cp.dirty_since() >= _dirty_expire)) {
+                dirty.push_back(&cp);
+                if (dirty.size() == _max_pages) {
+                    break;
+                }
+            }
+        }
+        if (dirty.empty()) {
+            s.write_lock.unlock();
+            return false;
+        }
+
+        std::sort(dirty.begin(), dirty.end(), [] (cached_page_write* a, cached_page_write* b) {
+            return a->key().ino < b->key().ino || (a->key().ino == b->key().ino && a->key().offset < b->key().offset);
+        });
+        char* buf = _buf.get();
+        for (auto cp : dirty) {
+            auto& key = cp->key();
+            if (runs.empty() || runs.back().key.ino != key.ino || runs.back().pages == flush_batch_pages ||
+                    runs.back().key.offset + off_t(runs.back().pages * mmu::page_size) != key.offset) {
+                vref(cp->vnode());
+                runs.push_back(flush_run{key, cp->vnode(), 0});
+            }
+            memcpy(buf, cp->addr(), mmu::page_size);
+            buf += mmu::page_size;
+            cp->mark_clean();
+            runs.back().pages++;
+        }
+
+        // An eviction or msync of one of these pages now waits for us, so a
+        // newer copy can't be overwritten by ours.
+        s.flushes_in_flight++;
+        s.writeback_lock.lock();
+        s.write_lock.unlock();
+        buf = _buf.get();
+        std::vector<flush_run> failed;
+        for (auto&& r : runs) {
+            trace_pagecache_flush(r.key.dev, r.key.ino, r.key.offset, r.pages);
+            struct iovec iov {buf, r.pages * mmu::page_size};
+            struct uio uio {&iov, 1, r.key.offset, ssize_t(r.pages * mmu::page_size), UIO_WRITE};
+            vn_lock(r.vp);
+            if (VOP_WRITE(r.vp, &uio, 0)) {
+                failed.push_back(r);
+            }
+            vn_unlock(r.vp);
+            buf += r.pages * mmu::page_size;
+        }
+        s.writeback_lock.unlock();
+        WITH_LOCK(s.write_lock) {
+            s.flushes_in_flight--;
+        }
+
+        // leave the pages of failed writes for the next round, or for their
+        // eviction to report
+        for (auto&& r : failed) {
+            WITH_LOCK(s.write_lock) {
+                auto key = r.key;
+                for (unsigned i = 0; i < r.pages; i++, key.offset += mmu::page_size) {
+                    cached_page_write* cp = find_in_cache(s.write_cache, key);
+                    if (cp) {
+                        cp->mark_dirty();
+                    }
+                }
+            }
+        }
+        for (auto&& r : runs) {
+            vrele(r.vp);
+        }
+
+        return dirty.size() == _max_pages && failed.empty();
+    }
+
+    void run()
+    {
+        while (true) {
+            sched::timer t(*sched::thread::current());
+            t.set(_flush_interval);
+            sched::thread::wait_until([&] { return _wakeup.load() || t.expired(); });
+            bool urgent = _wakeup.exchange(false);
+
+            auto ndirty = collect_dirty();
+            if (!ndirty) {
+                continue;
+            }
+            bool all = urgent || ndirty * 100 > _dirty_ratio * clock_max_length * nr_shards;
+            auto now = osv::clock::uptime::now();
+            for (auto&& s : shards) {
+                while (flush_shard(s, all, now)) {
+                }
+            }
+        }
+    }
+};
+
+constexpr std::chrono::seconds flusher::_flush_interval;
+constexpr std::chrono::seconds flusher::_dirty_expire;
+
+static mutex flushers_lock;
+static std::unordered_map<dev_t, std::unique_ptr<flusher>> flushers;
+
+static void start_flusher(dev_t dev)
+{
+    SCOPE_LOCK(flushers_lock);
+    if (!flushers.count(dev)) {
+        flushers.emplace(dev, std::unique_ptr<flusher>(new flusher(dev)));
+    }
+}
+
+static void wake_flusher(dev_t dev)
+{
+    SCOPE_LOCK(flushers_lock);
+    auto it = flushers.find(dev);
+    if (it != flushers.end()) {
+        it->second->wake();
+    }
+}
+
 TRACEPOINT(trace_drop_write_cached_page, "addr=%p", void*);
-static void insert(cached_page_write* cp) {
-    static cached_page_write* tofree[max_lru_free_count];
-    write_cache.emplace(cp->key(), cp);
-    write_lru.push_front(cp);
-
-    if (write_lru.size() > lru_max_length) {
-        for (unsigned i = 0; i < lru_free_count; i++) {
-            cached_page_write *p = write_lru.back();
-            write_lru.pop_back();
-            trace_drop_write_cached_page(p->addr());
-            write_cache.erase(p->key());
-            if (p->flush_check_dirty()) {
-                p->mark_dirty();
+static void insert(cache_shard& s, cached_page_write* cp) {
+    s.write_cache.emplace(cp->key(), cp);
+    s.write_clock.push_back(*cp);
+
+    if (s.write_clock.size() > clock_max_length) {
+        // Sweep the hand: referenced pages get a second chance at the back
+        // of the list, and so do dirty ones, which are left to the flusher
+        // rather than written back here. After one full turn the hand
+        // evicts whatever it finds.
+        auto chances = s.write_clock.size();
+        unsigned n = 0;
+        bool skipped_dirty = false;
+        dev_t dirty_dev = 0;
+        while (n < clock_free_count) {
+            cached_page_write& p = s.write_clock.front();
+            s.write_clock.pop_front();
+            if (chances) {
+                bool referenced = p.test_and_clear_referenced();
+                if (referenced || p.needs_writeback()) {
+                    if (!referenced) {
+                        skipped_dirty = true;
+                        dirty_dev = p.key().dev;
+                    }
+                    chances--;
+                    s.write_clock.push_back(p);
+                    continue;
+                }
             }
-            tofree[i] = p;
+            trace_drop_write_cached_page(p.addr());
+            s.write_cache.erase(p.key());
+            if (p.flush_check_dirty()) {
+                p.mark_dirty();
+            }
+            s.tofree[n++] = &p;
         }
         mmu::flush_tlb_all();
-        for (auto p: tofree) {
-            delete p;
+        for (unsigned i = 0; i < n; i++) {
+            delete s.tofree[i];
+        }
+        if (skipped_dirty) {
+            wake_flusher(dirty_dev);
         }
     }
 }
@@ -495,16 +832,25 @@ bool get(vfs_file* fp, off_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pt
     struct stat st;
     fp->stat(&st);
     hashkey key {st.st_dev, st.st_ino, offset};
-    SCOPE_LOCK(write_lock);
-    cached_page_write* wcp = find_in_cache(write_cache, key);
+    auto& s = shard_of(key);
+    SCOPE_LOCK(s.write_lock);
+    cached_page_write* wcp = find_in_cache(s.write_cache, key);
+
+    if (!wcp && s.flushes_in_flight) {
+        // The page may have been evicted, clean, while the flusher is still
+        // writing it back: wait for that before reading it from the file.
+        s.writeback_lock.lock();
+        s.writeback_lock.unlock();
+    }
 
     if (write) {
         if (!wcp) {
             auto newcp = create_write_cached_page(fp, key);
             if (shared) {
                 // write fault into shared mapping, there page is not in write cache yet, add it.
+                start_flusher(st.st_dev);
                 wcp = newcp.release();
-                insert(wcp);
+                insert(s, wcp);
                 // page is moved from read cache to write cache
                 // drop read page if exists, removing all mappings
                 if (IS_ZFS(st.st_dev)) {
@@ -526,6 +872,7 @@ bool get(vfs_file* fp, off_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pt
             }
         } else if (!shared) {
             // cow (copy-on-write) of private page from write cache
+            wcp->mark_referenced();
             void* page = memory::alloc_page();
             memcpy(page, wcp->addr(), mmu::page_size);
             return mmu::write_pte(page, ptep, pte);
@@ -535,8 +882,8 @@ bool get(vfs_file* fp, off_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pt
         // read fault and page is not in write cache yet, return one from ARC, mark it cow
         do {
             if (IS_ZFS(st.st_dev)) {
-                WITH_LOCK(arc_read_lock) {
-                    cached_page_arc* cp = find_in_cache(arc_read_cache, key);
+                WITH_LOCK(s.arc_read_lock) {
+                    cached_page_arc* cp = find_in_cache(s.arc_read_cache, key);
                     if (cp) {
                         add_arc_read_mapping(cp, ptep);
                         return mmu::write_pte(cp->addr(), ptep, mmu::pte_mark_cow(pte, true));
@@ -545,8 +892,8 @@ bool get(vfs_file* fp, off_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pt
             }
             else {
                 // ROFS (at least for now)
-                WITH_LOCK(read_lock) {
-                    cached_page* cp = find_in_cache(read_cache, key);
+                WITH_LOCK(s.read_lock) {
+                    cached_page* cp = find_in_cache(s.read_cache, key);
                     if (cp) {
                         add_read_mapping(cp, ptep);
                         return mmu::write_pte(cp->addr(), ptep, mmu::pte_mark_cow(pte, true));
@@ -554,14 +901,14 @@ bool get(vfs_file* fp, off_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pt
                 }
             }
 
-            DROP_LOCK(write_lock) {
+            DROP_LOCK(s.write_lock) {
                 // page is not in cache yet, create and try again
                 // function may sleep so drop write lock while executing it
                 ret = create_read_cached_page(fp, key);
             }
 
             // we dropped write lock, need to re-check write cache again
-            wcp = find_in_cache(write_cache, key);
+            wcp = find_in_cache(s.write_cache, key);
             if (wcp) {
                 // write cache page appeared while we were creating a read cache page from ARC
                 // return will cause faulting thread to re-fault and we will try again
@@ -575,6 +922,7 @@ bool get(vfs_file* fp, off_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pt
     }
 
     wcp->map(ptep);
+    wcp->mark_referenced();
 
     return mmu::write_pte(wcp->addr(), ptep, mmu::pte_mark_cow(pte, !shared));
 }
@@ -584,13 +932,14 @@ bool release(vfs_file* fp, void *addr, off_t offset, mmu::hw_ptep<0> ptep)
     struct stat st;
     fp->stat(&st);
     hashkey key {st.st_dev, st.st_ino, offset};
+    auto& s = shard_of(key);
 
     auto old = clear_pte(ptep);
 
     // page is either in ARC cache or write cache or zero page or private page
 
-    WITH_LOCK(write_lock) {
-        cached_page_write* wcp = find_in_cache(write_cache, key);
+    WITH_LOCK(s.write_lock) {
+        cached_page_write* wcp = find_in_cache(s.write_cache, key);
 
         if (wcp && mmu::virt_to_phys(wcp->addr()) == old.addr()) {
             // page is in write cache
@@ -604,21 +953,21 @@ bool release(vfs_file* fp, void *addr, off_t offset, mmu::hw_ptep<0> ptep)
     }
 
     if (IS_ZFS(st.st_dev)) {
-        WITH_LOCK(arc_read_lock) {
-            cached_page_arc* rcp = find_in_cache(arc_read_cache, key);
+        WITH_LOCK(s.arc_read_lock) {
+            cached_page_arc* rcp = find_in_cache(s.arc_read_cache, key);
             if (rcp && mmu::virt_to_phys(rcp->addr()) == old.addr()) {
                 // page is in ARC read cache
-                remove_arc_read_mapping(rcp, ptep);
+                remove_arc_read_mapping(s, rcp, ptep);
                 return false;
             }
         }
     } else {
         // ROFS (at least for now)
-        WITH_LOCK(read_lock) {
-            cached_page* rcp = find_in_cache(read_cache, key);
+        WITH_LOCK(s.read_lock) {
+            cached_page* rcp = find_in_cache(s.read_cache, key);
             if (rcp && mmu::virt_to_phys(rcp->addr()) == old.addr()) {
                 // page is in regular read cache
-                remove_read_mapping(read_cache, rcp, ptep);
+                remove_read_mapping(s.read_cache, rcp, ptep);
                 return false;
             }
         }
@@ -630,28 +979,57 @@ bool release(vfs_file* fp, void *addr, off_t offset, mmu::hw_ptep<0> ptep)
 
 void sync(vfs_file* fp, off_t start, off_t end)
 {
-    static std::stack<cached_page_write*> dirty; // protected by write_lock
     struct stat st;
     fp->stat(&st);
     hashkey key {st.st_dev, st.st_ino, 0};
-    SCOPE_LOCK(write_lock);
+    bool dirty = false;
+    std::bitset<nr_shards> waited;
 
+    // The range spans many shards, so collect dirty bits one page (and
+    // lock) at a time, then flush the tlb before writing back: anything
+    // dirtied after its bit was cleared will be found by the next sync.
     for (key.offset = start; key.offset < end; key.offset += mmu::page_size) {
-        cached_page_write* cp = find_in_cache(write_cache, key);
-        if (cp && cp->clear_dirty()) {
-            dirty.push(cp);
+        auto& s = shard_of(key);
+        WITH_LOCK(s.write_lock) {
+            cached_page_write* cp = find_in_cache(s.write_cache, key);
+            if (cp && cp->clear_dirty()) {
+                cp->mark_dirty();
+                dirty = true;
+            }
+            // The flusher marks the pages it writes back clean before
+            // writing them, so even with no dirty page left the data may
+            // not have reached the file yet: wait for it, once per shard.
+            if (s.flushes_in_flight && !waited.test(&s - shards)) {
+                waited.set(&s - shards);
+                s.writeback_lock.lock();
+                s.writeback_lock.unlock();
+            }
         }
     }
 
+    if (!dirty) {
+        return;
+    }
+
     mmu::flush_tlb_all();
 
-    while(!dirty.empty()) {
-        auto cp = dirty.top();
-        auto err = cp->writeback();
-        if (err) {
-            throw make_error(err);
+    // a page evicted meanwhile was written back on the way out
+    for (key.offset = start; key.offset < end; key.offset += mmu::page_size) {
+        auto& s = shard_of(key);
+        WITH_LOCK(s.write_lock) {
+            cached_page_write* cp = find_in_cache(s.write_cache, key);
+            if (cp && cp->dirty()) {
+                auto err = cp->writeback();
+                if (err) {
+                    throw make_error(err);
+                }
+            } else if (s.flushes_in_flight) {
+                // the flusher may have the only dirty copy of the page,
+                // even if the page was evicted since
+                s.writeback_lock.lock();
+                s.writeback_lock.unlock();
+            }
         }
-        dirty.pop();
     }
 }
 
@@ -680,14 +1058,17 @@ private:
     }
     void run()
     {
-        cached_page_arc::arc_map::size_type current_bucket = 0;
+        unsigned current_shard = 0;
+        std::unordered_map<hashkey, cached_page_arc*>::size_type current_bucket = 0;
         std::unordered_set<arc_hashkey> accessed;
         unsigned scanned = 0, cleared = 0;
 
         while (true) {
-            unsigned buckets_scanned = 0;
+            size_t buckets_scanned = 0, bucket_count = 0;
             bool flush = false;
-            auto bucket_count = cached_page_arc::arc_cache_map.bucket_count();
+            for (auto&& s : shards) {
+                bucket_count += s.arc_read_cache.bucket_count();
+            }
 
             double work = (1000000000 * _cpu)/100;
             double sleep = 1000000000 - work;
@@ -697,37 +1078,44 @@ private:
             auto start = sched::thread::current()->thread_clock();
             auto deadline = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::nanoseconds(static_cast<unsigned long>(work/_freq))) + start;
 
-            WITH_LOCK(arc_read_lock) {
-                while (sched::thread::current()->thread_clock() < deadline && buckets_scanned < bucket_count) {
-                    if (current_bucket >= cached_page_arc::arc_cache_map.bucket_count()) {
-                        current_bucket = 0;
-                    }
-                    std::for_each(cached_page_arc::arc_cache_map.begin(current_bucket), cached_page_arc::arc_cache_map.end(current_bucket),
-                            [&accessed, &scanned, &cleared](cached_page_arc::arc_map::value_type& p) {
-                        auto arcbuf = p.first;
-                        auto cp = p.second;
-                        if (cp->clear_accessed()) {
-                            arc_hashkey arc_hashkey;
-                            arc_buf_get_hashkey(arcbuf, arc_hashkey.key);
-                            accessed.emplace(arc_hashkey);
-                            cleared++;
+            // A page is in its shard's arc_read_cache until unmap_arc_buf()
+            // drops it under the shard lock, so its ARC buffer is alive while
+            // we hold that lock.
+            while (sched::thread::current()->thread_clock() < deadline && buckets_scanned < bucket_count) {
+                auto& s = shards[current_shard];
+                WITH_LOCK(s.arc_read_lock) {
+                    while (sched::thread::current()->thread_clock() < deadline && buckets_scanned < bucket_count) {
+                        if (current_bucket >= s.arc_read_cache.bucket_count()) {
+                            current_bucket = 0;
+                            current_shard = (current_shard + 1) % nr_shards;
+                            break;
                         }
-                        scanned++;
-                    });
-                    current_bucket++;
-                    buckets_scanned++;
-
-                    // mark ARC buffers as accessed when we have 1024 of them
-                    if (!(cleared % 1024)) {
-                        DROP_LOCK(arc_read_lock) {
-                            flush = mark_accessed(accessed);
+                        std::for_each(s.arc_read_cache.begin(current_bucket), s.arc_read_cache.end(current_bucket),
+                                [&accessed, &scanned, &cleared](std::pair<const hashkey, cached_page_arc*>& p) {
+                            auto cp = p.second;
+                            if (cp->clear_accessed()) {
+                                arc_hashkey arc_hashkey;
+                                arc_buf_get_hashkey(cp->arcbuf(), arc_hashkey.key);
+                                accessed.emplace(arc_hashkey);
+                                cleared++;
+                            }
+                            scanned++;
+                        });
+                        current_bucket++;
+                        buckets_scanned++;
+
+                        // mark ARC buffers as accessed when we have 1024 of them
+                        if (accessed.size() >= 1024) {
+                            DROP_LOCK(s.arc_read_lock) {
+                                flush |= mark_accessed(accessed);
+                            }
                         }
                     }
                 }
             }
 
             // mark leftovers ARC buffers as accessed
-            flush = mark_accessed(accessed);
+            flush |= mark_accessed(accessed);
 
             if (flush) {
                 mmu::flush_tlb_all();
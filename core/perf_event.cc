@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/perf.hh>
+#include <osv/sched.hh>
+#include <osv/percpu.hh>
+#include <osv/preempt-lock.hh>
+#include <osv/clock.hh>
+#include <osv/uio.h>
+#include <fs/fs.hh>
+#include <libc/libc.hh>
+#include <linux/perf_event.h>
+#include <fcntl.h>
+#include <errno.h>
+
+namespace perf {
+
+struct cpu_pmu {
+    // PMU counters reserved by CPU-wide users
+    u64 reserved;
+};
+
+static PERCPU(cpu_pmu, percpu_pmu);
+
+static u64 all_counters()
+{
+    return (u64(1) << pmu::counters()) - 1;
+}
+
+static u64 now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            osv::clock::uptime::now().time_since_epoch()).count();
+}
+
+// Runs f on cpu with preemption disabled
+template <typename Func>
+static void run_on_cpu(sched::cpu* cpu, Func f)
+{
+    sched::with_pinned(cpu, [&] {
+        WITH_LOCK(preempt_lock) {
+            f();
+        }
+    });
+}
+
+// The state of a thread counter is only changed by its thread, and by the
+// scheduler while that thread is switched in or out. The counter object
+// goes away with its file, which may be closed by another thread, so the
+// state is shared with the thread's counters list, and freed with the
+// last of them.
+struct thread_event {
+    pmu::event event;
+    unsigned owner;
+    std::atomic<bool> enabled;
+    std::atomic<bool> closed;
+    u64 count;
+    u64 time_enabled;
+    u64 time_running;
+    // PMU counter, while the thread runs and one was free
+    int hw;
+};
+
+struct thread_counters {
+    std::shared_ptr<thread_event> events[pmu::max_counters];
+    u64 switched_in;
+};
+
+static void switch_out(thread_counters* tc, u64 now)
+{
+    auto delta = now - tc->switched_in;
+    for (auto& ev : tc->events) {
+        if (!ev) {
+            continue;
+        }
+        if (ev->hw >= 0) {
+            ev->count += pmu::read(ev->hw) & pmu::mask();
+            pmu::stop(ev->hw);
+            ev->hw = -1;
+            ev->time_running += delta;
+        }
+        if (ev->enabled.load(std::memory_order_relaxed)) {
+            ev->time_enabled += delta;
+        }
+    }
+}
+
+static void switch_in(thread_counters* tc, u64 now)
+{
+    auto free = all_counters() & ~percpu_pmu->reserved;
+    for (auto& ev : tc->events) {
+        if (!ev || !free ||
+            !ev->enabled.load(std::memory_order_relaxed) ||
+            ev->closed.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        ev->hw = __builtin_ctzll(free);
+        free &= free - 1;
+        pmu::start(ev->hw, ev->event);
+    }
+    tc->switched_in = now;
+}
+
+void switch_counters(thread_counters* prev, thread_counters* next)
+{
+    auto now = now_ns();
+    if (prev) {
+        switch_out(prev, now);
+    }
+    if (next) {
+        switch_in(next, now);
+    }
+}
+
+void free_thread_counters(thread_counters* tc)
+{
+    delete tc;
+}
+
+// Re-applies the current thread's counters after a change to them, or to
+// the counters reserved on its CPU. Called with preemption disabled.
+template <typename Func>
+static void with_own_counters_out(Func f)
+{
+    auto tc = sched::thread::current()->perf_counters();
+    if (tc) {
+        switch_out(tc, now_ns());
+    }
+    f();
+    if (tc) {
+        switch_in(tc, now_ns());
+    }
+}
+
+int reserve_counter()
+{
+    int ret = -1;
+    with_own_counters_out([&] {
+        auto free = all_counters() & ~percpu_pmu->reserved;
+        if (free) {
+            ret = __builtin_ctzll(free);
+            percpu_pmu->reserved |= u64(1) << ret;
+        }
+    });
+    return ret;
+}
+
+void unreserve_counter(unsigned counter)
+{
+    with_own_counters_out([&] {
+        percpu_pmu->reserved &= ~(u64(1) << counter);
+    });
+}
+
+class thread_counter : public counter {
+public:
+    explicit thread_counter(std::shared_ptr<thread_event> ev) : _ev(ev) {}
+
+    virtual ~thread_counter()
+    {
+        _ev->closed = true;
+        if (!is_owner()) {
+            // Freed with the owner's other counters
+            return;
+        }
+        std::shared_ptr<thread_event> mine;
+        WITH_LOCK(preempt_lock) {
+            with_own_counters_out([&] {
+                for (auto& ev : sched::thread::current()->perf_counters()->events) {
+                    if (ev == _ev) {
+                        mine = std::move(ev);
+                    }
+                }
+            });
+        }
+    }
+
+    virtual void enable() override { set_enabled(true); }
+    virtual void disable() override { set_enabled(false); }
+
+    virtual void reset() override
+    {
+        update([this] {
+            _ev->count = 0;
+            _ev->time_enabled = 0;
+            _ev->time_running = 0;
+        });
+    }
+
+    virtual value read() override
+    {
+        value v;
+        update([&] {
+            v = { _ev->count, _ev->time_enabled, _ev->time_running };
+        });
+        return v;
+    }
+
+private:
+    std::shared_ptr<thread_event> _ev;
+
+    bool is_owner()
+    {
+        return sched::thread::current()->id() == _ev->owner;
+    }
+
+    // Another thread sees the counts as of the owner's last switch out
+    template <typename Func>
+    void update(Func f)
+    {
+        if (is_owner()) {
+            WITH_LOCK(preempt_lock) {
+                with_own_counters_out(f);
+            }
+        } else {
+            f();
+        }
+    }
+
+    void set_enabled(bool enabled)
+    {
+        update([&] { _ev->enabled = enabled; });
+    }
+};
+
+std::unique_ptr<counter> open_thread_counter(pmu::event e, bool enabled)
+{
+    if (!pmu::supported(e)) {
+        return nullptr;
+    }
+    auto ev = std::make_shared<thread_event>();
+    ev->event = e;
+    ev->owner = sched::thread::current()->id();
+    ev->enabled = enabled;
+    ev->closed = false;
+    ev->count = ev->time_enabled = ev->time_running = 0;
+    ev->hw = -1;
+
+    auto self = sched::thread::current();
+    if (!self->perf_counters()) {
+        self->set_perf_counters(new thread_counters());
+    }
+    std::shared_ptr<thread_event> closed[pmu::max_counters];
+    bool added = false;
+    WITH_LOCK(preempt_lock) {
+        with_own_counters_out([&] {
+            auto& events = self->perf_counters()->events;
+            for (unsigned i = 0; i < pmu::max_counters; i++) {
+                // counters closed by other threads leave their slot behind
+                if (events[i] && events[i]->closed) {
+                    closed[i] = std::move(events[i]);
+                }
+                if (!events[i] && !added) {
+                    events[i] = ev;
+                    added = true;
+                }
+            }
+        });
+    }
+    if (!added) {
+        return nullptr;
+    }
+    return std::unique_ptr<counter>(new thread_counter(ev));
+}
+
+class cpu_counter : public counter {
+public:
+    cpu_counter(pmu::event e, sched::cpu* cpu, int hw)
+        : _event(e), _cpu(cpu), _hw(hw), _enabled(false)
+        , _count(0), _last(0), _enabled_since(0), _time_enabled(0)
+    {
+    }
+
+    virtual ~cpu_counter()
+    {
+        run_on_cpu(_cpu, [this] {
+            pmu::stop(_hw);
+            unreserve_counter(_hw);
+        });
+    }
+
+    virtual void enable() override
+    {
+        run_on_cpu(_cpu, [this] {
+            if (!_enabled) {
+                pmu::start(_hw, _event);
+                _last = 0;
+                _enabled_since = now_ns();
+                _enabled = true;
+            }
+        });
+    }
+
+    virtual void disable() override
+    {
+        run_on_cpu(_cpu, [this] {
+            if (_enabled) {
+                accumulate();
+                pmu::stop(_hw);
+                _enabled = false;
+            }
+        });
+    }
+
+    virtual void reset() override
+    {
+        run_on_cpu(_cpu, [this] {
+            accumulate();
+            _count = 0;
+            _time_enabled = 0;
+        });
+    }
+
+    virtual value read() override
+    {
+        value v;
+        run_on_cpu(_cpu, [&] {
+            accumulate();
+            v = { _count, _time_enabled, _time_enabled };
+        });
+        return v;
+    }
+
+private:
+    pmu::event _event;
+    sched::cpu* _cpu;
+    int _hw;
+    bool _enabled;
+    u64 _count;
+    u64 _last;
+    u64 _enabled_since;
+    u64 _time_enabled;
+
+    void accumulate()
+    {
+        if (!_enabled) {
+            return;
+        }
+        auto now = now_ns();
+        auto cur = pmu::read(_hw);
+        _count += (cur - _last) & pmu::mask();
+        _last = cur;
+        _time_enabled += now - _enabled_since;
+        _enabled_since = now;
+    }
+};
+
+std::unique_ptr<counter> open_cpu_counter(pmu::event e, unsigned cpu, bool enabled)
+{
+    if (!pmu::supported(e) || cpu >= sched::cpus.size()) {
+        return nullptr;
+    }
+    int hw = -1;
+    run_on_cpu(sched::cpus[cpu], [&] { hw = reserve_counter(); });
+    if (hw < 0) {
+        return nullptr;
+    }
+    std::unique_ptr<counter> c(new cpu_counter(e, sched::cpus[cpu], hw));
+    if (enabled) {
+        c->enable();
+    }
+    return c;
+}
+
+std::vector<std::vector<u64>> measure_cpus(const std::vector<pmu::event>& events,
+                                           std::chrono::nanoseconds duration)
+{
+    std::vector<std::vector<std::unique_ptr<counter>>> counters;
+    for (auto e : events) {
+        std::vector<std::unique_ptr<counter>> cpus;
+        for (unsigned cpu = 0; cpu < sched::cpus.size(); cpu++) {
+            cpus.push_back(open_cpu_counter(e, cpu, false));
+        }
+        counters.push_back(std::move(cpus));
+    }
+
+    for (auto& cpus : counters) {
+        for (auto& c : cpus) {
+            if (c) {
+                c->enable();
+            }
+        }
+    }
+    sched::thread::sleep(duration);
+
+    std::vector<std::vector<u64>> ret;
+    for (auto& cpus : counters) {
+        std::vector<u64> counts;
+        for (auto& c : cpus) {
+            counts.push_back(c ? c->read().count : 0);
+        }
+        ret.push_back(std::move(counts));
+    }
+    return ret;
+}
+
+class perf_event_file final : public special_file {
+public:
+    perf_event_file(std::unique_ptr<counter> c, u64 read_format, u64 id, int flags)
+        : special_file(FREAD | flags, DTYPE_UNSPEC)
+        , _counter(std::move(c))
+        , _read_format(read_format)
+        , _id(id)
+    {
+    }
+
+    virtual int close() override
+    {
+        _counter.reset();
+        return 0;
+    }
+
+    virtual int read(struct uio *uio, int flags) override
+    {
+        auto v = _counter->read();
+        u64 values[4];
+        int n = 0;
+        values[n++] = v.count;
+        if (_read_format & PERF_FORMAT_TOTAL_TIME_ENABLED) {
+            values[n++] = v.time_enabled;
+        }
+        if (_read_format & PERF_FORMAT_TOTAL_TIME_RUNNING) {
+            values[n++] = v.time_running;
+        }
+        if (_read_format & PERF_FORMAT_ID) {
+            values[n++] = _id;
+        }
+        if (uio->uio_resid < ssize_t(n * sizeof(u64))) {
+            return ENOSPC;
+        }
+        return uiomove(values, n * sizeof(u64), uio);
+    }
+
+    virtual int ioctl(u_long com, void *data) override
+    {
+        switch (com) {
+        case PERF_EVENT_IOC_ENABLE:
+            _counter->enable();
+            return 0;
+        case PERF_EVENT_IOC_DISABLE:
+            _counter->disable();
+            return 0;
+        case PERF_EVENT_IOC_RESET:
+            _counter->reset();
+            return 0;
+        default:
+            return ENOTTY;
+        }
+    }
+
+private:
+    std::unique_ptr<counter> _counter;
+    u64 _read_format;
+    u64 _id;
+};
+
+}
+
+int perf_event_open(struct perf_event_attr* attr, pid_t pid, int cpu,
+                    int group_fd, unsigned long flags)
+{
+    static std::atomic<u64> next_id;
+
+    if (!attr || attr->size < PERF_ATTR_SIZE_VER0) {
+        return libc_error(EINVAL);
+    }
+    if (group_fd != -1 || (flags & ~PERF_FLAG_FD_CLOEXEC) ||
+        (attr->read_format & ~u64(PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                  PERF_FORMAT_TOTAL_TIME_RUNNING |
+                                  PERF_FORMAT_ID))) {
+        return libc_error(EINVAL);
+    }
+    // Only counting: there is no ring buffer to mmap() samples from
+    if (attr->sample_period || attr->inherit) {
+        return libc_error(EOPNOTSUPP);
+    }
+    if (attr->type != PERF_TYPE_HARDWARE ||
+        attr->config >= unsigned(pmu::event::count)) {
+        return libc_error(ENOENT);
+    }
+    auto e = pmu::event(attr->config);
+
+    std::unique_ptr<perf::counter> c;
+    if (pid == -1 && cpu >= 0) {
+        if (unsigned(cpu) >= sched::cpus.size()) {
+            return libc_error(EINVAL);
+        }
+        if (!pmu::supported(e)) {
+            return libc_error(ENOENT);
+        }
+        c = perf::open_cpu_counter(e, cpu, !attr->disabled);
+        if (!c) {
+            return libc_error(EBUSY);
+        }
+    } else if ((pid == 0 || unsigned(pid) == sched::thread::current()->id()) && cpu == -1) {
+        if (!pmu::supported(e)) {
+            return libc_error(ENOENT);
+        }
+        c = perf::open_thread_counter(e, !attr->disabled);
+        if (!c) {
+            return libc_error(EBUSY);
+        }
+    } else {
+        // Other threads' counters can't be changed safely while they run
+        return libc_error(pid == -1 ? EINVAL : EOPNOTSUPP);
+    }
+
+    int of = (flags & PERF_FLAG_FD_CLOEXEC) ? O_CLOEXEC : 0;
+    try {
+        fileref f = make_file<perf::perf_event_file>(std::move(c), attr->read_format,
+                                                     ++next_id, of);
+        fdesc fd(f);
+        return fd.release();
+    } catch (int error) {
+        return libc_error(error);
+    }
+}
@@ -6,6 +6,10 @@
  */
 
 #include <chrono>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <mutex>
 
 #include <osv/migration-lock.hh>
 #include <osv/sched.hh>
@@ -15,6 +19,13 @@
 #include <osv/trace.hh>
 #include <osv/percpu.hh>
 #include <osv/sampler.hh>
+#include <osv/execinfo.hh>
+#include <osv/irqlock.hh>
+#include <osv/demangle.hh>
+#include <osv/elf.hh>
+#include <osv/app.hh>
+#include <osv/perf.hh>
+#include <osv/preempt-lock.hh>
 
 namespace prof {
 
@@ -183,4 +194,289 @@ void stop_sampler() throw()
     debug("Sampler stopped.\n");
 }
 
+
+// The profiler's per-CPU tables are only touched by their CPU's timer
+// interrupt, and by the control functions below, which take _profiler_lock
+// and visit each CPU in turn with interrupts disabled, instead of the IPIs
+// the sampler uses to start and stop.
+
+constexpr unsigned profile_depth = 32;
+// Open addressing: a stack which finds no slot in this many is dropped
+constexpr unsigned max_probes = 8;
+constexpr size_t max_stacks = 1 << 16;
+
+struct profile_stack {
+    uint64_t hash; // 0 for a free slot
+    uint64_t count;
+    unsigned depth;
+    void* pc[profile_depth];
+};
+
+static profiler_config _profiler_config;
+static bool _profiler_running;
+static mutex _profiler_lock;
+
+static bool profiled(sched::thread* t)
+{
+    auto& config = _profiler_config;
+    if (t == sched::cpu::current()->idle_thread) {
+        return false;
+    }
+    if (!config.threads.empty() &&
+        !std::binary_search(config.threads.begin(), config.threads.end(), t->id())) {
+        return false;
+    }
+    if (!config.app.empty()) {
+        auto runtime = t->app_runtime();
+        return runtime && runtime->app.get_command() == config.app;
+    }
+    return true;
+}
+
+class cpu_profiler : public sched::timer_base::client {
+private:
+    sched::timer_base _timer;
+    // The PMU counter sampling cycles, or -1 when sampling on the timer
+    int _counter;
+    std::unique_ptr<profile_stack[]> _stacks;
+    size_t _size;
+    uint64_t _dropped;
+
+    void sample()
+    {
+        if (!profiled(sched::thread::current())) {
+            return;
+        }
+        void* pc[profile_depth];
+        unsigned depth = backtrace_safe_interrupted(pc, profile_depth);
+        if (!depth) {
+            return;
+        }
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned i = 0; i < depth; i++) {
+            hash = (hash ^ reinterpret_cast<uintptr_t>(pc[i])) * 1099511628211ull;
+        }
+        hash |= 1;
+        for (unsigned i = 0; i < max_probes; i++) {
+            auto& s = _stacks[(hash + i) & (_size - 1)];
+            if (!s.hash) {
+                s.hash = hash;
+                s.count = 1;
+                s.depth = depth;
+                std::copy(pc, pc + depth, s.pc);
+                return;
+            }
+            if (s.hash == hash && s.depth == depth && std::equal(pc, pc + depth, s.pc)) {
+                s.count++;
+                return;
+            }
+        }
+        _dropped++;
+    }
+
+public:
+    cpu_profiler()
+        : _timer(*this)
+        , _counter(-1)
+        , _size(0)
+        , _dropped(0)
+    {
+    }
+
+    void timer_fired()
+    {
+        sample();
+        _timer.set(_profiler_config.period);
+    }
+
+    void counter_overflow(unsigned counter)
+    {
+        if (int(counter) == _counter) {
+            sample();
+            pmu::write(_counter, -_profiler_config.cycles);
+        }
+    }
+
+    // Called on this CPU
+    void start(std::unique_ptr<profile_stack[]> stacks, size_t size)
+    {
+        _stacks = std::move(stacks);
+        _size = size;
+        _dropped = 0;
+        WITH_LOCK(preempt_lock) {
+            if (_profiler_config.cycles && pmu::overflow_supported() &&
+                pmu::supported(pmu::event::cycles)) {
+                _counter = perf::reserve_counter();
+            }
+            if (_counter >= 0) {
+                pmu::start(_counter, pmu::event::cycles, true);
+                pmu::write(_counter, -_profiler_config.cycles);
+            } else {
+                _timer.set(_profiler_config.period);
+            }
+        }
+    }
+
+    // Called on this CPU
+    void stop()
+    {
+        WITH_LOCK(preempt_lock) {
+            if (_counter >= 0) {
+                pmu::stop(_counter);
+                perf::unreserve_counter(_counter);
+                _counter = -1;
+            } else {
+                _timer.cancel();
+            }
+        }
+    }
+
+    // Called on this CPU. Copies the table to copy, which has room for it,
+    // and adds the samples dropped to dropped.
+    bool collect(profile_stack* copy, uint64_t& dropped, bool reset)
+    {
+        WITH_LOCK(irq_lock) {
+            if (!_stacks) {
+                return false;
+            }
+            std::copy(_stacks.get(), _stacks.get() + _size, copy);
+            dropped += _dropped;
+            if (reset) {
+                for (size_t i = 0; i < _size; i++) {
+                    _stacks[i].hash = 0;
+                }
+                _dropped = 0;
+            }
+        }
+        return true;
+    }
+};
+
+static dynamic_percpu<cpu_profiler> _profiler;
+
+// Runs f on each CPU in turn
+template <typename Func>
+static void on_each_cpu(Func f)
+{
+    for (auto cpu : sched::cpus) {
+        sched::with_pinned(cpu, f);
+    }
+}
+
+static void stop_profiler_locked()
+{
+    if (!_profiler_running) {
+        return;
+    }
+    on_each_cpu([] { _profiler->stop(); });
+    _profiler_running = false;
+}
+
+void start_profiler(profiler_config config) throw()
+{
+    SCOPE_LOCK(_profiler_lock);
+
+    stop_profiler_locked();
+
+    size_t size = 1;
+    while (size < std::min(config.stacks, max_stacks)) {
+        size <<= 1;
+    }
+    config.stacks = size;
+    std::sort(config.threads.begin(), config.threads.end());
+    config.cycles = std::min(config.cycles, u64(0x7fffffff));
+    _profiler_config = config;
+
+    static std::once_flag overflow_handler_set;
+    std::call_once(overflow_handler_set, [] {
+        pmu::set_overflow_handler([] (unsigned counter) {
+            _profiler->counter_overflow(counter);
+        });
+    });
+
+    if (config.cycles) {
+        debug("Starting profiler, period = %d cycles\n", config.cycles);
+    } else {
+        debug("Starting profiler, period = %d ns\n", to_nanoseconds(config.period));
+    }
+
+    on_each_cpu([size] {
+        _profiler->start(std::unique_ptr<profile_stack[]>(new profile_stack[size]()), size);
+    });
+    _profiler_running = true;
+}
+
+void stop_profiler() throw()
+{
+    SCOPE_LOCK(_profiler_lock);
+    stop_profiler_locked();
+}
+
+bool profiler_running()
+{
+    SCOPE_LOCK(_profiler_lock);
+    return _profiler_running;
+}
+
+void write_folded_stacks(std::ostream& out, bool reset)
+{
+    std::map<std::vector<void*>, uint64_t> stacks;
+    uint64_t dropped = 0;
+
+    WITH_LOCK(_profiler_lock) {
+        auto size = _profiler_config.stacks;
+        if (!size) {
+            return;
+        }
+        std::unique_ptr<profile_stack[]> copy(new profile_stack[size]);
+        on_each_cpu([&] {
+            if (!_profiler->collect(copy.get(), dropped, reset)) {
+                return;
+            }
+            for (size_t i = 0; i < size; i++) {
+                auto& s = copy[i];
+                if (s.hash) {
+                    // outermost frame first
+                    stacks[std::vector<void*>(std::reverse_iterator<void**>(s.pc + s.depth),
+                                              std::reverse_iterator<void**>(s.pc))] += s.count;
+                }
+            }
+        });
+    }
+
+    osv::demangler demangle;
+    std::unordered_map<void*, std::string> names;
+    auto name = [&] (void* pc, bool leaf) -> const std::string& {
+        auto i = names.find(pc);
+        if (i != names.end()) {
+            return i->second;
+        }
+        // a return address may be past the end of the calling function
+        auto ei = elf::get_program()->lookup_addr(leaf ? pc : static_cast<char*>(pc) - 1);
+        std::string n;
+        if (!ei.sym) {
+            char buf[20];
+            snprintf(buf, sizeof(buf), "%p", pc);
+            n = buf;
+        } else {
+            auto demangled = demangle(ei.sym);
+            n = demangled ? demangled : ei.sym;
+        }
+        return names.emplace(pc, std::move(n)).first->second;
+    };
+    for (auto& s : stacks) {
+        auto& frames = s.first;
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (i) {
+                out << ';';
+            }
+            out << name(frames[i], i == frames.size() - 1);
+        }
+        out << ' ' << s.second << '\n';
+    }
+    if (dropped) {
+        out << "[dropped] " << dropped << '\n';
+    }
+}
+
 }
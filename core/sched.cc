@@ -26,6 +26,7 @@
 #include <osv/preempt-lock.hh>
 #include <osv/app.hh>
 #include <osv/symbols.hh>
+#include <osv/perf.hh>
 
 MAKE_SYMBOL(sched::thread::current);
 MAKE_SYMBOL(sched::cpu::current);
@@ -336,6 +337,9 @@ void cpu::reschedule_from_interrupt(bool called_from_yield,
     if (lazy_flush_tlb.exchange(false, std::memory_order_seq_cst)) {
         mmu::flush_tlb_local();
     }
+    if (p->_perf_counters || n->_perf_counters) {
+        perf::switch_counters(p->_perf_counters, n->_perf_counters);
+    }
     n->switch_to();
 
     // Note: after the call to n->switch_to(), we should no longer use any of
@@ -1059,6 +1063,9 @@ thread::~thread()
         }
         delete[] _tls[i];
     }
+    if (_perf_counters) {
+        perf::free_thread_counters(_perf_counters);
+    }
     free_tcb();
     rcu_dispose(_detached_state.release());
 }
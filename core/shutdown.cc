@@ -3,6 +3,8 @@
 #include <osv/debug.hh>
 #include <osv/sched.hh>
 #include <osv/dhcp.hh>
+#include <osv/elf.hh>
+#include <osv/tracecontrol.hh>
 
 extern void vfs_exit(void);
 
@@ -11,6 +13,8 @@ namespace osv {
 void shutdown()
 {
     dhcp_release();
+    elf::get_program()->save_plt_profile();
+    trace::flush_stream();
 
     // The vfs_exit() call below will forcibly unmount the filesystem. If any
     // thread is executing code mapped from a file, these threads may crash if
@@ -13,12 +13,15 @@
 #include <atomic>
 #include <regex>
 #include <fstream>
+#include <sstream>
 #include <unordered_map>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/range/algorithm/remove.hpp>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
 #include <osv/debug.hh>
 #include <osv/prio.hh>
 #include <osv/execinfo.hh>
@@ -516,43 +519,30 @@ trace::remove_symbol_callback(generator_id id) {
     }
 }
 
-// Helper type to build trace dump binary files
-class trace_out: public std::ofstream {
+// Helper type to build trace dump binary files, in memory or in a file
+template<typename Stream>
+class trace_writer: public Stream {
 public:
-    std::string path;
+    using typename Stream::char_type;
 
-    trace_out() {
-        for (;;) {
-            std::unique_ptr<char> tmp(::tempnam(nullptr, nullptr));
-            if (tmp) {
-                auto f = ::open(tmp.get(), O_EXCL | O_CREAT);
-                if (f != -1) {
-                    ofstream::open(tmp.get(), ios::out|ios::binary);
-                    path = tmp.get();
-                    ::close(f);
-                    break;
-                }
-            }
-        }
-    }
-    trace_out & align(size_t a) {
-        while (tellp() & (a - 1)) {
-            put(0);
+    trace_writer & align(size_t a) {
+        while (this->tellp() & (a - 1)) {
+            this->put(0);
         }
         return *this;
     }
-    template<typename T> trace_out & align() {
+    template<typename T> trace_writer & align() {
         return align(std::alignment_of<T>::value);
     }
 
-    using std::ofstream::write;
+    using Stream::write;
 
-    template<typename T> trace_out & write(T && t) {
+    template<typename T> trace_writer & write(T && t) {
         align<T>();
         write(reinterpret_cast<const char_type*>(&t), sizeof(t));
         return *this;
     }
-    template<typename T> trace_out & twrite(const char *& s) {
+    template<typename T> trace_writer & twrite(const char *& s) {
         const auto a = object_serializer<T>().alignment();
         s = align_up(s, a);
         align(a);
@@ -560,29 +550,52 @@ public:
         s += sizeof(T);
         return *this;
     }
-    template<typename T> trace_out & twrite(const char *& s, size_t n) {
+    template<typename T> trace_writer & twrite(const char *& s, size_t n) {
         while (n-- > 0) {
             twrite<T>(s);
         }
         return *this;
     }
-    trace_out & swrite(const char * s) {
+    trace_writer & swrite(const char * s) {
         size_t len = s != nullptr ? strlen(s) : 0;
         write(u16(len));
         write(s, len);
         return *this;
     }
-    trace_out & swrite(const std::string & s) {
+    trace_writer & swrite(const std::string & s) {
         write(u16(s.size()));
         write(s.c_str(), s.size());
         return *this;
     }
 };
 
-template<typename T = uint32_t>
+// Trace dump in a temporary file
+class trace_out: public trace_writer<std::ofstream> {
+public:
+    std::string path;
+
+    trace_out() {
+        for (;;) {
+            std::unique_ptr<char> tmp(::tempnam(nullptr, nullptr));
+            if (tmp) {
+                auto f = ::open(tmp.get(), O_EXCL | O_CREAT);
+                if (f != -1) {
+                    ofstream::open(tmp.get(), ios::out|ios::binary);
+                    path = tmp.get();
+                    ::close(f);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+typedef trace_writer<std::ostringstream> trace_mem_out;
+
+template<typename Out, typename T = uint32_t>
 struct length {
 public:
-    length(trace_out & out, T v = T()) :
+    length(Out & out, T v = T()) :
             value(v), _out(out), _pos(out.tellp()) {
         out.write(T());
     }
@@ -594,8 +607,8 @@ public:
     }
     T value;
 private:
-    trace_out & _out;
-    trace_out::pos_type _pos;
+    Out & _out;
+    typename Out::pos_type _pos;
 };
 
 /*
@@ -690,24 +703,301 @@ dump = <chunk> {
     <align 8>
     //<raw traces, but with gaps removed>
   } +; // 1 or more
+
+  trace_lost = <chunk, align 8> {
+    uint32_t tag = 'TRCL';
+    uint64_t size = <chunk size>;
+    uint32_t cpu;
+    uint64_t bytes; // of trace data overwritten before it was streamed
+  } *; // streams only
+
+  padding = <chunk, align 8> {
+    uint32_t tag = 'PADD';
+    uint64_t size = <chunk size>;
+  } *; // streams only, to keep writes to devices whole blocks
 };
 
+A stream (see trace::start_stream()) is a dump whose size is 0, and
+which keeps growing: the dictionary and module chunks are repeated
+whenever they change, and each round of draining the cpu buffers
+appends one trace data chunk per cpu.
+
  */
-std::string
-trace::create_trace_dump()
+
+namespace {
+
+// Dealing with 'FOUR' fourcc tags
+struct tag {
+    tag(const char (&s)[5]) :
+        _val((s[0] << 24) | (s[1] << 16) | (s[2] << 8) | s[3])
+    {}
+    operator uint32_t() const {
+        return _val;
+    }
+    const uint32_t _val;
+};
+
+// RIFF-like chunk (see file format description).
+// Always aligned on 8
+template<typename Out>
+class chunk {
+public:
+    chunk(Out & out, const tag & tt) :
+            _out(out) {
+        out.align(8);
+        out.write(uint32_t(tt));
+        out.align(8);
+        _pos = out.tellp();
+        out.write(uint64_t(0));
+    }
+    ~chunk() {
+        auto p = _out.tellp();
+        _out.seekp(_pos);
+        _out.write(uint64_t(p - _pos - sizeof(uint64_t)));
+        _out.seekp(p);
+    }
+private:
+    Out & _out;
+    typename Out::pos_type _pos;
+};
+
+}
+
+static const int tf_version_major = 0;
+static const int tf_version_minor = 1;
+
+// The "OSVT" chunk header, without the chunk size
+template<typename Out>
+static void write_trace_header(Out & out)
 {
-    semaphore signal(0);
-    std::vector<trace_buf> copies;
+    out.write(uint32_t(1)); // endian (verify)
+    out.write(uint32_t((tf_version_major << 16) | tf_version_minor)); // version
+}
 
-    auto is_valid_tracepoint = [](const tracepoint_base * tp_test) {
-        for (auto & tp : tracepoint_base::tp_list) {
-            if (&tp == tp_test) {
-                return true;
+template<typename Out>
+static void write_trace_dictionary(Out & out)
+{
+    chunk<Out> dict(out, "TRCD");
+
+    out.write(uint32_t(tracepoint_base::backtrace_len));
+    out.write(uint32_t(tracepoint_base::tp_list.size()));
+
+    for (auto & tp : tracepoint_base::tp_list) {
+        out.write(reinterpret_cast<uint64_t>(&tp)); // tag/ptr
+        out.swrite(tp.name); // id
+        out.swrite(tp.name); // name (TODO: useful names)
+        out.swrite("OSv"); // provider
+        out.swrite(tp.format); // print format (?)
+        out.template write<uint32_t>(strlen(tp.sig));
+        int n = 0;
+        auto s = tp.sig;
+        while (*s) {
+            out.swrite(std::to_string(n++)); // no arg names
+            out.write(*s);
+            ++s;
+        }
+    }
+}
+
+// Module list, and the symbols of each module
+template<typename Out>
+static void write_trace_modules(Out & out, const elf::program::modules_list &ml)
+{
+    {
+        chunk<Out> mods(out, "MODS");
+        out.write(uint32_t(ml.objects.size()));
+        for (auto module : ml.objects) {
+            out.swrite(module->pathname());
+            out.write(uint64_t(module->base()));
+            out.write(uint64_t(module->end()) - uint64_t(module->base()));
+
+            if (module->module_index() == elf::program::core_module_index) {
+                out.write(uint32_t(0));
+                continue;
+            }
+            // Sections
+            auto sections = module->sections();
+            out.write(uint32_t(sections.size()));
+            for (auto & section : sections) {
+                out.swrite(module->section_name(section));
+                out.write(uint32_t(section.sh_type));
+                out.write(uint32_t(section.sh_info));
+                out.write(uint64_t(section.sh_flags));
+                out.write(uint64_t(section.sh_addr));
+                out.write(uint64_t(section.sh_offset));
+                out.write(uint64_t(section.sh_size));
+            }
+        }
+    }
+
+    struct demangler {
+        demangler()
+        {}
+        ~demangler()
+        {
+            if (buf) {
+                free(buf);
             }
         }
-        return false;
+        const char * operator()(const char * name) {
+            int status;
+            auto * demangled = abi::__cxa_demangle(name, buf, &len, &status);
+            if (demangled) {
+                buf = demangled;
+                return buf;
+            }
+            return name;
+        }
+    private:
+        char * buf = nullptr;
+        size_t len = 0;
     };
 
+    demangler demangle;
+
+    for (auto module : ml.objects) {
+        auto syms = module->symbols();
+        if (syms.empty()) {
+            continue;
+        }
+        chunk<Out> mods(out, "SYMB");
+        length<Out> len(out);
+        for (auto & es : syms) {
+            auto t = es.st_info & elf::STT_HIPROC;
+            if (t != elf::STT_FUNC && t != elf::STT_OBJECT) {
+                continue;
+            }
+            auto * n = module->symbol_name(&es);
+            if (n && *n) {
+                elf::symbol_module m(&es, module);
+                ++len.value;
+                out.swrite(demangle(n));
+                out.write(uint64_t(m.relocated_addr()));
+                out.write(uint64_t(m.size()));
+                out.swrite(nullptr);
+                out.write(uint32_t(0));
+            }
+        }
+
+    }
+}
+
+// Symbol tables
+template<typename Out>
+static void write_trace_symbols(Out & out)
+{
+    WITH_LOCK(symbol_func_mutex) {
+        for (auto & p : symbol_functions) {
+            chunk<Out> symb(out, "SYMB");
+            length<Out> len(out);
+            p.second([&](const trace::symbol & s) {
+                ++len.value;
+                out.swrite(s.name);
+                out.write(uint64_t(s.addr));
+                out.write(uint64_t(s.size));
+                out.swrite(s.filename);
+                out.write(s.n_locations);
+                for (uint32_t i = 0; i < s.n_locations; ++i) {
+                    auto loc = s.location(i);
+                    out.write(loc.first);
+                    out.write(loc.second);
+                }
+            });
+        }
+    }
+}
+
+static bool is_valid_tracepoint(const tracepoint_base * tp_test)
+{
+    for (auto & tp : tracepoint_base::tp_list) {
+        if (&tp == tp_test) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Copies the trace records between s and e, which are in a copy of a
+// trace buffer starting at base, leaving out the padding at page ends.
+template<typename Out>
+static void write_trace_records(Out & out, const char * base,
+                                const char * s, const char * e)
+{
+    while (s < e) {
+        auto * tr = reinterpret_cast<const trace_record*>(s);
+        if (tr->tp == nullptr) {
+            // alignment up to 8 is fine on the pointer itself.
+            // page alignment we must do per offset.
+            size_t off = s - base;
+            s = base + align_up(off + 1, trace_page_size);
+            continue;
+        }
+        if (tr->tp == trace_buf::invalid_trace_point) {
+            break;
+        }
+
+        assert(is_valid_tracepoint(tr->tp));
+
+        out.template twrite<trace_record>(s);
+
+        if (tr->backtrace) {
+            out.template twrite<void *>(s, tracepoint_base::backtrace_len);
+        }
+        auto sig = tr->tp->sig;
+        while (*sig != 0) {
+            switch (*sig++) {
+            case 'c':
+                out.template twrite<char>(s);
+                break;
+            case 'b':
+            case 'B':
+                out.template twrite<u8>(s);
+                break;
+            case 'h':
+            case 'H':
+                out.template twrite<u16>(s);
+                break;
+            case 'i':
+            case 'I':
+            case 'f':
+                out.template twrite<u32>(s);
+                break;
+            case 'q':
+            case 'Q':
+            case 'd':
+            case 'P':
+                out.template twrite<u64>(s);
+                break;
+            case '?':
+                out.template twrite<bool>(s);
+                break;
+            case 'p': {
+                out.template twrite<char>(s,
+                        object_serializer<const char*>::max_len);
+                break;
+            }
+            case '*': {
+                s = align_up(s, sizeof(u16));
+                auto len = *reinterpret_cast<const u16*>(s);
+                s += 2;
+                out.write(len);
+                out.template twrite<char>(s, len);
+                break;
+            }
+            default:
+                assert(0 && "should not reach");
+            }
+        }
+        s = align_up(s, sizeof(long));
+    }
+}
+
+std::string
+trace::create_trace_dump()
+{
+    semaphore signal(0);
+    std::vector<trace_buf> copies;
+
     // Copy the trace buffers from each cpu, locking out trace generation
     // during the extraction (disable preemption, just like trace write)
     unsigned i = 0;
@@ -728,184 +1018,26 @@ trace::create_trace_dump()
     // Redundant. But just to verify.
     signal.wait(sched::cpus.size());
 
-    // Dealing with 'FOUR' fourcc tags
-    struct tag {
-        tag(const char (&s)[5]) :
-            _val((s[0] << 24) | (s[1] << 16) | (s[2] << 8) | s[3])
-        {}
-        operator uint32_t() const {
-            return _val;
-        }
-        const uint32_t _val;
-    };
-
-    // RIFF-like chunk (see file format description).
-    // Always aligned on 8
-    class chunk {
-    public:
-        chunk(trace_out & out, const tag & tt) :
-                _out(out) {
-            out.align(8);
-            out.write(uint32_t(tt));
-            out.align(8);
-            _pos = out.tellp();
-            out.write(uint64_t(0));
-        }
-        ~chunk() {
-            auto p = _out.tellp();
-            _out.seekp(_pos);
-            _out.write(uint64_t(p - _pos - sizeof(uint64_t)));
-            _out.seekp(p);
-        }
-    private:
-        trace_out & _out;
-        trace_out::pos_type _pos;
-    };
-
-    static const int tf_version_major = 0;
-    static const int tf_version_minor = 1;
-
     trace_out out;
 
     // Want early fail
     out.exceptions(trace_out::failbit);
 
     {
-        chunk osvt(out, "OSVT"); // magic
-        out.write(uint32_t(1)); // endian (verify)
-        out.write(uint32_t((tf_version_major << 16) | tf_version_minor)); // version
+        chunk<trace_out> osvt(out, "OSVT"); // magic
+        write_trace_header(out);
 
         // Trace dictionary
-        {
-            chunk dict(out, "TRCD");
-
-            out.write(uint32_t(tracepoint_base::backtrace_len));
-            out.write(uint32_t(tracepoint_base::tp_list.size()));
-
-            for (auto & tp : tracepoint_base::tp_list) {
-                out.write(reinterpret_cast<uint64_t>(&tp)); // tag/ptr
-                out.swrite(tp.name); // id
-                out.swrite(tp.name); // name (TODO: useful names)
-                out.swrite("OSv"); // provider
-                out.swrite(tp.format); // print format (?)
-                out.write<uint32_t>(strlen(tp.sig));
-                int n = 0;
-                auto s = tp.sig;
-                while (*s) {
-                    out.swrite(std::to_string(n++)); // no arg names
-                    out.write(*s);
-                    ++s;
-                }
-            }
-        }
-
-        { // Module list
-            elf::get_program()->with_modules(
-                    [&](const elf::program::modules_list &ml)
-                    {
-                        {
-                            chunk mods(out, "MODS");
-                            out.write(uint32_t(ml.objects.size()));
-                            for (auto module : ml.objects) {
-                                out.swrite(module->pathname());
-                                out.write(uint64_t(module->base()));
-                                out.write(uint64_t(module->end()) - uint64_t(module->base()));
-
-                                if (module->module_index() == elf::program::core_module_index) {
-                                    out.write(uint32_t(0));
-                                    continue;
-                                }
-                                // Sections
-                                auto sections = module->sections();
-                                out.write(uint32_t(sections.size()));
-                                for (auto & section : sections) {
-                                    out.swrite(module->section_name(section));
-                                    out.write(uint32_t(section.sh_type));
-                                    out.write(uint32_t(section.sh_info));
-                                    out.write(uint64_t(section.sh_flags));
-                                    out.write(uint64_t(section.sh_addr));
-                                    out.write(uint64_t(section.sh_offset));
-                                    out.write(uint64_t(section.sh_size));
-                                }
-                            }
-                        }
-
-                        struct demangler {
-                            demangler()
-                            {}
-                            ~demangler()
-                            {
-                                if (buf) {
-                                    free(buf);
-                                }
-                            }
-                            const char * operator()(const char * name) {
-                                int status;
-                                auto * demangled = abi::__cxa_demangle(name, buf, &len, &status);
-                                if (demangled) {
-                                    buf = demangled;
-                                    return buf;
-                                }
-                                return name;
-                            }
-                        private:
-                            char * buf = nullptr;
-                            size_t len = 0;
-                        };
-
-                        demangler demangle;
-
-                        for (auto module : ml.objects) {
-                            auto syms = module->symbols();
-                            if (syms.empty()) {
-                                continue;
-                            }
-                            chunk mods(out, "SYMB");
-                            length<> len(out);
-                            for (auto & es : syms) {
-                                auto t = es.st_info & elf::STT_HIPROC;
-                                if (t != elf::STT_FUNC && t != elf::STT_OBJECT) {
-                                    continue;
-                                }
-                                auto * n = module->symbol_name(&es);
-                                if (n && *n) {
-                                    elf::symbol_module m(&es, module);
-                                    ++len.value;
-                                    out.swrite(demangle(n));
-                                    out.write(uint64_t(m.relocated_addr()));
-                                    out.write(uint64_t(m.size()));
-                                    out.swrite(nullptr);
-                                    out.write(uint32_t(0));
-                                }
-                            }
-
-                        }
-                    });
-        }
+        write_trace_dictionary(out);
 
+        // Module list
+        elf::get_program()->with_modules(
+                [&](const elf::program::modules_list &ml)
+                {
+                    write_trace_modules(out, ml);
+                });
 
-        {
-            // Symbol tables
-            WITH_LOCK(symbol_func_mutex) {
-                for (auto & p : symbol_functions) {
-                    chunk symb(out, "SYMB");
-                    length<> len(out);
-                    p.second([&](const symbol & s) {
-                        ++len.value;
-                        out.swrite(s.name);
-                        out.write(uint64_t(s.addr));
-                        out.write(uint64_t(s.size));
-                        out.swrite(s.filename);
-                        out.write(s.n_locations);
-                        for (uint32_t i = 0; i < s.n_locations; ++i) {
-                            auto loc = s.location(i);
-                            out.write(loc.first);
-                            out.write(loc.second);
-                        }
-                    });
-                }
-            }
-        }
+        write_trace_symbols(out);
 
         // Trace data, one chunk for each cpu buffer
         for (auto & buf : copies) {
@@ -915,81 +1047,12 @@ trace::create_trace_dump()
                     buf._base.get() + buf._size), std::make_pair(
                     buf._base.get(), buf._base.get() + last) };
 
-            chunk trcs(out, "TRCS");
+            chunk<trace_out> trcs(out, "TRCS");
 
             out.align(8);
 
             for (auto & r : regs) {
-                const char * s = r.first;
-                const char * e = r.second;
-
-                while (s < e) {
-                    auto * tr = reinterpret_cast<const trace_record*>(s);
-                    if (tr->tp == nullptr) {
-                        // alignment up to 8 is fine on the pointer itself.
-                        // page alignment we must do per offset.
-                        size_t off = s - r.first;
-                        s = r.first + align_up(off + 1, trace_page_size);
-                        continue;
-                    }
-                    if (tr->tp == trace_buf::invalid_trace_point) {
-                        break;
-                    }
-
-                    assert(is_valid_tracepoint(tr->tp));
-
-                    out.twrite<trace_record>(s);
-
-                    if (tr->backtrace) {
-                        out.twrite<void *>(s, tracepoint_base::backtrace_len);
-                    }
-                    auto sig = tr->tp->sig;
-                    while (*sig != 0) {
-                        switch (*sig++) {
-                        case 'c':
-                            out.twrite<char>(s);
-                            break;
-                        case 'b':
-                        case 'B':
-                            out.twrite<u8>(s);
-                            break;
-                        case 'h':
-                        case 'H':
-                            out.twrite<u16>(s);
-                            break;
-                        case 'i':
-                        case 'I':
-                        case 'f':
-                            out.twrite<u32>(s);
-                            break;
-                        case 'q':
-                        case 'Q':
-                        case 'd':
-                        case 'P':
-                            out.twrite<u64>(s);
-                            break;
-                        case '?':
-                            out.twrite<bool>(s);
-                            break;
-                        case 'p': {
-                            out.twrite<char>(s,
-                                    object_serializer<const char*>::max_len);
-                            break;
-                        }
-                        case '*': {
-                            s = align_up(s, sizeof(u16));
-                            auto len = *reinterpret_cast<const u16*>(s);
-                            s += 2;
-                            out.write(len);
-                            out.twrite<char>(s, len);
-                            break;
-                        }
-                        default:
-                            assert(0 && "should not reach");
-                        }
-                    }
-                    s = align_up(s, sizeof(long));
-                }
+                write_trace_records(out, buf._base.get(), r.first, r.second);
             }
         }
 
@@ -999,3 +1062,204 @@ trace::create_trace_dump()
 
     return std::move(out.path);
 }
+
+// Drains the trace buffers of all cpus into a file or a device, in the
+// trace dump format, every stream_interval. The buffers are copied the way
+// create_trace_dump() does, running on their cpu with interrupts disabled,
+// but only the part written since the last round.
+class trace_streamer {
+public:
+    explicit trace_streamer(int fd, bool whole_blocks);
+    void flush();
+private:
+    void run();
+    void drain(sched::cpu * cpu, trace_mem_out & out);
+    void write(trace_mem_out & out);
+private:
+    static constexpr std::chrono::milliseconds stream_interval{100};
+    // Low, so that streaming stays out of the workload's way, but not
+    // idle, or a busy system would never drain and lose every event.
+    static constexpr float stream_priority = 8.0;
+    static constexpr size_t block_size = 4096;
+
+    struct cpu_state {
+        size_t read = 0; // position in trace_buf::_last terms
+        std::unique_ptr<char[]> copy; // of the trace_buf, _size bytes
+        size_t size = 0;
+    };
+
+    mutex _mutex;
+    int _fd;
+    bool _whole_blocks;
+    bool _failed = false;
+    std::vector<cpu_state> _cpus;
+    size_t _tracepoints = 0;
+    int _modules_gen = -1;
+    std::unique_ptr<sched::thread> _thread;
+};
+
+constexpr std::chrono::milliseconds trace_streamer::stream_interval;
+
+trace_streamer::trace_streamer(int fd, bool whole_blocks)
+    : _fd(fd)
+    , _whole_blocks(whole_blocks)
+    , _cpus(sched::cpus.size())
+{
+    trace_mem_out out;
+    out.write(uint32_t(tag("OSVT")));
+    out.align(8);
+    out.write(uint64_t(0)); // size: open ended
+    write_trace_header(out);
+    write_trace_symbols(out);
+    write(out);
+
+    _thread.reset(sched::thread::make([this] { run(); },
+            sched::thread::attr().name("trace-stream")));
+    _thread->set_priority(stream_priority);
+    _thread->start();
+}
+
+void trace_streamer::run()
+{
+    for (;;) {
+        sched::thread::sleep(stream_interval);
+        flush();
+    }
+}
+
+void trace_streamer::flush()
+{
+    SCOPE_LOCK(_mutex);
+    if (_failed) {
+        return;
+    }
+    trace_mem_out out;
+
+    if (tracepoint_base::tp_list.size() != _tracepoints) {
+        _tracepoints = tracepoint_base::tp_list.size();
+        write_trace_dictionary(out);
+    }
+    elf::get_program()->with_modules(
+            [&](const elf::program::modules_list &ml)
+            {
+                if (ml.adds + ml.subs != _modules_gen) {
+                    _modules_gen = ml.adds + ml.subs;
+                    write_trace_modules(out, ml);
+                }
+            });
+    // each cpu's buffer is drained on that cpu
+    for (auto cpu : sched::cpus) {
+        sched::with_pinned(cpu, [&] { drain(cpu, out); });
+    }
+
+    write(out);
+}
+
+void trace_streamer::drain(sched::cpu * cpu, trace_mem_out & out)
+{
+    auto & state = _cpus[cpu->id];
+    auto * tbp = percpu_trace_buffer.for_cpu(cpu);
+    size_t size = tbp->_size;
+    if (!size) {
+        return;
+    }
+    if (state.size != size) {
+        state.copy.reset(new char[size]);
+        state.size = size;
+    }
+
+    // Copy, on the buffer's cpu, what was written since the last round.
+    // Writers are on that cpu too, with interrupts disabled, so none is
+    // in the middle of a record.
+    size_t read = state.read, last, lost = 0;
+    arch::irq_flag_notrace irq;
+    irq.save();
+    arch::irq_disable_notrace();
+    last = tbp->_last;
+    if (read + size < align_down(last, trace_page_size) + trace_page_size) {
+        // The buffer wrapped over what we didn't read yet: what is left
+        // starts after the page being written
+        auto oldest = align_down(last, trace_page_size) + trace_page_size - size;
+        lost = oldest - read;
+        read = oldest;
+    }
+    auto base = tbp->_base.get();
+    for (size_t p = read; p < last; ) {
+        auto i = p & (size - 1);
+        auto n = std::min(last - p, size - i);
+        memcpy(state.copy.get() + i, base + i, n);
+        p += n;
+    }
+    irq.restore();
+    state.read = last;
+
+    if (lost) {
+        chunk<trace_mem_out> trcl(out, "TRCL");
+        out.write(uint32_t(cpu->id));
+        out.write(uint64_t(lost));
+    }
+    if (read == last) {
+        return;
+    }
+    chunk<trace_mem_out> trcs(out, "TRCS");
+    out.align(8);
+    auto copy = state.copy.get();
+    auto from = read & (size - 1), to = last & (size - 1);
+    if (from < to) {
+        write_trace_records(out, copy, copy + from, copy + to);
+    } else {
+        write_trace_records(out, copy, copy + from, copy + size);
+        write_trace_records(out, copy, copy, copy + to);
+    }
+}
+
+void trace_streamer::write(trace_mem_out & out)
+{
+    // Chunks are aligned by their offset in out, which must be their
+    // offset in the stream too
+    out.align(8);
+    if (_whole_blocks && size_t(out.tellp()) % block_size) {
+        chunk<trace_mem_out> padd(out, "PADD");
+        out.align(block_size);
+    }
+    auto data = out.str();
+    auto p = data.data();
+    auto left = data.size();
+    while (left) {
+        auto n = ::write(_fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            debug("trace stream: write failed, stopping: %s\n", strerror(errno));
+            _failed = true;
+            return;
+        }
+        p += n;
+        left -= n;
+    }
+}
+
+static trace_streamer * streamer;
+
+void
+trace::start_stream(const std::string & path)
+{
+    ensure_log_initialized();
+    auto fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        debug("trace stream: can't open %s: %s\n", path.c_str(), strerror(errno));
+        return;
+    }
+    struct stat st;
+    bool whole_blocks = fstat(fd, &st) == 0 && !S_ISREG(st.st_mode);
+    streamer = new trace_streamer(fd, whole_blocks);
+}
+
+void
+trace::flush_stream()
+{
+    if (streamer) {
+        streamer->flush();
+    }
+}
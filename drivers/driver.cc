@@ -8,9 +8,18 @@
 #include "drivers/driver.hh"
 #include <osv/pci.hh>
 #include <osv/debug.hh>
+#include <osv/sched.hh>
+#include <osv/clock.hh>
+#include <osv/boot.hh>
+#include <osv/printf.hh>
+#include <algorithm>
+#include <memory>
+#include <string.h>
 
 #include "driver.hh"
 
+extern boot_time_chart boot_time;
+
 using namespace pci;
 
 namespace hw {
@@ -27,23 +36,87 @@ namespace hw {
         unload_all();
     }
 
-    void driver_manager::register_driver(std::function<hw_driver* (hw_device*)> probe)
+    void driver_manager::register_driver(std::function<hw_driver* (hw_device*)> probe,
+                                         std::string group)
     {
-        _probes.push_back(probe);
+        _probes.push_back({probe, group});
     }
 
-    void driver_manager::load_all()
+    // Within a group, the devices are probed in the order they were
+    // enumerated, trying the group's probes in the order they were
+    // registered, so its drivers see the devices (and name them) the same
+    // way they would if all of them were probed on a single thread.
+    void driver_manager::load_group(const std::string& group,
+                                    const std::vector<hw_device*>& devices,
+                                    std::vector<hw_driver*>& drivers)
     {
-        auto dm = device_manager::instance();
-        dm->for_each_device([this] (hw_device* dev) {
-            for (auto probe : _probes) {
-                if (auto drv = probe(dev)) {
-                    dev->set_attached();
-                    _drivers.push_back(drv);
+        for (unsigned i = 0; i < devices.size(); i++) {
+            for (auto& p : _probes) {
+                if (p.group != group) {
+                    continue;
+                }
+                auto start = osv::clock::uptime::now();
+                if (auto drv = p.probe(devices[i])) {
+                    // only our group writes drivers[i], unless two groups
+                    // claim the same device, which is a bug
+                    assert(!drivers[i]);
+                    drivers[i] = drv;
+                    devices[i]->set_attached();
+                    std::chrono::duration<double, std::milli> ms =
+                        osv::clock::uptime::now() - start;
+                    // the chart keeps the string, and outlives us
+                    boot_time.event(strdup(osv::sprintf("%s loaded (%.2fms)",
+                        drv->get_name(), ms.count()).c_str()));
                     break;
                 }
             }
+        }
+    }
+
+    // Each group of probes gets a thread of its own, on a cpu of its own
+    // when there are enough, so that e.g. the network card's feature
+    // negotiation and queue setup doesn't wait for the disk's. Everything
+    // that depends on the devices (mounting the root file system, bringing
+    // up the network) only runs once all groups are done.
+    void driver_manager::load_all()
+    {
+        std::vector<hw_device*> devices;
+        device_manager::instance()->for_each_device([&] (hw_device* dev) {
+            devices.push_back(dev);
         });
+        std::vector<std::string> groups;
+        for (auto& p : _probes) {
+            if (std::find(groups.begin(), groups.end(), p.group) == groups.end()) {
+                groups.push_back(p.group);
+            }
+        }
+
+        std::vector<hw_driver*> drivers(devices.size());
+        if (groups.size() < 2 || sched::cpus.size() < 2) {
+            for (auto& group : groups) {
+                load_group(group, devices, drivers);
+            }
+        } else {
+            std::vector<std::unique_ptr<sched::thread>> threads;
+            for (unsigned i = 0; i < groups.size(); i++) {
+                auto cpu = sched::cpus[i % sched::cpus.size()];
+                auto& group = groups[i];
+                threads.emplace_back(sched::thread::make([&] {
+                    load_group(group, devices, drivers);
+                }, sched::thread::attr().pin(cpu).name(group.empty() ? "probe" : "probe-" + group)));
+                threads.back()->start();
+            }
+            for (auto& t : threads) {
+                t->join();
+            }
+        }
+
+        // keep _drivers in device order, whichever group finished first
+        for (auto drv : drivers) {
+            if (drv) {
+                _drivers.push_back(drv);
+            }
+        }
     }
 
     void driver_manager::unload_all()
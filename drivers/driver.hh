@@ -42,14 +42,27 @@ namespace hw {
             return _instance;
         }
 
-        void register_driver(std::function<hw_driver* (hw_device*)> probe);
+        // Probes in different groups run in parallel (see load_all()), so
+        // they must never claim the same devices. Drivers which share
+        // state, such as a counter their device names come from, belong
+        // in the same group.
+        void register_driver(std::function<hw_driver* (hw_device*)> probe,
+                             std::string group = "");
         void load_all();
         void unload_all();
         void list_drivers();
 
     private:
         static driver_manager* _instance;
-        std::vector<std::function<hw_driver* (hw_device*)>> _probes;
+        struct probe_entry {
+            std::function<hw_driver* (hw_device*)> probe;
+            std::string group;
+        };
+        void load_group(const std::string& group,
+                        const std::vector<hw_device*>& devices,
+                        std::vector<hw_driver*>& drivers);
+
+        std::vector<probe_entry> _probes;
         std::vector<hw_driver*> _drivers;
     };
 }
@@ -26,6 +26,7 @@
 
 #include <osv/device.h>
 #include <osv/bio.h>
+#include <osv/devstat.h>
 
 namespace ide {
 
@@ -39,6 +40,7 @@ ide_strategy(struct bio *bio)
 {
     struct ide_priv *prv = reinterpret_cast<struct ide_priv*>(bio->bio_dev->private_data);
 
+    devstat_start_transaction_bio(bio);
     bio->bio_offset += bio->bio_dev->offset;
     prv->drv->make_request(bio);
 }
@@ -27,6 +27,7 @@
 
 #include <osv/device.h>
 #include <osv/bio.h>
+#include <osv/devstat.h>
 
 TRACEPOINT(trace_virtio_blk_read_config_capacity, "capacity=%lu", u64);
 TRACEPOINT(trace_virtio_blk_read_config_size_max, "size_max=%u", u32);
@@ -62,6 +63,7 @@ blk_strategy(struct bio *bio)
     struct blk_priv *prv = reinterpret_cast<struct blk_priv*>(bio->bio_dev->private_data);
 
     trace_virtio_blk_strategy(bio);
+    devstat_start_transaction_bio(bio);
     bio->bio_offset += bio->bio_dev->offset;
     prv->drv->make_request(bio);
 }
@@ -389,6 +389,14 @@ private:
             kick_pending(_kick_thresh);
         }
 
+        /**
+         * Account a packet posted in-place without kicking the vring: it will
+         * be kicked by the next kick_pending().
+         */
+        void defer_kick() {
+            _pkts_to_kick++;
+        }
+
         /**
          * Kick the underlying vring.
          *
@@ -167,6 +167,7 @@ public:
     int transmit(struct mbuf* m_head);
     void kick_pending();
     void kick_pending_with_thresh();
+    void defer_kick() { ++layout->npending; }
     bool kick_hw();
     int xmit_prep(mbuf* m_head, void*& cooky);
     int try_xmit_one_locked(void* cooky);
@@ -5,6 +5,9 @@
  * BSD license as described in the LICENSE file in the top-level directory.
  */
 #include "fastlz.h"
+#ifdef LZKERNEL_LZ4
+#include <lz4hc.h>
+#endif
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
@@ -12,8 +15,8 @@
 using namespace std;
 
 // Compress the kernel by splitting it into smaller 1MB segments
-// and compressing each one using fastlz algorithm and finally
-// combining into single output file
+// and compressing each one using fastlz algorithm (or lz4, when built with
+// LZKERNEL_LZ4) and finally combining into single output file
 //
 // The resulting output file has following structure:
 // - 4 bytes (int) field - offset where segment info table is stored
@@ -69,11 +72,20 @@ int main(int argc, char* argv[])
         auto bytes_to_compress = (segment < segments_count - 1) ? SEGMENT_SIZE : input_length % SEGMENT_SIZE;
         segment_sizes[segment * 2] = bytes_to_compress;
 
+#ifdef LZKERNEL_LZ4
+        // Compressing harder only costs build time: the decompression
+        // speed is the same, and there is less to read from disk.
+        size_t compressed_segment_length =
+                LZ4_compress_HC(input + segment * SEGMENT_SIZE, compressed_segment,
+                                bytes_to_compress, SEGMENT_SIZE * 2, LZ4HC_CLEVEL_MAX);
+#else
         size_t compressed_segment_length =
                 fastlz_compress(input + segment * SEGMENT_SIZE, bytes_to_compress, compressed_segment);
+#endif
         //
         // Check if we actually compressed anything
-        if (compressed_segment_length < bytes_to_compress && compressed_segment_length <= MAX_COMPRESSED_SEGMENT_SIZE) {
+        if (compressed_segment_length > 0 && compressed_segment_length < bytes_to_compress &&
+            compressed_segment_length <= MAX_COMPRESSED_SEGMENT_SIZE) {
             output_file.write(compressed_segment, compressed_segment_length);
             segment_sizes[segment * 2 + 1] = compressed_segment_length;
         }
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// A minimal LZ4 block decoder for lzloader, which runs in 32-bit mode with
+// no library to call into. Each sequence is a token (literals length in the
+// high nibble, match length - 4 in the low one), the literals, a 16-bit
+// little endian match offset and the match; the last sequence has literals
+// only.
+//
+// Most of the time goes into copying, so literals and non-overlapping
+// matches are copied 8 bytes at a time, possibly writing a few bytes past
+// their end - but never past the end of the output, as the segment after
+// it has already been decompressed.
+
+#include "lz4dec.h"
+#include <stdint.h>
+
+static inline void copy8(uint8_t* dst, const uint8_t* src)
+{
+    __builtin_memcpy(dst, src, 8);
+}
+
+static inline unsigned read_length(const uint8_t*& ip, unsigned len)
+{
+    if (len == 15) {
+        uint8_t b;
+        do {
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+    }
+    return len;
+}
+
+int lz4_decompress(const void* input, int length, void* output, int maxout)
+{
+    auto ip = static_cast<const uint8_t*>(input);
+    auto iend = ip + length;
+    auto op = static_cast<uint8_t*>(output);
+    auto oend = op + maxout;
+
+    while (ip < iend) {
+        unsigned token = *ip++;
+
+        auto lit = read_length(ip, token >> 4);
+        auto lend = op + lit;
+        if (lend + 8 <= oend) {
+            for (; op < lend; op += 8, ip += 8) {
+                copy8(op, ip);
+            }
+            ip -= op - lend;
+        } else {
+            while (op < lend) {
+                *op++ = *ip++;
+            }
+        }
+        op = lend;
+        if (ip >= iend) {
+            break;
+        }
+
+        unsigned offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        auto len = read_length(ip, token & 15) + 4;
+        auto match = op - offset;
+        auto mend = op + len;
+        if (offset >= 8 && mend + 8 <= oend) {
+            for (; op < mend; op += 8, match += 8) {
+                copy8(op, match);
+            }
+        } else {
+            // overlapping (a repeated pattern), or close to the end
+            while (op < mend) {
+                *op++ = *match++;
+            }
+        }
+        op = mend;
+    }
+    return op - static_cast<uint8_t*>(output);
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef LZ4DEC_H
+#define LZ4DEC_H
+
+/**
+  Decompress a block in the LZ4 block format (as produced by
+  LZ4_compress_default() or LZ4_compress_HC()) and return the size of the
+  decompressed data. The output buffer must be exactly as large as the
+  decompressed data, given by maxout: nothing is written past it.
+
+  The input is trusted (it is the kernel we were built with), so unlike
+  fastlz_decompress() this doesn't check for corrupted data.
+ */
+
+int lz4_decompress(const void* input, int length, void* output, int maxout);
+
+#endif
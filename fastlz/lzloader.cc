@@ -6,6 +6,7 @@
  * BSD license as described in the LICENSE file in the top-level directory.
  */
 #include "fastlz.h"
+#include "lz4dec.h"
 #include <string.h>
 #include <cstddef>
 #include <stdint.h>
@@ -21,7 +22,7 @@ extern char _binary_loader_stripped_elf_lz_start;
 extern char _binary_loader_stripped_elf_lz_end;
 extern char _binary_loader_stripped_elf_lz_size;
 
-// std libraries used by fastlz.
+// std libraries used by fastlz (the lz4 decoder doesn't need any).
 extern "C" void *memset(void *s, int c, size_t n)
 {
     return __builtin_memset(s, c, n);
@@ -64,10 +65,17 @@ extern "C" void uncompress_loader()
         src_offset -= *(segment_info + 1);
         dst_offset -= *segment_info;
         if (*(segment_info + 1) < *segment_info) {
+#ifdef LZKERNEL_LZ4
+            lz4_decompress(compressed_input + src_offset,
+                           *(segment_info + 1),
+                           BUFFER_OUT + dst_offset,
+                           *segment_info);
+#else
             fastlz_decompress(compressed_input + src_offset,
                               *(segment_info + 1),
                               BUFFER_OUT + dst_offset,
                               INT_MAX);
+#endif
         }
         else {
             //
@@ -51,6 +51,7 @@
 #include <osv/prex.h>
 #include <osv/mutex.h>
 #include <osv/device.h>
+#include <osv/devstat.h>
 #include <osv/debug.h>
 #include <osv/buf.h>
 
@@ -176,6 +177,9 @@ void device_register(struct device *dev, const char *name, int flags)
 
 	strlcpy(dev->name, name, len + 1);
 	dev->flags = flags;
+	dev->stats = NULL;
+	if (dev->driver->devops && dev->driver->devops->strategy != no_strategy)
+		dev->stats = devstat_alloc();
 	dev->active = 1;
 	dev->refcnt = 1;
 	dev->offset = 0;
@@ -293,6 +297,7 @@ device_release(struct device *dev)
 			break;
 		}
 	}
+	devstat_free(dev->stats);
 	delete dev;
 	sched_unlock();
 }
@@ -524,6 +529,34 @@ device_info(struct devinfo *info)
 	return error;
 }
 
+/*
+ * Return the I/O statistics of the next block device.
+ */
+int
+devstat_info(struct devinfo *info, struct devstat_info *stat)
+{
+	u_long target = info->cookie;
+	u_long i = 0;
+	struct device *dev;
+	int error = ESRCH;
+
+	sched_lock();
+	for (dev = device_list; dev != NULL; dev = dev->next) {
+		if (i++ < target || dev->stats == NULL)
+			continue;
+		info->cookie = i;
+		info->id = dev;
+		info->flags = dev->flags;
+		strlcpy(info->name, dev->name, MAXDEVNAME);
+		strlcpy(stat->name, dev->name, MAXDEVNAME);
+		devstat_read(dev->stats, stat);
+		error = 0;
+		break;
+	}
+	sched_unlock();
+	return error;
+}
+
 int
 enodev(void)
 {
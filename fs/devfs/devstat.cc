@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/devstat.h>
+#include <osv/bio.h>
+#include <osv/clock.hh>
+#include <osv/percpu.hh>
+#include <osv/preempt-lock.hh>
+#include <osv/sched.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+struct devstat_cpu {
+    uint64_t ops[DEVSTAT_NOPS];
+    uint64_t errors[DEVSTAT_NOPS];
+    uint64_t bytes[DEVSTAT_NOPS];
+    uint64_t time_ns[DEVSTAT_NOPS];
+    uint64_t merged[DEVSTAT_NOPS];
+    uint64_t split;
+    // Requests are often completed on another cpu than the one that
+    // issued them, so only the sum over all cpus is meaningful.
+    int64_t inflight;
+    uint64_t latency[DEVSTAT_NOPS][DEVSTAT_LAT_BUCKETS];
+};
+
+struct devstat {
+    dynamic_percpu<devstat_cpu> cpu;
+};
+
+static int devstat_op(int cmd)
+{
+    switch (cmd) {
+    case BIO_READ:
+        return DEVSTAT_READ;
+    case BIO_WRITE:
+        return DEVSTAT_WRITE;
+    case BIO_FLUSH:
+        return DEVSTAT_FLUSH;
+    default:
+        return -1;
+    }
+}
+
+static uint64_t now_ns()
+{
+    return osv::clock::uptime::now().time_since_epoch().count();
+}
+
+static unsigned latency_bucket(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    unsigned b = us ? 64 - __builtin_clzll(us) : 0;
+    return std::min(b, unsigned(DEVSTAT_LAT_BUCKETS - 1));
+}
+
+struct devstat *devstat_alloc(void)
+{
+    return new devstat;
+}
+
+void devstat_free(struct devstat *ds)
+{
+    delete ds;
+}
+
+void devstat_start_transaction_bio(struct bio *bio)
+{
+    auto ds = bio->bio_dev->stats;
+    if (!ds || devstat_op(bio->bio_cmd) < 0) {
+        return;
+    }
+    bio->bio_t0 = now_ns();
+    WITH_LOCK(preempt_lock) {
+        ds->cpu->inflight++;
+    }
+}
+
+void devstat_end_transaction_bio(struct bio *bio, bool ok)
+{
+    auto ds = bio->bio_dev->stats;
+    auto op = devstat_op(bio->bio_cmd);
+    auto ns = now_ns() - bio->bio_t0;
+    bio->bio_t0 = 0;
+    WITH_LOCK(preempt_lock) {
+        auto c = &*ds->cpu;
+        c->inflight--;
+        c->ops[op]++;
+        c->bytes[op] += bio->bio_bcount;
+        c->time_ns[op] += ns;
+        c->latency[op][latency_bucket(ns)]++;
+        if (!ok) {
+            c->errors[op]++;
+        }
+    }
+}
+
+void devstat_merged(struct device *dev, int cmd, unsigned count)
+{
+    auto ds = dev->stats;
+    auto op = devstat_op(cmd);
+    if (!ds || op < 0) {
+        return;
+    }
+    WITH_LOCK(preempt_lock) {
+        ds->cpu->merged[op] += count;
+    }
+}
+
+void devstat_split(struct device *dev)
+{
+    auto ds = dev->stats;
+    if (!ds) {
+        return;
+    }
+    WITH_LOCK(preempt_lock) {
+        ds->cpu->split++;
+    }
+}
+
+void devstat_read(struct devstat *ds, struct devstat_info *stat)
+{
+    int64_t inflight = 0;
+
+    memset(reinterpret_cast<char*>(stat) + sizeof(stat->name), 0,
+           sizeof(*stat) - sizeof(stat->name));
+    for (auto cpu : sched::cpus) {
+        auto c = ds->cpu.for_cpu(cpu);
+        for (int op = 0; op < DEVSTAT_NOPS; op++) {
+            stat->ops[op] += c->ops[op];
+            stat->errors[op] += c->errors[op];
+            stat->bytes[op] += c->bytes[op];
+            stat->time_ns[op] += c->time_ns[op];
+            stat->merged[op] += c->merged[op];
+            for (int b = 0; b < DEVSTAT_LAT_BUCKETS; b++) {
+                stat->latency[op][b] += c->latency[op][b];
+            }
+        }
+        stat->split += c->split;
+        inflight += c->inflight;
+    }
+    // The cpus are read one after the other, so a request may be seen
+    // completed but not issued.
+    stat->inflight = std::max(inflight, int64_t(0));
+}
+
+uint64_t devstat_percentile(const uint64_t *latency, double pct)
+{
+    uint64_t total = 0;
+    for (int b = 0; b < DEVSTAT_LAT_BUCKETS; b++) {
+        total += latency[b];
+    }
+    if (!total) {
+        return 0;
+    }
+    auto rank = std::max(uint64_t(std::ceil(total * pct / 100)), uint64_t(1));
+    uint64_t seen = 0;
+    int b = 0;
+    for (; b < DEVSTAT_LAT_BUCKETS - 1; b++) {
+        seen += latency[b];
+        if (seen >= rank) {
+            break;
+        }
+    }
+    return uint64_t(1) << b;
+}
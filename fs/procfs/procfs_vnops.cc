@@ -12,6 +12,7 @@
 #include <osv/prex.h>
 #include <osv/sched.hh>
 #include <osv/mmu.hh>
+#include <osv/devstat.h>
 
 #include "fs/pseudofs/pseudofs.hh"
 
@@ -134,6 +135,30 @@ static std::string procfs_mounts()
 	return rstr;
 }
 
+// Same layout as Linux's, so that iostat and friends can parse it. There
+// are no device numbers, and no time the device was busy, so those are 0.
+static std::string procfs_diskstats()
+{
+    std::ostringstream os;
+    struct devinfo info = {};
+    struct devstat_info st;
+    auto ms = [&] (int op) { return st.time_ns[op] / 1000000; };
+
+    while (!devstat_info(&info, &st)) {
+        auto weighted = ms(DEVSTAT_READ) + ms(DEVSTAT_WRITE) + ms(DEVSTAT_FLUSH);
+        osv::fprintf(os, "%4d %7lu %s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu 0 0 0 0 %lu %lu\n",
+            0, info.cookie - 1, st.name,
+            st.ops[DEVSTAT_READ], st.merged[DEVSTAT_READ],
+            st.bytes[DEVSTAT_READ] >> 9, ms(DEVSTAT_READ),
+            st.ops[DEVSTAT_WRITE], st.merged[DEVSTAT_WRITE],
+            st.bytes[DEVSTAT_WRITE] >> 9, ms(DEVSTAT_WRITE),
+            st.inflight, 0UL, weighted,
+            st.ops[DEVSTAT_FLUSH], ms(DEVSTAT_FLUSH));
+    }
+
+    return os.str();
+}
+
 static std::string procfs_hostname()
 {
     char hostname[65];
@@ -179,6 +204,7 @@ procfs_mount(mount* mp, const char *dev, int flags, const void* data)
     root->add("self", self);
     root->add("0", self); // our standard pid
     root->add("mounts", inode_count++, procfs_mounts);
+    root->add("diskstats", inode_count++, procfs_diskstats);
     root->add("sys", sys);
 
     root->add("cpuinfo", inode_count++, [] { return processor::features_str(); });
@@ -10,6 +10,7 @@
 #include <mntent.h>
 #include <osv/printf.hh>
 #include <osv/mempool.hh>
+#include <osv/devstat.h>
 
 #include "fs/pseudofs/pseudofs.hh"
 
@@ -73,6 +74,46 @@ static string sysfs_memory_pools()
     return os.str();
 }
 
+static string sysfs_block_latency()
+{
+    static const char* op_names[DEVSTAT_NOPS] = { "read", "write", "flush" };
+
+    std::ostringstream os;
+    struct devinfo info = {};
+    struct devstat_info st;
+    while (!devstat_info(&info, &st)) {
+        for (int op = 0; op < DEVSTAT_NOPS; op++) {
+            auto lat = st.latency[op];
+            osv::fprintf(os, "%s %s p50 %lu p90 %lu p99 %lu p999 %lu us, hist",
+                st.name, op_names[op],
+                devstat_percentile(lat, 50), devstat_percentile(lat, 90),
+                devstat_percentile(lat, 99), devstat_percentile(lat, 99.9));
+            for (int b = 0; b < DEVSTAT_LAT_BUCKETS; b++) {
+                osv::fprintf(os, " %lu", lat[b]);
+            }
+            os << "\n";
+        }
+    }
+
+    return os.str();
+}
+
+static string sysfs_block_stats()
+{
+    std::ostringstream os;
+    struct devinfo info = {};
+    struct devstat_info st;
+    while (!devstat_info(&info, &st)) {
+        osv::fprintf(os, "%s inflight %lu split %lu merged %lu %lu errors %lu %lu %lu\n",
+            st.name, st.inflight, st.split,
+            st.merged[DEVSTAT_READ], st.merged[DEVSTAT_WRITE],
+            st.errors[DEVSTAT_READ], st.errors[DEVSTAT_WRITE],
+            st.errors[DEVSTAT_FLUSH]);
+    }
+
+    return os.str();
+}
+
 static int
 sysfs_mount(mount* mp, const char *dev, int flags, const void* data)
 {
@@ -96,8 +137,13 @@ sysfs_mount(mount* mp, const char *dev, int flags, const void* data)
     memory->add("free_page_ranges", inode_count++, sysfs_free_page_ranges);
     memory->add("pools", inode_count++, sysfs_memory_pools);
 
+    auto block = make_shared<pseudo_dir_node>(inode_count++);
+    block->add("latency", inode_count++, sysfs_block_latency);
+    block->add("stats", inode_count++, sysfs_block_stats);
+
     auto osv_extension = make_shared<pseudo_dir_node>(inode_count++);
     osv_extension->add("memory", memory);
+    osv_extension->add("block", block);
 
     auto* root = new pseudo_dir_node(vp->v_ino);
     root->add("devices", devices);
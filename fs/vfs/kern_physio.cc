@@ -13,6 +13,7 @@
 
 #include <osv/device.h>
 #include <osv/bio.h>
+#include <osv/devstat.h>
 #include <sys/param.h>
 #include <assert.h>
 #include <sys/refcount.h>
@@ -50,6 +51,9 @@ bio_wait(struct bio *bio)
 void
 biodone(struct bio *bio, bool ok)
 {
+	if (bio->bio_t0)
+		devstat_end_transaction_bio(bio, ok);
+
 	WITH_LOCK(bio->bio_mutex) {
 		bio->bio_flags |= BIO_DONE;
 		if (!ok)
@@ -107,10 +111,13 @@ void multiplex_strategy(struct bio *bio)
 	assert(strategy != nullptr);
 
 	if (len <= dev->max_io_size) {
+		devstat_start_transaction_bio(bio);
 		strategy(bio);
 		return;
 	}
 
+	devstat_split(dev);
+
 	// It is better to initialize the refcounter beforehand, specially because we can
 	// trivially determine what is the number going to be. Otherwise, we can have a
 	// situation in which we bump the refcount to 1, get scheduled out, the bio is
@@ -131,6 +138,7 @@ void multiplex_strategy(struct bio *bio)
 		b->bio_private = bio->bio_private;
 		b->bio_done = multiplex_bio_done;
 
+		devstat_start_transaction_bio(b);
 		strategy(b);
 		buf += req_size;
 		offset += req_size;
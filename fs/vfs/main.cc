@@ -2300,6 +2300,39 @@ static void import_extra_zfs_pools(void)
     }
 }
 
+extern "C" int spa_has_log_device(const char *pool, const char *path);
+
+// Add a separate intent log device to the osv pool, so that synchronous
+// writes are committed to it rather than to the main pool. The pool keeps
+// the device from then on, so later boots find it there and skip this.
+extern "C" void add_zfs_log_device(const char *dev)
+{
+    struct stat st;
+    int ret;
+
+    // zpool resolves a bare device name under /dev, and records that path
+    std::string path = dev[0] == '/' ? dev : std::string("/dev/") + dev;
+    if (spa_has_log_device("osv", path.c_str())) {
+        debug("zfs: log device %s is already in the pool.\n", dev);
+        return;
+    }
+
+    // libzfs needs '/etc/mnttab', see import_extra_zfs_pools().
+    if (stat("/etc/mnttab" , &st) != 0 || access("zpool.so", X_OK) != 0) {
+        kprintf("zfs: cannot add log device %s without zpool.so\n", dev);
+        return;
+    }
+    vector<string> zpool_args = {"zpool", "add", "-f", "osv", "log", dev};
+    auto ok = osv::run("zpool.so", zpool_args, &ret);
+    assert(ok);
+
+    if (ret) {
+        kprintf("zfs: failed to add log device %s\n", dev);
+    } else {
+        debug("zfs: added log device %s.\n", dev);
+    }
+}
+
 static void mount_fs(mntent *m)
 {
     if (!strcmp(m->mnt_dir, "/")) {
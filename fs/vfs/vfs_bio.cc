@@ -40,19 +40,36 @@
 #include <osv/buf.h>
 #include <osv/bio.h>
 #include <osv/device.h>
+#include <osv/condvar.h>
+#include <osv/sched.hh>
+#include <osv/mempool.hh>
 
 #include <errno.h>
 #include <limits.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
-#include <semaphore.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
 #include "vfs.h"
 #include <boost/intrusive/list.hpp>
 
-/* number of buffer cache */
-#define NBUFS		256
+/*
+ * The buffer cache grows on demand up to 1/BIO_MEM_FRACTION of the memory
+ * (but to at least NBUFS_MIN buffers), and gives clean buffers back to the
+ * system when the memory shrinker asks for it.
+ */
+#define NBUFS_MIN		256
+#define BIO_MEM_FRACTION	64
+
+/* number of hash buckets, must be a power of two */
+#define BIO_NBUCKETS		1024
+
+/* delayed writes are pushed to disk at least this often */
+#define BIO_FLUSH_INTERVAL	std::chrono::seconds(5)
 
 /* macros to clear/set/test flags. */
 #define	SET(t, f)	(t) |= (f)
@@ -60,59 +77,109 @@
 #define	ISSET(t, f)	((t) & (f))
 
 /*
- * Global lock to access all buffer headers and lists.
+ * Locking:
+ *
+ * Each hash bucket has a lock protecting its chain, and B_BUSY of the
+ * buffers on it.  Threads waiting for a busy buffer sleep on the busy_cv of
+ * its bucket.  A buffer which is not busy is on the LRU list, protected by
+ * bio_lru_lock, which nests inside the bucket locks.  B_INVAL buffers are
+ * not hashed; they are only reachable through the LRU list.
+ *
+ * The other flags are only changed by the owner of a busy buffer.
  */
-static mutex bio_lock;
+typedef boost::intrusive::list<struct buf,
+    boost::intrusive::member_hook<struct buf,
+        boost::intrusive::list_member_hook<>, &buf::b_hash>> buf_hash_list;
 
-/* fixed set of buffers */
-static struct buf buf_table[NBUFS];
-boost::intrusive::list<struct buf, boost::intrusive::base_hook<struct buf>> free_list;
+struct bio_bucket {
+	mutex		lock;
+	condvar		busy_cv;
+	buf_hash_list	bufs;
+};
 
-static sem_t free_sem;
+static bio_bucket bio_buckets[BIO_NBUCKETS];
 
-/*
- * Insert buffer to the head of free list
- */
-static void
-bio_insert_head(struct buf *bp)
+static mutex bio_lru_lock;
+static condvar bio_lru_cv;
+static boost::intrusive::list<struct buf,
+    boost::intrusive::base_hook<struct buf>> bio_lru;
+
+static unsigned int bio_nbufs;		/* buffers allocated */
+static unsigned int bio_max_bufs;	/* cache size limit */
+static std::atomic<unsigned int> bio_ndirty;
+
+static condvar bio_flush_cv;
+static sched::thread *bio_flusher;
+
+static bio_bucket &
+bio_hash(struct device *dev, int blkno)
 {
-	free_list.push_front(*bp);
-	sem_post(&free_sem);
+	uintptr_t h = reinterpret_cast<uintptr_t>(dev) >> 4;
+
+	h ^= static_cast<unsigned int>(blkno) * 0x9e3779b1U;
+	return bio_buckets[(h ^ (h >> 16)) & (BIO_NBUCKETS - 1)];
+}
+
+static struct buf *
+bio_alloc(void)
+{
+	auto *bp = new buf();
+
+	bp->b_flags = B_INVAL;
+	bp->b_data = malloc(BSIZE);
+	return bp;
 }
 
-/*
- * Insert buffer to the tail of free list
- */
 static void
-bio_insert_tail(struct buf *bp)
+bio_free(struct buf *bp)
 {
-	free_list.push_back(*bp);
-	sem_post(&free_sem);
+	free(bp->b_data);
+	delete bp;
 }
 
 /*
- * Remove buffer from free list
+ * Make a buffer found on the LRU list busy.  Must be called with
+ * bio_lru_lock and, if the buffer is hashed, its bucket lock held.
  */
 static void
-bio_remove(struct buf *bp)
+bio_claim(struct buf *bp)
 {
-	sem_wait(&free_sem);
-	free_list.erase(free_list.iterator_to(*bp));
+	bio_lru.erase(bio_lru.iterator_to(*bp));
+	SET(bp->b_flags, B_BUSY);
 }
 
 /*
- * Remove buffer from the head of free list
+ * Claim up to max buffers off the LRU list, oldest first, which pass the
+ * given filter.  Buffers whose bucket is contended are skipped, since the
+ * bucket locks can't be taken while holding bio_lru_lock.  If unhash is
+ * set the claimed buffers are also removed from the hash.
  */
-static struct buf *
-bio_remove_head(void)
+template <typename Filter>
+static void
+bio_claim_lru(std::vector<struct buf *> &claimed, size_t max, bool unhash,
+    Filter filter)
 {
-	sem_wait(&free_sem);
-	auto& bp = free_list.front();
-	free_list.pop_front();
-	return &bp;
+	SCOPE_LOCK(bio_lru_lock);
+	for (auto it = bio_lru.begin();
+	    it != bio_lru.end() && claimed.size() < max; ) {
+		auto *bp = &*it++;
+		if (!filter(bp))
+			continue;
+		if (ISSET(bp->b_flags, B_INVAL)) {
+			bio_claim(bp);
+		} else {
+			auto &b = bio_hash(bp->b_dev, bp->b_blkno);
+			if (!b.lock.try_lock())
+				continue;
+			bio_claim(bp);
+			if (unhash)
+				b.bufs.erase(b.bufs.iterator_to(*bp));
+			b.lock.unlock();
+		}
+		claimed.push_back(bp);
+	}
 }
 
-
 static int
 rw_buf(struct buf *bp, int rw)
 {
@@ -138,60 +205,122 @@ rw_buf(struct buf *bp, int rw)
 
 /*
  * Determine if a block is in the cache.
+ * Must be called with the bucket lock held.
  */
 static struct buf *
-incore(struct device *dev, int blkno)
+incore(bio_bucket &b, struct device *dev, int blkno)
 {
-	for (int i = 0; i < NBUFS; i++) {
-		auto* bp = &buf_table[i];
-		if (bp->b_blkno == blkno && bp->b_dev == dev &&
-		    !ISSET(bp->b_flags, B_INVAL))
-			return bp;
+	for (auto &bp : b.bufs) {
+		if (bp.b_blkno == blkno && bp.b_dev == dev)
+			return &bp;
 	}
 	return nullptr;
 }
 
+/*
+ * Get a buffer to be assigned to a new block: allocate one while under the
+ * cache size limit, otherwise reuse the least recently used one, writing it
+ * out first if it holds a delayed write.  The buffer is returned busy and
+ * unhashed.
+ */
+static struct buf *
+bio_getnew(void)
+{
+	struct buf *bp = nullptr;
+
+	WITH_LOCK(bio_lru_lock) {
+		if (bio_nbufs < bio_max_bufs) {
+			bio_nbufs++;
+			DROP_LOCK(bio_lru_lock) {
+				bp = bio_alloc();
+			}
+			SET(bp->b_flags, B_BUSY);
+			return bp;
+		}
+	}
+
+	for (;;) {
+		std::vector<struct buf *> victim;
+		bio_claim_lru(victim, 1, false, [] (struct buf *) { return true; });
+		if (victim.empty()) {
+			/* All in use, or their buckets are contended. */
+			WITH_LOCK(bio_lru_lock) {
+				while (bio_lru.empty())
+					bio_lru_cv.wait(bio_lru_lock);
+			}
+			sched::thread::yield();
+			continue;
+		}
+		bp = victim.front();
+		if (ISSET(bp->b_flags, B_DELWRI)) {
+			rw_buf(bp, 1);
+			CLR(bp->b_flags, B_DELWRI);
+			bio_ndirty--;
+		}
+		if (!ISSET(bp->b_flags, B_INVAL)) {
+			auto &b = bio_hash(bp->b_dev, bp->b_blkno);
+			WITH_LOCK(b.lock) {
+				b.bufs.erase(b.bufs.iterator_to(*bp));
+				b.busy_cv.wake_all();
+			}
+		}
+		bp->b_flags = B_BUSY | B_INVAL;
+		return bp;
+	}
+}
+
 /*
  * Assign a buffer for the given block.
  *
- * The block is selected from the buffer list with LRU
- * algorithm.  If the appropriate block already exists in the
- * block list, return it.  Otherwise, the least recently used
- * block is used.
+ * If the appropriate block already exists in the cache, return
+ * it.  Otherwise a new or the least recently used buffer is
+ * assigned to the block.
  */
 struct buf *
 getblk(struct device *dev, int blkno)
 {
 	DPRINTF(VFSDB_BIO, ("getblk: dev=%x blkno=%d\n", dev, blkno));
-	SCOPE_LOCK(bio_lock);
-start:
-	auto* bp = incore(dev, blkno);
-	if (bp != nullptr) {
-		/* Block found in cache. */
-		if (ISSET(bp->b_flags, B_BUSY)) {
-			/*
-			 * Wait buffer ready.
-			 */
-			DROP_LOCK(bio_lock) {
-				mutex_lock(&bp->b_lock);
-				mutex_unlock(&bp->b_lock);
+	auto &b = bio_hash(dev, blkno);
+	struct buf *newbp = nullptr;
+	struct buf *bp;
+
+	WITH_LOCK(b.lock) {
+		for (;;) {
+			bp = incore(b, dev, blkno);
+			if (bp == nullptr) {
+				if (newbp == nullptr) {
+					DROP_LOCK(b.lock) {
+						newbp = bio_getnew();
+					}
+					/* Someone may have added the block meanwhile */
+					continue;
+				}
+				bp = newbp;
+				newbp = nullptr;
+				bp->b_flags = B_BUSY;
+				bp->b_dev = dev;
+				bp->b_blkno = blkno;
+				b.bufs.push_front(*bp);
+				break;
 			}
-			/* Scan again if it's busy */
-			goto start;
-		}
-		bio_remove(bp);
-		SET(bp->b_flags, B_BUSY);
-	} else {
-		bp = bio_remove_head();
-		if (ISSET(bp->b_flags, B_DELWRI)) {
-			DROP_LOCK(bio_lock) {
-				bwrite(bp);
+			/* Block found in cache. */
+			if (!ISSET(bp->b_flags, B_BUSY)) {
+				WITH_LOCK(bio_lru_lock) {
+					bio_claim(bp);
+				}
+				break;
 			}
-			goto start;
+			/* Wait buffer ready. */
+			b.busy_cv.wait(b.lock);
+		}
+	}
+	if (newbp != nullptr) {
+		/* Not needed after all, make it the next one to be reused. */
+		WITH_LOCK(bio_lru_lock) {
+			CLR(newbp->b_flags, B_BUSY);
+			bio_lru.push_front(*newbp);
+			bio_lru_cv.wake_one();
 		}
-		bp->b_flags = B_BUSY;
-		bp->b_dev = dev;
-		bp->b_blkno = blkno;
 	}
 	mutex_lock(&bp->b_lock);
 	DPRINTF(VFSDB_BIO, ("getblk: done bp=%x\n", bp));
@@ -205,16 +334,19 @@ void
 brelse(struct buf *bp)
 {
 	ASSERT(ISSET(bp->b_flags, B_BUSY));
+	ASSERT(!ISSET(bp->b_flags, B_INVAL));
 	DPRINTF(VFSDB_BIO, ("brelse: bp=%x dev=%x blkno=%d\n",
 				bp, bp->b_dev, bp->b_blkno));
 
-	SCOPE_LOCK(bio_lock);
-	CLR(bp->b_flags, B_BUSY);
 	mutex_unlock(&bp->b_lock);
-	if (ISSET(bp->b_flags, B_INVAL))
-		bio_insert_head(bp);
-	else
-		bio_insert_tail(bp);
+	auto &b = bio_hash(bp->b_dev, bp->b_blkno);
+	SCOPE_LOCK(b.lock);
+	WITH_LOCK(bio_lru_lock) {
+		CLR(bp->b_flags, B_BUSY);
+		bio_lru.push_back(*bp);
+		bio_lru_cv.wake_one();
+	}
+	b.busy_cv.wake_all();
 }
 
 /*
@@ -240,7 +372,6 @@ bread(struct device *dev, int blkno, struct buf **bpp)
 			return error;
 		}
 	}
-	CLR(bp->b_flags, B_INVAL);
 	SET(bp->b_flags, (B_READ | B_DONE));
 	DPRINTF(VFSDB_BIO, ("bread: done bp=%x\n\n", bp));
 	*bpp = bp;
@@ -261,16 +392,14 @@ bwrite(struct buf *bp)
 	DPRINTF(VFSDB_BIO, ("bwrite: dev=%x blkno=%d\n", bp->b_dev,
 			    bp->b_blkno));
 
-	WITH_LOCK(bio_lock) {
-		CLR(bp->b_flags, (B_READ | B_DONE | B_DELWRI));
-	}
+	if (ISSET(bp->b_flags, B_DELWRI))
+		bio_ndirty--;
+	CLR(bp->b_flags, (B_READ | B_DONE | B_DELWRI));
 
 	auto error = rw_buf(bp, 1);
 	if (error)
 		return error;
-	WITH_LOCK(bio_lock) {
-		SET(bp->b_flags, B_DONE);
-	}
+	SET(bp->b_flags, B_DONE);
 	brelse(bp);
 	return 0;
 }
@@ -280,16 +409,20 @@ bwrite(struct buf *bp)
  *
  * The buffer is marked dirty, but an actual I/O is not
  * performed.  This routine should be used when the buffer
- * is expected to be modified again soon.
+ * is expected to be modified again soon.  The flusher thread
+ * writes it behind if it is not reused meanwhile.
  */
 void
 bdwrite(struct buf *bp)
 {
+	ASSERT(ISSET(bp->b_flags, B_BUSY));
 
-	WITH_LOCK(bio_lock) {
+	if (!ISSET(bp->b_flags, B_DELWRI)) {
 		SET(bp->b_flags, B_DELWRI);
-		CLR(bp->b_flags, B_DONE);
+		if (++bio_ndirty >= bio_max_bufs / 4)
+			bio_flush_cv.wake_one();
 	}
+	CLR(bp->b_flags, B_DONE);
 	brelse(bp);
 }
 
@@ -299,9 +432,50 @@ bdwrite(struct buf *bp)
 void
 bflush(struct buf *bp)
 {
-	WITH_LOCK(bio_lock) {
-		if (ISSET(bp->b_flags, B_DELWRI))
-			bwrite(bp);
+	if (ISSET(bp->b_flags, B_DELWRI))
+		bwrite(bp);
+}
+
+/*
+ * Write out all delayed writes which are not in use.
+ * Returns false if some are left, because they were in use, their
+ * bucket was contended or the write failed.
+ */
+static bool
+bio_flush_dirty(void)
+{
+	constexpr size_t batch = 64;
+	bool found;
+
+	do {
+		std::vector<struct buf *> dirty;
+		bio_claim_lru(dirty, batch, false, [] (struct buf *bp) {
+			return ISSET(bp->b_flags, B_DELWRI);
+		});
+		found = !dirty.empty();
+		for (auto *bp : dirty) {
+			mutex_lock(&bp->b_lock);
+			if (bwrite(bp) != 0) {
+				/* Keep it dirty and retry on the next pass. */
+				SET(bp->b_flags, B_DELWRI);
+				bio_ndirty++;
+				brelse(bp);
+				found = false;
+			}
+		}
+	} while (found);
+	return bio_ndirty == 0;
+}
+
+static void
+bio_flusher_loop(void)
+{
+	for (;;) {
+		WITH_LOCK(bio_lru_lock) {
+			if (bio_ndirty < bio_max_bufs / 4)
+				bio_flush_cv.wait(&bio_lru_lock, BIO_FLUSH_INTERVAL);
+		}
+		bio_flush_dirty();
 	}
 }
 
@@ -312,40 +486,73 @@ bflush(struct buf *bp)
 void
 binval(struct device *dev)
 {
-	SCOPE_LOCK(bio_lock);
-	for (auto i = 0; i < NBUFS; i++) {
-		auto* bp = &buf_table[i];
-		if (bp->b_dev == dev) {
-			if (ISSET(bp->b_flags, B_DELWRI))
-				bwrite(bp);
-			else if (ISSET(bp->b_flags, B_BUSY))
-				brelse(bp);
-			bp->b_flags = B_INVAL;
+	for (auto &b : bio_buckets) {
+		SCOPE_LOCK(b.lock);
+restart:
+		for (auto &bp : b.bufs) {
+			if (bp.b_dev != dev)
+				continue;
+			if (ISSET(bp.b_flags, B_BUSY)) {
+				b.busy_cv.wait(b.lock);
+				goto restart;
+			}
+			WITH_LOCK(bio_lru_lock) {
+				bio_claim(&bp);
+			}
+			if (ISSET(bp.b_flags, B_DELWRI)) {
+				DROP_LOCK(b.lock) {
+					rw_buf(&bp, 1);
+				}
+				bio_ndirty--;
+			}
+			b.bufs.erase(b.bufs.iterator_to(bp));
+			bp.b_flags = B_INVAL;
+			WITH_LOCK(bio_lru_lock) {
+				bio_lru.push_front(bp);
+				bio_lru_cv.wake_one();
+			}
+			b.busy_cv.wake_all();
+			goto restart;
 		}
 	}
 }
 
 /*
- * Invalidate all buffers.
+ * Write out all delayed writes.
  * This is called when unmount.
  */
 void
 bio_sync(void)
 {
-	SCOPE_LOCK(bio_lock);
-start:
-	for (int i = 0; i < NBUFS; i++) {
-		auto* bp = &buf_table[i];
-		if (ISSET(bp->b_flags, B_BUSY)) {
-			DROP_LOCK(bio_lock) {
-				mutex_lock(&bp->b_lock);
-				mutex_unlock(&bp->b_lock);
-			}
-			goto start;
-		}
-		if (ISSET(bp->b_flags, B_DELWRI))
-			bwrite(bp);
+	/* Retry while some are in use, but give up on persistent errors. */
+	for (int retry = 0; !bio_flush_dirty() && retry < 100; retry++)
+		sched::thread::sleep(std::chrono::milliseconds(10));
+}
+
+/*
+ * Give clean buffers which are not in use back to the system.
+ */
+class bio_shrinker : public memory::shrinker {
+public:
+	bio_shrinker() : shrinker("bio") {}
+	size_t request_memory(size_t s, bool hard);
+};
+
+size_t
+bio_shrinker::request_memory(size_t s, bool hard)
+{
+	std::vector<struct buf *> victims;
+	size_t n = (s + BSIZE - 1) / BSIZE;
+
+	bio_claim_lru(victims, n, true, [] (struct buf *bp) {
+		return !ISSET(bp->b_flags, B_DELWRI);
+	});
+	WITH_LOCK(bio_lru_lock) {
+		bio_nbufs -= victims.size();
 	}
+	for (auto *bp : victims)
+		bio_free(bp);
+	return victims.size() * BSIZE;
 }
 
 /*
@@ -354,14 +561,13 @@ start:
 void
 bio_init(void)
 {
-	for (int i = 0; i < NBUFS; i++) {
-		auto* bp = &buf_table[i];
-		bp->b_flags = B_INVAL;
-		bp->b_data = malloc(BSIZE);
-		free_list.push_back(*bp);
-	}
-	sem_init(&free_sem, 0, NBUFS);
-
-	DPRINTF(VFSDB_BIO, ("bio: Buffer cache size %dK bytes\n",
-			    BSIZE * NBUFS / 1024));
+	bio_max_bufs = std::max<size_t>(NBUFS_MIN,
+	    memory::phys_mem_size / BIO_MEM_FRACTION / BSIZE);
+	new bio_shrinker();
+	bio_flusher = sched::thread::make(bio_flusher_loop,
+	    sched::thread::attr().name("bio-flusher"));
+	bio_flusher->start();
+
+	DPRINTF(VFSDB_BIO, ("bio: Buffer cache size up to %dK bytes\n",
+			    BSIZE * bio_max_bufs / 1024));
 }
@@ -16,6 +16,12 @@ struct linger
         int l_linger;
 };
 
+struct mmsghdr
+{
+        struct msghdr msg_hdr;
+        unsigned int msg_len;
+};
+
 #ifndef SOL_SOCKET
 #define SOL_SOCKET      1
 #endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+/* The part of Linux's perf_event ABI which OSv implements */
+
+#ifndef _LINUX_PERF_EVENT_H
+#define _LINUX_PERF_EVENT_H
+
+#include <stdint.h>
+#include <sys/ioctl.h>
+
+enum perf_type_id {
+	PERF_TYPE_HARDWARE = 0,
+	PERF_TYPE_SOFTWARE = 1,
+	PERF_TYPE_TRACEPOINT = 2,
+	PERF_TYPE_HW_CACHE = 3,
+	PERF_TYPE_RAW = 4,
+	PERF_TYPE_BREAKPOINT = 5,
+};
+
+enum perf_hw_id {
+	PERF_COUNT_HW_CPU_CYCLES = 0,
+	PERF_COUNT_HW_INSTRUCTIONS = 1,
+	PERF_COUNT_HW_CACHE_REFERENCES = 2,
+	PERF_COUNT_HW_CACHE_MISSES = 3,
+	PERF_COUNT_HW_BRANCH_INSTRUCTIONS = 4,
+	PERF_COUNT_HW_BRANCH_MISSES = 5,
+};
+
+enum perf_event_read_format {
+	PERF_FORMAT_TOTAL_TIME_ENABLED = 1U << 0,
+	PERF_FORMAT_TOTAL_TIME_RUNNING = 1U << 1,
+	PERF_FORMAT_ID = 1U << 2,
+	PERF_FORMAT_GROUP = 1U << 3,
+};
+
+#define PERF_ATTR_SIZE_VER0	64
+
+struct perf_event_attr {
+	uint32_t type;
+	uint32_t size;
+	uint64_t config;
+	union {
+		uint64_t sample_period;
+		uint64_t sample_freq;
+	};
+	uint64_t sample_type;
+	uint64_t read_format;
+	uint64_t disabled : 1,
+	    inherit : 1,
+	    pinned : 1,
+	    exclusive : 1,
+	    exclude_user : 1,
+	    exclude_kernel : 1,
+	    exclude_hv : 1,
+	    exclude_idle : 1,
+	    mmap : 1,
+	    comm : 1,
+	    freq : 1,
+	    inherit_stat : 1,
+	    enable_on_exec : 1,
+	    task : 1,
+	    watermark : 1,
+	    precise_ip : 2,
+	    mmap_data : 1,
+	    sample_id_all : 1,
+	    exclude_host : 1,
+	    exclude_guest : 1,
+	    exclude_callchain_kernel : 1,
+	    exclude_callchain_user : 1,
+	    mmap2 : 1,
+	    comm_exec : 1,
+	    use_clockid : 1,
+	    context_switch : 1,
+	    write_backward : 1,
+	    namespaces : 1,
+	    __reserved_1 : 35;
+	union {
+		uint32_t wakeup_events;
+		uint32_t wakeup_watermark;
+	};
+	uint32_t bp_type;
+	union {
+		uint64_t bp_addr;
+		uint64_t config1;
+	};
+	union {
+		uint64_t bp_len;
+		uint64_t config2;
+	};
+	uint64_t branch_sample_type;
+	uint64_t sample_regs_user;
+	uint32_t sample_stack_user;
+	int32_t clockid;
+	uint64_t sample_regs_intr;
+	uint32_t aux_watermark;
+	uint16_t sample_max_stack;
+	uint16_t __reserved_2;
+};
+
+#define PERF_EVENT_IOC_ENABLE	_IO('$', 0)
+#define PERF_EVENT_IOC_DISABLE	_IO('$', 1)
+#define PERF_EVENT_IOC_RESET	_IO('$', 3)
+
+#define PERF_FLAG_FD_NO_GROUP	(1UL << 0)
+#define PERF_FLAG_FD_OUTPUT	(1UL << 1)
+#define PERF_FLAG_PID_CGROUP	(1UL << 2)
+#define PERF_FLAG_FD_CLOEXEC	(1UL << 3)
+
+#endif
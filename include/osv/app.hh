@@ -192,7 +192,7 @@ public:
     /**
      * Returns the invoked program executable of this application.
      */
-    std::string get_command();
+    const std::string& get_command() const;
 
     /**
       * Returns thread_id/PID of thread running app main() function.
@@ -217,6 +217,7 @@ private:
     void start_and_join(waiter* setup_waiter);
     void main();
     void prepare_argv(elf::program *program);
+    void print_load_stats();
     void run_main();
     friend void ::__libc_start_main(int(*)(int, char**), int, char**, void(*)(),
         void(*)(), void(*)(), void*);
@@ -232,6 +233,7 @@ private:
     bool _termination_requested;
     mutex _termination_mutex;
     std::shared_ptr<elf::object> _lib;
+    elf::program::load_stats _load_stats;
     std::shared_ptr<elf::object> _libenviron;
     std::shared_ptr<elf::object> _libvdso;
     main_func_t* _main;
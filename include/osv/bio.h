@@ -93,6 +93,7 @@ struct bio {
 	struct disk *bio_disk;
 	daddr_t bio_pblkno;
 	off_t   bio_length;     /* Like bio_bcount */
+	uint64_t bio_t0;	/* Time the driver got it, for devstat (ns). */
 
 	TAILQ_ENTRY(bio) bio_queue;
 
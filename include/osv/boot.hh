@@ -2,6 +2,7 @@
 #define BOOT_HH
 
 #include "arch-setup.hh"
+#include <atomic>
 
 class time_element {
 public:
@@ -16,14 +17,21 @@ public:
     void event(int event_idx, const char *str, u64 stamp);
     void print_chart();
     void print_total_time();
+    // The applications start after the chart is printed, so when it is
+    // asked for, each application prints its own ELF load, relocation and
+    // init times once it is about to run (see application::main()).
+    bool app_phases = false;
 private:
     // Can we keep it at 0 and let the initial two users increment it?  No, we
     // cannot. The reason is that the code that *parses* those fields run
     // relatively late (the code that takes the measure is so early it cannot
     // call this one directly. Therefore, the measurements would appear in the
     // middle of the list, and we want to preserve order.
-    int _event = 4;
-    time_element arrays[16];
+    // Events may come from several threads (e.g. drivers loading in
+    // parallel); those which don't fit are dropped.
+    std::atomic<int> _event = {4};
+    static constexpr int max_events = 64;
+    time_element arrays[max_events];
 
     void print_one_time(int index);
     double to_msec(u64 time);
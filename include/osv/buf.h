@@ -41,6 +41,7 @@
  * Buffer header
  */
 struct buf: boost::intrusive::list_base_hook<> {
+	boost::intrusive::list_member_hook<> b_hash;	/* hash chain */
 	int		b_flags;	/* see defines below */
 	struct device	*b_dev;		/* device */
 	int		b_blkno;	/* block # on device */
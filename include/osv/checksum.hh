@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_CHECKSUM_HH_
+#define OSV_CHECKSUM_HH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// The block checksums used by ZFS come in several implementations, and the
+// fastest one the CPU supports is picked at boot. The individual variants
+// are exposed here so they can be compared against each other.
+namespace osv {
+namespace checksum {
+
+typedef void (*fletcher_4_fn)(const void *buf, uint64_t size, uint64_t cksum[4]);
+// Compresses nblocks 64-byte blocks into the SHA-256 state
+typedef void (*sha256_blocks_fn)(uint32_t state[8], const void *data, size_t nblocks);
+
+template <typename Fn>
+struct variant {
+    const char *name;
+    Fn fn;
+};
+
+// The variants usable on this CPU; the one in use is the last.
+std::vector<variant<fletcher_4_fn>> fletcher_4_native_variants();
+std::vector<variant<fletcher_4_fn>> fletcher_4_byteswap_variants();
+std::vector<variant<sha256_blocks_fn>> sha256_variants();
+
+}
+}
+
+#endif /* OSV_CHECKSUM_HH_ */
@@ -129,6 +129,7 @@ struct device {
 	off_t		offset; /* 0 for the main drive, if we have a partition, this is the start address */
 	size_t		max_io_size;
 	void		*private_data;	/* private storage */
+	struct devstat	*stats;		/* I/O statistics, block devices only */
 
 	void *softc;
 	void *ivars;
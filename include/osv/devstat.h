@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef _OSV_DEVSTAT_H
+#define _OSV_DEVSTAT_H
+
+/*
+ * Block device statistics.
+ *
+ * Every block device gets a struct devstat when it is registered.  Drivers
+ * call devstat_start_transaction_bio() when a bio reaches them, and biodone()
+ * accounts its completion.  The counters are kept per cpu, so neither path
+ * takes a lock or bounces a shared cache line; readers sum them up.
+ */
+
+#include <sys/cdefs.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <osv/device.h>
+
+__BEGIN_DECLS
+
+struct bio;
+struct devstat;
+
+enum {
+	DEVSTAT_READ,
+	DEVSTAT_WRITE,
+	DEVSTAT_FLUSH,
+	DEVSTAT_NOPS
+};
+
+/*
+ * Latency histogram buckets: bucket 0 counts the requests which completed
+ * in under 1us, bucket n those which took [2^(n-1), 2^n) us, and the last
+ * bucket all slower ones.
+ */
+#define	DEVSTAT_LAT_BUCKETS	24
+
+struct devstat_info {
+	char		name[MAXDEVNAME];
+	uint64_t	ops[DEVSTAT_NOPS];	/* completed requests */
+	uint64_t	errors[DEVSTAT_NOPS];	/* of which failed */
+	uint64_t	bytes[DEVSTAT_NOPS];
+	uint64_t	time_ns[DEVSTAT_NOPS];	/* total latency */
+	uint64_t	merged[DEVSTAT_NOPS];	/* requests merged into others */
+	uint64_t	split;			/* requests split to fit the device */
+	uint64_t	inflight;		/* requests issued, not completed */
+	uint64_t	latency[DEVSTAT_NOPS][DEVSTAT_LAT_BUCKETS];
+};
+
+struct devstat *devstat_alloc(void);
+void	devstat_free(struct devstat *);
+
+void	devstat_start_transaction_bio(struct bio *);
+void	devstat_end_transaction_bio(struct bio *, bool ok);
+void	devstat_merged(struct device *, int cmd, unsigned count);
+void	devstat_split(struct device *);
+
+/* Sum up the per-cpu counters of one device into stat (but not its name). */
+void	devstat_read(struct devstat *, struct devstat_info *stat);
+
+/*
+ * Iterate over the block devices, like device_info(): fills in the
+ * statistics of the next device after info->cookie, or returns ESRCH.
+ */
+int	devstat_info(struct devinfo *info, struct devstat_info *stat);
+
+/*
+ * Upper bound, in microseconds, of the bucket holding the given percentile
+ * (0-100) of a latency histogram; 0 if the histogram is empty.
+ */
+uint64_t devstat_percentile(const uint64_t *latency, double pct);
+
+__END_DECLS
+
+#endif /* _OSV_DEVSTAT_H */
@@ -17,13 +17,26 @@
 #include <bsd/sys/netinet/udp.h>
 #include <osv/sched.hh>
 #include <osv/mutex.h>
+#include <osv/condvar.h>
 #include <osv/debug.h>
+#include <atomic>
+#include <string>
 
 #include <boost/asio/ip/address.hpp>
 #include <boost/asio/ip/address_v4.hpp>
 
 extern "C" {
 void dhcp_start(bool wait);
+// Like dhcp_start(true), but in a thread of its own: the caller goes on,
+// and dhcp_wait() blocks until the lease is there.
+void dhcp_start_background();
+// Blocks until dhcp_start_background() got its lease; returns right away
+// if it is not running.
+void dhcp_wait();
+// Remember the leases in this file, and ask for the same address again
+// on the next boot (INIT-REBOOT), saving the DISCOVER/OFFER round trip.
+// Must be called before dhcp_start().
+void dhcp_set_lease_cache(const char* path);
 void dhcp_release();
 void dhcp_renew(bool wait);
 }
@@ -234,6 +247,8 @@ namespace dhcp {
         ~dhcp_interface_state();
 
         void discover();
+        // Ask for the cached address if there is one, otherwise discover.
+        void init_reboot();
         void release();
         void renew();
         void process_packet(struct mbuf*);
@@ -241,6 +256,9 @@ namespace dhcp {
         void state_request(dhcp_mbuf &dm);
 
         bool is_acknowledged() { return (_state == DHCP_ACKNOWLEDGE); }
+        void set_cached_addr(boost::asio::ip::address_v4 addr) { _cached_addr = addr; }
+        boost::asio::ip::address_v4 client_addr() const { return _client_addr; }
+        struct ifnet* ifp() const { return _ifp; }
 
     private:
         state _state;
@@ -248,6 +266,7 @@ namespace dhcp {
         dhcp_socket* _sock;
         boost::asio::ip::address_v4 _client_addr;
         boost::asio::ip::address_v4 _server_addr;
+        boost::asio::ip::address_v4 _cached_addr;
 
         // Transaction id
         u32 _xid;
@@ -266,6 +285,9 @@ namespace dhcp {
         void init();
         // Send discover packets
         void start(bool wait);
+        void start_background();
+        void wait();
+        void set_lease_cache(std::string path) { _lease_cache = path; }
         // Send release packet for all DHCP IPs.
         void release();
         void renew(bool wait);
@@ -284,6 +306,14 @@ namespace dhcp {
         bool _have_ip;
         sched::thread * _waiter;
         void _send_and_wait(bool wait, dhcp_interface_state_send_packet iface_func);
+
+        // Set while start_background() has no lease yet
+        std::atomic<bool> _pending;
+        condvar _lease_cond;
+
+        std::string _lease_cache;
+        void load_leases();
+        void save_leases();
     };
 
 } // namespace dhcp
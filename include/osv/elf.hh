@@ -16,6 +16,7 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <osv/types.h>
+#include <osv/rwlock.h>
 #include <atomic>
 
 #include "arch-elf.hh"
@@ -193,6 +194,11 @@ enum {
     DT_FINI_ARRAYSZ = 28, // d_val Size, in bytes, of the array of termination functions.
     DT_RUNPATH = 29, // d_val The string table offset of a shared library search path string.
     DT_FLAGS = 30, // value is various flags, bits from DF_*.
+    DT_RELRSZ = 35, // d_val Total size, in bytes, of the DT_RELR relocation table.
+    DT_RELR = 36, // d_ptr Address of a table of packed relative relocations.
+    DT_RELRENT = 37, // d_val Size, in bytes, of each DT_RELR entry.
+    DT_RELACOUNT = 0x6ffffff9, // d_val Number of relative relocations at the
+      // start of the DT_RELA table.
     DT_FLAGS_1 = 0x6ffffffb, // value is various flags, bits from DF_1_*.
     DT_VERSYM = 0x6ffffff0, // d_ptr Address of the version symbol table.
     DT_LOOS = 0x60000000, // Defines a range of dynamic table tags that are reserved for
@@ -329,6 +335,18 @@ struct [[gnu::packed]] Elf64_Shdr {
     Elf64_Xword sh_entsize; /* Size of entries, if section has table */
 };
 
+// Symbol bindings of one object, precomputed at image build time by
+// scripts/prelink.py. See program::load_prelink().
+struct prelink_object {
+    // The modules list this object is relocated with, in search order, as
+    // pairs of pathname and object::symbols_hash(); the kernel's is "".
+    std::vector<std::pair<std::string, u64>> modules;
+    // For each dynamic symbol, the position in modules of the one which
+    // defines it, and the symbol's index there; or no_binding.
+    std::vector<std::pair<u32, u32>> bindings;
+    static constexpr u32 no_binding = ~0u;
+};
+
 enum VisibilityLevel {
     Public,
     ThreadOnly,
@@ -400,11 +418,15 @@ private:
     Elf64_Dyn& dynamic_tag(unsigned tag);
     Elf64_Dyn* _dynamic_tag(unsigned tag);
     symbol_module symbol(unsigned idx, bool ignore_missing = false);
+    symbol_module prelinked_symbol(unsigned idx, const char* name);
     symbol_module symbol_other(unsigned idx);
     Elf64_Xword symbol_tls_module(unsigned idx);
     void relocate_rela();
+    void relocate_relr();
     void relocate_pltgot();
     unsigned symtab_len();
+    u64 symbols_hash();
+    void use_prelink();
     void collect_dependencies(std::unordered_set<elf::object*>& ds);
     std::deque<elf::object*> collect_dependencies_bfs();
     void prepare_initial_tls(void* buffer, size_t size, std::vector<ptrdiff_t>& offsets);
@@ -436,6 +458,13 @@ protected:
 
     std::unordered_map<std::string,void*> _cached_symbols;
 
+    // Set while relocating, if the bindings prelinked for this object are
+    // valid: _prelinked_modules is the modules list they index.
+    const prelink_object* _prelinked = nullptr;
+    std::vector<object*> _prelinked_modules;
+    u64 _symbols_hash = 0;
+    unsigned _symbols_count = 0;
+
     // Keep list of references to other modules, to prevent them from being
     // unloaded. When this object is unloaded, the reference count of all
     // objects listed here goes down, and they too may be unloaded.
@@ -466,6 +495,9 @@ private:
     bool visible(void) const;
 public:
     void set_visibility(VisibilityLevel);
+    bool visible_to_all() const {
+        return _visibility_level.load(std::memory_order_acquire) == VisibilityLevel::Public;
+    }
 };
 
 class file : public object {
@@ -584,11 +616,48 @@ public:
      */
     void set_search_path(std::initializer_list<std::string> path);
 
+    /**
+     * Record which PLT entries lazy binding resolves, for bind_plt_profile().
+     *
+     * save_plt_profile() writes the symbols resolved since, and those bound
+     * from a profile, to path, one "<object pathname> <symbol>" per line.
+     */
+    void record_plt_profile(const std::string& path);
+    void save_plt_profile();
+
+    /**
+     * Bind the PLT entries listed in the profile at path (see
+     * record_plt_profile()) when their objects get loaded, leaving the
+     * others to lazy binding. Objects which ask to be bound immediately
+     * (DT_BIND_NOW and friends) still have all their entries bound.
+     *
+     * The profile is that of the main program, whichever program this
+     * is called on, and applies to objects loaded by the programs of
+     * applications in other namespaces as well.
+     */
+    void bind_plt_profile(const std::string& path);
+
     symbol_module lookup(const char* symbol, object* seeker);
     symbol_module lookup_next(const char* name, const void* retaddr);
     template <typename T>
     T* lookup_function(const char* symbol);
 
+    /**
+     * Where the dynamic linker's time went, summed over all the objects
+     * this program loaded so far. Times are in nanoseconds.
+     */
+    struct load_stats {
+        u64 objects = 0;     // objects loaded
+        u64 load_ns = 0;     // mapping segments, parsing headers
+        u64 relocate_ns = 0; // relocations, including symbol lookups
+        u64 init_ns = 0;     // running init functions
+        u64 lookups = 0;     // lookup() calls
+        u64 lookup_hits = 0; // ... answered from the lookup cache
+        u64 prelinked = 0;   // symbols bound from a .prelink file instead
+        u64 relr_sliced = 0; // DT_RELR tables relocated in parallel
+    };
+    load_stats get_load_stats();
+
     struct modules_list {
         // List of objects, in search priority order
         std::vector<object*> objects;
@@ -619,6 +688,15 @@ private:
     std::shared_ptr<object> load_object(std::string name,
             std::vector<std::string> extra_path,
             std::vector<std::shared_ptr<object>> &loaded_objects);
+    bool lookup_cached(const char* name, uint32_t hash, object* seeker,
+            symbol_module& ret);
+    void lookup_cache_insert(const char* name, uint32_t hash, int gen,
+            const symbol_module& sm, unsigned pos);
+    void invalidate_lookup_cache(const modules_list& ml);
+    void load_prelink(const std::string& name);
+    std::unordered_set<std::string> plt_hot(const std::string& pathname);
+    void plt_profile_add(const std::string& pathname, const char* name);
+    const prelink_object* prelinked(const std::string& name);
 private:
     mutex _mutex;
     void* _next_alloc;
@@ -640,6 +718,38 @@ private:
     void module_delete_enable();
     std::vector <object*> _modules_to_delete;
 
+    // Program-wide cache of lookup() results, keyed by the symbol's GNU hash.
+    // Only lookups which didn't depend on the looking thread (all the
+    // objects searched were visible to all) are cached. The cache is
+    // emptied whenever the modules list changes, which _lookup_cache_gen
+    // (adds + subs of the list the cache is valid for) tracks.
+    struct lookup_cache_entry {
+        std::string name;
+        symbol_module sm;
+        unsigned pos; // of sm.obj in the modules list, or its size if none
+    };
+    rwlock_t _lookup_cache_lock;
+    std::unordered_multimap<uint32_t, lookup_cache_entry> _lookup_cache;
+    std::unordered_map<const object*, unsigned> _lookup_cache_pos;
+    int _lookup_cache_gen = 0;
+    std::atomic<u64> _lookups = {0};
+    std::atomic<u64> _lookup_hits = {0};
+    std::atomic<u64> _prelinked_symbols = {0};
+    std::atomic<u64> _relr_sliced = {0};
+    load_stats _load_stats;
+
+    // The prelink_object of each object of the application get_library()
+    // is loading, by pathname, from the application's .prelink file.
+    std::unordered_map<std::string, prelink_object> _prelink;
+
+    // PLT binding profile, of the main program only: the symbols to bind
+    // when loading each object, and those recorded as used.
+    std::unordered_map<std::string, std::unordered_set<std::string>> _plt_hot;
+    mutex _plt_profile_mutex;
+    std::atomic<bool> _plt_profile_recording = {false};
+    std::string _plt_profile_path;
+    std::unordered_map<std::string, std::unordered_set<std::string>> _plt_used;
+
     // debugger interface
     static std::vector<object*> s_objs;
     static mutex s_objs_mutex;
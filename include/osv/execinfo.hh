@@ -13,5 +13,9 @@
 // contexts, but requires -fno-omit-frame-pointer
 int backtrace_safe(void** pc, int nr);
 
+// Like backtrace_safe(), but of the code the current interrupt interrupted,
+// starting with its pc.  Returns 0 outside of interrupt context.
+int backtrace_safe_interrupted(void** pc, int nr);
+
 
 #endif /* EXECINFO_HH_ */
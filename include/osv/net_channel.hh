@@ -100,6 +100,13 @@ struct ipv4_tcp_conn_id {
     }
 };
 
+// A connected UDP socket is registered with its full 4-tuple.  A bound,
+// unconnected one is registered with a wildcard (INADDR_ANY, 0) source, and
+// with a wildcard destination address too if it is bound to INADDR_ANY.
+struct ipv4_udp_conn_id : ipv4_tcp_conn_id {
+    using ipv4_tcp_conn_id::ipv4_tcp_conn_id;
+};
+
 namespace std {
 
 template <>
@@ -107,6 +114,11 @@ struct hash<ipv4_tcp_conn_id> {
     size_t operator()(ipv4_tcp_conn_id x) const { return x.hash(); }
 };
 
+template <>
+struct hash<ipv4_udp_conn_id> {
+    size_t operator()(ipv4_udp_conn_id x) const { return x.hash(); }
+};
+
 }
 
 class classifier {
@@ -115,27 +127,42 @@ public:
     // consumer side operations
     void add(ipv4_tcp_conn_id id, net_channel* channel);
     void remove(ipv4_tcp_conn_id id);
+    void add(ipv4_udp_conn_id id, net_channel* channel);
+    void remove(ipv4_udp_conn_id id);
     // producer side operations
     bool post_packet(mbuf* m);
 private:
-    net_channel* classify_ipv4_tcp(mbuf* m);
+    net_channel* classify_ipv4(mbuf* m);
+    net_channel* classify_ipv4_tcp(ip* ip_hdr, caddr_t h);
+    net_channel* classify_ipv4_udp(ip* ip_hdr, caddr_t h);
 private:
+    template <typename Key>
     struct item {
-        item(const ipv4_tcp_conn_id& key, net_channel* chan) : key(key), chan(chan) {}
-        ipv4_tcp_conn_id key;
+        item(const Key& key, net_channel* chan) : key(key), chan(chan) {}
+        Key key;
         net_channel* chan;
     };
-    struct item_hash : private std::hash<ipv4_tcp_conn_id> {
-        size_t operator()(const item& i) const { return std::hash<ipv4_tcp_conn_id>::operator()(i.key); }
+    template <typename Key>
+    struct item_hash : private std::hash<Key> {
+        size_t operator()(const item<Key>& i) const { return std::hash<Key>::operator()(i.key); }
     };
+    template <typename Key>
     struct key_item_compare {
-        bool operator()(const ipv4_tcp_conn_id& key, const item& item) const {
+        bool operator()(const Key& key, const item<Key>& item) const {
             return key == item.key;
         }
     };
-    using ipv4_tcp_channels = osv::rcu_hashtable<item, item_hash>;
+    template <typename Key>
+    using channels = osv::rcu_hashtable<item<Key>, item_hash<Key>>;
+    template <typename Key>
+    void add(channels<Key>& table, Key id, net_channel* channel);
+    template <typename Key>
+    void remove(channels<Key>& table, Key id);
+    template <typename Key>
+    net_channel* find(channels<Key>& table, Key id);
     mutex _mtx;
-    ipv4_tcp_channels _ipv4_tcp_channels;
+    channels<ipv4_tcp_conn_id> _ipv4_tcp_channels;
+    channels<ipv4_udp_conn_id> _ipv4_udp_channels;
 };
 
 #endif /* NETCHANNEL_HH_ */
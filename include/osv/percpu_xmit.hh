@@ -14,6 +14,7 @@
 
 #include <osv/clock.hh>
 #include <osv/migration-lock.hh>
+#include <osv/tx_batch.hh>
 #include <osv/aligned_new.hh>
 
 #include <bsd/sys/sys/mbuf.h>
@@ -188,7 +189,7 @@ private:
  */
 template <class NetDevTxq, unsigned CpuTxqSize,
           class StopPollingPred, class XmitIterator>
-class xmitter {
+class xmitter : public tx_kick_flusher {
 private:
     struct worker_info {
         worker_info() : me(NULL), next(NULL) {}
@@ -290,7 +291,15 @@ public:
 
         // Alright!!!
         if (!rc) {
-            _txq->kick_hw();
+            //
+            // Inside a tx_batch only account the frame here and let
+            // flush_kick() kick the HW once for the whole batch.
+            //
+            if (tx_batch::defer_kick(this)) {
+                _txq->defer_kick();
+            } else {
+                _txq->kick_hw();
+            }
         }
 
         unlock_running();
@@ -318,6 +327,22 @@ public:
         return 0;
     }
 
+    /**
+     * Kick the HW for the frames posted in-place during a tx_batch.
+     *
+     * If a dispatcher holds the RUNNING lock it will kick them together with
+     * its own frames, so it's ok to wait for it here.
+     */
+    virtual void flush_kick() override {
+        lock_running();
+        _txq->kick_pending();
+        unlock_running();
+
+        if (has_pending()) {
+            wake_worker();
+        }
+    }
+
 private:
     void wake_worker() {
         WITH_LOCK(migration_lock)
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_PERF_HH
+#define OSV_PERF_HH
+
+#include <osv/pmu.hh>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+
+namespace sched {
+class thread;
+}
+
+// Hardware event counters, shared between CPU-wide counters, which keep
+// their PMU counter for as long as they exist, and per-thread counters,
+// which get the remaining PMU counters of a CPU while their thread runs
+// there, and are saved and restored on context switches.
+namespace perf {
+
+class counter {
+public:
+    struct value {
+        u64 count;
+        // Nanoseconds enabled, and actually counting: a thread counter does
+        // not count when its CPU has no free PMU counter for it
+        u64 time_enabled;
+        u64 time_running;
+    };
+
+    virtual ~counter() {}
+    virtual void enable() = 0;
+    virtual void disable() = 0;
+    virtual void reset() = 0;
+    virtual value read() = 0;
+};
+
+// Counts e for the current thread, on any CPU. Returns nullptr if the
+// event is not supported.
+std::unique_ptr<counter> open_thread_counter(pmu::event e, bool enabled);
+
+// Counts e on cpu, for all threads. Returns nullptr if the event is not
+// supported or the CPU has no free PMU counter.
+std::unique_ptr<counter> open_cpu_counter(pmu::event e, unsigned cpu, bool enabled);
+
+// Counts each event on each CPU for the given duration. Returns a
+// count per event per CPU; events which could not be counted are 0.
+std::vector<std::vector<u64>> measure_cpus(const std::vector<pmu::event>& events,
+                                           std::chrono::nanoseconds duration);
+
+// Reserves a PMU counter of the current CPU, for users programming it
+// themselves. Returns -1 if all counters are in use. Must be called
+// with preemption disabled.
+int reserve_counter();
+void unreserve_counter(unsigned counter);
+
+struct thread_counters;
+
+// Called by the scheduler, with interrupts disabled, when switching from a
+// thread to another and either has counters
+void switch_counters(thread_counters* prev, thread_counters* next);
+
+// Called when a thread with counters is destroyed
+void free_thread_counters(thread_counters* tc);
+
+}
+
+struct perf_event_attr;
+
+// Counting (not sampling) hardware events, of the calling thread or of a
+// CPU, see <linux/perf_event.h>
+int perf_event_open(struct perf_event_attr* attr, pid_t pid, int cpu,
+                    int group_fd, unsigned long flags);
+
+#endif
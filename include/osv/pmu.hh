@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_PMU_HH
+#define OSV_PMU_HH
+
+#include <osv/types.h>
+#include <functional>
+
+// Low level access to the general purpose counters of the CPU's performance
+// monitoring unit. Users normally go through perf (<osv/perf.hh>), which
+// shares the counters between CPU-wide and per-thread users.
+namespace pmu {
+
+// In the order of Linux's PERF_COUNT_HW_* ids
+enum class event : unsigned {
+    cycles,
+    instructions,
+    cache_references,
+    cache_misses,
+    branch_instructions,
+    branch_misses,
+    count,
+};
+
+constexpr unsigned max_counters = 8;
+
+// Number of general purpose counters, 0 if there is no usable PMU
+unsigned counters();
+
+bool supported(event e);
+
+// Whether counters can interrupt on overflow, see set_overflow_handler()
+bool overflow_supported();
+
+inline const char* event_name(event e)
+{
+    static const char* names[] = {
+        "cycles",
+        "instructions",
+        "cache-references",
+        "cache-misses",
+        "branch-instructions",
+        "branch-misses",
+    };
+    return names[unsigned(e)];
+}
+
+// The rest act on the current CPU's counters, and must be called with
+// preemption disabled.
+
+// Starts counting e on counter from 0, in all privilege levels. With
+// overflow_interrupt, the overflow handler is called when it wraps.
+void start(unsigned counter, event e, bool overflow_interrupt = false);
+
+void stop(unsigned counter);
+
+u64 read(unsigned counter);
+
+// Only the low 31 bits of value are significant, and are sign extended to
+// the counter's width, so write(-period) makes the counter overflow after
+// period events.
+void write(unsigned counter, u64 value);
+
+// Mask of the counter's valid bits
+u64 mask();
+
+// Sets the function called, in interrupt context on the overflowing CPU,
+// with the counter that overflowed. One handler serves all the counters.
+void set_overflow_handler(std::function<void (unsigned counter)> handler);
+
+}
+
+#endif
@@ -9,6 +9,9 @@
 #define _OSV_SAMPLER_HH
 
 #include <osv/clock.hh>
+#include <ostream>
+#include <string>
+#include <vector>
 
 namespace prof {
 
@@ -32,6 +35,49 @@ void start_sampler(config) throw();
  */
 void stop_sampler() throw();
 
+struct profiler_config {
+    osv::clock::uptime::duration period = std::chrono::milliseconds(10);
+    // Ids of the threads to sample, all threads if empty
+    std::vector<unsigned> threads;
+    // Only sample the threads of applications running this command
+    std::string app;
+    // Distinct stacks kept per CPU; samples of stacks beyond that are dropped
+    size_t stacks = 1024;
+    // If nonzero, sample every this many CPU cycles instead of every period,
+    // on the overflow interrupt of a PMU counter, where there is one free.
+    // At most 2^31 - 1.
+    u64 cycles = 0;
+};
+
+/**
+ * Starts the always-on profiler.
+ *
+ * Unlike the sampler, which logs every sample as a tracepoint, the profiler
+ * counts the samples of each distinct stack in per-CPU tables, so it can run
+ * for the lifetime of the system. Restarting it clears the profile.
+ *
+ * May block.
+ */
+void start_profiler(profiler_config) throw();
+
+/**
+ * Stops the profiler. The profile collected so far remains readable.
+ *
+ * May block.
+ */
+void stop_profiler() throw();
+
+bool profiler_running();
+
+/**
+ * Writes the profile in the folded stacks format of flame graph tools: one
+ * line per stack, its frames from the outermost in, separated by ';',
+ * followed by the number of samples.
+ *
+ * With reset, the profile is cleared after it is read.
+ */
+void write_folded_stacks(std::ostream& out, bool reset = false);
+
 }
 
 #endif
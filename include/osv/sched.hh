@@ -49,6 +49,10 @@ struct application_runtime;
 
 }
 
+namespace perf {
+    struct thread_counters;
+}
+
 /**
  * OSV Scheduler namespace
  */
@@ -535,6 +539,11 @@ public:
         return _app_runtime;
     }
     static osv::application *current_app();
+    perf::thread_counters* perf_counters() const { return _perf_counters; }
+    // Only by the thread itself
+    void set_perf_counters(perf::thread_counters* counters) {
+        _perf_counters = counters;
+    }
     bool migratable() const { return _migration_lock_counter == 0; }
     bool pinned() const { return _pinned; }
     /**
@@ -702,6 +711,7 @@ private:
     std::vector<char*> _tls;
     bool _app;
     std::shared_ptr<osv::application_runtime> _app_runtime;
+    perf::thread_counters* _perf_counters = nullptr;
     void destroy();
     friend class thread_ref_guard;
     friend void thread_main_c(thread* t);
@@ -910,6 +920,26 @@ private:
 
 thread* current();
 
+/**
+ * Run f on the given CPU, with the current thread pinned to it.
+ *
+ * Afterwards the thread goes back to where it was: pinned again to the CPU
+ * it was pinned to before, if any, or unpinned.
+ */
+template <typename Func>
+void with_pinned(cpu* target_cpu, Func f)
+{
+    auto self = thread::current();
+    auto pinned_to = self->pinned() ? self->tcpu() : nullptr;
+    thread::pin(target_cpu);
+    f();
+    if (pinned_to) {
+        thread::pin(pinned_to);
+    } else {
+        self->unpin();
+    }
+}
+
 // wait_for() support for predicates
 //
 
@@ -57,6 +57,17 @@ set_event_state(tracepoint_base &, bool enable, bool stacktrace = false);
 std::string
 create_trace_dump();
 
+// Continuously write the trace buffers out to path, a file or a device,
+// so that long recordings don't lose events when the buffers wrap. The
+// result is in the dump format, which scripts/trace.py can read as it
+// grows ("trace.py stream").
+void
+start_stream(const std::string & path);
+
+// Write out what was traced since the stream's last round.
+void
+flush_stream();
+
 struct symbol {
     std::string name;
     const void * addr;
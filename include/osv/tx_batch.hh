@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_TX_BATCH_HH_
+#define OSV_TX_BATCH_HH_
+
+namespace osv {
+
+/**
+ * @class tx_kick_flusher
+ * Implemented by transmitters that can postpone notifying the HW about newly
+ * posted frames until the end of a tx_batch.
+ */
+class tx_kick_flusher {
+public:
+    virtual void flush_kick() = 0;
+protected:
+    ~tx_kick_flusher() {}
+};
+
+/**
+ * @class tx_batch
+ * Marks a sequence of transmissions made by the current thread, e.g. the
+ * datagrams of a single sendmmsg() call.
+ *
+ * While a tx_batch is alive a transmitter may post frames to the HW ring
+ * without kicking the HW for each of them. The kick is issued once, when the
+ * outermost tx_batch of the thread is destroyed, which for virtio turns a VM
+ * exit per frame into a VM exit per batch.
+ */
+class tx_batch {
+public:
+    tx_batch() { ++state().depth; }
+    ~tx_batch() {
+        auto& s = state();
+        if (--s.depth == 0) {
+            flush(s);
+        }
+    }
+    tx_batch(const tx_batch&) = delete;
+    tx_batch& operator=(const tx_batch&) = delete;
+
+    /**
+     * Register a kick to be issued at the end of the current batch.
+     *
+     * @return true if the kick has been deferred, false if the caller has to
+     *         kick the HW right away (no batch is open or there is no room
+     *         to remember another transmitter).
+     */
+    static bool defer_kick(tx_kick_flusher* f) {
+        auto& s = state();
+        if (!s.depth) {
+            return false;
+        }
+        for (unsigned i = 0; i < s.nflushers; i++) {
+            if (s.flushers[i] == f) {
+                return true;
+            }
+        }
+        if (s.nflushers == max_flushers) {
+            return false;
+        }
+        s.flushers[s.nflushers++] = f;
+        return true;
+    }
+
+private:
+    static constexpr unsigned max_flushers = 4;
+
+    struct batch_state {
+        unsigned depth;
+        unsigned nflushers;
+        tx_kick_flusher* flushers[max_flushers];
+    };
+
+    static batch_state& state() {
+        static __thread batch_state s;
+        return s;
+    }
+
+    static void flush(batch_state& s) {
+        for (unsigned i = 0; i < s.nflushers; i++) {
+            s.flushers[i]->flush_kick();
+        }
+        s.nflushers = 0;
+    }
+};
+
+}
+
+#endif /* OSV_TX_BATCH_HH_ */
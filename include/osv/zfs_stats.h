@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_ZFS_STATS_H
+#define OSV_ZFS_STATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Calls fn with the name and current value of each statistic of the kstat
+ * registered as module:name, e.g. "zfs":"arcstats" or "zfs":"zfetchstats".
+ * Returns 0, or ENOENT if there is no such kstat.
+ */
+int kstat_read(const char *module, const char *name,
+    void (*fn)(const char *stat, uint64_t value, void *arg), void *arg);
+
+/*
+ * Number of buckets of the vdev latency histograms. Bucket 0 counts the
+ * I/Os which took less than 1us, bucket i > 0 those which took [2^(i-1),
+ * 2^i) us, and the last one everything slower.
+ */
+#define ZFS_LAT_BUCKETS 24
+
+struct zfs_vdev_iostat {
+    const char *name;       /* device path, or vdev type for interior vdevs */
+    int level;              /* depth in the vdev tree, 0 for the pool */
+    uint64_t read_ops;
+    uint64_t write_ops;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t queued;        /* I/Os waiting in the vdev queue */
+    uint64_t pending;       /* I/Os issued to the device */
+    uint64_t read_latency[ZFS_LAT_BUCKETS];
+    uint64_t write_latency[ZFS_LAT_BUCKETS];
+};
+
+/*
+ * Calls fn for each vdev of the pool, parents before their children. The
+ * queue depths and latencies of interior vdevs are the sums of their
+ * leaves'. Returns 0, or an errno (ENOENT if there is no such pool).
+ */
+int zfs_pool_iostat(const char *pool,
+    void (*fn)(const struct zfs_vdev_iostat *vs, void *arg), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSV_ZFS_STATS_H */
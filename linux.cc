@@ -13,6 +13,7 @@
 #include <osv/mutex.h>
 #include <osv/waitqueue.hh>
 #include <osv/stubbing.hh>
+#include <osv/perf.hh>
 #include <memory>
 
 #include <syscall.h>
@@ -393,6 +394,7 @@ long syscall(long number, ...)
     SYSCALL4(accept4, int, struct sockaddr *, socklen_t *, int);
     SYSCALL3(connect, int, struct sockaddr *, socklen_t);
     SYSCALL5(get_mempolicy, int *, unsigned long *, unsigned long, void *, int);
+    SYSCALL5(perf_event_open, struct perf_event_attr *, pid_t, int, int, unsigned long);
     SYSCALL3(sched_getaffinity_syscall, pid_t, unsigned, unsigned long *);
     SYSCALL6(long_mmap, void *, size_t, int, int, int, off_t);
     SYSCALL2(munmap, void *, size_t);
@@ -419,6 +421,8 @@ long syscall(long number, ...)
     SYSCALL3(sendmsg, int, const struct msghdr *, int);
     SYSCALL6(recvfrom, int, void *, size_t, int, struct sockaddr *, socklen_t *);
     SYSCALL3(recvmsg, int, struct msghdr *, int);
+    SYSCALL5(recvmmsg, int, struct mmsghdr *, unsigned int, unsigned int, struct timespec *);
+    SYSCALL4(sendmmsg, int, struct mmsghdr *, unsigned int, unsigned int);
     SYSCALL3(dup3, int, int, int);
     SYSCALL2(flock, int, int);
     SYSCALL4(pwrite64, int, const void *, size_t, off_t);
@@ -28,6 +28,7 @@
 #include "arch.hh"
 #include "arch-setup.hh"
 #include "osv/trace.hh"
+#include "osv/tracecontrol.hh"
 #include <osv/power.hh>
 #include <osv/rcu.hh>
 #include <osv/mempool.hh>
@@ -88,8 +89,14 @@ extern "C" {
     void vfs_init(void);
     void unmount_devfs();
     void mount_zfs_rootfs(bool,bool);
+    void add_zfs_log_device(const char *);
     int mount_rofs_rootfs(bool);
     void rofs_disable_cache();
+    extern int zfs_arc_compressed;
+    extern int zfs_prefetch_disable;
+    extern uint32_t zfetch_max_streams;
+    extern uint32_t zfetch_block_cap;
+    extern int zfetch_adaptive;
 }
 
 void premain()
@@ -129,6 +136,8 @@ int main(int loader_argc, char **loader_argv)
 }
 
 static bool opt_extra_zfs_pools = false;
+static bool opt_zfs_arc_compressed = false;
+static std::string opt_zfs_log_device;
 static bool opt_disable_rofs_cache = false;
 static bool opt_leak = false;
 static bool opt_noshutdown = false;
@@ -145,9 +154,14 @@ static bool opt_bootchart = false;
 static std::vector<std::string> opt_ip;
 static std::string opt_defaultgw;
 static std::string opt_nameserver;
+static bool opt_dhcp_async = false;
+static std::string opt_dhcp_lease_cache;
+static std::string opt_plt_profile;
+static std::string opt_plt_hot;
 static std::string opt_redirect;
 static std::chrono::nanoseconds boot_delay;
 static bool opt_runtime_tracepoint = false;
+static std::string opt_trace_stream;
 std::vector<mntent> opt_mount_fs;
 bool opt_maxnic = false;
 int maxnic;
@@ -155,14 +169,18 @@ bool opt_pci_disabled = false;
 
 static int sampler_frequency;
 static bool opt_enable_sampler = false;
+static int profiler_frequency;
+static bool opt_enable_profiler = false;
 
 static void usage()
 {
     std::cout << "OSv options:\n";
     std::cout << "  --help                show help text\n";
     std::cout << "  --sampler=arg         start stack sampling profiler\n";
+    std::cout << "  --profiler=arg        start always-on stack profiler, at arg samples/sec\n";
     std::cout << "  --trace=arg           tracepoints to enable\n";
     std::cout << "  --trace-backtrace     log backtraces in the tracepoint log\n";
+    std::cout << "  --trace-stream=arg    stream the tracepoint log to this file or device\n";
     std::cout << "  --leak                start leak detector after boot\n";
     std::cout << "  --nomount             don't mount the ZFS file system\n";
     std::cout << "  --nopivot             do not pivot the root from bootfs to the ZFS\n";
@@ -181,11 +199,24 @@ static void usage()
     std::cout << "  --ip=arg              set static IP on NIC\n";
     std::cout << "  --defaultgw=arg       set default gateway address\n";
     std::cout << "  --nameserver=arg      set nameserver address\n";
+    std::cout << "  --dhcp-async          start the application without waiting for the DHCP\n";
+    std::cout << "                        lease, which its first network socket waits for\n";
+    std::cout << "  --dhcp-lease-cache=arg\n";
+    std::cout << "                        remember the DHCP lease in this file, to ask for\n";
+    std::cout << "                        the same address on the next boot\n";
+    std::cout << "  --plt-profile=arg     record the PLT entries the applications use in this\n";
+    std::cout << "                        file, when shutting down\n";
+    std::cout << "  --plt-hot=arg         bind the PLT entries recorded with --plt-profile in\n";
+    std::cout << "                        this file when loading, and the others lazily\n";
     std::cout << "  --delay=arg (=0)      delay in seconds before boot\n";
     std::cout << "  --redirect=arg        redirect stdout and stderr to file\n";
     std::cout << "  --disable_rofs_cache  disable ROFS memory cache\n";
     std::cout << "  --nopci               disable PCI enumeration\n";
     std::cout << "  --extra-zfs-pools     import extra ZFS pools\n";
+    std::cout << "  --zfs-arc-compressed  keep compressed ZFS blocks in memory\n";
+    std::cout << "  --zfs-log-device=arg  add a separate ZFS intent log device to the pool\n";
+    std::cout << "  --zfs-prefetch=arg    tune the ZFS prefetcher: off, or a list of\n";
+    std::cout << "                        streams=<n>,cap=<blocks>,adaptive=<0|1>\n";
     std::cout << "  --mount-fs=arg        mount extra filesystem, format:<fs_type,url,path>\n";
     std::cout << "  --runtime-tracepoint  allow adding tracepoints at runtime by mapping kernel as RWX\n\n";
 }
@@ -222,6 +253,36 @@ static void parse_options(int loader_argc, char** loader_argv)
         opt_extra_zfs_pools = true;
     }
 
+    if (extract_option_flag(options_values, "zfs-arc-compressed")) {
+        opt_zfs_arc_compressed = true;
+    }
+
+    if (options::option_value_exists(options_values, "zfs-log-device")) {
+        opt_zfs_log_device = options::extract_option_value(options_values, "zfs-log-device");
+    }
+
+    if (options::option_value_exists(options_values, "zfs-prefetch")) {
+        auto v = options::extract_option_value(options_values, "zfs-prefetch");
+        std::vector<std::string> tmp;
+        boost::split(tmp, v, boost::is_any_of(","), boost::token_compress_on);
+        for (auto t : tmp) {
+            auto eq = t.find('=');
+            auto key = t.substr(0, eq);
+            auto val = eq == std::string::npos ? 0 : strtoul(t.c_str() + eq + 1, nullptr, 0);
+            if (t == "off") {
+                zfs_prefetch_disable = 1;
+            } else if (key == "streams" && val > 0) {
+                zfetch_max_streams = val;
+            } else if (key == "cap" && val > 0) {
+                zfetch_block_cap = val;
+            } else if (key == "adaptive" && eq != std::string::npos) {
+                zfetch_adaptive = val;
+            } else {
+                printf("Ignoring value: '%s' for option zfs-prefetch\n", t.c_str());
+            }
+        }
+    }
+
     if (extract_option_flag(options_values, "noshutdown")) {
         opt_noshutdown = true;
     }
@@ -249,6 +310,11 @@ static void parse_options(int loader_argc, char** loader_argv)
         opt_enable_sampler = true;
     }
 
+    if (options::option_value_exists(options_values, "profiler")) {
+        profiler_frequency = options::extract_option_int_value(options_values, "profiler", handle_parse_error);
+        opt_enable_profiler = profiler_frequency > 0;
+    }
+
     if (extract_option_flag(options_values, "bootchart")) {
         opt_bootchart = true;
     }
@@ -258,6 +324,10 @@ static void parse_options(int loader_argc, char** loader_argv)
         opt_runtime_tracepoint = true;
     }
 
+    if (options::option_value_exists(options_values, "trace-stream")) {
+        opt_trace_stream = options::extract_option_value(options_values, "trace-stream");
+    }
+
     if (options::option_value_exists(options_values, "trace")) {
         auto tv = options::extract_option_values(options_values, "trace");
         for (auto t : tv) {
@@ -321,6 +391,22 @@ static void parse_options(int loader_argc, char** loader_argv)
         opt_ip = options::extract_option_values(options_values, "ip");
     }
 
+    if (extract_option_flag(options_values, "dhcp-async")) {
+        opt_dhcp_async = true;
+    }
+
+    if (options::option_value_exists(options_values, "dhcp-lease-cache")) {
+        opt_dhcp_lease_cache = options::extract_option_value(options_values, "dhcp-lease-cache");
+    }
+
+    if (options::option_value_exists(options_values, "plt-profile")) {
+        opt_plt_profile = options::extract_option_value(options_values, "plt-profile");
+    }
+
+    if (options::option_value_exists(options_values, "plt-hot")) {
+        opt_plt_hot = options::extract_option_value(options_values, "plt-hot");
+    }
+
     if (options::option_value_exists(options_values, "defaultgw")) {
         opt_defaultgw = options::extract_option_value(options_values, "defaultgw");
     }
@@ -408,8 +494,14 @@ void* do_main_thread(void *_main_args)
         if(mount_rofs_rootfs(opt_pivot) != 0) {
             //
             // Failed -> try to mount zfs
+            if (opt_zfs_arc_compressed) {
+                zfs_arc_compressed = 1;
+            }
             zfsdev::zfsdev_init();
             mount_zfs_rootfs(opt_pivot, opt_extra_zfs_pools);
+            if (!opt_zfs_log_device.empty()) {
+                add_zfs_log_device(opt_zfs_log_device.c_str());
+            }
             bsd_shrinker_init();
 
             boot_time.event("ZFS mounted");
@@ -436,7 +528,14 @@ void* do_main_thread(void *_main_args)
     });
     if (has_if) {
         if (opt_ip.size() == 0) {
-            dhcp_start(true);
+            if (!opt_dhcp_lease_cache.empty()) {
+                dhcp_set_lease_cache(opt_dhcp_lease_cache.c_str());
+            }
+            if (opt_dhcp_async) {
+                dhcp_start_background();
+            } else {
+                dhcp_start(true);
+            }
         } else {
             for (auto t : opt_ip) {
                 std::vector<std::string> tmp;
@@ -483,6 +582,17 @@ void* do_main_thread(void *_main_args)
         debug("chdir done\n");
     }
 
+    if (!opt_trace_stream.empty()) {
+        trace::start_stream(opt_trace_stream);
+    }
+
+    if (!opt_plt_hot.empty()) {
+        elf::get_program()->bind_plt_profile(opt_plt_hot);
+    }
+    if (!opt_plt_profile.empty()) {
+        elf::get_program()->record_plt_profile(opt_plt_profile);
+    }
+
     if (opt_leak) {
         debug("Enabling leak detector.\n");
         memory::tracker_enabled = true;
@@ -497,6 +607,7 @@ void* do_main_thread(void *_main_args)
 #endif /* !AARCH64_PORT_STUB */
 
     if (opt_bootchart) {
+        boot_time.app_phases = true;
         boot_time.print_chart();
     }
     else {
@@ -664,6 +775,11 @@ void main_cont(int loader_argc, char** loader_argv)
         prof::start_sampler(config);
     }
 #endif /* !AARCH64_PORT_STUB */
+    if (opt_enable_profiler) {
+        prof::profiler_config config;
+        config.period = std::chrono::nanoseconds(1000000000 / profiler_frequency);
+        prof::start_profiler(config);
+    }
 
     // multiple programs can be run -> separate their arguments
 
@@ -13,6 +13,10 @@
 #include <osv/sched.hh>
 #include <osv/firmware.hh>
 #include <osv/hypervisor.hh>
+#include <osv/devstat.h>
+#include <osv/perf.hh>
+#include <vector>
+#include <sstream>
 
 namespace httpserver {
 
@@ -24,6 +28,37 @@ using namespace std;
 using namespace json;
 using namespace hardware_json;
 
+static void fill_block_dev_stat(BlockDevStat& bs, const struct devstat_info& st)
+{
+    bs.name = st.name;
+    bs.read_ops = st.ops[DEVSTAT_READ];
+    bs.read_errors = st.errors[DEVSTAT_READ];
+    bs.read_bytes = st.bytes[DEVSTAT_READ];
+    bs.read_merged = st.merged[DEVSTAT_READ];
+    bs.read_time_us = st.time_ns[DEVSTAT_READ] / 1000;
+    bs.read_p50_us = devstat_percentile(st.latency[DEVSTAT_READ], 50);
+    bs.read_p99_us = devstat_percentile(st.latency[DEVSTAT_READ], 99);
+    bs.write_ops = st.ops[DEVSTAT_WRITE];
+    bs.write_errors = st.errors[DEVSTAT_WRITE];
+    bs.write_bytes = st.bytes[DEVSTAT_WRITE];
+    bs.write_merged = st.merged[DEVSTAT_WRITE];
+    bs.write_time_us = st.time_ns[DEVSTAT_WRITE] / 1000;
+    bs.write_p50_us = devstat_percentile(st.latency[DEVSTAT_WRITE], 50);
+    bs.write_p99_us = devstat_percentile(st.latency[DEVSTAT_WRITE], 99);
+    bs.flush_ops = st.ops[DEVSTAT_FLUSH];
+    bs.flush_errors = st.errors[DEVSTAT_FLUSH];
+    bs.flush_time_us = st.time_ns[DEVSTAT_FLUSH] / 1000;
+    bs.flush_p50_us = devstat_percentile(st.latency[DEVSTAT_FLUSH], 50);
+    bs.flush_p99_us = devstat_percentile(st.latency[DEVSTAT_FLUSH], 99);
+    bs.inflight = st.inflight;
+    bs.split = st.split;
+    for (int b = 0; b < DEVSTAT_LAT_BUCKETS; b++) {
+        bs.read_latency_us.push(st.latency[DEVSTAT_READ][b]);
+        bs.write_latency_us.push(st.latency[DEVSTAT_WRITE][b]);
+        bs.flush_latency_us.push(st.latency[DEVSTAT_FLUSH][b]);
+    }
+}
+
 #if !defined(MONITORING)
 extern "C" void httpserver_plugin_register_routes(httpserver::routes* routes) {
     httpserver::api::hardware::init(*routes);
@@ -51,6 +86,75 @@ void init(routes& routes)
     hypervisor_name.set_handler([](const_req) {
         return osv::hypervisor_name();
     });
+
+    getBlockDevStat.set_handler([](const_req req)
+    {
+        auto name = req.param.at("device").substr(1);
+        struct devinfo info = {};
+        struct devstat_info st;
+        while (!devstat_info(&info, &st)) {
+            if (name == st.name) {
+                BlockDevStat bs;
+                fill_block_dev_stat(bs, st);
+                return bs;
+            }
+        }
+        throw not_found_exception("device does not exist");
+    });
+
+    listBlockDevStats.set_handler([](const_req req)
+    {
+        vector<BlockDevStat> res;
+        struct devinfo info = {};
+        struct devstat_info st;
+        while (!devstat_info(&info, &st)) {
+            BlockDevStat bs;
+            fill_block_dev_stat(bs, st);
+            res.push_back(bs);
+        }
+        return res;
+    });
+
+    getPmuCounters.set_handler([](const_req req)
+    {
+        if (!pmu::counters()) {
+            throw bad_request_exception("No PMU");
+        }
+        vector<pmu::event> events;
+        auto names = req.get_query_param("events");
+        stringstream ss(names.empty() ? "cycles,instructions" : names);
+        string name;
+        while (getline(ss, name, ',')) {
+            unsigned e = 0;
+            while (e < unsigned(pmu::event::count) && name != pmu::event_name(pmu::event(e))) {
+                e++;
+            }
+            if (e == unsigned(pmu::event::count) || !pmu::supported(pmu::event(e))) {
+                throw bad_param_exception("Unsupported event " + name);
+            }
+            events.push_back(pmu::event(e));
+        }
+        auto ms = req.get_query_param("duration_ms");
+        auto duration = chrono::milliseconds(ms.empty() ? 1000 : stoul(ms));
+        if (duration > chrono::seconds(60)) {
+            throw bad_param_exception("Duration too long. Maximum is 60000 ms");
+        }
+
+        auto counts = perf::measure_cpus(events, duration);
+        vector<PmuCpuCounts> res;
+        for (unsigned cpu = 0; cpu < sched::cpus.size(); cpu++) {
+            PmuCpuCounts c;
+            c.cpu = cpu;
+            for (unsigned i = 0; i < events.size(); i++) {
+                PmuCount pc;
+                pc.event = pmu::event_name(events[i]);
+                pc.count = counts[i][cpu];
+                c.counts.push(pc);
+            }
+            res.push_back(c);
+        }
+        return res;
+    });
 }
 
 }
@@ -14,6 +14,7 @@
 #include <algorithm>
 #include <cctype>
 #include <fstream>
+#include <sstream>
 #include <sys/stat.h>
 #include <osv/tracecontrol.hh>
 #include <osv/sampler.hh>
@@ -99,6 +100,46 @@ void httpserver::api::trace::init(routes & routes)
         return "Sampler started successfully";
     });
 
+    trace_json::setProfilerState.set_handler([](const_req req) {
+        auto freq = std::stoi(req.get_query_param("freq"));
+        if (freq == 0) {
+            prof::stop_profiler();
+            return "Profiler stopped successfully";
+        }
+
+        const int max_frequency = 10000;
+        if (freq < 0 || freq > max_frequency) {
+            throw bad_request_exception("Bad frequency. Maximum is " + std::to_string(max_frequency));
+        }
+
+        prof::profiler_config config;
+        config.period = std::chrono::nanoseconds(1000000000 / freq);
+        std::stringstream threads(req.get_query_param("threads"));
+        std::string id;
+        while (std::getline(threads, id, ',')) {
+            if (!id.empty()) {
+                config.threads.push_back(std::stoul(id));
+            }
+        }
+        config.app = req.get_query_param("app");
+        const auto stacks = req.get_query_param("stacks");
+        if (!stacks.empty()) {
+            config.stacks = std::stoul(stacks);
+        }
+        const auto cycles = req.get_query_param("cycles");
+        if (!cycles.empty()) {
+            config.cycles = std::stoull(cycles);
+        }
+        prof::start_profiler(config);
+        return "Profiler started successfully";
+    });
+
+    trace_json::getProfile.set_handler("txt", [](const_req req) {
+        std::ostringstream out;
+        prof::write_folded_stacks(out, str2bool(req.get_query_param("reset")));
+        return out.str();
+    });
+
     class create_trace_dump_file {
     public:
         create_trace_dump_file()
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "zfs.hh"
+#include "json/formatter.hh"
+#include "autogen/zfs.json.hh"
+#include <osv/zfs_stats.h>
+#include <osv/clock.hh>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+namespace httpserver {
+
+namespace api {
+
+namespace zfs {
+
+using namespace std;
+using namespace json;
+using namespace zfs_json;
+
+static long time_ms()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>
+        (osv::clock::wall::now().time_since_epoch()).count();
+}
+
+static void fill_vdev_iostat(VdevIOStat& vdev, const struct zfs_vdev_iostat& vs)
+{
+    vdev.name = vs.name;
+    vdev.level = vs.level;
+    vdev.read_ops = vs.read_ops;
+    vdev.write_ops = vs.write_ops;
+    vdev.read_bytes = vs.read_bytes;
+    vdev.write_bytes = vs.write_bytes;
+    vdev.queued = vs.queued;
+    vdev.pending = vs.pending;
+    for (int i = 0; i < ZFS_LAT_BUCKETS; i++) {
+        vdev.read_latency_us.push(vs.read_latency[i]);
+        vdev.write_latency_us.push(vs.write_latency[i]);
+    }
+}
+
+#if !defined(MONITORING)
+extern "C" void httpserver_plugin_register_routes(httpserver::routes* routes) {
+    httpserver::api::zfs::init(*routes);
+}
+#endif
+
+void init(routes& routes)
+{
+    zfs_json_init_path("ZFS API");
+
+    getARCStats.set_handler([](const_req req)
+    {
+        // The kstat is read under a lock: copy it out, and format afterwards
+        unordered_map<string, uint64_t> stats;
+        if (kstat_read("zfs", "arcstats", [](const char* name, uint64_t value, void* arg) {
+                (*static_cast<unordered_map<string, uint64_t>*>(arg))[name] = value;
+            }, &stats) != 0) {
+            throw not_found_exception("ZFS is not in use");
+        }
+
+        ARCStats arc;
+        arc.time_ms = time_ms();
+        arc.hits = stats["hits"];
+        arc.misses = stats["misses"];
+        auto lookups = stats["hits"] + stats["misses"];
+        arc.hit_ratio = lookups ? double(stats["hits"]) / lookups : 0;
+        arc.demand_data_hits = stats["demand_data_hits"];
+        arc.demand_data_misses = stats["demand_data_misses"];
+        arc.demand_metadata_hits = stats["demand_metadata_hits"];
+        arc.demand_metadata_misses = stats["demand_metadata_misses"];
+        arc.prefetch_data_hits = stats["prefetch_data_hits"];
+        arc.prefetch_data_misses = stats["prefetch_data_misses"];
+        arc.prefetch_metadata_hits = stats["prefetch_metadata_hits"];
+        arc.prefetch_metadata_misses = stats["prefetch_metadata_misses"];
+        arc.mru_hits = stats["mru_hits"];
+        arc.mru_ghost_hits = stats["mru_ghost_hits"];
+        arc.mfu_hits = stats["mfu_hits"];
+        arc.mfu_ghost_hits = stats["mfu_ghost_hits"];
+        arc.size = stats["size"];
+        arc.target_size = stats["c"];
+        arc.min_size = stats["c_min"];
+        arc.max_size = stats["c_max"];
+        arc.mru_size = stats["p"];
+        arc.data_size = stats["data_size"];
+        arc.hdr_size = stats["hdr_size"];
+        arc.other_size = stats["other_size"];
+        arc.compressed_size = stats["compressed_size"];
+        arc.uncompressed_size = stats["uncompressed_size"];
+        arc.deleted = stats["deleted"];
+        arc.evict_skip = stats["evict_skip"];
+        arc.mutex_miss = stats["mutex_miss"];
+        arc.recycle_miss = stats["recycle_miss"];
+        arc.memory_throttle_count = stats["memory_throttle_count"];
+        return arc;
+    });
+
+    getPoolIOStat.set_handler([](const_req req)
+    {
+        PoolIOStat pool;
+        pool.name = req.param.at("pool").substr(1);
+        pool.time_ms = time_ms();
+        if (zfs_pool_iostat(pool.name().c_str(),
+                [](const struct zfs_vdev_iostat* vs, void* arg) {
+                    VdevIOStat vdev;
+                    fill_vdev_iostat(vdev, *vs);
+                    static_cast<PoolIOStat*>(arg)->vdevs.push(vdev);
+                }, &pool) != 0) {
+            throw not_found_exception("pool does not exist");
+        }
+        return pool;
+    });
+}
+
+}
+}
+}
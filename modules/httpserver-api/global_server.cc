@@ -27,6 +27,7 @@
 #include "api/hardware.hh"
 #include "api/api.hh"
 #include "api/env.hh"
+#include "api/zfs.hh"
 #endif
 
 namespace httpserver {
@@ -206,6 +207,7 @@ void global_server::set_routes()
     httpserver::api::hardware::init(_routes);
     httpserver::api::env::init(_routes);
     httpserver::api::file::init(_routes);
+    httpserver::api::zfs::init(_routes);
 #endif
     {
         namespace fs = boost::filesystem;
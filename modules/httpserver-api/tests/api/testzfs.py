@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+import basetest
+
+class testzfs(basetest.Basetest):
+    def test_arc(self):
+        path = self.path_by_nick(self.zfs_api, "getARCStats")
+        arc = self.curl(path)
+        self.assertGreater(arc["hits"] + arc["misses"], 0)
+        self.assertGreaterEqual(arc["hit_ratio"], 0)
+        self.assertLessEqual(arc["hit_ratio"], 1)
+        self.assertGreater(arc["size"], 0)
+        self.assertGreaterEqual(arc["max_size"], arc["min_size"])
+
+    def test_pool_iostat(self):
+        pool = self.curl("/zfs/iostat/osv")
+        self.assertEqual(pool["name"], "osv")
+        root = pool["vdevs"][0]
+        self.assertEqual(root["name"], "osv")
+        self.assertEqual(root["level"], 0)
+        self.assertGreater(root["read_ops"], 0)
+        leaves = [v for v in pool["vdevs"] if v["name"].startswith("/dev/")]
+        self.assertGreater(len(leaves), 0)
+        self.assertEqual(len(leaves[0]["read_latency_us"]), 24)
+        self.assertGreater(sum(leaves[0]["read_latency_us"]), 0)
+
+    def test_pool_not_found(self):
+        self.assertHttpError("/zfs/iostat/nosuchpool")
+
+    @classmethod
+    def setUpClass(cls):
+        cls.zfs_api = cls.get_json_api("zfs.json")
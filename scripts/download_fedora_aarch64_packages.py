@@ -14,14 +14,18 @@ def aarch64_download(version):
     boost_packages = ['boost-devel',
                       'boost-static',
                       'boost-system']
+    zstd_packages = ['libzstd-devel',
+                     'libzstd-static']
     osv_root = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
     script_path = '%s/scripts/download_rpm_package.sh' % osv_root
     destination = '%s/build/downloaded_packages/aarch64' % osv_root
 
     install_commands = ['%s %s %s %s/gcc' % (script_path, package, version, destination) for package in gcc_packages]
     install_commands += ['%s %s %s %s/boost' % (script_path, package, version, destination) for package in boost_packages]
+    install_commands += ['%s %s %s %s/zstd' % (script_path, package, version, destination) for package in zstd_packages]
     install_commands = ['rm -rf %s/gcc/install' % destination,
-                        'rm -rf %s/boost/install' % destination] + install_commands
+                        'rm -rf %s/boost/install' % destination,
+                        'rm -rf %s/zstd/install' % destination] + install_commands
     return ' && '.join(install_commands)
 
 (name, version) = linux_distribution()
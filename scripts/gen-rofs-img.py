@@ -47,6 +47,7 @@ import os, optparse, io
 from struct import *
 from ctypes import *
 from manifest_common import add_var, expand, unsymlink, read_manifest, defines, strip_file
+import prelink
 
 OSV_BLOCK_SIZE = 512
 
@@ -335,6 +336,64 @@ def parse_manifest(manifest):
 
     return file_dict
 
+# Returns the canonical image path of path, and the host file it comes from,
+# following the symbolic links in the manifest
+def resolve_path(manifest, path):
+    parts = []
+    rest = [p for p in path.split('/') if p]
+    links = 0
+    while rest:
+        part = rest.pop(0)
+        if part == '.':
+            continue
+        if part == '..':
+            parts = parts[:-1]
+            continue
+        node = manifest.get('')
+        for p in parts:
+            node = node.get(p)
+        val = node.get(part) if type(node) is dict else None
+        if val is None:
+            return None
+        if type(val) is str and val.startswith('->'):
+            links += 1
+            if links > 16:
+                return None
+            if val[2:].startswith('/'):
+                parts = []
+            rest = [p for p in val[2:].split('/') if p] + rest
+            continue
+        parts.append(part)
+    node = manifest.get('')
+    for p in parts:
+        node = node.get(p)
+    if type(node) is not str:
+        return None
+    return ('/' + '/'.join(parts), node)
+
+def add_prelink_files(manifest, apps, kernel, outdir):
+    if not os.path.exists(outdir):
+        os.makedirs(outdir)
+    for app in apps:
+        try:
+            result = prelink.prelink(lambda path: resolve_path(manifest, path), kernel, app)
+        except prelink.ElfError as e:
+            print('Not prelinking %s: %s' % (app, e))
+            continue
+        if not result:
+            print('Not prelinking %s: not found in the manifest' % app)
+            continue
+        path, data = result
+        hostname = os.path.join(outdir, path.strip('/').replace('/', '_') + '.prelink')
+        with open(hostname, 'wb') as f:
+            f.write(data)
+        p = manifest
+        tokens = (path + '.prelink').split('/')
+        for token in tokens[:-1]:
+            p = p.setdefault(token, {})
+        p[tokens[-1]] = hostname
+        print('Prelinked %s' % path)
+
 def main():
     make_option = optparse.make_option
 
@@ -353,6 +412,17 @@ def main():
                         metavar='VAR=DATA',
                         action='callback',
                         callback=add_var),
+            make_option('-P',
+                        dest='prelink',
+                        action='append',
+                        default=[],
+                        help='precompute the symbol bindings of the application PATH',
+                        metavar='PATH'),
+            make_option('-k',
+                        dest='kernel',
+                        default='loader.elf',
+                        help='kernel ELF file providing the core symbols for -P',
+                        metavar='FILE'),
     ])
 
     (options, args) = opt.parse_args()
@@ -363,6 +433,10 @@ def main():
 
     manifest = parse_manifest(manifest)
 
+    if options.prelink:
+        add_prelink_files(manifest, options.prelink, options.kernel,
+                          os.path.join(os.path.dirname(outfile), 'prelink'))
+
     gen_image(outfile, manifest)
 
 if __name__ == '__main__':
@@ -434,6 +434,14 @@ class osv_zfs(gdb.Command):
         print ("\tMax target size: %d (%d MB)" %
                (arc_max_size, arc_max_size / 1024 / 1024))
 
+        # Blocks kept compressed (vfs.zfs.arc_compressed)
+        arc_compressed_size = get_stat_by_name(arc_stats_struct, arc_stats_cast, 'arcstat_compressed_size')
+        arc_uncompressed_size = get_stat_by_name(arc_stats_struct, arc_stats_cast, 'arcstat_uncompressed_size')
+        if arc_compressed_size > 0:
+            print ("\tCompressed size: %d (%d MB), %d MB uncompressed" %
+                   (arc_compressed_size, arc_compressed_size / 1024 / 1024,
+                    arc_uncompressed_size / 1024 / 1024))
+
         print ("\n:: ARC SIZE BREAKDOWN ::")
         print ("\tMost recently used cache size:   %d (%d MB) (%.2f%%)" %
                (arc_mru_size, arc_mru_size / 1024 / 1024, arc_mru_perc))
@@ -2,6 +2,7 @@ import mmap
 import struct
 import heapq
 import bisect
+import time
 
 from osv import debug
 
@@ -349,6 +350,8 @@ class TraceDumpReaderBase :
             tag = self.read('I')
         except EOFError:
             return False
+        if tag == 0: # past the end of a stream written to a device
+            return False
         size = self.read('Q')
         if not self.readStruct(tag, size):
             self.file.seek(size, 1)
@@ -362,6 +365,7 @@ class TraceDumpReader(TraceDumpReaderBase) :
     def __init__(self, filename):
         self.tracepoints = {}
         self.trace_buffers = []
+        self.lost = {}
         TraceDumpReaderBase.__init__(self, filename)
 
     def readStruct(self, tag, size):
@@ -371,6 +375,10 @@ class TraceDumpReader(TraceDumpReaderBase) :
             data = self.file.read(size)
             self.trace_buffers.append(data)
             return True
+        elif tag == 0x5452434c: # 'TRCL'
+            cpu = self.read('I')
+            self.lost[cpu] = self.lost.get(cpu, 0) + self.read('Q')
+            return True
         else:
             return False
 
@@ -427,6 +435,66 @@ class TraceDumpReader(TraceDumpReaderBase) :
         return heapq.merge(*iters)
 
 
+class TraceStreamReader(TraceDumpReader):
+    """Reads a trace stream (OSv's --trace-stream) while it is being written.
+
+    traces() yields the traces of all the complete chunks found, sorted by
+    time, and with follow=True then waits for more chunks to be written
+    and does the same with them."""
+    def __init__(self, filename, follow=False, interval=0.5):
+        self.tracepoints = {}
+        self.trace_buffers = []
+        self.lost = {}
+        self.endian = '<'
+        self.follow = follow
+        self.interval = interval
+        self.file = open(filename, 'rb')
+        while not self.readHeader():
+            if not follow:
+                raise NotATraceDumpFile("Empty trace stream")
+            time.sleep(interval)
+
+    def readHeader(self):
+        header = self.file.read(24)
+        if len(header) < 24:
+            self.file.seek(0)
+            return False
+        tag, size, endian, version = struct.unpack('<4s4xQII', header)
+        if tag != b'TVSO' or endian != 1:
+            raise NotATraceDumpFile("Not a trace stream")
+        return True
+
+    # Like readStruct0(), but leaves incomplete chunks for a later call
+    def readChunk(self):
+        pos = self.file.tell()
+        start = align_up(pos, 8)
+        self.file.seek(start)
+        header = self.file.read(16)
+        if len(header) < 16:
+            self.file.seek(pos)
+            return False
+        tag, size = struct.unpack('<I4xQ', header)
+        if tag == 0 or len(self.file.read(size)) < size:
+            self.file.seek(pos)
+            return False
+        self.file.seek(start + 16)
+        if not self.readStruct(tag, size):
+            self.file.seek(size, 1)
+        return True
+
+    def traces(self):
+        while True:
+            self.trace_buffers = []
+            while self.readChunk():
+                pass
+            if self.trace_buffers:
+                for t in heapq.merge(*[self.oneTrace(data) for data in self.trace_buffers]):
+                    yield t
+            elif not self.follow:
+                return
+            else:
+                time.sleep(self.interval)
+
 class Symbol:
     def __init__(self, addr, size, name=None, filename=None, line=None):
         self.addr = addr
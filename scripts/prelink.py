@@ -0,0 +1,333 @@
+#!/usr/bin/python3
+
+#
+# Copyright (C) 2026 Cloudius Systems, Ltd.
+#
+# This work is open source software, licensed under the terms of the
+# BSD license as described in the LICENSE file in the top-level directory.
+#
+
+##################################################################################
+# Precomputes, at image build time, how the dynamic linker (core/elf.cc) will
+# bind the symbols of an application and of the shared objects it needs.
+#
+# For each application the load order of program::load_object() is replayed
+# on the image contents: the DT_NEEDED objects are loaded depth first, each
+# object is relocated after its own dependencies, and the libraries supplied
+# by the kernel resolve to the kernel, which stays last on the modules list.
+# For every dynamic symbol of every object we then record which module, and
+# which symbol in it, program::lookup() would return given the modules list
+# at that object's relocation time.
+#
+# The result is written next to the application as <app>.prelink:
+#
+#   "OSVPRELK" u32 version, u32 objects count, followed by for each object:
+#     string  path
+#     u32     modules count, and for each: string path, u64 symbols hash
+#     u32     bindings count, and for each dynamic symbol: u32 module, u32 symbol
+#
+# where a string is a u32 length followed by the characters, the kernel is the
+# module with an empty path and a module of 0xffffffff means the symbol is left
+# to the run time lookup. The symbols hash identifies the exact contents of a
+# module's .dynstr, .dynsym and versions table, so that the loader only uses
+# bindings computed against the very same objects in the very same order.
+##################################################################################
+
+import struct
+
+PT_LOAD = 1
+PT_DYNAMIC = 2
+
+DT_NULL = 0
+DT_NEEDED = 1
+DT_HASH = 4
+DT_STRTAB = 5
+DT_SYMTAB = 6
+DT_STRSZ = 10
+DT_SYMENT = 11
+DT_SONAME = 14
+DT_RPATH = 15
+DT_RUNPATH = 29
+DT_GNU_HASH = 0x6ffffef5
+DT_VERSYM = 0x6ffffff0
+
+STB_LOCAL = 0
+SHN_UNDEF = 0
+OLD_VERSION_SYMBOL_MASK = 1 << 15
+
+NO_BINDING = 0xffffffff
+MAGIC = b'OSVPRELK'
+VERSION = 1
+
+# Must match the supplied_modules list in program::program()
+SUPPLIED_MODULES = {
+    'libresolv.so.2',
+    'libc.so.6',
+    'libm.so.6',
+    'ld-linux-x86-64.so.2',
+    'libc.musl-x86_64.so.1',
+    'ld-linux-aarch64.so.1',
+    'libpthread.so.0',
+    'libdl.so.2',
+    'librt.so.1',
+    'libstdc++.so.6',
+    'libaio.so.1',
+    'libxenstore.so.3.0',
+    'libcrypt.so.1',
+}
+
+SEARCH_PATH = ['/', '/usr/lib']
+
+class ElfError(Exception):
+    pass
+
+def fnv1a_64(data, h=0xcbf29ce484222325):
+    for b in data:
+        h = ((h ^ b) * 0x100000001b3) & 0xffffffffffffffff
+    return h
+
+def dl_new_hash(name):
+    h = 5381
+    for c in name:
+        h = (h * 33 + c) & 0xffffffff
+    return h
+
+def elf64_hash(name):
+    h = 0
+    for c in name:
+        h = (h << 4) + c
+        g = h & 0xf0000000
+        if g:
+            h ^= g >> 24
+        h &= 0x0fffffff
+    return h
+
+class Elf(object):
+    def __init__(self, path, filename):
+        self.path = path
+        with open(filename, 'rb') as f:
+            self.data = f.read()
+        ident = self.data[:16]
+        if ident[:4] != b'\x7fELF' or ident[4] != 2 or ident[5] != 1:
+            raise ElfError('%s: not a little endian ELF64 file' % filename)
+        (e_phoff,) = struct.unpack_from('<Q', self.data, 32)
+        (e_phentsize, e_phnum) = struct.unpack_from('<HH', self.data, 54)
+
+        self.loads = []
+        dynamic = None
+        for i in range(e_phnum):
+            (p_type, _, p_offset, p_vaddr, _, p_filesz, _, _) = \
+                struct.unpack_from('<IIQQQQQQ', self.data, e_phoff + i * e_phentsize)
+            if p_type == PT_LOAD:
+                self.loads.append((p_vaddr, p_offset, p_filesz))
+            elif p_type == PT_DYNAMIC:
+                dynamic = (p_offset, p_filesz)
+        if dynamic is None:
+            raise ElfError('%s: no dynamic section' % filename)
+
+        self.dyn = {}
+        self.needed = []
+        offset, size = dynamic
+        for off in range(offset, offset + size, 16):
+            tag, val = struct.unpack_from('<qQ', self.data, off)
+            if tag == DT_NULL:
+                break
+            if tag == DT_NEEDED:
+                self.needed.append(val)
+            else:
+                self.dyn.setdefault(tag, val)
+        if self.dyn.get(DT_SYMENT, 24) != 24:
+            raise ElfError('%s: unexpected DT_SYMENT' % filename)
+        if DT_GNU_HASH not in self.dyn and DT_HASH not in self.dyn:
+            raise ElfError('%s: no symbol hash table' % filename)
+
+        self.tables = {}
+        self.strtab_off = self.offset(self.dyn[DT_STRTAB])
+        self.strtab = self.data[self.strtab_off:self.strtab_off + self.dyn[DT_STRSZ]]
+        self.symtab_off = self.offset(self.dyn[DT_SYMTAB])
+        self.nsyms = self.count_symbols()
+        self.symbols = [struct.unpack_from('<IBBHQQ', self.data, self.symtab_off + i * 24)
+                        for i in range(self.nsyms)]
+        self.versym = None
+        if DT_VERSYM in self.dyn:
+            off = self.offset(self.dyn[DT_VERSYM])
+            self.versym = struct.unpack_from('<%dH' % self.nsyms, self.data, off)
+        self.needed = [self.str(n) for n in self.needed]
+        self.soname = self.str(self.dyn[DT_SONAME]) if DT_SONAME in self.dyn else ''
+        self.hash = None
+
+    def offset(self, vaddr):
+        for (p_vaddr, p_offset, p_filesz) in self.loads:
+            if p_vaddr <= vaddr < p_vaddr + p_filesz:
+                return vaddr - p_vaddr + p_offset
+        raise ElfError('%s: address 0x%x is not in the file' % (self.path, vaddr))
+
+    def words(self, tag, off, count):
+        base = self.tables.get(tag)
+        if base is None:
+            base = self.tables[tag] = self.offset(self.dyn[tag])
+        return struct.unpack_from('<%dI' % count, self.data, base + 4 * off)
+
+    def str(self, off):
+        end = self.strtab.index(b'\0', off)
+        return self.strtab[off:end].decode()
+
+    def sym_name(self, idx):
+        off = self.symbols[idx][0]
+        return self.strtab[off:self.strtab.index(b'\0', off)]
+
+    # Same as object::symbols_hash(): the whole symbol table, not just the
+    # part covered by the GNU hash table
+    def count_symbols(self):
+        if DT_HASH in self.dyn:
+            return self.words(DT_HASH, 1, 1)[0]
+        nbucket, symndx, maskwords = self.words(DT_GNU_HASH, 0, 3)
+        buckets = self.words(DT_GNU_HASH, 4 + 2 * maskwords, nbucket)
+        chains_off = 4 + 2 * maskwords + nbucket - symndx
+        count = symndx
+        for idx in buckets:
+            if idx == 0:
+                continue
+            while True:
+                count += 1
+                if self.words(DT_GNU_HASH, chains_off + idx, 1)[0] & 1:
+                    break
+                idx += 1
+        return count
+
+    def symbols_hash(self):
+        if self.hash is None:
+            h = fnv1a_64(self.strtab)
+            h = fnv1a_64(self.data[self.symtab_off:self.symtab_off + self.nsyms * 24], h)
+            if self.versym is not None:
+                h = fnv1a_64(struct.pack('<%dH' % self.nsyms, *self.versym), h)
+            self.hash = h
+        return self.hash
+
+    # object::lookup_symbol(), returning a symbol index or None
+    def lookup(self, name, self_lookup):
+        if DT_GNU_HASH in self.dyn:
+            idx = self.lookup_gnu(name, self_lookup)
+        else:
+            idx = self.lookup_old(name)
+        if idx is not None and self.symbols[idx][3] == SHN_UNDEF:
+            idx = None
+        return idx
+
+    def lookup_gnu(self, name, self_lookup):
+        nbucket, symndx, maskwords, shift2 = self.words(DT_GNU_HASH, 0, 4)
+        hashval = dl_new_hash(name)
+        C = 64
+        bword_idx = (hashval // C) % maskwords
+        lo, hi = self.words(DT_GNU_HASH, 4 + 2 * bword_idx, 2)
+        bword = lo | (hi << 32)
+        if (bword >> (hashval % C)) == 0 or (bword >> ((hashval >> shift2) % C)) == 0:
+            return None
+        idx = self.words(DT_GNU_HASH, 4 + 2 * maskwords + hashval % nbucket, 1)[0]
+        if idx == 0:
+            return None
+        chains_off = 4 + 2 * maskwords + nbucket - symndx
+        versym = None if self_lookup else self.versym
+        while True:
+            chain = self.words(DT_GNU_HASH, chains_off + idx, 1)[0]
+            if (chain & ~1) == (hashval & ~1) and \
+                    not (versym and versym[idx] & OLD_VERSION_SYMBOL_MASK) and \
+                    self.sym_name(idx) == name:
+                return idx
+            if chain & 1:
+                return None
+            idx += 1
+
+    def lookup_old(self, name):
+        nbucket = self.words(DT_HASH, 0, 1)[0]
+        ent = self.words(DT_HASH, 2 + elf64_hash(name) % nbucket, 1)[0]
+        while ent != 0:
+            if self.sym_name(ent) == name:
+                return ent
+            ent = self.words(DT_HASH, 2 + nbucket + ent, 1)[0]
+        return None
+
+class Loader(object):
+    """Replays program::load_object() for one application.
+
+    resolve(path) returns the canonical image path of path, and the host file
+    holding it, or None if the image has no such file.
+    """
+    def __init__(self, resolve, kernel):
+        self.resolve = resolve
+        self.kernel = kernel
+        self.modules = [kernel]
+        self.files = dict((name, kernel) for name in SUPPLIED_MODULES)
+        self.objects = []
+
+    def load(self, name, extra_path=[]):
+        if name in self.files:
+            return self.files[name]
+        found = None
+        if '/' not in name:
+            for d in extra_path + SEARCH_PATH:
+                found = self.resolve(d + '/' + name)
+                if found:
+                    break
+        elif name.startswith('/'):
+            found = self.resolve(name)
+        if not found:
+            return None
+        path, hostname = found
+        if path in self.files:
+            return self.files[path]
+        obj = Elf(path, hostname)
+        self.modules.insert(len(self.modules) - 1, obj)
+        rpath = obj.dyn.get(DT_RUNPATH, obj.dyn.get(DT_RPATH))
+        rpath = obj.str(rpath).replace('$ORIGIN', path.rsplit('/', 1)[0]).split(':') if rpath else []
+        for lib in obj.needed:
+            self.load(lib, rpath)
+        self.objects.append((obj, list(self.modules)))
+        self.files[path] = obj
+        self.files[obj.soname] = obj
+        return obj
+
+def bind(obj, modules):
+    # program::lookup() emulation, by symbol name, of all of obj's symbols
+    bindings = []
+    for idx, sym in enumerate(obj.symbols):
+        binding = (NO_BINDING, 0)
+        if idx > 0 and (sym[1] >> 4) != STB_LOCAL:
+            name = obj.sym_name(idx)
+            for pos, module in enumerate(modules):
+                found = module.lookup(name, module is obj)
+                if found is not None:
+                    binding = (pos, found)
+                    break
+        bindings.append(binding)
+    return bindings
+
+def pack_str(s):
+    s = s.encode()
+    return struct.pack('<I', len(s)) + s
+
+def prelink(resolve, kernel_file, app):
+    """Returns the canonical image path of app and the contents of its
+    .prelink file, or None if the app can't be prelinked."""
+    found = resolve(app)
+    if not found:
+        return None
+    kernel = Elf('', kernel_file)
+    loader = Loader(resolve, kernel)
+    # application::prepare_argv() loads libvdso.so ahead of the application
+    loader.load('libvdso.so')
+    vdso_objects = len(loader.objects)
+    if not loader.load(found[0]):
+        return None
+    objects = loader.objects[vdso_objects:]
+
+    out = [MAGIC, struct.pack('<II', VERSION, len(objects))]
+    for obj, modules in objects:
+        out.append(pack_str(obj.path))
+        out.append(struct.pack('<I', len(modules)))
+        for module in modules:
+            out.append(pack_str(module.path) + struct.pack('<Q', module.symbols_hash()))
+        bindings = bind(obj, modules)
+        out.append(struct.pack('<I', len(bindings)))
+        out.extend(struct.pack('<II', *b) for b in bindings)
+    return (found[0], b''.join(out))
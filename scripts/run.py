@@ -167,6 +167,12 @@ def start_osv_qemu(options):
         "-device", "virtio-blk-pci,id=blk0,drive=hd0,scsi=off%s%s" % (boot_index, options.virtio_device_suffix),
         "-drive", "file=%s,if=none,id=hd0,%s" % (options.image_file, aio)]
 
+    # Ahead of the cloud-init image, so that it is always /dev/vblk1
+    if options.log_image:
+        args += [
+        "-device", "virtio-blk-pci,id=blk2,drive=hd2,scsi=off%s" % options.virtio_device_suffix,
+        "-drive", "file=%s,if=none,id=hd2,%s" % (options.log_image, aio)]
+
     if options.cloud_init_image:
         args += [
         "-device", "virtio-blk-pci,id=blk1,bootindex=1,drive=hd1,scsi=off%s" % options.virtio_device_suffix,
@@ -569,6 +575,8 @@ if __name__ == "__main__":
                         help="XEN define configuration script for vif")
     parser.add_argument("--cloud-init-image", action="store",
                         help="Path to the optional cloud-init image that should be attached to the instance")
+    parser.add_argument("--log-image", action="store",
+                        help="Path to the optional disk image attached as /dev/vblk1, for a separate ZFS intent log")
     parser.add_argument("-k", "--kernel", action="store_true",
                         help="Run OSv in QEMU kernel mode as PVH.")
     parser.add_argument("--kernel-path", action="store",
@@ -590,6 +598,10 @@ if __name__ == "__main__":
         cmdargs.kernel_file = os.path.abspath(cmdargs.kernel_path or os.path.join(osv_base, "build/%s/kernel.elf" % cmdargs.opt_path))
     if not os.path.exists(cmdargs.image_file):
         raise Exception('Image file %s does not exist.' % cmdargs.image_file)
+    if cmdargs.log_image:
+        cmdargs.log_image = os.path.abspath(cmdargs.log_image)
+        if not os.path.exists(cmdargs.log_image):
+            raise Exception('Log image %s does not exist.' % cmdargs.log_image)
     if cmdargs.cloud_init_image:
         cmdargs.cloud_init_image = os.path.abspath(cmdargs.cloud_init_image)
         if not os.path.exists(cmdargs.cloud_init_image):
@@ -43,6 +43,9 @@ class Fedora(object):
                 'libstdc++-static',
                 'libtool',
                 'libvirt',
+                'lz4-devel',
+                'libzstd-devel',
+                'libzstd-static',
                 'make',
                 'maven',
                 'maven-shade-plugin',
@@ -177,6 +180,8 @@ class Debian(object):
                 'libssl-dev',
                 'libtool',
                 'libyaml-cpp-dev',
+                'liblz4-dev',
+                'libzstd-dev',
                 'make',
                 'maven',
                 'openssl',
@@ -234,6 +239,8 @@ class Ubuntu(object):
                 'libssl-dev',
                 'libtool',
                 'libyaml-cpp-dev',
+                'liblz4-dev',
+                'libzstd-dev',
                 'make',
                 'maven',
                 'openssl',
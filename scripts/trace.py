@@ -624,10 +624,27 @@ def convert_dump(args):
         print("Converting dump %s -> %s" % (args.dumpfile, args.tracefile))
         td = trace.TraceDumpReader(args.dumpfile)
         trace.write_to_file(args.tracefile, list(td.traces()))
+        print_lost(td)
     else:
         print("error: %s not found" % (args.dumpfile))
         sys.exit(1)
 
+def print_lost(reader):
+    for cpu, size in sorted(reader.lost.items()):
+        sys.stderr.write("warning: cpu %d lost %d bytes of traces\n" % (cpu, size))
+
+def stream_trace(args):
+    backtrace_formatter = get_backtrace_formatter(args)
+    reader = trace.TraceStreamReader(args.streamfile, follow=args.follow)
+    try:
+        for t in reader.traces():
+            print(t.format(backtrace_formatter))
+            if args.follow:
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    print_lost(reader)
+
 def download_dump(args):
     if os.path.exists(args.tracefile):
         os.remove(args.tracefile)
@@ -783,6 +800,18 @@ if __name__ == "__main__":
                                   default="buffers")
     cmd_convert_dump.set_defaults(func=convert_dump, paginate=False)
 
+    cmd_stream = subparsers.add_parser("stream", help="list a trace stream"
+                                       , description="""
+                                       Lists the traces of a trace stream written with OSv's --trace-stream,
+                                       as a file or device. 'convert-dump -f <stream>' converts it as a whole.
+                                       """)
+    cmd_stream.add_argument("streamfile", help="path to the trace stream")
+    cmd_stream.add_argument("-f", "--follow", action="store_true",
+                            help="keep listing the traces appended to the stream")
+    cmd_stream.add_argument("-b", "--backtrace", action="store_true", help="show backtrace")
+    add_symbol_resolution_options(cmd_stream)
+    cmd_stream.set_defaults(func=stream_trace, paginate=False)
+
     cmd_download_dump = subparsers.add_parser("download", help="download trace dump file (REST)"
                                              , description="""
                                              Downloads a trace dump via REST Api
@@ -137,7 +137,18 @@ def main():
             make_option('-k',
                         dest='kernel',
                         action='store_true',
-                        help='run OSv in direct kernel mode')
+                        help='run OSv in direct kernel mode'),
+            make_option('-c',
+                        dest='compression',
+                        help='compress the files with ALGO (e.g. lz4, zstd-19)',
+                        metavar='ALGO',
+                        default='lz4'),
+            make_option('-l',
+                        dest='log_image',
+                        help='keep the ZFS intent log on the disk image FILE, '
+                             'which has to be attached as /dev/vblk1 at run time too',
+                        metavar='FILE',
+                        default=None)
     ])
 
     (options, args) = opt.parse_args()
@@ -155,7 +166,11 @@ def main():
         kernel_mode_flag = '-k --kernel-path build/release/loader-stripped.elf'
     else:
         kernel_mode_flag = ''
-    osv = subprocess.Popen('cd ../..; scripts/run.py %s --vnc none -m 512 -c1 -i "%s" --block-device-cache unsafe -s -e "--nomount --noinit /tools/mkfs.so; /tools/cpiod.so --prefix /zfs/zfs/; /zfs.so set compression=off osv" --forward tcp:127.0.0.1:%s-:10000' % (kernel_mode_flag,image_path,upload_port), shell=True, stdout=subprocess.PIPE)
+    mkfs_args = options.compression
+    if options.log_image:
+        kernel_mode_flag += ' --log-image "%s"' % os.path.abspath(options.log_image)
+        mkfs_args += ' --log /dev/vblk1'
+    osv = subprocess.Popen('cd ../..; scripts/run.py %s --vnc none -m 512 -c1 -i "%s" --block-device-cache unsafe -s -e "--nomount --noinit /tools/mkfs.so %s; /tools/cpiod.so --prefix /zfs/zfs/; /zfs.so set compression=off osv" --forward tcp:127.0.0.1:%s-:10000' % (kernel_mode_flag,image_path,mkfs_args,upload_port), shell=True, stdout=subprocess.PIPE)
 
     upload(osv, manifest, depends, upload_port)
 
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Loaded by tst-plt-profile.cc. Each function calls through a PLT entry of
+// its own; tst_plt_profile_missing() is defined nowhere, so its entry can
+// only be left to lazy binding, and must never be called.
+
+#include <unistd.h>
+
+extern "C" int tst_plt_profile_missing();
+
+extern "C" int lib_hot()
+{
+    return getpid();
+}
+
+extern "C" int lib_lazy()
+{
+    return getppid();
+}
+
+extern "C" int lib_missing()
+{
+    return tst_plt_profile_missing();
+}
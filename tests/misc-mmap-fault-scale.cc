@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Measures how page faults on file mappings scale with the number of
+// faulting threads. Each thread maps the same file on its own, so that every
+// page touched is a fault, served from the page cache after the first pass.
+//
+// Usage: misc-mmap-fault-scale.so [file size in MB]
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include <sys/mman.h>
+
+#include <fcntl.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PAGE_SIZE (4 << 10)
+#define FNAME "/tmp/mmap-fault-scale"
+
+static char ch(unsigned long i)
+{
+    return '@' + (i % ('}' - '@'));
+}
+
+// Touches every page of a fresh mapping of the file. Read passes check the
+// contents; write passes dirty the thread's own slice of a shared mapping.
+static void fault_pass(int fd, unsigned long pages, bool write,
+                       unsigned thread, unsigned nthreads)
+{
+    auto prot = write ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *ret = mmap(nullptr, pages * PAGE_SIZE, prot, MAP_SHARED, fd, 0);
+    assert(ret != MAP_FAILED);
+    auto base = static_cast<char *>(ret);
+
+    if (write) {
+        auto slice = pages / nthreads;
+        for (unsigned long i = thread * slice; i < (thread + 1) * slice; ++i) {
+            base[i * PAGE_SIZE] = ch(i);
+        }
+    } else {
+        // start at different offsets, so the threads don't walk in lockstep
+        for (unsigned long j = 0; j < pages; ++j) {
+            auto i = (j + thread * pages / nthreads) % pages;
+            assert(base[i * PAGE_SIZE] == ch(i));
+        }
+    }
+
+    munmap(base, pages * PAGE_SIZE);
+}
+
+static void run(const char *phase, int fd, unsigned long pages, bool write,
+                unsigned nthreads)
+{
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (unsigned t = 0; t < nthreads; t++) {
+        threads.emplace_back([=] { fault_pass(fd, pages, write, t, nthreads); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    auto faults = write ? pages : pages * nthreads;
+    std::cout << phase << " " << nthreads << " threads: "
+              << float(usec) * nthreads / faults << " usec / fault, "
+              << (faults * 1000000.0 / usec) / 1000 << "k faults / sec\n";
+}
+
+int main(int ac, char** av)
+{
+    unsigned long mb = ac > 1 ? atol(av[1]) : 64;
+    unsigned long pages = (mb << 20) / PAGE_SIZE;
+    unsigned ncpus = std::thread::hardware_concurrency();
+    static char buf[PAGE_SIZE];
+
+    int fd = open(FNAME, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    assert(fd >= 0);
+    for (unsigned long i = 0; i < pages; ++i) {
+        memset(buf, ch(i), PAGE_SIZE);
+        assert(write(fd, buf, PAGE_SIZE) == PAGE_SIZE);
+    }
+    std::cout << "Wrote " << mb << " Mb\n";
+
+    // warm the cache, so the timed passes measure the faults themselves
+    fault_pass(fd, pages, false, 0, 1);
+
+    for (unsigned n = 1; n <= ncpus; n *= 2) {
+        run("Read faults", fd, pages, false, n);
+    }
+    for (unsigned n = 1; n <= ncpus; n *= 2) {
+        run("Write faults", fd, pages, true, n);
+    }
+
+    close(fd);
+    unlink(FNAME);
+
+    std::cout << "PASSED\n";
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Compares the implementations of the ZFS block checksums available on
+// this CPU: checks they agree, and prints the throughput of each.
+
+#include <osv/checksum.hh>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace osv::checksum;
+
+static constexpr size_t block_size = 128 << 10;
+static constexpr int loops = 2000;
+
+template <typename Fn>
+static double throughput(Fn fn)
+{
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < loops; i++) {
+        fn();
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> sec = t2 - t1;
+    return double(block_size) * loops / sec.count() / (1 << 20);
+}
+
+static bool bench_fletcher_4(const char *what,
+                             const std::vector<variant<fletcher_4_fn>>& variants,
+                             const std::vector<char>& buf)
+{
+    bool ok = true;
+    uint64_t ref[4];
+    variants[0].fn(buf.data(), buf.size(), ref);
+    for (auto& v : variants) {
+        uint64_t cksum[4];
+        v.fn(buf.data(), buf.size(), cksum);
+        if (memcmp(cksum, ref, sizeof(ref))) {
+            printf("%s %s: wrong checksum\n", what, v.name);
+            ok = false;
+            continue;
+        }
+        auto mbs = throughput([&] { v.fn(buf.data(), buf.size(), cksum); });
+        printf("%s %-8s %10.1f MB/s\n", what, v.name, mbs);
+    }
+    return ok;
+}
+
+static bool bench_sha256(const std::vector<char>& buf)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    auto variants = sha256_variants();
+    auto nblocks = buf.size() / 64;
+    bool ok = true;
+    uint32_t ref[8];
+    memcpy(ref, init, sizeof(ref));
+    variants[0].fn(ref, buf.data(), nblocks);
+    for (auto& v : variants) {
+        uint32_t state[8];
+        memcpy(state, init, sizeof(state));
+        v.fn(state, buf.data(), nblocks);
+        if (memcmp(state, ref, sizeof(ref))) {
+            printf("sha256 %s: wrong digest\n", v.name);
+            ok = false;
+            continue;
+        }
+        auto mbs = throughput([&] { v.fn(state, buf.data(), nblocks); });
+        printf("sha256 %-8s %10.1f MB/s\n", v.name, mbs);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<char> buf(block_size);
+    for (auto& c : buf) {
+        c = rand();
+    }
+
+    bool ok = bench_fletcher_4("fletcher4", fletcher_4_native_variants(), buf);
+    ok &= bench_fletcher_4("fletcher4-bswap", fletcher_4_byteswap_variants(), buf);
+    ok &= bench_sha256(buf);
+    return ok ? 0 : 1;
+}
@@ -110,6 +110,44 @@ static int test_mmap_with_file_removed()
     return 0;
 }
 
+// The background flusher marks the pages it writes back clean before the
+// write reaches the file, so msync() racing with it must still wait for the
+// data to get there. Dirty enough pages for the flusher to write back all
+// of them, and msync() at various points of its one second period.
+static int test_msync_during_flush()
+{
+    constexpr size_t size = 8 << 20;
+    constexpr size_t page_size = 4096;
+    auto fd = open("/tmp/mmap-file-flush", O_CREAT|O_TRUNC|O_RDWR, 0666);
+    assert(fd != -1);
+    assert(ftruncate(fd, size) == 0);
+    auto* p = reinterpret_cast<unsigned*>(mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+    assert(p != MAP_FAILED);
+
+    bool ok = true;
+    for (unsigned round = 1; ok && round <= 20; round++) {
+        for (size_t off = 0; off < size; off += page_size) {
+            p[off / sizeof(*p)] = round;
+        }
+        usleep((round % 10) * 100000);
+        assert(msync(p, size, MS_SYNC) == 0);
+        for (size_t off = 0; ok && off < size; off += page_size) {
+            unsigned v;
+            assert(pread(fd, &v, sizeof(v), off) == sizeof(v));
+            if (v != round) {
+                printf("round %u: read %u at offset %zu\n", round, v, off);
+                ok = false;
+            }
+        }
+    }
+
+    munmap(p, size);
+    close(fd);
+    unlink("/tmp/mmap-file-flush");
+    report(ok, "msync while the flusher writes the pages back");
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     auto fd = open("/tmp/mmap-file-test", O_CREAT|O_TRUNC|O_RDWR, 0666);
@@ -173,6 +211,7 @@ int main(int argc, char *argv[])
     report(close(fd) == 0, "close again");
 
     test_mmap_with_file_removed();
+    test_msync_during_flush();
 
     // TODO: map an append-only file with prot asking for PROT_WRITE, mmap should return EACCES.
     // TODO: map a file under a fs mounted with the flag NO_EXEC and prot asked for PROT_EXEC (expect EPERM).
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <iostream>
+
+static int tests = 0, fails = 0;
+
+static void report(bool ok, const char* msg)
+{
+    ++tests;
+    if (!ok) {
+        ++fails;
+    }
+    std::cout << (ok ? "PASS: " : "FAIL: ") << msg << "\n";
+}
+
+static int open_counter(uint64_t config, pid_t pid, int cpu, bool disabled,
+                        uint64_t read_format = 0, uint64_t sample_period = 0)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = disabled;
+    attr.read_format = read_format;
+    attr.sample_period = sample_period;
+    return syscall(__NR_perf_event_open, &attr, pid, cpu, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+static uint64_t read_count(int fd)
+{
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return uint64_t(-1);
+    }
+    return count;
+}
+
+static void __attribute__((noinline)) work(unsigned long iterations)
+{
+    for (unsigned long i = 0; i < iterations; i++) {
+        asm volatile("" ::: "memory");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int fd = open_counter(PERF_COUNT_HW_INSTRUCTIONS, 0, -1, true);
+    if (fd < 0 && errno == ENOENT) {
+        std::cout << "No PMU, skipping\n";
+        return 0;
+    }
+    report(fd >= 0, "open an instructions counter of the current thread");
+
+    work(1000000);
+    report(read_count(fd) == 0, "a disabled counter does not count");
+
+    report(ioctl(fd, PERF_EVENT_IOC_ENABLE, 0) == 0, "enable");
+    work(10000000);
+    report(ioctl(fd, PERF_EVENT_IOC_DISABLE, 0) == 0, "disable");
+    auto count = read_count(fd);
+    report(count >= 10000000, "the loop's instructions are counted");
+    work(1000000);
+    report(read_count(fd) == count, "a disabled counter stops counting");
+
+    report(ioctl(fd, PERF_EVENT_IOC_RESET, 0) == 0, "reset");
+    report(read_count(fd) == 0, "a reset counter reads 0");
+    close(fd);
+
+    fd = open_counter(PERF_COUNT_HW_CPU_CYCLES, 0, -1, false,
+                      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING);
+    report(fd >= 0, "open an enabled cycles counter with times");
+    work(10000000);
+    // across a context switch
+    usleep(1000);
+    work(10000000);
+    uint64_t values[3];
+    report(read(fd, values, sizeof(values)) == sizeof(values), "read count and times");
+    report(values[0] > 0 && values[1] > 0 && values[2] <= values[1],
+           "cycles are counted, running for at most the time enabled");
+    close(fd);
+
+    fd = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1, 0, false);
+    report(fd >= 0, "open a cycles counter of CPU 0");
+    usleep(10000);
+    report(read_count(fd) > 0, "CPU 0 has cycles counted");
+    close(fd);
+
+    fd = open_counter(PERF_COUNT_HW_CPU_CYCLES, 0, -1, false, 0, 100000);
+    report(fd < 0 && errno == EOPNOTSUPP, "sampling is not supported");
+    fd = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1, -1, false);
+    report(fd < 0 && errno == EINVAL, "a counter needs a thread or a CPU");
+
+    std::cout << "SUMMARY: " << tests << " tests, " << fails << " failures\n";
+    return fails == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Checks PLT binding from a profile: the entries a profile lists are bound
+// when libtst-plt-profile.so is loaded, the others are left to lazy binding,
+// and so is a listed symbol which cannot be resolved. Then, that a profile
+// recorded while using the library binds what was used on the next load.
+
+#include <osv/elf.hh>
+
+#include <dlfcn.h>
+#include <link.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+extern "C" void __elf_resolve_pltgot(void);
+
+static constexpr const char* lib_path = "/tests/libtst-plt-profile.so";
+static constexpr const char* hot_path = "/tmp/tst-plt-profile-hot";
+static constexpr const char* saved_path = "/tmp/tst-plt-profile-saved";
+
+static int tests = 0, fails = 0;
+
+static void report(bool ok, const char* msg)
+{
+    ++tests;
+    fails += !ok;
+    printf("%s: %s\n", (ok ? "PASS" : "FAIL"), msg);
+}
+
+// The library's PLT GOT, the GOT entry of each of its JUMP_SLOT relocations,
+// by symbol, and the extent of its mapping.
+struct plt_info {
+    void** pltgot = nullptr;
+    std::unordered_map<std::string, void**> slots;
+    uintptr_t start = UINTPTR_MAX;
+    uintptr_t end = 0;
+
+    bool lazy(const char* name) {
+        auto slot = reinterpret_cast<uintptr_t>(*slots[name]);
+        return slot >= start && slot < end &&
+               pltgot[2] == reinterpret_cast<void*>(__elf_resolve_pltgot);
+    }
+    bool bound(const char* name, void* addr) {
+        return *slots[name] == addr;
+    }
+};
+
+static int find_plt(struct dl_phdr_info* info, size_t, void* arg)
+{
+    if (strcmp(info->dlpi_name, lib_path) != 0) {
+        return 0;
+    }
+    auto plt = static_cast<plt_info*>(arg);
+    const ElfW(Dyn)* dyn = nullptr;
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        auto& ph = info->dlpi_phdr[i];
+        auto start = info->dlpi_addr + ph.p_vaddr;
+        if (ph.p_type == PT_LOAD) {
+            plt->start = std::min(plt->start, start);
+            plt->end = std::max(plt->end, start + ph.p_memsz);
+        } else if (ph.p_type == PT_DYNAMIC) {
+            dyn = reinterpret_cast<const ElfW(Dyn)*>(start);
+        }
+    }
+    if (!dyn) {
+        return 1;
+    }
+    ElfW(Addr) jmprel = 0, symtab = 0, strtab = 0, pltgot = 0;
+    size_t pltrelsz = 0;
+    for (; dyn->d_tag != DT_NULL; dyn++) {
+        switch (dyn->d_tag) {
+        case DT_JMPREL: jmprel = dyn->d_un.d_ptr; break;
+        case DT_PLTRELSZ: pltrelsz = dyn->d_un.d_val; break;
+        case DT_SYMTAB: symtab = dyn->d_un.d_ptr; break;
+        case DT_STRTAB: strtab = dyn->d_un.d_ptr; break;
+        case DT_PLTGOT: pltgot = dyn->d_un.d_ptr; break;
+        }
+    }
+    // Unlike OSv, some dynamic linkers relocate the d_ptr entries
+    auto relocated = [&] (ElfW(Addr) addr) {
+        return addr < info->dlpi_addr ? addr + info->dlpi_addr : addr;
+    };
+    auto rel = reinterpret_cast<const ElfW(Rela)*>(relocated(jmprel));
+    auto syms = reinterpret_cast<const ElfW(Sym)*>(relocated(symtab));
+    auto strs = reinterpret_cast<const char*>(relocated(strtab));
+    for (size_t i = 0; i < pltrelsz / sizeof(*rel); i++) {
+        auto name = strs + syms[ELF64_R_SYM(rel[i].r_info)].st_name;
+        plt->slots[name] = reinterpret_cast<void**>(info->dlpi_addr + rel[i].r_offset);
+    }
+    plt->pltgot = reinterpret_cast<void**>(relocated(pltgot));
+    return 1;
+}
+
+static bool load(void*& handle, plt_info& plt)
+{
+    handle = dlopen(lib_path, RTLD_LAZY);
+    if (!handle) {
+        return false;
+    }
+    plt = plt_info();
+    dl_iterate_phdr(find_plt, &plt);
+    return plt.pltgot && plt.slots.count("getpid") && plt.slots.count("getppid") &&
+           plt.slots.count("tst_plt_profile_missing");
+}
+
+static std::set<std::string> read_profile(const char* path)
+{
+    std::set<std::string> ret;
+    std::ifstream f(path);
+    std::string line;
+    while (std::getline(f, line)) {
+        ret.insert(line);
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    auto prog = elf::get_program();
+    {
+        std::ofstream f(hot_path, std::ios::trunc);
+        f << lib_path << " getpid\n";
+        f << lib_path << " tst_plt_profile_missing\n";
+    }
+    prog->bind_plt_profile(hot_path);
+    prog->record_plt_profile(saved_path);
+
+    void* handle;
+    plt_info plt;
+    if (!load(handle, plt)) {
+        report(false, "load library and find its PLT");
+        printf("SUMMARY: %d tests, %d failures\n", tests, fails);
+        return 1;
+    }
+    auto getpid_addr = reinterpret_cast<void*>(getpid);
+    auto getppid_addr = reinterpret_cast<void*>(getppid);
+    report(plt.bound("getpid", getpid_addr), "profiled entry bound at load");
+    report(plt.lazy("getppid"), "other entry left to lazy binding");
+    report(plt.lazy("tst_plt_profile_missing"), "unresolvable profiled entry left to lazy binding");
+
+    auto lib_lazy = reinterpret_cast<int (*)()>(dlsym(handle, "lib_lazy"));
+    report(lib_lazy && lib_lazy() == getppid(), "call through lazy entry");
+    report(plt.bound("getppid", getppid_addr), "lazy entry bound on first call");
+
+    prog->save_plt_profile();
+    auto saved = read_profile(saved_path);
+    report(saved.count(std::string(lib_path) + " getpid"), "profile keeps entry bound from profile");
+    report(saved.count(std::string(lib_path) + " getppid"), "profile records lazily bound entry");
+    report(!saved.count(std::string(lib_path) + " tst_plt_profile_missing"),
+           "profile drops unresolvable entry");
+    dlclose(handle);
+
+    prog->bind_plt_profile(saved_path);
+    if (load(handle, plt)) {
+        report(plt.bound("getpid", getpid_addr) && plt.bound("getppid", getppid_addr),
+               "recorded entries bound at next load");
+        report(plt.lazy("tst_plt_profile_missing"), "unprofiled entry left to lazy binding at next load");
+        dlclose(handle);
+    } else {
+        report(false, "load library again");
+    }
+
+    unlink(hot_path);
+    unlink(saved_path);
+
+    printf("SUMMARY: %d tests, %d failures\n", tests, fails);
+    return fails == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Checks relative relocations are applied correctly. This is built as a PIE
+// twice: once with packed (DT_RELR) relative relocations, and once with
+// plain DT_RELA ones. The tables are large enough for the dynamic linker to
+// relocate them in parallel either way.
+
+#include <osv/elf.hh>
+#include <osv/sched.hh>
+
+#include <link.h>
+#include <stdio.h>
+
+#ifndef DT_RELR
+#define DT_RELRSZ 35
+#define DT_RELR 36
+#endif
+
+static char data[4096];
+
+static constexpr int counter_base = __COUNTER__;
+#define E &data[(__COUNTER__ - counter_base - 1) % sizeof(data)],
+#define E4 E E E E
+#define E16 E4 E4 E4 E4
+#define E64 E16 E16 E16 E16
+#define E256 E64 E64 E64 E64
+#define E1K E256 E256 E256 E256
+#define E4K E1K E1K E1K E1K
+#define E16K E4K E4K E4K E4K
+#define E64K E16K E16K E16K E16K
+
+// Runs of relocated words separated by gaps of far more than the 63 words
+// a bitmap entry covers, so that the packed encoding needs an address entry
+// for each run. The gaps are initialized so that all of it stays in .data.
+static struct {
+    char* table[128 * 1024];
+    long gap[1000];
+    char* table2[80 * 1024 + 4];
+    long gap2[1000];
+    char* table3[4];
+} tables = {
+    { E64K E64K },
+    { 1 },
+    { E64K E16K E4 },
+    { 2 },
+    { E4 },
+};
+
+static bool check(char** t, unsigned n)
+{
+    auto first = t[0] - data;
+    for (unsigned i = 0; i < n; i++) {
+        if (t[i] != &data[(first + i) % sizeof(data)]) {
+            printf("entry %u: %p, expected %p\n", i, t[i], &data[(first + i) % sizeof(data)]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_gap(long* gap, unsigned n, long value)
+{
+    if (gap[0] != value) {
+        return false;
+    }
+    for (unsigned i = 1; i < n; i++) {
+        if (gap[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the number of address entries in this object's DT_RELR table,
+// or -1 if it has none.
+static int relr_address_entries()
+{
+    int ret = -1;
+    dl_iterate_phdr([] (struct dl_phdr_info* info, size_t, void* arg) {
+        auto self = reinterpret_cast<ElfW(Addr)>(&tables);
+        const ElfW(Dyn)* dyn = nullptr;
+        bool mine = false;
+        for (int i = 0; i < info->dlpi_phnum; i++) {
+            auto& ph = info->dlpi_phdr[i];
+            auto start = info->dlpi_addr + ph.p_vaddr;
+            if (ph.p_type == PT_LOAD && self >= start && self < start + ph.p_memsz) {
+                mine = true;
+            } else if (ph.p_type == PT_DYNAMIC) {
+                dyn = reinterpret_cast<const ElfW(Dyn)*>(start);
+            }
+        }
+        if (!mine || !dyn) {
+            return 0;
+        }
+        ElfW(Addr) relr = 0;
+        size_t size = 0;
+        for (; dyn->d_tag != DT_NULL; dyn++) {
+            if (dyn->d_tag == DT_RELR) {
+                relr = dyn->d_un.d_ptr;
+            } else if (dyn->d_tag == DT_RELRSZ) {
+                size = dyn->d_un.d_val;
+            }
+        }
+        if (relr) {
+            // Unlike OSv, some dynamic linkers relocate the d_ptr entries
+            if (relr < info->dlpi_addr) {
+                relr += info->dlpi_addr;
+            }
+            auto p = reinterpret_cast<const u64*>(relr);
+            int n = 0;
+            for (size_t i = 0; i < size / sizeof(u64); i++) {
+                n += (p[i] & 1) == 0;
+            }
+            *static_cast<int*>(arg) = n;
+        }
+        return 1;
+    }, &ret);
+    return ret;
+}
+
+int main()
+{
+    bool ok = check(tables.table, sizeof(tables.table) / sizeof(tables.table[0]));
+    ok &= check_gap(tables.gap, sizeof(tables.gap) / sizeof(tables.gap[0]), 1);
+    ok &= check(tables.table2, sizeof(tables.table2) / sizeof(tables.table2[0]));
+    ok &= check_gap(tables.gap2, sizeof(tables.gap2) / sizeof(tables.gap2[0]), 2);
+    ok &= check(tables.table3, sizeof(tables.table3) / sizeof(tables.table3[0]));
+
+    auto n = relr_address_entries();
+    if (n >= 0) {
+        printf("DT_RELR has %d address entries\n", n);
+        if (n < 3) {
+            printf("expected an address entry per table\n");
+            ok = false;
+        }
+        if (sched::cpus.size() > 1 &&
+                elf::get_program()->get_load_stats().relr_sliced == 0) {
+            printf("DT_RELR was not relocated in parallel\n");
+            ok = false;
+        }
+    }
+    printf("%s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -9,6 +9,22 @@
 #include <chrono>
 #include <thread>
 #include <iostream>
+#include <sstream>
+#include <cassert>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Exported (and built with frame pointers) so that the profiler can walk
+// into it and symbolize it, see modules/tests/Makefile
+extern "C" void __attribute__((noinline, noclone, used))
+tst_sampler_spin(long ms)
+{
+    auto duration = std::chrono::milliseconds(ms);
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+        asm volatile("" ::: "memory");
+    }
+}
 
 int main(int argc, char const *argv[])
 {
@@ -30,6 +46,25 @@ int main(int argc, char const *argv[])
     std::cout << "Stopping" << std::endl;
     prof::stop_sampler();
 
+    std::cout << "Profiling" << std::endl;
+    prof::profiler_config pconfig;
+    pconfig.period = std::chrono::milliseconds(1);
+    pconfig.threads.push_back(syscall(SYS_gettid));
+    prof::start_profiler(pconfig);
+    assert(prof::profiler_running());
+
+    tst_sampler_spin(200);
+
+    std::ostringstream folded;
+    prof::write_folded_stacks(folded, true);
+    prof::stop_profiler();
+    assert(!prof::profiler_running());
+    assert(folded.str().find("tst_sampler_spin") != std::string::npos);
+
+    std::ostringstream empty;
+    prof::write_folded_stacks(empty);
+    assert(empty.str().empty());
+
     std::cout << "Done" << std::endl;
     return 0;
 }
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#define BOOST_TEST_MODULE tst-tcp-reuseport
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <boost/test/unit_test.hpp>
+
+#define LISTEN_PORT 7778
+
+static int reuseport_listener()
+{
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE(s > 0);
+
+    int one = 1;
+    BOOST_REQUIRE(setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0);
+
+    struct sockaddr_in laddr = {};
+    laddr.sin_family = AF_INET;
+    laddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    laddr.sin_port = htons(LISTEN_PORT);
+    BOOST_REQUIRE(bind(s, (struct sockaddr *) &laddr, sizeof(laddr)) == 0);
+    BOOST_REQUIRE(listen(s, SOMAXCONN) == 0);
+    BOOST_REQUIRE(fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK) == 0);
+    return s;
+}
+
+static int drain(int listener)
+{
+    int n = 0;
+    int s;
+    while ((s = accept(listener, NULL, NULL)) >= 0) {
+        close(s);
+        n++;
+    }
+    BOOST_REQUIRE(errno == EAGAIN || errno == EWOULDBLOCK);
+    return n;
+}
+
+// The final ACK of the handshake may still be in flight when connect()
+// returns, so keep accepting until all expected connections show up.
+static std::vector<int> accept_all(const std::vector<int>& listeners, int expected)
+{
+    std::vector<int> accepted(listeners.size());
+    int total = 0;
+    for (int retry = 0; retry < 500 && total < expected; retry++) {
+        for (size_t i = 0; i < listeners.size(); i++) {
+            int n = drain(listeners[i]);
+            accepted[i] += n;
+            total += n;
+        }
+        if (total < expected) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    BOOST_REQUIRE_EQUAL(total, expected);
+    return accepted;
+}
+
+static int connect_to_listeners()
+{
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE(s > 0);
+
+    struct sockaddr_in raddr = {};
+    raddr.sin_family = AF_INET;
+    inet_aton("127.0.0.1", &raddr.sin_addr);
+    raddr.sin_port = htons(LISTEN_PORT);
+    BOOST_REQUIRE(connect(s, (struct sockaddr *) &raddr, sizeof(raddr)) == 0);
+    return s;
+}
+
+BOOST_AUTO_TEST_CASE(test_connections_are_spread_across_reuseport_listeners)
+{
+    constexpr int n_listeners = 4;
+    constexpr int n_connections = 64;
+
+    std::vector<int> listeners;
+    for (int i = 0; i < n_listeners; i++) {
+        listeners.push_back(reuseport_listener());
+    }
+
+    std::vector<int> clients;
+    for (int i = 0; i < n_connections; i++) {
+        clients.push_back(connect_to_listeners());
+    }
+
+    auto accepted = accept_all(listeners, n_connections);
+    for (size_t i = 0; i < listeners.size(); i++) {
+        BOOST_TEST_MESSAGE("listener " << i << " accepted " << accepted[i]);
+        BOOST_CHECK(accepted[i] > 0);
+    }
+
+    // Once a member leaves the group, the remaining ones take all the load
+    close(listeners.back());
+    listeners.pop_back();
+
+    clients.push_back(connect_to_listeners());
+    accept_all(listeners, 1);
+
+    for (auto c : clients) {
+        close(c);
+    }
+    for (auto l : listeners) {
+        close(l);
+    }
+}
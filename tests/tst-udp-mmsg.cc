@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#define BOOST_TEST_MODULE tst-udp-mmsg
+
+#include <vector>
+#include <string>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <boost/test/unit_test.hpp>
+
+#define LISTEN_PORT 7779
+#define NMSGS 16
+
+static int udp_socket(int port)
+{
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    BOOST_REQUIRE(s > 0);
+
+    if (port) {
+        struct sockaddr_in laddr = {};
+        laddr.sin_family = AF_INET;
+        laddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        laddr.sin_port = htons(port);
+        BOOST_REQUIRE(bind(s, (struct sockaddr *) &laddr, sizeof(laddr)) == 0);
+    }
+    return s;
+}
+
+BOOST_AUTO_TEST_CASE(test_sendmmsg_recvmmsg)
+{
+    int rx = udp_socket(LISTEN_PORT);
+    int tx = udp_socket(0);
+
+    struct sockaddr_in raddr = {};
+    raddr.sin_family = AF_INET;
+    raddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    raddr.sin_port = htons(LISTEN_PORT);
+
+    std::vector<std::string> payloads;
+    std::vector<struct iovec> tx_iov(NMSGS);
+    std::vector<struct mmsghdr> tx_msgs(NMSGS);
+    for (int i = 0; i < NMSGS; i++) {
+        payloads.push_back("datagram-" + std::to_string(i));
+    }
+    for (int i = 0; i < NMSGS; i++) {
+        tx_iov[i].iov_base = &payloads[i][0];
+        tx_iov[i].iov_len = payloads[i].size();
+        tx_msgs[i] = {};
+        tx_msgs[i].msg_hdr.msg_name = &raddr;
+        tx_msgs[i].msg_hdr.msg_namelen = sizeof(raddr);
+        tx_msgs[i].msg_hdr.msg_iov = &tx_iov[i];
+        tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    BOOST_REQUIRE_EQUAL(sendmmsg(tx, tx_msgs.data(), NMSGS, 0), NMSGS);
+    for (int i = 0; i < NMSGS; i++) {
+        BOOST_CHECK_EQUAL(tx_msgs[i].msg_len, payloads[i].size());
+    }
+
+    // Receive everything in two calls, the second one asking for more
+    // datagrams than are queued
+    std::vector<std::vector<char>> bufs(NMSGS + 4, std::vector<char>(64));
+    std::vector<struct iovec> rx_iov(bufs.size());
+    std::vector<struct sockaddr_in> from(bufs.size());
+    std::vector<struct mmsghdr> rx_msgs(bufs.size());
+    for (size_t i = 0; i < bufs.size(); i++) {
+        rx_iov[i].iov_base = bufs[i].data();
+        rx_iov[i].iov_len = bufs[i].size();
+        rx_msgs[i] = {};
+        rx_msgs[i].msg_hdr.msg_name = &from[i];
+        rx_msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+        rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int first = recvmmsg(rx, rx_msgs.data(), NMSGS / 2, 0, NULL);
+    BOOST_REQUIRE_EQUAL(first, NMSGS / 2);
+    int second = recvmmsg(rx, rx_msgs.data() + first, rx_msgs.size() - first,
+            MSG_WAITFORONE, NULL);
+    BOOST_REQUIRE_EQUAL(second, NMSGS - first);
+
+    for (int i = 0; i < NMSGS; i++) {
+        BOOST_CHECK_EQUAL(std::string(bufs[i].data(), rx_msgs[i].msg_len),
+                payloads[i]);
+        BOOST_CHECK_EQUAL(rx_msgs[i].msg_hdr.msg_namelen, sizeof(from[i]));
+        BOOST_CHECK_EQUAL(from[i].sin_family, AF_INET);
+        BOOST_CHECK_EQUAL(from[i].sin_addr.s_addr, htonl(INADDR_LOOPBACK));
+    }
+
+    // Nothing left: a non-blocking call fails rather than returning 0
+    BOOST_REQUIRE_EQUAL(recvmmsg(rx, rx_msgs.data(), 1, MSG_DONTWAIT, NULL), -1);
+    BOOST_REQUIRE(errno == EAGAIN || errno == EWOULDBLOCK);
+
+    close(tx);
+    close(rx);
+}
+
+BOOST_AUTO_TEST_CASE(test_recvmmsg_truncates_each_datagram)
+{
+    int rx = udp_socket(LISTEN_PORT);
+    int tx = udp_socket(0);
+
+    struct sockaddr_in raddr = {};
+    raddr.sin_family = AF_INET;
+    raddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    raddr.sin_port = htons(LISTEN_PORT);
+
+    const char big[] = "0123456789abcdef";
+    for (int i = 0; i < 2; i++) {
+        BOOST_REQUIRE(sendto(tx, big, sizeof(big), 0,
+                (struct sockaddr *) &raddr, sizeof(raddr)) == sizeof(big));
+    }
+
+    char bufs[2][4];
+    struct iovec iov[2] = {{bufs[0], sizeof(bufs[0])}, {bufs[1], sizeof(bufs[1])}};
+    struct mmsghdr msgs[2] = {};
+    for (int i = 0; i < 2; i++) {
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    struct timespec timeout = {1, 0};
+    BOOST_REQUIRE_EQUAL(recvmmsg(rx, msgs, 2, 0, &timeout), 2);
+    for (int i = 0; i < 2; i++) {
+        BOOST_CHECK_EQUAL(msgs[i].msg_len, sizeof(bufs[i]));
+        BOOST_CHECK(msgs[i].msg_hdr.msg_flags & MSG_TRUNC);
+        BOOST_CHECK(memcmp(bufs[i], big, sizeof(bufs[i])) == 0);
+    }
+
+    close(tx);
+    close(rx);
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Checks that the ZFS prefetcher sizes its distance after the read latency:
+// a reader going at the same pace gets a long distance when reads are slow,
+// and a short one when they are fast. The latency is fed to the prefetcher
+// directly, so that the test doesn't depend on the disk's speed.
+
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+extern "C" void dmu_zfetch_read_latency(long long latency);
+
+// See bsd/sys/sys/filio.h, which uses the BSD ioctl encoding
+struct fiozfetchstats {
+    uint64_t fzs_hits;
+    uint64_t fzs_misses;
+    uint64_t fzs_prefetched;
+    uint64_t fzs_streams;
+    uint64_t fzs_distance;
+};
+#define FIOZFETCHSTATS (0x40000000UL | (sizeof(fiozfetchstats) << 16) | ('f' << 8) | 99)
+
+static constexpr size_t block_size = 128 * 1024;
+static constexpr unsigned nblocks = 64;
+static constexpr auto read_interval = std::chrono::milliseconds(4);
+
+static int tests = 0, fails = 0;
+
+static void report(bool ok, const char* msg)
+{
+    ++tests;
+    fails += !ok;
+    printf("%s: %s\n", (ok ? "PASS" : "FAIL"), msg);
+}
+
+static bool make_file(const char* path)
+{
+    auto fd = open(path, O_CREAT|O_TRUNC|O_WRONLY, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    std::vector<char> buf(block_size, 'z');
+    for (unsigned i = 0; i < nblocks; i++) {
+        if (write(fd, buf.data(), buf.size()) != ssize_t(buf.size())) {
+            close(fd);
+            return false;
+        }
+    }
+    fsync(fd);
+    close(fd);
+    return true;
+}
+
+// Reads path sequentially, one block every read_interval, while telling the
+// prefetcher reads take latency_ns, and returns the prefetch distance it
+// ended up with, or -1 if the file has no prefetch statistics.
+static long read_with_latency(const char* path, long long latency_ns)
+{
+    auto fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    std::vector<char> buf(block_size);
+    for (unsigned i = 0; i < nblocks; i++) {
+        // enough samples to outweigh those of actual reads in the average
+        for (int j = 0; j < 64; j++) {
+            dmu_zfetch_read_latency(latency_ns);
+        }
+        if (pread(fd, buf.data(), buf.size(), off_t(i) * block_size) != ssize_t(buf.size())) {
+            close(fd);
+            return -1;
+        }
+        std::this_thread::sleep_for(read_interval);
+    }
+    fiozfetchstats fzs;
+    memset(&fzs, 0, sizeof(fzs));
+    auto ret = ioctl(fd, FIOZFETCHSTATS, &fzs);
+    close(fd);
+    if (ret < 0) {
+        return -1;
+    }
+    printf("%s: latency %lldns, %lu hits, %lu misses, distance %lu blocks\n",
+            path, latency_ns, fzs.fzs_hits, fzs.fzs_misses, fzs.fzs_distance);
+    return fzs.fzs_distance;
+}
+
+int main(int argc, char *argv[])
+{
+    const char* slow = "/tst-zfetch-slow";
+    const char* fast = "/tst-zfetch-fast";
+    if (!make_file(slow) || !make_file(fast)) {
+        printf("SKIP: cannot create the test files\n");
+        return 0;
+    }
+
+    // With reads taking 50ms and a block consumed every 4ms, the prefetcher
+    // should stay about 2 * 50 / 4 = 25 blocks ahead...
+    auto slow_distance = read_with_latency(slow, 50 * 1000 * 1000);
+    if (slow_distance < 0) {
+        printf("SKIP: not a ZFS file system\n");
+        unlink(slow);
+        unlink(fast);
+        return 0;
+    }
+    report(slow_distance >= 16, "long prefetch distance with slow reads");
+
+    // ... and with reads taking a microsecond, it shouldn't prefetch beyond
+    // the block being read.
+    auto fast_distance = read_with_latency(fast, 1000);
+    report(fast_distance >= 0 && fast_distance <= 4, "short prefetch distance with fast reads");
+    report(fast_distance < slow_distance, "prefetch distance follows read latency");
+
+    unlink(slow);
+    unlink(fast);
+
+    printf("SUMMARY: %d tests, %d failures\n", tests, fails);
+    return fails == 0 ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Checks synchronous writes committed concurrently to the ZFS intent log,
+// with fsync() or O_DSYNC, from several threads at once, to files of their
+// own and to a shared one. The data must all be there after a remount.
+
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <osv/run.hh>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+int sys_mount(const char *dev, const char *dir, const char *fsname, int flags, const void *data);
+int sys_umount(const char *path);
+}
+
+static constexpr const char* dataset = "osv/tst-zil-commit";
+static constexpr const char* mount_point = "/tst-zil-commit";
+static constexpr unsigned nthreads = 8;
+static constexpr unsigned nrecords = 64;
+static constexpr size_t record_size = 4096;
+
+static int tests = 0, fails = 0;
+
+static void report(bool ok, const char* msg)
+{
+    ++tests;
+    fails += !ok;
+    printf("%s: %s\n", (ok ? "PASS" : "FAIL"), msg);
+}
+
+static bool zfs(std::vector<std::string> args)
+{
+    int ret;
+    args.insert(args.begin(), "zfs");
+    return osv::run("/zfs.so", args, &ret) && ret == 0;
+}
+
+static std::string own_file(unsigned thread)
+{
+    return std::string(mount_point) + "/file" + std::to_string(thread);
+}
+
+static std::string shared_file()
+{
+    return std::string(mount_point) + "/shared";
+}
+
+static void fill(char* buf, unsigned thread, unsigned record)
+{
+    for (size_t i = 0; i < record_size; i++) {
+        buf[i] = char(thread * 31 + record * 7 + i);
+    }
+}
+
+// Even threads fsync() after each write, odd ones use O_DSYNC. Each also
+// writes its records to the shared file, at offsets of its own.
+static void writer(unsigned thread, std::atomic<bool>& ok)
+{
+    int flags = O_CREAT|O_TRUNC|O_WRONLY | (thread % 2 ? O_DSYNC : 0);
+    auto fd = open(own_file(thread).c_str(), flags, 0666);
+    auto shared = open(shared_file().c_str(), O_WRONLY | (thread % 2 ? O_DSYNC : 0));
+    if (fd < 0 || shared < 0) {
+        ok = false;
+        return;
+    }
+    char buf[record_size];
+    for (unsigned r = 0; r < nrecords; r++) {
+        fill(buf, thread, r);
+        if (write(fd, buf, sizeof(buf)) != sizeof(buf) ||
+                pwrite(shared, buf, sizeof(buf), off_t(r * nthreads + thread) * record_size) != sizeof(buf)) {
+            ok = false;
+            break;
+        }
+        if (thread % 2 == 0 && (fsync(fd) != 0 || fsync(shared) != 0)) {
+            ok = false;
+            break;
+        }
+    }
+    close(fd);
+    close(shared);
+}
+
+static bool check_record(int fd, off_t offset, unsigned thread, unsigned record)
+{
+    char buf[record_size], expected[record_size];
+    fill(expected, thread, record);
+    return pread(fd, buf, sizeof(buf), offset) == sizeof(buf) &&
+           memcmp(buf, expected, sizeof(buf)) == 0;
+}
+
+static bool check_files()
+{
+    auto shared = open(shared_file().c_str(), O_RDONLY);
+    if (shared < 0) {
+        return false;
+    }
+    bool ok = true;
+    for (unsigned t = 0; ok && t < nthreads; t++) {
+        auto fd = open(own_file(t).c_str(), O_RDONLY);
+        if (fd < 0) {
+            ok = false;
+            break;
+        }
+        for (unsigned r = 0; ok && r < nrecords; r++) {
+            ok = check_record(fd, off_t(r) * record_size, t, r) &&
+                 check_record(shared, off_t(r * nthreads + t) * record_size, t, r);
+            if (!ok) {
+                printf("thread %u: record %u is wrong\n", t, r);
+            }
+        }
+        close(fd);
+    }
+    close(shared);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (access("/zfs.so", X_OK) != 0 || !zfs({"create", "-o", "mountpoint=none", dataset})) {
+        printf("SKIP: cannot create a ZFS dataset\n");
+        return 0;
+    }
+    mkdir(mount_point, 0755);
+    report(sys_mount("", mount_point, "zfs", 0, dataset) == 0, "mount dataset");
+
+    auto fd = open(shared_file().c_str(), O_CREAT|O_TRUNC|O_WRONLY, 0666);
+    report(fd >= 0 && close(fd) == 0, "create shared file");
+
+    std::atomic<bool> ok(true);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < nthreads; t++) {
+        threads.emplace_back([t, &ok] { writer(t, ok); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    report(ok, "concurrent synchronous writes");
+    report(check_files(), "data is there before remount");
+
+    report(sys_umount(mount_point) == 0, "unmount dataset");
+    report(sys_mount("", mount_point, "zfs", 0, dataset) == 0, "mount dataset again");
+    report(check_files(), "data is there after remount");
+
+    report(sys_umount(mount_point) == 0, "unmount dataset");
+    rmdir(mount_point);
+    report(zfs({"destroy", dataset}), "destroy dataset");
+
+    printf("SUMMARY: %d tests, %d failures\n", tests, fails);
+    return fails == 0 ? 0 : 1;
+}
@@ -25,8 +25,8 @@ static void run_cmd(const char *cmdpath, vector<string> args)
     assert(ok && ret == 0);
 }
 
-// Get extra blk devices for pool creation.
-static void get_blk_devices(vector<string> &zpool_args)
+// Get extra blk devices for pool creation, other than the log device.
+static void get_blk_devices(vector<string> &zpool_args, const string& log_device)
 {
     DIR *dir;
     struct dirent *entry;
@@ -45,13 +45,18 @@ static void get_blk_devices(vector<string> &zpool_args)
             continue;
         }
 
-        zpool_args.push_back("/dev/" + string(entry->d_name));
+        auto dev = "/dev/" + string(entry->d_name);
+        if (dev == log_device) {
+            continue;
+        }
+
+        zpool_args.push_back(dev);
     }
 
     closedir(dir);
 }
 
-static void mkfs(void)
+static void mkfs(const string& compression, const string& log_device)
 {
     // Create zfs device, then /etc/mnttab which is required by libzfs
     zfsdev::zfsdev_init();
@@ -65,7 +70,13 @@ static void mkfs(void)
     vector<string> zpool_args = {"zpool", "create", "-f", "-R", "/zfs", "osv",
         "/dev/vblk0.1"};
 
-    get_blk_devices(zpool_args);
+    get_blk_devices(zpool_args, log_device);
+
+    // Keep the intent log on a device of its own, if given one
+    if (!log_device.empty()) {
+        zpool_args.push_back("log");
+        zpool_args.push_back(log_device);
+    }
 
     // Create zpool named osv
     run_cmd("/zpool.so", zpool_args);
@@ -77,15 +88,27 @@ static void mkfs(void)
     run_cmd("/zfs.so", {"zfs", "set", "canmount=noauto", "osv"});
     run_cmd("/zfs.so", {"zfs", "set", "canmount=noauto", "osv/zfs"});
 
-    // Enable lz4 compression on the created zfs dataset
+    // Enable compression on the created zfs dataset, lz4 by default
     // NOTE: Compression is disabled after image creation.
-    run_cmd("/zfs.so", {"zfs", "set", "compression=lz4", "osv"});
+    run_cmd("/zfs.so", {"zfs", "set", "compression=" + compression, "osv"});
 }
 
+// Usage: mkfs.so [compression] [--log <device>]
 int main(int ac, char** av)
 {
+    string compression = "lz4";
+    string log_device;
+
+    for (int i = 1; i < ac; i++) {
+        if (!strcmp(av[i], "--log") && i + 1 < ac) {
+            log_device = av[++i];
+        } else {
+            compression = av[i];
+        }
+    }
+
     cout << "Running mkfs...\n";
-    mkfs();
+    mkfs(compression, log_device);
     sync();
     return 0;
 }